@@ -0,0 +1,72 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "5thdbuffer.h"
+#include "5thdlfbuffer.h"
+
+/**
+ * ManagedBuffer (mutex) vs LockFreeManagedBuffer (Treiber list, with and without per-thread magazines).
+ * Every thread does get_slot + touch + release_slot in a loop, the same pattern as ZMQWTransmitter::_send.
+ */
+
+constexpr size_t SLOTS = 64;
+constexpr size_t OPS_PER_THREAD = 1000000;
+
+struct Payload {
+    char data[64];
+};
+
+static void init_payload(Payload& p) {
+    p.data[0] = 0;
+}
+
+static void deinit_payload(Payload& p) {
+    p.data[0] = 0;
+}
+
+template <typename Buffer>
+double run(size_t num_threads) {
+    Buffer buffer(init_payload, deinit_payload);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&buffer, &go] {
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                auto slot = buffer.get_slot();
+                if (!slot) {
+                    continue;
+                }
+                slot->data[0] = static_cast<char>(i);
+                buffer.release_slot(&slot);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (num_threads * OPS_PER_THREAD) / elapsed / 1e6;
+}
+
+int main() {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+
+    printf("%-8s %16s %16s %16s\n", "threads", "mutex Mops/s", "lockfree Mops/s", "lf+mag Mops/s");
+    for (size_t threads : {1, 2, 4, 8, 16}) {
+        double locked = run<ManagedBuffer<Payload, SLOTS>>(threads);
+        double lock_free = run<LockFreeManagedBuffer<Payload, SLOTS>>(threads);
+        double magazine = run<LockFreeManagedBuffer<Payload, SLOTS, 8>>(threads);
+        printf("%-8zu %16.2f %16.2f %16.2f\n", threads, locked, lock_free, magazine);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <zmq.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "5thdipcmsg.h"
+#include "bus_trace.h"
+#include "izmq.h"
+#include "receiver.h"
+#include "software_bus.h"
+#include "transmitter.h"
+
+/**
+ * ZMQBus routing throughput with 2..32 concurrent dealers.
+ * Every dealer registers a dynamic client id and sends ipc_msg_t to itself through the bus.
+ * Usage: 5thDBusRoutingBench [workers], 1 (default) is the single threaded bus.
+ * FIFTHD_BUS_TRACE=1 turns per message tracing on, compare with and without it for the tracing cost.
+ * @note Results go to stderr, redirect stdout when tracing is on.
+ */
+
+constexpr size_t MESSAGES_PER_DEALER = 20000;
+constexpr size_t WINDOW = 64;
+
+static void dealer(IContext* ctx, int client_id, std::atomic<bool>* go) {
+    char identity[16];
+    snprintf(identity, sizeof(identity), "dealer%03d", client_id);
+    ZMQWSocket sock(ctx, ZMQ_DEALER);
+    ZMQWTransmitter trans(ctx, &sock, identity);
+    trans.connect(IPC_ENDPOINT, 0);
+
+    ipc_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.src_id = client_id;
+    msg.dist_id = client_id;
+
+    auto recv_reply = [&sock] {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        do {
+            zmq_msg_recv(&frame, sock.get_socket(), 0);
+        } while (zmq_msg_more(&frame));
+        zmq_msg_close(&frame);
+    };
+
+    // First message registers the route
+    trans.send(&msg, sizeof(msg));
+    recv_reply();
+
+    while (!go->load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    size_t in_flight = 0;
+    for (size_t i = 0; i < MESSAGES_PER_DEALER; ++i) {
+        trans.send(&msg, sizeof(msg));
+        if (++in_flight == WINDOW) {
+            recv_reply();
+            in_flight--;
+        }
+    }
+    while (in_flight--) {
+        recv_reply();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+    const char* trace = getenv("FIFTHD_BUS_TRACE");
+    BusTrace::set_enabled(trace && trace[0] == '1');
+
+    size_t workers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1;
+
+    ZMQWContext ctx;
+    ZMQWSocket router(&ctx, ZMQ_ROUTER);
+    ZMQWReceiver recv("bench", 0, &ctx, &router);
+    ZMQBus bus(&recv, &ctx, workers);
+    std::thread bus_thread([&bus] { bus.run(); });
+
+    fprintf(stderr, "bus workers: %zu\n", workers);
+    fprintf(stderr, "%-8s %14s\n", "dealers", "routed msg/s");
+    int next_id = 100;
+    for (size_t dealers : {2, 4, 8, 16, 32}) {
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < dealers; ++i) {
+            threads.emplace_back(dealer, &ctx, next_id++, &go);
+        }
+        // let every dealer register before timing
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "%-8zu %14.0f\n", dealers, dealers * MESSAGES_PER_DEALER / elapsed);
+    }
+
+    auto stats = bus.worker_stats();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        fprintf(stderr, "worker %-3zu handled %10llu max queue depth %6llu\n", i,
+                static_cast<unsigned long long>(stats[i].handled),
+                static_cast<unsigned long long>(stats[i].max_queue_depth));
+    }
+
+    ZMQBus::signal_handler(SIGINT);
+    bus_thread.join();
+    return 0;
+}
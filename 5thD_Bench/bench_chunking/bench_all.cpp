@@ -0,0 +1,91 @@
+#include <zmq.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "izmq.h"
+#include "transmitter.h"
+
+/**
+ * ZMQWTransmitter::send throughput per ChunkPolicy over inproc DEALER -> ROUTER.
+ * Use the table to pick a policy per deployment (payload mix and SNDHWM).
+ */
+
+constexpr const char* ENDPOINT = "inproc://bench_chunking";
+constexpr size_t TOTAL_BYTES_PER_RUN = 64u << 20;
+
+struct Case {
+    const char* name;
+    ChunkPolicy policy;
+};
+
+static size_t drain(void* router, size_t messages) {
+    size_t frames = 0;
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    for (size_t i = 0; i < messages; ++i) {
+        do {
+            zmq_msg_recv(&frame, router, 0);
+            frames++;
+        } while (zmq_msg_more(&frame));
+    }
+    zmq_msg_close(&frame);
+    return frames;
+}
+
+int main() {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+
+    const std::vector<size_t> payloads = {302, 4u << 10, 64u << 10, 1u << 20, 16u << 20};
+    const std::vector<Case> cases = {
+        {"fixed/302", {ChunkMode::FIXED, sizeof(ipc_msg_t), 0}},
+        {"fixed/64K", {ChunkMode::FIXED, 64u << 10, 0}},
+        {"single", {ChunkMode::SINGLE_FRAME, 0, 0}},
+        {"adaptive/1M", {ChunkMode::ADAPTIVE, 0, 1u << 20}},
+    };
+
+    auto data = std::make_unique<char[]>(payloads.back());
+    memset(data.get(), 0x5A, payloads.back());
+
+    ZMQWContext ctx;
+    ZMQWSocket router(&ctx, ZMQ_ROUTER);
+    ZMQWSocket dealer(&ctx, ZMQ_DEALER);
+    zmq_bind(router.get_socket(), ENDPOINT);
+
+    ZMQWTransmitter trans(&ctx, &dealer, "benchtx");
+    trans.connect(ENDPOINT, 0);
+
+    printf("%-12s", "payload");
+    for (const auto& c : cases) {
+        printf(" %14s", c.name);
+    }
+    printf("   (MiB/s, frames/msg)\n");
+
+    for (size_t payload : payloads) {
+        printf("%-12zu", payload);
+        size_t messages = std::max<size_t>(TOTAL_BYTES_PER_RUN / payload, 16);
+        for (const auto& c : cases) {
+            trans.set_chunk_policy(c.policy);
+            size_t frames = 0;
+            std::thread receiver([&] { frames = drain(router.get_socket(), messages); });
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < messages; ++i) {
+                trans.send(data.get(), payload);
+            }
+            receiver.join();
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // routing id + identity + empty are framing, not payload
+            double payload_frames = double(frames) / messages - 3;
+            printf(" %8.1f/%-5.0f", (messages * payload) / elapsed / (1024.0 * 1024.0), payload_frames);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+#include "db_executor.h"
+#include "keys_db.h"
+
+/**
+ * What a network thread pays for database work. Another connection keeps taking the write lock
+ * for HOLD_MS at a time (a checkpoint, a long import ...):
+ * - sync: the thread calls store_key itself and sits in busy_timeout behind that lock.
+ * - async: the thread hands the write to DbExecutor and moves on, the executor waits instead.
+ * Then LOOKUPS get_key reads, sync one by one vs submitted to the executor and batched.
+ * Usage: 5thDDbExecutorBench [db_path]
+ */
+
+constexpr int WRITES = 200;
+constexpr int HOLD_MS = 20;
+constexpr int NUM_KEYS = 1000;
+constexpr int LOOKUPS = 20000;
+
+using Clock = std::chrono::steady_clock;
+
+static std::string key_name(int i) {
+    return "key" + std::to_string(i);
+}
+
+static double us(Clock::duration elapsed) {
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+struct CallerTime {
+    double mean_us = 0;
+    double max_us = 0;
+    double total_ms = 0;
+};
+
+template <typename Write>
+static CallerTime with_lock_holder(const std::string& path, Write write) {
+    std::atomic<bool> stop{false};
+    std::thread holder([&path, &stop]() {
+        DatabaseAccess other(path);
+        while (!stop.load()) {
+            other.exec("BEGIN IMMEDIATE;");
+            std::this_thread::sleep_for(std::chrono::milliseconds(HOLD_MS));
+            other.exec("COMMIT;");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    CallerTime time;
+    auto start = Clock::now();
+    for (int i = 0; i < WRITES; ++i) {
+        auto call = Clock::now();
+        write(i);
+        double elapsed = us(Clock::now() - call);
+        time.mean_us += elapsed / WRITES;
+        time.max_us = std::max(time.max_us, elapsed);
+    }
+    time.total_ms = us(Clock::now() - start) / 1000.0;
+    stop.store(true);
+    holder.join();
+    return time;
+}
+
+int main(int argc, char** argv) {
+    Log::init();
+    Log::get_logger()->set_level(spdlog::level::err);
+
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench_exec.db").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup, the bench applies its own
+    std::ofstream(path).close();
+
+    {
+        DatabaseAccess db(path);
+        if (db.add_scheme(KEYS_SCHEME_PATH).is_err()) {
+            fprintf(stderr, "Failed to apply %s\n", KEYS_SCHEME_PATH);
+            return 1;
+        }
+        std::vector<KeyWrite> keys;
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            keys.push_back({"bench", KeyType::AES, key_name(i), std::vector<unsigned char>(32, 0x5d)});
+        }
+        store_keys(db, keys);
+        std::vector<unsigned char> value(32, 0x11);
+
+        size_t failed = 0;
+        CallerTime sync = with_lock_holder(path, [&](int i) {
+            failed += store_key(db, "sync", KeyType::AES, key_name(i), value).is_err();
+        });
+
+        DbExecutor executor(path, 1);
+        std::vector<std::future<VoidResult>> pending;
+        CallerTime async = with_lock_holder(path, [&](int i) {
+            pending.push_back(executor.write([&value, i](DatabaseAccess& conn) {
+                return store_key(conn, "async", KeyType::AES, key_name(i), value);
+            }));
+        });
+        auto drain = Clock::now();
+        for (auto& result : pending) {
+            failed += result.get().is_err();
+        }
+        double drain_ms = us(Clock::now() - drain) / 1000.0;
+
+        printf("%d writes while another connection holds the write lock %d ms at a time\n", WRITES, HOLD_MS);
+        printf("%-10s %14s %14s %14s\n", "", "caller us/op", "caller max us", "caller ms");
+        printf("%-10s %14.1f %14.1f %14.1f\n", "sync", sync.mean_us, sync.max_us, sync.total_ms);
+        printf("%-10s %14.1f %14.1f %14.1f\n", "async", async.mean_us, async.max_us, async.total_ms);
+        DbExecutorStats stats = executor.stats();
+        printf("async writes done %.1f ms after the last submit, %llu writes in %llu commits, failed %zu\n\n",
+               drain_ms, (unsigned long long) stats.writes, (unsigned long long) stats.write_batches, failed);
+
+        size_t found = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < LOOKUPS; ++i) {
+            found += get_key(db, "bench", KeyType::AES, key_name((i * 7919) % NUM_KEYS)).is_ok();
+        }
+        double sync_reads = us(Clock::now() - start) / LOOKUPS;
+
+        std::vector<std::future<bool>> reads;
+        reads.reserve(LOOKUPS);
+        start = Clock::now();
+        for (int i = 0; i < LOOKUPS; ++i) {
+            reads.push_back(executor.read([i](DatabaseAccess& conn) {
+                return get_key(conn, "bench", KeyType::AES, key_name((i * 7919) % NUM_KEYS)).is_ok();
+            }));
+        }
+        double submit_reads = us(Clock::now() - start) / LOOKUPS;
+        for (auto& read : reads) {
+            found += read.get();
+        }
+        double async_reads = us(Clock::now() - start) / LOOKUPS;
+        stats = executor.stats();
+
+        printf("%d get_key\n", LOOKUPS);
+        printf("%-28s %10.2f us/op\n", "sync", sync_reads);
+        printf("%-28s %10.2f us/op\n", "async, caller submit", submit_reads);
+        printf("%-28s %10.2f us/op\n", "async, end to end", async_reads);
+        printf("found %zu/%d, %llu reads in %llu batches\n", found, 2 * LOOKUPS, (unsigned long long) stats.reads,
+               (unsigned long long) stats.read_batches);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+#include "db_key.h"
+#include "startup_profiler.h"
+
+/**
+ * What opening the key database costs: one PBKDF2 run at SQLCipher's default iteration count
+ * (paid by every passphrase open), DatabaseAccess opened with the passphrase, the first open that
+ * derives the raw key and the later ones that reuse it, with StartupProfiler's phase breakdown.
+ * Usage: 5thDDbOpenBench [db_path]
+ */
+
+constexpr int OPENS = 200;
+constexpr int DERIVES = 3;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double open_ms(const std::string& path, bool cache_kdf) {
+    DbTuning tuning;
+    tuning.cache_kdf = cache_kdf;
+    auto start = Clock::now();
+    for (int i = 0; i < OPENS; ++i) {
+        DatabaseAccess db(path, MEANWHILE_DB_KEY, tuning);
+    }
+    return ms_since(start) / OPENS;
+}
+
+static void print_phases(const char* title, const std::vector<StartupPhaseStats>& phases) {
+    printf("\n%s:\n", title);
+    for (const auto& stats : phases) {
+        printf("  %-12s x%-4u %10.3f ms\n", stats.name.c_str(), stats.count,
+               std::chrono::duration<double, std::milli>(stats.total).count());
+    }
+}
+
+int main(int argc, char** argv) {
+    Log::init();
+    Log::get_logger()->set_level(spdlog::level::warn);
+
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench_open.db").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup
+    std::ofstream(path).close();
+    {
+        DatabaseAccess db(path);
+        db.exec("CREATE TABLE IF NOT EXISTS bench (id INTEGER);");
+    }
+
+    char raw[RAW_DB_KEY_CHARS];
+    auto start = Clock::now();
+    for (int i = 0; i < DERIVES; ++i) {
+        derive_raw_db_key(path, MEANWHILE_DB_KEY, sizeof(MEANWHILE_DB_KEY) - 1, SQLCIPHER_DEFAULT_KDF_ITER, raw);
+    }
+    double derive = ms_since(start) / DERIVES;
+    sodium_memzero(raw, sizeof(raw));
+
+    double passphrase = open_ms(path, false);
+    StartupProfiler::reset();
+    auto first = Clock::now();
+    { DatabaseAccess db(path); }
+    double first_cached = ms_since(first);
+    auto first_phases = StartupProfiler::phases();
+    StartupProfiler::reset();
+    double cached = open_ms(path, true);
+
+    printf("%-34s %10s\n", "", "ms/open");
+    printf("%-34s %10.3f\n", "PBKDF2-HMAC-SHA512, 256000 iter", derive);
+    printf("%-34s %10.3f\n", "open with passphrase", passphrase);
+    printf("%-34s %10.3f\n", "first open, derives the raw key", first_cached);
+    printf("%-34s %10.3f\n", "later opens, cached raw key", cached);
+    print_phases("first open", first_phases);
+    print_phases("later opens", StartupProfiler::phases());
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+#include "db_pool.h"
+#include "keys_db.h"
+
+/**
+ * Concurrent get_key throughput at 1..16 threads: every thread sharing one DatabaseAccess behind a
+ * mutex (what a process wide connection amounts to) vs borrowing a reader from a DbPool sized to the
+ * thread count. Also the cost of opening a keyed connection, the price a fresh DatabaseAccess per
+ * call pays and the pool pays once.
+ * Usage: 5thDDbPoolBench [db_path]
+ */
+
+constexpr int NUM_KEYS = 1000;
+constexpr int LOOKUPS = 100000;
+constexpr int OPENS = 50;
+
+using Clock = std::chrono::steady_clock;
+
+static std::string key_name(int i) {
+    return "key" + std::to_string(i);
+}
+
+template <typename Lookup>
+static double run(int threads, Lookup lookup, size_t& found) {
+    std::vector<std::thread> workers;
+    std::vector<size_t> hits(threads, 0);
+    auto start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t, threads, &lookup, &hits]() {
+            for (int i = t; i < LOOKUPS; i += threads) {
+                hits[t] += lookup(key_name((i * 7919) % NUM_KEYS));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (size_t h : hits) {
+        found += h;
+    }
+    return LOOKUPS / seconds / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    Log::init();
+    Log::get_logger()->set_level(spdlog::level::warn);
+
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench_pool.db").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup, the bench applies its own
+    std::ofstream(path).close();
+
+    {
+        DatabaseAccess shared(path);
+        if (shared.add_scheme(KEYS_SCHEME_PATH).is_err()) {
+            fprintf(stderr, "Failed to apply %s\n", KEYS_SCHEME_PATH);
+            return 1;
+        }
+        std::vector<KeyWrite> keys;
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            keys.push_back({"bench", KeyType::AES, key_name(i), std::vector<unsigned char>(32, 0x5d)});
+        }
+        store_keys(shared, keys);
+
+        auto start = Clock::now();
+        for (int i = 0; i < OPENS; ++i) {
+            DatabaseAccess fresh(path);
+        }
+        double open_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / OPENS;
+        printf("open + key a connection: %.1f us\n\n", open_us);
+
+        std::mutex lock;
+        auto shared_lookup = [&shared, &lock](const std::string& name) {
+            std::lock_guard<std::mutex> guard(lock);
+            return get_key(shared, "bench", KeyType::AES, name).is_ok();
+        };
+
+        size_t found = 0;
+        printf("%-8s %16s %16s %8s\n", "threads", "shared k/s", "pool k/s", "waits");
+        for (int threads = 1; threads <= 16; threads *= 2) {
+            double single = run(threads, shared_lookup, found);
+
+            DbPool pool(path, threads);
+            auto pool_lookup = [&pool](const std::string& name) {
+                auto reader = pool.reader();
+                return get_key(*reader, "bench", KeyType::AES, name).is_ok();
+            };
+            double pooled = run(threads, pool_lookup, found);
+            printf("%-8d %16.1f %16.1f %8llu\n", threads, single, pooled, (unsigned long long) pool.stats().waits);
+        }
+        printf("found %zu/%d\n", found, 2 * 5 * LOOKUPS);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    return 0;
+}
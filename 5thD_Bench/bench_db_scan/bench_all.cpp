@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+
+/**
+ * Full scan of 100k rows (int, 32 char text, 64 byte blob): query() copying into sdbret_t
+ * vs for_each_row() reading sqlite's buffers in place.
+ * Usage: 5thDDbScanBench [db_path]
+ */
+
+constexpr int NUM_ROWS = 100000;
+constexpr int ROUNDS = 5;
+
+using Clock = std::chrono::steady_clock;
+
+static const std::string SCAN_SQL = "SELECT id, name, payload FROM scan;";
+
+static size_t scan_copy(DatabaseAccess& db) {
+    auto stmt = db.prepare_cached(SCAN_SQL);
+    sdbret_t result;
+    db.query(stmt.value(), result);
+    size_t bytes = 0;
+    for (const auto& row : result.rows) {
+        bytes += row.columns[1].second.size() + row.columns[2].second.size();
+    }
+    return bytes;
+}
+
+static size_t scan_in_place(DatabaseAccess& db) {
+    auto stmt = db.prepare_cached(SCAN_SQL);
+    size_t bytes = 0;
+    db.for_each_row(stmt.value(), [&bytes](const SqlRow& row) {
+        bytes += row.get_text(1).size() + row.get_blob(2).size;
+        return true;
+    });
+    return bytes;
+}
+
+template <typename F>
+static double best_ms(DatabaseAccess& db, F scan, size_t& bytes) {
+    double best = 1e30;
+    for (int i = 0; i < ROUNDS; ++i) {
+        auto start = Clock::now();
+        bytes = scan(db);
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    Log::init();
+    Log::get_logger()->set_level(spdlog::level::warn);
+
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench_scan.db").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup
+    std::ofstream(path).close();
+
+    {
+        DatabaseAccess db(path);
+        db.exec("CREATE TABLE scan (id INTEGER PRIMARY KEY, name TEXT, payload BLOB);");
+        db.begin_transaction();
+        std::vector<unsigned char> payload(64, 0x5d);
+        for (int i = 0; i < NUM_ROWS; ++i) {
+            auto stmt = db.prepare_cached("INSERT INTO scan (id, name, payload) VALUES (?, ?, ?);");
+            db.bind_int(stmt.value(), 1, i);
+            db.bind_text(stmt.value(), 2, "row-" + std::string(28, 'a' + i % 26));
+            db.bind_blob(stmt.value(), 3, payload);
+            db.execute(stmt.value());
+        }
+        db.end_transaction();
+
+        size_t copy_bytes = 0;
+        size_t in_place_bytes = 0;
+        double copy_ms = best_ms(db, scan_copy, copy_bytes);
+        double in_place_ms = best_ms(db, scan_in_place, in_place_bytes);
+
+        printf("%-16s %10s %10s %12s\n", "scan 100k rows", "ms", "ns/row", "bytes");
+        printf("%-16s %10.2f %10.1f %12zu\n", "query()", copy_ms, copy_ms * 1e6 / NUM_ROWS, copy_bytes);
+        printf("%-16s %10.2f %10.1f %12zu\n", "for_each_row()", in_place_ms, in_place_ms * 1e6 / NUM_ROWS,
+               in_place_bytes);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hash_helpers.h"
+
+#if BENCH_LEGACY_OPENSSL
+#    include <openssl/evp.h>
+#    include <iomanip>
+#    include <sstream>
+#endif
+
+/**
+ * sha256 hex of 32 B .. 1 MiB inputs: the old net_helpers sha256() (new EVP context per call,
+ * stringstream/setw hex, built only when OpenSSL is found) vs a reused Sha256 + table hex.
+ * Then hex of one digest alone and a batch of short peer ids.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+#if BENCH_LEGACY_OPENSSL
+static std::string legacy_sha256(const std::string& str) {
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_len;
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL);
+    EVP_DigestUpdate(mdctx, str.c_str(), str.size());
+    EVP_DigestFinal_ex(mdctx, hash, &hash_len);
+    EVP_MD_CTX_free(mdctx);
+
+    std::stringstream ss;
+    for (unsigned int i = 0; i < hash_len; i++) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << (int) hash[i];
+    }
+    return ss.str();
+}
+
+static std::string legacy_hex(const unsigned char* data, size_t size) {
+    std::stringstream ss;
+    for (size_t i = 0; i < size; i++) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << (int) data[i];
+    }
+    return ss.str();
+}
+#endif
+
+template <typename F>
+static double ns_per_op(size_t iterations, F&& fn) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+int main() {
+    volatile char sink = 0;
+    printf("%-10s %14s %14s %12s\n", "input", "legacy ns/op", "Sha256 ns/op", "Sha256 MB/s");
+    for (size_t size : {size_t(32), size_t(256), size_t(4096), size_t(65536), size_t(1) << 20}) {
+        std::string input(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            input[i] = static_cast<char>(i * 131);
+        }
+        size_t iterations = std::max<size_t>(20, (size_t(64) << 20) / size / 4);
+
+        double legacy = 0;
+#if BENCH_LEGACY_OPENSSL
+        legacy = ns_per_op(iterations, [&](size_t) { sink ^= legacy_sha256(input)[0]; });
+#endif
+        Sha256 hasher;
+        char hex[SHA256_HEX_CHARS];
+        double fast = ns_per_op(iterations, [&](size_t) {
+            hasher.update(input);
+            hasher.finish_hex(hex);
+            sink ^= hex[0];
+        });
+        printf("%-10zu %14.0f %14.0f %12.1f\n", size, legacy, fast, size / fast * 1e3);
+    }
+
+    constexpr size_t HEX_ITERATIONS = 1000000;
+    Sha256Digest digest = Sha256::digest("peer", 4);
+    double legacy_hex_ns = 0;
+#if BENCH_LEGACY_OPENSSL
+    legacy_hex_ns = ns_per_op(HEX_ITERATIONS, [&](size_t) { sink ^= legacy_hex(digest.data(), digest.size())[0]; });
+#endif
+    char hex[SHA256_HEX_CHARS];
+    double table_hex_ns = ns_per_op(HEX_ITERATIONS, [&](size_t i) {
+        digest[0] = static_cast<unsigned char>(i);
+        hex_encode(digest.data(), digest.size(), hex);
+        sink ^= hex[1];
+    });
+    printf("\nhex of a 32 B digest: stringstream %.1f ns, table %.1f ns\n", legacy_hex_ns, table_hex_ns);
+
+    constexpr size_t PEERS = 10000;
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < PEERS; ++i) {
+        ids.push_back("peer-" + std::to_string(i * 7919));
+    }
+    std::vector<std::string_view> inputs(ids.begin(), ids.end());
+    std::vector<Sha256Digest> digests(PEERS);
+    sha256_batch(inputs.data(), inputs.size(), digests.data());  // warm up
+    double one_by_one = ns_per_op(PEERS, [&](size_t i) { digests[i] = Sha256::digest(ids[i].data(), ids[i].size()); });
+    auto start = Clock::now();
+    sha256_batch(inputs.data(), inputs.size(), digests.data());
+    double batch = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / PEERS;
+    double legacy_ids = 0;
+#if BENCH_LEGACY_OPENSSL
+    legacy_ids = ns_per_op(PEERS, [&](size_t i) { sink ^= legacy_sha256(ids[i])[0]; });
+#endif
+    printf("%zu peer ids: legacy %.1f ns/id, digest() %.1f ns/id, sha256_batch %.1f ns/id\n", PEERS, legacy_ids,
+           one_by_one, batch);
+    printf("(legacy columns read 0 when built without OpenSSL)\n");
+    return sink == 42;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "5thdipcmsg.h"
+#include "ipc_codec.h"
+#include "ipc_messages.h"
+
+/**
+ * ns/message for encode + parse + decode + dispatch of typed messages,
+ * against the legacy ipc_msg_t with a category string compared on receive.
+ */
+
+constexpr size_t ROUNDS = 5000000;
+
+using Clock = std::chrono::steady_clock;
+
+struct Blob {
+    static constexpr uint16_t TYPE_ID = 0x7f01;
+    uint64_t id;
+    IpcBytes data;
+
+    static constexpr auto schema() { return std::make_tuple(ipc_field(&Blob::id), ipc_field(&Blob::data)); }
+};
+
+static double ns_per_msg(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ROUNDS;
+}
+
+template <typename T>
+static double bench_typed(const T& msg) {
+    IpcDispatcher<BusPing, BusPong, ModuleStatus, Blob> dispatcher;
+    volatile uint64_t sink = 0;
+    dispatcher.on<T>([&sink](const T&, const ipc_view_t& view) { sink = sink + view.hdr.length; });
+
+    std::vector<uint8_t> frame(IpcCodec<T>::frame_size(msg));
+    auto start = Clock::now();
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        IpcCodec<T>::encode(msg, Clients::PEER, Clients::UI, frame.data(), frame.size());
+        ipc_view_t view;
+        ipc_parse(frame.data(), frame.size(), &view);
+        dispatcher.dispatch(view);
+    }
+    return ns_per_msg(start);
+}
+
+static double bench_legacy(const char* category, size_t data_size) {
+    static const char* categories[] = {"bus.ping", "bus.pong", "module.status", "blob"};
+    std::vector<uint8_t> data(data_size, 0x5d);
+    uint8_t frame[sizeof(ipc_msg_t)];
+    volatile uint64_t sink = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        ipc_msg_t msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.src_id = Clients::PEER;
+        msg.dist_id = Clients::UI;
+        strncpy(msg.category, category, CATEGORY_LENGTH_BYTES - 1);
+        memcpy(msg.data, data.data(), data_size);
+        memcpy(frame, &msg, sizeof(msg));
+
+        ipc_msg_t in;
+        memcpy(&in, frame, sizeof(in));
+        for (const char* known : categories) {
+            if (strcmp(in.category, known) == 0) {
+                sink = sink + in.dist_id;
+                break;
+            }
+        }
+    }
+    return ns_per_msg(start);
+}
+
+int main() {
+    static uint8_t blob_data[256];
+    memset(blob_data, 0x5d, sizeof(blob_data));
+
+    BusPing ping{42};
+    ModuleStatus status{ModuleState::RUNNING, 3600, "peer connected to 12 nodes"};
+    Blob blob{1, {blob_data, sizeof(blob_data)}};
+
+    printf("%-16s %10s %14s\n", "message", "bytes", "ns/msg");
+    printf("%-16s %10zu %14.1f\n", "BusPing", IpcCodec<BusPing>::frame_size(ping), bench_typed(ping));
+    printf("%-16s %10zu %14.1f\n", "ModuleStatus", IpcCodec<ModuleStatus>::frame_size(status), bench_typed(status));
+    printf("%-16s %10zu %14.1f\n", "Blob 256B", IpcCodec<Blob>::frame_size(blob), bench_typed(blob));
+    printf("%-16s %10zu %14.1f\n", "legacy 8B", sizeof(ipc_msg_t), bench_legacy("bus.ping", 8));
+    printf("%-16s %10zu %14.1f\n", "legacy 256B", sizeof(ipc_msg_t), bench_legacy("blob", 256));
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <zmq.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "5thdipcmsg.h"
+
+/**
+ * Legacy ipc_msg_t vs v1 header + body.
+ * Per body size: bytes on the wire, encode+parse rate, and msg/s over inproc PUSH -> PULL.
+ * Legacy can't carry bodies over DATA_LENGTH_BYTES, those rows show "-".
+ */
+
+constexpr const char* ENDPOINT = "inproc://bench_ipc_format";
+constexpr size_t CODEC_ROUNDS = 2000000;
+constexpr size_t WIRE_MESSAGES = 500000;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double codec_legacy(size_t body_size) {
+    ipc_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    std::vector<uint8_t> frame(sizeof(ipc_msg_t));
+    volatile int32_t sink = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < CODEC_ROUNDS; ++i) {
+        msg.src_id = i;
+        memset(msg.data, 0x5d, body_size);
+        memcpy(frame.data(), &msg, sizeof(msg));
+        ipc_view_t view;
+        ipc_parse(frame.data(), frame.size(), &view);
+        sink = sink + view.hdr.src_id;
+    }
+    return CODEC_ROUNDS / seconds_since(start);
+}
+
+static double codec_v1(size_t body_size) {
+    std::vector<uint8_t> body(body_size, 0x5d);
+    std::vector<uint8_t> frame(ipc_frame_size(body_size));
+    volatile int32_t sink = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < CODEC_ROUNDS; ++i) {
+        ipc_hdr_t hdr;
+        ipc_hdr_init(&hdr, 1, i, 1, body_size);
+        ipc_encode(frame.data(), frame.size(), &hdr, body.data());
+        ipc_view_t view;
+        ipc_parse(frame.data(), frame.size(), &view);
+        sink = sink + view.hdr.src_id;
+    }
+    return CODEC_ROUNDS / seconds_since(start);
+}
+
+static double wire_rate(void* ctx, size_t frame_size) {
+    void* pull = zmq_socket(ctx, ZMQ_PULL);
+    void* push = zmq_socket(ctx, ZMQ_PUSH);
+    zmq_bind(pull, ENDPOINT);
+    zmq_connect(push, ENDPOINT);
+
+    std::vector<uint8_t> frame(frame_size, 0x5d);
+    std::thread reader([pull] {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        for (size_t i = 0; i < WIRE_MESSAGES; ++i) {
+            zmq_msg_recv(&msg, pull, 0);
+        }
+        zmq_msg_close(&msg);
+    });
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < WIRE_MESSAGES; ++i) {
+        zmq_send(push, frame.data(), frame.size(), 0);
+    }
+    reader.join();
+    double rate = WIRE_MESSAGES / seconds_since(start);
+
+    zmq_close(push);
+    zmq_close(pull);
+    return rate;
+}
+
+int main() {
+    void* ctx = zmq_ctx_new();
+
+    printf("%-6s | %10s %10s | %14s %14s | %12s %12s\n", "body", "legacy B", "v1 B", "legacy codec/s",
+           "v1 codec/s", "legacy msg/s", "v1 msg/s");
+    for (size_t body : {0, 16, 64, 256, 1024, 4096}) {
+        bool fits_legacy = body <= DATA_LENGTH_BYTES;
+        size_t v1_bytes = ipc_frame_size(body);
+        double v1_codec = codec_v1(body);
+        double v1_wire = wire_rate(ctx, v1_bytes);
+
+        if (fits_legacy) {
+            printf("%-6zu | %10zu %10zu | %14.0f %14.0f | %12.0f %12.0f\n", body, sizeof(ipc_msg_t), v1_bytes,
+                   codec_legacy(body), v1_codec, wire_rate(ctx, sizeof(ipc_msg_t)), v1_wire);
+        } else {
+            printf("%-6zu | %10s %10zu | %14s %14.0f | %12s %12.0f\n", body, "-", v1_bytes, "-", v1_codec, "-",
+                   v1_wire);
+        }
+    }
+
+    zmq_ctx_destroy(ctx);
+    return 0;
+}
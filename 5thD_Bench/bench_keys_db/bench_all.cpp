@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+#include "key_store.h"
+#include "key_writer.h"
+#include "keys_db.h"
+
+/**
+ * get_key latency against a scratch key store, prepare-per-call (the pre-cache code path)
+ * vs the cached statement that get_key uses now vs a warm KeyStore (no SQL).
+ * Then WRITES inserts each way: store_key autocommit (one commit per key), store_key in one manual
+ * transaction, store_keys() bulk, and WRITER_THREADS threads each waiting on its own KeyWriter write.
+ * Usage: 5thDKeysDbBench [db_path]
+ */
+
+constexpr int NUM_KEYS = 1000;
+constexpr int LOOKUPS = 100000;
+constexpr int WRITES = 2000;
+constexpr int WRITER_THREADS = 4;
+
+using Clock = std::chrono::steady_clock;
+
+// get_key as it was before the statement cache: prepare, bind, query, finalize on every call
+static bool get_key_uncached(DatabaseAccess& db, const std::string& module_name, const std::string& key_name,
+                             std::vector<unsigned char>& out) {
+    auto stmt = db.prepare(
+        "SELECT key_value FROM module_keys "
+        "WHERE module_name = ? AND key_type_id = (SELECT id FROM key_types WHERE type_name = ?) "
+        "AND key_name = ? AND is_active = 1");
+    if (stmt.is_err()) {
+        return false;
+    }
+    db.bind_text(stmt.value(), 1, module_name);
+    db.bind_text(stmt.value(), 2, "AES");
+    db.bind_text(stmt.value(), 3, key_name);
+    sdbret_t result;
+    bool found = db.query(stmt.value(), result).is_ok() && !result.rows.empty();
+    if (found) {
+        out = result.rows[0].columns[0].second;
+    }
+    db.release(stmt.value());
+    return found;
+}
+
+static std::string key_name(int i) {
+    return "key" + std::to_string(i);
+}
+
+static double us_per_write(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / WRITES;
+}
+
+static void bench_writes(DatabaseAccess& db) {
+    std::vector<unsigned char> value(32, 0x3c);
+    size_t failed = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < WRITES; ++i) {
+        failed += store_key(db, "autocommit", KeyType::AES, key_name(i), value).is_err();
+    }
+    double autocommit = us_per_write(start);
+
+    start = Clock::now();
+    db.begin_transaction();
+    for (int i = 0; i < WRITES; ++i) {
+        failed += store_key(db, "transaction", KeyType::AES, key_name(i), value).is_err();
+    }
+    db.end_transaction();
+    double transaction = us_per_write(start);
+
+    std::vector<KeyWrite> keys;
+    keys.reserve(WRITES);
+    for (int i = 0; i < WRITES; ++i) {
+        keys.push_back({"bulk", KeyType::AES, key_name(i), value});
+    }
+    start = Clock::now();
+    failed += store_keys(db, keys).is_err();
+    double bulk = us_per_write(start);
+
+    KeyWriterStats stats;
+    start = Clock::now();
+    {
+        KeyWriter writer(db);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < WRITER_THREADS; ++t) {
+            threads.emplace_back([&writer, &value, &failed, t]() {
+                std::string module_name = "writer" + std::to_string(t);
+                size_t thread_failed = 0;
+                for (int i = 0; i < WRITES / WRITER_THREADS; ++i) {
+                    thread_failed += writer.submit({module_name, KeyType::AES, key_name(i), value}).get().is_err();
+                }
+                static std::mutex lock;
+                std::lock_guard<std::mutex> guard(lock);
+                failed += thread_failed;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        stats = writer.stats();
+    }
+    double group = us_per_write(start);
+
+    printf("\n%-28s %10s\n", "store", "us/key");
+    printf("%-28s %10.2f\n", "store_key autocommit", autocommit);
+    printf("%-28s %10.2f\n", "store_key one transaction", transaction);
+    printf("%-28s %10.2f\n", "store_keys bulk", bulk);
+    printf("%-28s %10.2f\n", "KeyWriter group commit", group);
+    printf("failed %zu, writer batches %llu (largest %llu)\n", failed, (unsigned long long) stats.batches,
+           (unsigned long long) stats.largest_batch);
+}
+
+int main(int argc, char** argv) {
+    Log::init();
+    Log::get_logger()->set_level(spdlog::level::warn);
+
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench_keys.db").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup, the bench applies its own
+    std::ofstream(path).close();
+
+    {
+        DatabaseAccess db(path);
+        if (db.add_scheme(KEYS_SCHEME_PATH).is_err()) {
+            fprintf(stderr, "Failed to apply %s\n", KEYS_SCHEME_PATH);
+            return 1;
+        }
+
+        std::vector<unsigned char> value(32, 0x5d);
+        db.begin_transaction();
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            store_key(db, "bench", KeyType::AES, key_name(i), value);
+        }
+        db.end_transaction();
+
+        std::vector<std::string> names;
+        for (int i = 0; i < LOOKUPS; ++i) {
+            names.push_back(key_name((i * 7919) % NUM_KEYS));
+        }
+
+        std::vector<unsigned char> out;
+        size_t found = 0;
+        auto start = Clock::now();
+        for (const auto& name : names) {
+            found += get_key_uncached(db, "bench", name, out);
+        }
+        double uncached = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / LOOKUPS;
+
+        start = Clock::now();
+        for (const auto& name : names) {
+            found += get_key(db, "bench", KeyType::AES, name).is_ok();
+        }
+        double cached = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / LOOKUPS;
+
+        KeyStore keys(db);
+        size_t copied = 0;
+        auto view = [&copied](const unsigned char*, size_t num_bytes) { copied += num_bytes; };
+        for (int i = 0; i < NUM_KEYS; ++i) {
+            keys.with_key("bench", KeyType::AES, key_name(i), view);
+        }
+        start = Clock::now();
+        for (const auto& name : names) {
+            found += keys.with_key("bench", KeyType::AES, name, view).is_ok();
+        }
+        double store = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / LOOKUPS;
+
+        printf("%-28s %10s\n", "get_key", "us/lookup");
+        printf("%-28s %10.2f\n", "prepare per call", uncached);
+        printf("%-28s %10.2f\n", "cached statement", cached);
+        printf("%-28s %10.2f\n", "KeyStore (warm)", store);
+        KeyStoreStats stats = keys.stats();
+        printf("found %zu/%d, store hits %llu misses %llu\n", found, 3 * LOOKUPS, (unsigned long long) stats.hits,
+               (unsigned long long) stats.misses);
+
+        bench_writes(db);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    return 0;
+}
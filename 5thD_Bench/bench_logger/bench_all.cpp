@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "spdlog/sinks/basic_file_sink.h"
+
+/**
+ * What a bus/transmitter thread pays per WARN, sync (format, sink mutex, write on the caller)
+ * against the async modes (format the text, copy it into the ring). THREADS threads log
+ * CALLS messages each into a file sink, every call is timed on its own.
+ * Then the cost of a DEBUG line when the level is off, the old macro against the level gated one.
+ * Usage: 5thDLoggerBench [log_path]
+ */
+
+constexpr int CALLS = 100000;
+constexpr int THREADS = 4;
+
+using Clock = std::chrono::steady_clock;
+
+struct Latency {
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+    double wall_ms = 0;
+};
+
+static Latency run(const std::string& path, LogConfig config, size_t threads) {
+    std::filesystem::remove(path);
+    config.sinks = {std::make_shared<spdlog::sinks::basic_file_sink_mt>(path)};
+    Log::init(config);
+
+    std::vector<std::vector<double>> samples(threads);
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&samples, t] {
+            auto& mine = samples[t];
+            mine.reserve(CALLS);
+            for (int i = 0; i < CALLS; ++i) {
+                auto before = Clock::now();
+                WARN("Route to {} failed, message {} of {} dropped", "module.echo", i, t);
+                mine.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    Log::flush();
+    Latency result;
+    result.wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto& mine : samples) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    std::sort(all.begin(), all.end());
+    result.p50 = all[all.size() / 2];
+    result.p99 = all[all.size() * 99 / 100];
+    result.p999 = all[all.size() * 999 / 1000];
+    result.max = all.back();
+    return result;
+}
+
+static int expensive_argument() {
+    static volatile int value = 0;
+    for (int i = 0; i < 100; ++i) {
+        value = value + i;
+    }
+    return value;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : (std::filesystem::temp_directory_path() / "5thd_bench.log").string();
+
+    struct Mode {
+        const char* name;
+        LogMode mode;
+        LogOverflow overflow;
+    };
+    Mode modes[] = {
+        {"sync", LogMode::SYNC, LogOverflow::BLOCK},
+        {"async block", LogMode::ASYNC, LogOverflow::BLOCK},
+        {"async drop", LogMode::ASYNC, LogOverflow::DROP},
+        {"async overrun", LogMode::ASYNC, LogOverflow::OVERRUN},
+    };
+
+    printf("%-16s %8s %10s %10s %10s %12s %10s %10s\n", "mode", "threads", "p50 ns", "p99 ns", "p999 ns", "max ns",
+           "wall ms", "lost");
+    for (size_t threads : {size_t(1), size_t(THREADS)}) {
+        for (const auto& mode : modes) {
+            LogConfig config;
+            config.mode = mode.mode;
+            config.overflow = mode.overflow;
+            Latency latency = run(path, config, threads);
+            LogStats stats = Log::stats();
+            printf("%-16s %8zu %10.0f %10.0f %10.0f %12.0f %10.1f %10llu\n", mode.name, threads, latency.p50,
+                   latency.p99, latency.p999, latency.max, latency.wall_ms,
+                   (unsigned long long) (stats.dropped + stats.overrun));
+        }
+    }
+
+    LogConfig config;
+    config.level = spdlog::level::info;
+    config.sinks = {std::make_shared<spdlog::sinks::basic_file_sink_mt>(path)};
+    Log::init(config);
+    auto start = Clock::now();
+    for (int i = 0; i < CALLS; ++i) {
+        // What DEBUG expanded to before, the argument is evaluated before the level check
+        Log::get_logger()->debug("value {}", expensive_argument());
+    }
+    double before_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / CALLS;
+    start = Clock::now();
+    for (int i = 0; i < CALLS; ++i) {
+        LOG_AT(spdlog::level::debug, "value {}", expensive_argument());
+    }
+    double after_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / CALLS;
+    printf("\ndisabled DEBUG: %.1f ns before, %.1f ns level gated\n", before_ns, after_ns);
+
+    Log::shutdown();
+    std::filesystem::remove(path);
+    return 0;
+}
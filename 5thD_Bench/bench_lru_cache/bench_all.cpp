@@ -0,0 +1,85 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlru_cache.h"
+#include "5thdsharded_cache.h"
+
+/**
+ * Multi threaded get/push throughput: LRU_Cache vs ShardedCache (LRU and SIEVE).
+ * 90% get / 10% push over a skewed key space twice the capacity, 64 byte string values.
+ * Usage: 5thDLruCacheBench [max_threads]
+ */
+
+constexpr size_t CAPACITY = 60000;  // LRU_Cache is capped at uint16_t
+constexpr size_t KEY_SPACE = CAPACITY * 2;
+constexpr size_t OPS_PER_THREAD = 1000000;
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t next_rand(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Half the traffic hits the hottest 1/16 of the keys
+static uint64_t skewed_key(uint64_t& state) {
+    uint64_t r = next_rand(state);
+    return (r & 1) ? (r >> 1) % (KEY_SPACE / 16) : (r >> 1) % KEY_SPACE;
+}
+
+template <typename Cache>
+static void run(const char* name, size_t threads) {
+    Cache cache(CAPACITY);
+    std::string value(64, 'v');
+    for (uint64_t key = 0; key < CAPACITY; ++key) {
+        cache.push(key, value);
+    }
+
+    std::atomic<uint64_t> hits{0};
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&cache, &hits, &value, t] {
+            uint64_t state = 0x9E3779B97F4A7C15ull + t;
+            uint64_t local_hits = 0;
+            std::string out;
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                uint64_t key = skewed_key(state);
+                if (i % 10 == 0) {
+                    cache.push(key, value);
+                } else if (cache.get(key, out)) {
+                    ++local_hits;
+                }
+            }
+            hits += local_hits;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    double ops = double(OPS_PER_THREAD) * threads;
+    printf("%-22s %8zu %12.2f %10.1f%%\n", name, threads, ops / secs / 1e6, 100.0 * hits / (ops * 0.9));
+}
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    printf("%-22s %8s %12s %11s\n", "cache", "threads", "Mops/s", "hit rate");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        run<LRU_Cache<uint64_t, std::string>>("LRU_Cache", threads);
+        run<ShardedCache<uint64_t, std::string>>("ShardedCache LRU", threads);
+        run<ShardedCache<uint64_t, std::string, CachePolicy::SIEVE>>("ShardedCache SIEVE", threads);
+    }
+    return 0;
+}
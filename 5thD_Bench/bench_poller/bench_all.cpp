@@ -0,0 +1,152 @@
+#include <sys/resource.h>
+#include <zmq.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "izmq.h"
+#include "poller.h"
+#include "receiver.h"
+
+/**
+ * N inproc PULL sockets served by
+ *  - one ZMQWPoller thread
+ *  - ZMQWPollerPool with 4 loops
+ *  - a ZMQWReceiver::worker thread per socket (the current model, skipped for 1024)
+ * A single producer pushes MESSAGES round robin over the N peers.
+ */
+
+constexpr size_t MESSAGES = 200000;
+
+struct Fixture {
+    ZMQWContext ctx;
+    std::vector<std::unique_ptr<ZMQWSocket>> pull;
+    std::vector<std::unique_ptr<ZMQWSocket>> push;
+
+    explicit Fixture(size_t n) {
+        zmq_ctx_set(ctx.get_context(), ZMQ_MAX_SOCKETS, static_cast<int>(2 * n + 64));
+        for (size_t i = 0; i < n; ++i) {
+            char endpoint[64];
+            snprintf(endpoint, sizeof(endpoint), "inproc://bench_poller_%zu", i);
+            pull.push_back(std::make_unique<ZMQWSocket>(&ctx, ZMQ_PULL));
+            push.push_back(std::make_unique<ZMQWSocket>(&ctx, ZMQ_PUSH));
+            zmq_bind(pull.back()->get_socket(), endpoint);
+            zmq_connect(push.back()->get_socket(), endpoint);
+        }
+    }
+
+    void produce() {
+        for (size_t i = 0; i < MESSAGES; ++i) {
+            zmq_send(push[i % push.size()]->get_socket(), &i, sizeof(i), 0);
+        }
+    }
+};
+
+template <typename Serve>
+static double measure(Fixture& fixture, Serve serve) {
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&fixture] { fixture.produce(); });
+    serve();
+    producer.join();
+    return MESSAGES / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double single_poller(size_t n) {
+    Fixture fixture(n);
+    ZMQWPoller poller(&fixture.ctx, 100);
+    std::atomic<bool> until{true};
+    size_t received = 0;
+
+    for (auto& sock : fixture.pull) {
+        poller.add(sock.get(), ZMQ_POLLIN, [&](void* s) {
+            size_t value;
+            while (zmq_recv(s, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+                if (++received == MESSAGES) {
+                    until = false;
+                }
+            }
+        });
+    }
+    return measure(fixture, [&] { poller.run(&until); });
+}
+
+static double poller_pool(size_t n, size_t loops) {
+    Fixture fixture(n);
+    ZMQWPollerPool pool(&fixture.ctx, loops, 100);
+    std::atomic<size_t> received{0};
+
+    for (auto& sock : fixture.pull) {
+        pool.add(sock.get(), ZMQ_POLLIN, [&](void* s) {
+            size_t value;
+            while (zmq_recv(s, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+                received.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    return measure(fixture, [&] {
+        pool.start();
+        while (received.load(std::memory_order_relaxed) < MESSAGES) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        pool.stop();
+    });
+}
+
+static double thread_per_socket(size_t n) {
+    Fixture fixture(n);
+    std::atomic<bool> until{true};
+    std::atomic<size_t> received{0};
+    std::vector<std::unique_ptr<ZMQWReceiver>> receivers;
+    std::vector<std::thread> threads;
+
+    for (auto& sock : fixture.pull) {
+        receivers.push_back(std::make_unique<ZMQWReceiver>("127.0.0.1", 0, &fixture.ctx, sock.get()));
+    }
+    return measure(fixture, [&] {
+        for (auto& recv : receivers) {
+            threads.emplace_back([&, r = recv.get()] {
+                r->worker(&until, [&](void* s) {
+                    size_t value;
+                    while (zmq_recv(s, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+                        received.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            });
+        }
+        while (received.load(std::memory_order_relaxed) < MESSAGES) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        until = false;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+}
+
+int main() {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+
+    // every zmq socket holds a mailbox fd
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    printf("%-8s %14s %14s %14s\n", "sockets", "poller msg/s", "pool4 msg/s", "thread/sock");
+    for (size_t n : {1, 64, 1024}) {
+        double single = single_poller(n);
+        double pool = poller_pool(n, 4);
+        printf("%-8zu %14.0f %14.0f ", n, single, pool);
+        if (n <= 64) {
+            printf("%14.0f\n", thread_per_socket(n));
+        } else {
+            printf("%14s\n", "skipped");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "port_allocator.h"
+
+/**
+ * Picking a listener port with N busy loopback ports in a row: the old is_port_available loop
+ * (one socket, bind() port after port), reserve_in_range() over the same range, and reserve()
+ * where the kernel picks. Only the kernel pick stays flat as N grows.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+#define BENCH_BASE_PORT 20000
+#define BENCH_ROUNDS 20
+
+static sockaddr_in loopback(int port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return addr;
+}
+
+// The pre-allocator loop, with the range opened to PORT_MAX so it finds something
+static int legacy_scan(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    for (; port <= PORT_MAX; ++port) {
+        sockaddr_in addr = loopback(port);
+        if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            break;
+        }
+    }
+    close(sock);
+    return port;
+}
+
+// Occupies busy ports from BENCH_BASE_PORT on, returns the first port past the block
+static int occupy(std::vector<int>& socks, size_t busy) {
+    int port = BENCH_BASE_PORT;
+    while (socks.size() < busy && port <= PORT_MAX) {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = loopback(port++);
+        if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            socks.push_back(sock);
+        } else {
+            close(sock);
+        }
+    }
+    return port;
+}
+
+template <typename F>
+static double us_per_pick(F&& fn) {
+    auto start = Clock::now();
+    for (int i = 0; i < BENCH_ROUNDS; ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / BENCH_ROUNDS;
+}
+
+int main() {
+    Log::init();
+
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    volatile int sink = 0;
+    printf("%-8s %16s %16s %16s\n", "busy", "legacy us/pick", "range us/pick", "kernel us/pick");
+    for (size_t busy : {size_t(0), size_t(10), size_t(100), size_t(1000), size_t(5000)}) {
+        std::vector<int> socks;
+        occupy(socks, busy);
+        if (socks.size() < busy) {
+            printf("%-8zu could only occupy %zu ports\n", busy, socks.size());
+        }
+
+        double legacy = us_per_pick([&] { sink = legacy_scan(BENCH_BASE_PORT); });
+
+        PortAllocator ports;
+        double range = us_per_pick([&] {
+            auto port = ports.reserve_in_range("127.0.0.1", BENCH_BASE_PORT);
+            if (port.is_ok()) {
+                ports.release(port.value());
+            }
+        });
+        double kernel = us_per_pick([&] {
+            auto port = ports.reserve("127.0.0.1");
+            if (port.is_ok()) {
+                ports.release(port.value());
+            }
+        });
+        printf("%-8zu %16.1f %16.1f %16.1f\n", socks.size(), legacy, range, kernel);
+
+        for (int sock : socks) {
+            close(sock);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <zmq.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "izmq.h"
+#include "receiver.h"
+
+/**
+ * ZMQWReceiver::worker (one callback per POLLIN) vs ZMQWReceiver::worker_batch (drain up to N with
+ * ZMQ_DONTWAIT) on a saturated inproc ROUTER. Each payload carries its send time, latency is
+ * measured at delivery to the callback.
+ */
+
+constexpr const char* ENDPOINT = "inproc://bench_recv_batch";
+constexpr size_t MESSAGES = 500000;
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct Stats {
+    std::vector<int64_t> latency;
+    int64_t first_send = 0;
+    int64_t last_recv = 0;
+
+    void record(const zmq_msg_t* payload) {
+        int64_t sent;
+        memcpy(&sent, zmq_msg_data(const_cast<zmq_msg_t*>(payload)), sizeof(sent));
+        last_recv = now_ns();
+        latency.push_back(last_recv - sent);
+    }
+
+    void print(const char* name) {
+        std::sort(latency.begin(), latency.end());
+        double seconds = (last_recv - first_send) / 1e9;
+        printf("%-14s %12.0f %10.1f %10.1f\n", name, latency.size() / seconds, latency[latency.size() / 2] / 1e3,
+               latency[latency.size() * 99 / 100] / 1e3);
+    }
+};
+
+static void sender(void* ctx, Stats* stats) {
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    int hwm = 0;
+    zmq_setsockopt(dealer, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_connect(dealer, ENDPOINT);
+    stats->first_send = now_ns();
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        int64_t ts = now_ns();
+        zmq_send(dealer, &ts, sizeof(ts), 0);
+    }
+    zmq_close(dealer);
+}
+
+template <typename Run>
+static void bench(const char* name, ZMQWContext& ctx, Run run) {
+    ZMQWSocket router(&ctx, ZMQ_ROUTER);
+    int hwm = 0;
+    zmq_setsockopt(router.get_socket(), ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    ZMQWReceiver recv("127.0.0.1", 0, &ctx, &router);
+    recv.set_endpoint(ENDPOINT);
+    recv.listen();
+
+    Stats stats;
+    stats.latency.reserve(MESSAGES);
+    std::atomic<bool> until{true};
+
+    std::thread producer(sender, ctx.get_context(), &stats);
+    run(recv, until, stats);
+    producer.join();
+    stats.print(name);
+}
+
+int main() {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+    ZMQWContext ctx;
+
+    printf("%-14s %12s %10s %10s\n", "mode", "msgs/s", "p50 us", "p99 us");
+
+    bench("worker", ctx, [](ZMQWReceiver& recv, std::atomic<bool>& until, Stats& stats) {
+        recv.worker(&until, [&](void* sock) {
+            zmq_msg_t identity, payload;
+            zmq_msg_init(&identity);
+            zmq_msg_init(&payload);
+            zmq_msg_recv(&identity, sock, 0);
+            zmq_msg_recv(&payload, sock, 0);
+            stats.record(&payload);
+            zmq_msg_close(&identity);
+            zmq_msg_close(&payload);
+            if (stats.latency.size() == MESSAGES) {
+                until = false;
+            }
+        });
+    });
+
+    for (size_t batch : {8, 64, 256}) {
+        char name[32];
+        snprintf(name, sizeof(name), "batch/%zu", batch);
+        bench(name, ctx, [batch](ZMQWReceiver& recv, std::atomic<bool>& until, Stats& stats) {
+            recv.worker_batch(&until, batch, [&](RecvBatch& messages) {
+                for (size_t i = 0; i < messages.size(); ++i) {
+                    stats.record(messages.frame(i, 1));
+                }
+                if (stats.latency.size() == MESSAGES) {
+                    until = false;
+                }
+            });
+        });
+    }
+    return 0;
+}
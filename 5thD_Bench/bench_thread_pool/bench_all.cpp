@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+/**
+ * ThreadPool scaling from 1 to hardware_concurrency() threads, short (~100 ns) and long (~50 us) tasks.
+ * "single queue" is the previous pool design: one std::queue<std::function> behind one mutex.
+ * Usage: 5thDThreadPoolBench [max_threads]
+ */
+
+constexpr size_t SHORT_TASKS = 400000;
+constexpr uint32_t SHORT_SPIN = 64;
+constexpr size_t LONG_TASKS = 4000;
+constexpr uint32_t LONG_SPIN = 40000;
+
+using Clock = std::chrono::steady_clock;
+
+class SingleQueuePool {
+public:
+    explicit SingleQueuePool(size_t num_threads) {
+        for (size_t i = 0; i < num_threads; ++i) {
+            _workers.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(_lock);
+                        _cond.wait(lock, [this] { return _stop || !_tasks.empty(); });
+                        if (_stop && _tasks.empty()) {
+                            return;
+                        }
+                        task = std::move(_tasks.front());
+                        _tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~SingleQueuePool() {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stop = true;
+        }
+        _cond.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    void enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _tasks.push(std::move(task));
+        }
+        _cond.notify_one();
+    }
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _lock;
+    std::condition_variable _cond;
+    bool _stop = false;
+};
+
+static uint32_t spin(uint32_t seed, uint32_t rounds) {
+    for (uint32_t i = 0; i < rounds; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+    }
+    return seed;
+}
+
+struct Sink {
+    std::atomic<size_t> done{0};
+    std::atomic<uint32_t> value{0};
+};
+
+static double wait_all(Sink& sink, size_t tasks, Clock::time_point start) {
+    while (sink.done.load(std::memory_order_acquire) < tasks) {
+        std::this_thread::yield();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double run_single_queue(size_t threads, size_t tasks, uint32_t rounds) {
+    SingleQueuePool pool(threads);
+    Sink sink;
+    auto start = Clock::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        pool.enqueue([&sink, i, rounds] {
+            sink.value.fetch_xor(spin(uint32_t(i) | 1, rounds), std::memory_order_relaxed);
+            sink.done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    return wait_all(sink, tasks, start);
+}
+
+static double run_enqueue(size_t threads, size_t tasks, uint32_t rounds) {
+    ThreadPool pool(threads);
+    Sink sink;
+    auto start = Clock::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        pool.enqueue([&sink, i, rounds] {
+            sink.value.fetch_xor(spin(uint32_t(i) | 1, rounds), std::memory_order_relaxed);
+            sink.done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    return wait_all(sink, tasks, start);
+}
+
+static double run_parallel_for(size_t threads, size_t tasks, uint32_t rounds) {
+    ThreadPool pool(threads);
+    std::atomic<uint32_t> value{0};
+    auto start = Clock::now();
+    pool.parallel_for<size_t>(0, tasks, [&value, rounds](size_t i) {
+        value.fetch_xor(spin(uint32_t(i) | 1, rounds), std::memory_order_relaxed);
+    });
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void scale(const char* name, size_t max_threads, size_t tasks, uint32_t rounds) {
+    printf("\n%s: %zu tasks\n", name, tasks);
+    printf("%8s %16s %16s %16s\n", "threads", "single queue ms", "enqueue ms", "parallel_for ms");
+    for (size_t threads = 1; threads <= max_threads; threads = threads < max_threads ? std::min(threads * 2, max_threads) : threads + 1) {
+        printf("%8zu %16.1f %16.1f %16.1f\n", threads, run_single_queue(threads, tasks, rounds),
+               run_enqueue(threads, tasks, rounds), run_parallel_for(threads, tasks, rounds));
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    scale("short tasks", max_threads, SHORT_TASKS, SHORT_SPIN);
+    scale("long tasks", max_threads, LONG_TASKS, LONG_SPIN);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <zmq.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "izmq.h"
+#include "transmitter.h"
+
+/**
+ * ZMQWTransmitter::send (chunk + memcpy) vs ZMQWTransmitter::send_zero_copy (zmq_msg_init_data)
+ * over inproc DEALER -> ROUTER, payloads 4 KiB .. 16 MiB.
+ */
+
+constexpr const char* ENDPOINT = "inproc://bench_zero_copy";
+constexpr size_t POOL_BUFFERS = 4;
+constexpr size_t TOTAL_BYTES_PER_RUN = 256u << 20;
+
+struct PoolBuffer {
+    std::unique_ptr<char[]> data;
+    std::atomic<bool> busy{false};
+};
+
+static void release_pool_buffer(void* data, void* hint) {
+    static_cast<PoolBuffer*>(hint)->busy.store(false, std::memory_order_release);
+}
+
+static void drain(void* router, size_t messages) {
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    for (size_t i = 0; i < messages; ++i) {
+        do {
+            zmq_msg_recv(&frame, router, 0);
+        } while (zmq_msg_more(&frame));
+    }
+    zmq_msg_close(&frame);
+}
+
+static double run(ZMQWTransmitter& trans, void* router, std::vector<PoolBuffer>& pool, size_t payload,
+                  bool zero_copy) {
+    size_t messages = std::max<size_t>(TOTAL_BYTES_PER_RUN / payload, 8);
+    std::thread receiver(drain, router, messages);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messages; ++i) {
+        PoolBuffer& buffer = pool[i % pool.size()];
+        if (zero_copy) {
+            // wait until libzmq handed this buffer back before reusing it
+            while (buffer.busy.exchange(true, std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            trans.send_zero_copy(buffer.data.get(), payload, release_pool_buffer, &buffer);
+        } else {
+            trans.send(buffer.data.get(), payload);
+        }
+    }
+    receiver.join();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto& buffer : pool) {
+        while (buffer.busy.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    return (messages * payload) / elapsed / (1024.0 * 1024.0);
+}
+
+int main() {
+    Log::init();
+    spdlog::set_level(spdlog::level::off);
+
+    constexpr size_t max_payload = 16u << 20;
+    std::vector<PoolBuffer> pool(POOL_BUFFERS);
+    for (auto& buffer : pool) {
+        buffer.data = std::make_unique<char[]>(max_payload);
+        memset(buffer.data.get(), 0xA5, max_payload);
+    }
+
+    ZMQWContext ctx;
+    ZMQWSocket router(&ctx, ZMQ_ROUTER);
+    ZMQWSocket dealer(&ctx, ZMQ_DEALER);
+    zmq_bind(router.get_socket(), ENDPOINT);
+
+    ZMQWTransmitter trans(&ctx, &dealer, "benchtx");
+    trans.connect(ENDPOINT, 0);
+
+    printf("%-10s %14s %14s %8s\n", "payload", "copy MiB/s", "zc MiB/s", "ratio");
+    for (size_t payload = 4u << 10; payload <= max_payload; payload <<= 2) {
+        double copy = run(trans, router.get_socket(), pool, payload, false);
+        double zero_copy = run(trans, router.get_socket(), pool, payload, true);
+        printf("%-10zu %14.1f %14.1f %8.2f\n", payload, copy, zero_copy, zero_copy / copy);
+    }
+    return 0;
+}
@@ -10,7 +10,10 @@
 #include "peer.h"
 #include "5thdipcmsg.h"
 #include "5thdsql.h"
+#include "ipc_trace.h"
+#include "key_store.h"
 #include "keys_db.h"
+#include "startup_profiler.h"
 #include "transmitter.h"
 #include "module.h"
 
@@ -34,13 +37,25 @@ void ipc_msg(ipc_msg_t* msg, int src, int dist) {
 }
 
 int main() {
-    module_init_t config;
-    memset(&config, 0, sizeof(module_init_t));
+    // Value initialized, a memset would wipe the LogConfig defaults
+    module_init_t config{};
     config.keys_info.is_ready = false;
     config.keys_info.key_type = KeyType::CURVE25519;
     config.client_id = Clients::PEER;
-
-    module_init(&config);;
+    // Peer traffic must not stall on logging, a full queue overwrites the oldest record
+    config.log.mode = LogMode::ASYNC;
+    config.log.overflow = LogOverflow::OVERRUN;
+
+    module_init(&config);
+
+    // FIFTHD_IPC_TRACE=N traces one message out of N, FIFTHD_TELEMETRY_FILE=path exports the metrics
+    const char* trace_every = getenv("FIFTHD_IPC_TRACE");
+    IpcTrace::set_sampling(trace_every ? static_cast<uint32_t>(strtoul(trace_every, nullptr, 10)) : 0);
+    const char* telemetry_file = getenv("FIFTHD_TELEMETRY_FILE");
+    FILE* telemetry_out = telemetry_file ? fopen(telemetry_file, "a") : nullptr;
+    if (telemetry_out) {
+        Telemetry::start(std::make_unique<JsonLinesExporter>(telemetry_out));
+    }
 
     // Set up signal handler
     signal(SIGINT, signal_handler);
@@ -53,9 +68,9 @@ int main() {
 
     std::string ipcpub_key;
 
-    DatabaseAccess db;
+    // Same store (and db connection) module_init just used for this module's own keys
     auto ipcrout_pub_key =
-        get_key(db, CLIENTS_IDS[static_cast<int>(Clients::ROUTER)], KeyType::CURVE25519, "public_key");
+        KeyStore::shared().get(CLIENTS_IDS[static_cast<int>(Clients::ROUTER)], KeyType::CURVE25519, "public_key");
 
     if (ipcrout_pub_key.is_err()) {
         ERROR("IPCROUT Public key is unavailable");
@@ -96,12 +111,14 @@ int main() {
     ipc_msg(&ipc_peer_msg, Clients::PEER, Clients::ROUTER);
 
     print_ipc_msg(&ipc_peer_msg);
+    StartupProfiler::report();
 
     while (termination_requested) {
         DEBUG("Sending data");
         ipc_client->send(&ipc_peer_msg);
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
+    Telemetry::stop();
 
     return 0;
 }
\ No newline at end of file
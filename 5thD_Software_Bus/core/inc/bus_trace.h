@@ -0,0 +1,55 @@
+#ifndef BUS_TRACE_H
+#define BUS_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "5thdipcmsg.h"
+#include "5thdlogger.h"
+
+/**
+ * Per message tracing for the bus hot path.
+ * Compile time: BUS_TRACE_ENABLED=0 removes every trace site, arguments included (default follows NDEBUG).
+ * Runtime: sites compiled in only evaluate their arguments after BusTrace::enabled() says so.
+ */
+#ifndef BUS_TRACE_ENABLED
+#    ifndef NDEBUG
+#        define BUS_TRACE_ENABLED 1
+#    else
+#        define BUS_TRACE_ENABLED 0
+#    endif
+#endif
+
+class BusTrace {
+public:
+    static void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Dump the sender identity and the message, only called behind BUS_TRACE_FRAME.
+     */
+    static void frame(const void* identity, size_t identity_size, const ipc_view_t* view);
+
+private:
+    static std::atomic<bool> _enabled;
+};
+
+#if BUS_TRACE_ENABLED
+#    define BUS_TRACE(...)             \
+        do {                           \
+            if (BusTrace::enabled()) { \
+                DEBUG(__VA_ARGS__);    \
+            }                          \
+        } while (0)
+#    define BUS_TRACE_FRAME(identity, identity_size, view)      \
+        do {                                                    \
+            if (BusTrace::enabled()) {                          \
+                BusTrace::frame(identity, identity_size, view); \
+            }                                                   \
+        } while (0)
+#else
+#    define BUS_TRACE(...) (void) 0
+#    define BUS_TRACE_FRAME(identity, identity_size, view) (void) 0
+#endif
+
+#endif  // BUS_TRACE_H
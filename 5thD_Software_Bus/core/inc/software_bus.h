@@ -1,14 +1,30 @@
 #ifndef SOFTWARE_BUS_H
 #define SOFTWARE_BUS_H
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "5thdbuffer.h"
 #include "5thderror_handler.h"
 #include "5thdipcmsg.h"
 #include "receiver.h"
+#include "routing_table.h"
+#include "telemetry.h"
 
+#define BUS_DISPATCH_BATCH 64
+/**
+ * @brief Snapshot of one bus worker, queue_depth is dispatched - handled at snapshot time.
+ */
+struct BusWorkerStats {
+    uint64_t dispatched;
+    uint64_t handled;
+    uint64_t queue_depth;
+    uint64_t max_queue_depth;
+};
 
 class ZMQBus {
 public:
@@ -18,25 +34,66 @@ public:
           _msg_buffer(init_allmsg, deinit_allmsg) {
         _init();
     }
+    /**
+     * @brief Multi worker bus, the ROUTER thread only moves frames and num_workers threads do the routing.
+     * Messages are sharded by sender identity so every sender keeps its ordering.
+     * @note num_workers <= 1 is the single threaded bus.
+     */
+    ZMQBus(IReceiver* receiver, IContext* ctx, size_t num_workers)
+        : _router(receiver),
+          _ctx(ctx),
+          _num_workers(num_workers),
+          _error(_drp),
+          _msg_buffer(init_allmsg, deinit_allmsg) {
+        _init();
+    }
     ~ZMQBus();
     void set_security(const char* pub_key, const char* prv_key);
     void run();
     static void signal_handler(int sign);
 
+    /**
+     * @brief Per worker counters, empty for the single threaded bus. Safe from any thread.
+     */
+    std::vector<BusWorkerStats> worker_stats() const;
+
 protected:
     ErrorHandler _error;
     DisasterRecoveryPlan _drp;
 
 private:
+    struct alignas(64) Worker {
+        void* dispatch = nullptr;  // PUSH, owned by the ROUTER thread
+        std::thread thread;
+        std::atomic<uint64_t> dispatched{0};
+        std::atomic<uint64_t> handled{0};
+        std::atomic<uint64_t> max_depth{0};
+    };
+
     IReceiver* _router;
-    std::unordered_map<int, std::string> _clients;
-    std::mutex _clients_mutex;
+    IContext* _ctx = nullptr;
+    size_t _num_workers = 1;
+    RoutingTable _routes;
     static std::atomic<bool> _poll;
     ManagedBuffer<ZMQAllMsg, 10> _msg_buffer;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<bool> _workers_run{false};  // Per bus, cleared before workers are joined
+    void* _replies = nullptr;  // PULL, workers push routed messages here
+    Counter _tm_messages;
+    Counter _tm_unroutable;
+    Histogram _tm_handle_ns;  // receipt of the identity frame to the routed send
     void _init();
     void _handle_msg(void* sock);
+    bool _route(const void* identity, size_t identity_size, const ipc_view_t& view, zmq_msg_t* payload, Route& dst);
+    bool _handle_local(const ipc_view_t& view, zmq_msg_t* payload);
+    void _run_workers();
+    void _worker_loop(size_t index);
+    void _dispatch(void* router);
+    void _forward_replies(void* router);
+    VoidResult _start_workers();
+    void _stop_workers();
     VoidResult _recv_message(void* sock, ipc_msg_t* msg);
-    VoidResult _send_message(void* sock, const ipc_msg_t* msg, const std::string& identity);
+    VoidResult _send_message(void* sock, zmq_msg_t* payload, const Route& route);
 };
 
 #endif  // SOFTWARE_BUS_H
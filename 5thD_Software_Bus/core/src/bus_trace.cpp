@@ -0,0 +1,10 @@
+#include <string_view>
+
+#include "bus_trace.h"
+
+std::atomic<bool> BusTrace::_enabled(false);
+
+void BusTrace::frame(const void* identity, size_t identity_size, const ipc_view_t* view) {
+    DEBUG("Received from id: {}", std::string_view(static_cast<const char*>(identity), identity_size));
+    print_ipc_view(view);
+}
@@ -1,14 +1,32 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
 #include <cstring>
 #include <functional>
 #include <unordered_map>
 
 #include "5thdipcmsg.h"
 #include "5thdlogger.h"
+#include "bus_trace.h"
+#include "ipc_messages.h"
+#include "ipc_trace.h"
 #include "software_bus.h"
 #include "zmq.h"
 
 std::atomic<bool> ZMQBus::_poll(true);  // Initialize as true
 
+namespace {
+    // FNV-1a, identities are short so this is cheaper than std::hash<std::string> and needs no copy
+    size_t identity_hash(const void* identity, size_t num_bytes) {
+        auto bytes = static_cast<const uint8_t*>(identity);
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < num_bytes; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+}  // namespace
+
 VoidResult ZMQBus::_recv_message(void* sock, ipc_msg_t* msg) {
     auto request = _msg_buffer.get_slot();
     int rc;
@@ -23,11 +41,12 @@ VoidResult ZMQBus::_recv_message(void* sock, ipc_msg_t* msg) {
         return Err(ErrorCode::FIAIL_RECV_MSG, "Failed to receive message");
     }
 
-    if (zmq_msg_size(&request->msg) != sizeof(ipc_msg_t)) {
+    // Either wire format, v1 bodies that don't fit the legacy struct are rejected
+    ipc_view_t view;
+    if (ipc_parse(zmq_msg_data(&request->msg), zmq_msg_size(&request->msg), &view) != 0
+        || ipc_to_legacy(&view, msg) != 0) {
         return Err(ErrorCode::FIAIL_RECV_MSG, "Message size wierd :/");
     }
-
-    memcpy(msg, zmq_msg_data(&request->msg), sizeof(ipc_msg_t));
     auto ret = _msg_buffer.release_slot(&request);
     if (ret.is_err()) {
         WARN("Buffer fail to release mem");
@@ -35,16 +54,8 @@ VoidResult ZMQBus::_recv_message(void* sock, ipc_msg_t* msg) {
     return Ok();
 }
 
-VoidResult ZMQBus::_send_message(void* sock, const ipc_msg_t* msg, const std::string& identity) {
-    int rc;
-    auto replay = _msg_buffer.get_slot();
-    if (!replay) {
-        ERROR("Got null from bus msg buffer frame dropped");
-        return Ok();
-    }
-
-    memcpy(zmq_msg_data(&replay->identity), identity.c_str(), identity.size());
-    rc = zmq_msg_send(&replay->identity, sock, ZMQ_SNDMORE);
+VoidResult ZMQBus::_send_message(void* sock, zmq_msg_t* payload, const Route& route) {
+    int rc = zmq_send(sock, route.id, route.size, ZMQ_SNDMORE);
     if (rc == -1) {
         return Err(ErrorCode::FAIL_SEND_FRAME, "Fail to send identity frame");
     }
@@ -55,21 +66,16 @@ VoidResult ZMQBus::_send_message(void* sock, const ipc_msg_t* msg, const std::st
         return Err(ErrorCode::FAIL_SEND_FRAME, "Fail to send empty frame");
     }
 
-    memcpy(zmq_msg_data(&replay->msg), msg, sizeof(ipc_msg_t));
-    rc = zmq_msg_send(&replay->msg, sock, 0);
+    // Payload goes out as received, whatever its format version
+    rc = zmq_msg_send(payload, sock, 0);
     if (rc == -1) {
         return Err(ErrorCode::FAIL_SEND_FRAME, "Fail to send message frame");
     }
-
-    auto ret = _msg_buffer.release_slot(&replay);
-    if (ret.is_err()) {
-        WARN("Buffer fail to release mem");
-    }
     return Ok();
 }
 
 void ZMQBus::_handle_msg(void* sock) {
-    ipc_msg_t data;
+    TelemetryTimer timer(_tm_handle_ns);
     int rc;
     auto all_msg = _msg_buffer.get_slot();
 
@@ -88,53 +94,109 @@ void ZMQBus::_handle_msg(void* sock) {
         return;
     }
 
-    int64_t more = 1;
-    size_t more_size = sizeof(more);
-    do {
-        zmq_msg_init(&all_msg->msg);
-        rc = zmq_msg_recv(&all_msg->msg, sock, 0);
+    ipc_view_t view;
+    bool has_data = false;
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    bool more = zmq_msg_more(&all_msg->identity);
+    while (more) {
+        rc = zmq_msg_recv(&frame, sock, 0);
+        if (rc == -1) {
+            break;
+        }
+        more = zmq_msg_more(&frame);
         if (rc == 0) {
-            DEBUG("Empty frame received");
-        } else {
-            if (rc == sizeof(ipc_msg_t)) {
-                std::memcpy(&data, zmq_msg_data(&all_msg->msg), rc);
-            }
+            BUS_TRACE("Empty frame received");
+        } else if (ipc_parse(zmq_msg_data(&frame), zmq_msg_size(&frame), &view) == 0) {
+            // Keep the frame itself, the body is forwarded without a copy
+            zmq_msg_move(&all_msg->msg, &frame);
+            has_data = true;
         }
-        /* Determine if more message parts are to follow */
-        rc = zmq_getsockopt(sock, ZMQ_RCVMORE, &more, &more_size);
-        zmq_msg_close(&all_msg->msg);
-    } while (more);
+    }
+    zmq_msg_close(&frame);
+    // Small frames are stored inside zmq_msg_t, the move copied their bytes: view the frame where it is now
+    if (has_data && ipc_parse(zmq_msg_data(&all_msg->msg), zmq_msg_size(&all_msg->msg), &view) == 0 && view.trace) {
+        IpcTrace::stamp(zmq_msg_data(&all_msg->msg), zmq_msg_size(&all_msg->msg), IPC_HOP_BUS_IN);
+    }
 
-    // Copy sender Id
-    std::string src_id(static_cast<char*>(zmq_msg_data(&all_msg->identity)), zmq_msg_size(&all_msg->identity));
+    Route dst;
+    if (!has_data
+        || !_route(zmq_msg_data(&all_msg->identity), zmq_msg_size(&all_msg->identity), view, &all_msg->msg, dst)) {
+        return;
+    }
+    // Route is copied out of the table, the send itself runs without holding anything
+    auto send_ret = _send_message(sock, &all_msg->msg, dst);
+    if (send_ret.is_err()) {
+        ERROR("Failed to send message");
+        _error.handle_error(send_ret.error());
+    }
+}
 
-    DEBUG("Received from id: {}", src_id);
-    print_ipc_msg(&data);
+static void trace_bus_out(const ipc_view_t& view, zmq_msg_t* payload) {
+    if (view.trace) {
+        // view.trace points into payload, the fresh stamp is read back by record_bus
+        IpcTrace::stamp(zmq_msg_data(payload), zmq_msg_size(payload), IPC_HOP_BUS_OUT);
+        IpcTrace::record_bus(view);
+    }
+}
+
+bool ZMQBus::_route(const void* identity, size_t identity_size, const ipc_view_t& view, zmq_msg_t* payload,
+                    Route& dst) {
+    BUS_TRACE_FRAME(identity, identity_size, &view);
+    _tm_messages.add();
 
-    {
-        std::lock_guard<std::mutex> lock(_clients_mutex);
-        auto it_src = _clients.find(data.src_id);
-        if (it_src == _clients.end()) {
-            _clients.insert({data.src_id, src_id});
+    // Raw identity bytes are compared against the known route, nothing is copied unless it changed
+    _routes.update(view.hdr.src_id, identity, identity_size);
+
+    if (view.hdr.dst_id == Clients::ROUTER) {
+        // Recorded before the handler, the answer replaces payload and view with it
+        trace_bus_out(view, payload);
+        // Addressed to the bus itself, the answer replaces payload and goes back to the sender
+        if (!_handle_local(view, payload)) {
+            _tm_unroutable.add();
+            return false;
         }
+        dst.size = static_cast<uint8_t>(identity_size);
+        memcpy(dst.id, identity, identity_size);
+        return true;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(_clients_mutex);
-        auto it_dst = _clients.find(data.dist_id);
-        if (it_dst == _clients.end()) {
-            WARN("The destination: {} never registered", CLIENTS_IDS[data.dist_id]);
-            return;
-        }
-        auto send_ret = _send_message(sock, &data, it_dst->second);
-        if (send_ret.is_err()) {
-            ERROR("Failed to send message");
-            _error.handle_error(send_ret.error());
+    int dst_id = view.hdr.dst_id;
+    if (!_routes.lookup(dst_id, dst)) {
+        WARN("The destination: {} never registered", dst_id);
+        _tm_unroutable.add();
+        return false;
+    }
+    trace_bus_out(view, payload);
+    return true;
+}
+
+bool ZMQBus::_handle_local(const ipc_view_t& view, zmq_msg_t* payload) {
+    uint16_t type_id = view.hdr.type_id;
+    switch (type_id) {
+        case BusPing::TYPE_ID: {
+            // view points into payload, decode before it is replaced
+            BusPing ping;
+            if (!IpcCodec<BusPing>::decode(view, ping)) {
+                return false;
+            }
+            BusPong pong{ping.seq, static_cast<uint32_t>(std::max<size_t>(_workers.size(), 1))};
+            size_t frame_size = IpcCodec<BusPong>::frame_size(pong);
+            zmq_msg_close(payload);
+            zmq_msg_init_size(payload, frame_size);
+            // Ping timestamp is echoed so the sender can take the round trip
+            IpcCodec<BusPong>::encode(pong, Clients::ROUTER, view.hdr.src_id, zmq_msg_data(payload), frame_size,
+                                      view.hdr.timestamp);
+            return true;
         }
+        default:
+            WARN("Bus has no handler for type {}", type_id);
+            return false;
     }
 }
 
 ZMQBus::~ZMQBus() {
+    _stop_workers();
     _router->close();
     DEBUG("Closed bus");
 }
@@ -148,9 +210,238 @@ void ZMQBus::set_security(const char* pub_key, const char* prv_key) {
 void ZMQBus::run() {
     _router->listen();
 
+    if (!_workers.empty()) {
+        _run_workers();
+        return;
+    }
     _router->worker(&_poll, std::bind(&ZMQBus::_handle_msg, this, std::placeholders::_1));
 }
 
+void ZMQBus::_run_workers() {
+    auto ret = _start_workers();
+    if (ret.is_err()) {
+        _error.handle_error(ret.error());
+        _stop_workers();
+        return;
+    }
+
+    void* router = _router->get_socket();
+    zmq_pollitem_t items[] = {{router, 0, ZMQ_POLLIN, 0}, {_replies, 0, ZMQ_POLLIN, 0}};
+
+    DEBUG("Bus front started with {} workers", _workers.size());
+
+    while (_poll) {
+        auto rc = zmq_poll(items, 2, 500);  // Poll with 500 ms timeout
+
+        if (rc == (int) ErrorCode::OK) {
+            continue;
+        } else if (rc == -1) {
+            ERROR("Error in zmq_poll {}", zmq_strerror(zmq_errno()));
+            break;
+        }
+        if (items[0].revents & ZMQ_POLLIN) {
+            _dispatch(router);
+        }
+        if (items[1].revents & ZMQ_POLLIN) {
+            _forward_replies(router);
+        }
+    }
+
+    _stop_workers();
+    auto stats = worker_stats();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        DEBUG("Bus worker {}: handled {} max queue depth {}", i, stats[i].handled, stats[i].max_queue_depth);
+    }
+}
+
+VoidResult ZMQBus::_start_workers() {
+    char endpoint[64];
+
+    _replies = zmq_socket(_ctx->get_context(), ZMQ_PULL);
+    snprintf(endpoint, sizeof(endpoint), "inproc://bus-replies-%p", static_cast<void*>(this));
+    if (!_replies || zmq_bind(_replies, endpoint) != (int) ErrorCode::OK) {
+        return Err(ErrorCode::FAIL_BIND_SOCKET, "Failed to bind bus replies socket", Severity::HIGH);
+    }
+
+    // Bind everything before any worker connects
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        auto& worker = _workers[i];
+        worker->dispatch = zmq_socket(_ctx->get_context(), ZMQ_PUSH);
+        snprintf(endpoint, sizeof(endpoint), "inproc://bus-worker-%p-%zu", static_cast<void*>(this), i);
+        if (!worker->dispatch || zmq_bind(worker->dispatch, endpoint) != (int) ErrorCode::OK) {
+            return Err(ErrorCode::FAIL_BIND_SOCKET, "Failed to bind bus worker socket", Severity::HIGH);
+        }
+    }
+
+    _workers_run.store(true, std::memory_order_release);
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->thread = std::thread(&ZMQBus::_worker_loop, this, i);
+    }
+    return Ok();
+}
+
+void ZMQBus::_stop_workers() {
+    // _poll is process wide and may still be set (poll error, bus destroyed without a signal)
+    _workers_run.store(false, std::memory_order_release);
+    int linger = 0;
+    for (auto& worker : _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        if (worker->dispatch) {
+            zmq_setsockopt(worker->dispatch, ZMQ_LINGER, &linger, sizeof(linger));
+            zmq_close(worker->dispatch);
+            worker->dispatch = nullptr;
+        }
+    }
+    if (_replies) {
+        zmq_setsockopt(_replies, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_close(_replies);
+        _replies = nullptr;
+    }
+}
+
+void ZMQBus::_dispatch(void* router) {
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+
+    for (size_t n = 0; n < BUS_DISPATCH_BATCH; ++n) {
+        if (zmq_msg_recv(&frame, router, ZMQ_DONTWAIT) == -1) {
+            break;
+        }
+
+        // Identity frame picks the worker, same sender always lands on the same worker
+        auto& worker = *_workers[identity_hash(zmq_msg_data(&frame), zmq_msg_size(&frame)) % _workers.size()];
+
+        bool more = true;
+        while (more) {
+            more = zmq_msg_more(&frame);
+            if (zmq_msg_send(&frame, worker.dispatch, more ? ZMQ_SNDMORE : 0) == -1) {
+                ERROR("Failed to dispatch frame {}", zmq_strerror(zmq_errno()));
+            }
+            if (more) {
+                zmq_msg_recv(&frame, router, 0);
+            }
+        }
+
+        // Only this thread writes dispatched and max_depth
+        uint64_t dispatched = worker.dispatched.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t depth = dispatched - worker.handled.load(std::memory_order_relaxed);
+        if (depth > worker.max_depth.load(std::memory_order_relaxed)) {
+            worker.max_depth.store(depth, std::memory_order_relaxed);
+        }
+    }
+    zmq_msg_close(&frame);
+}
+
+void ZMQBus::_forward_replies(void* router) {
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+
+    for (size_t n = 0; n < BUS_DISPATCH_BATCH; ++n) {
+        if (zmq_msg_recv(&frame, _replies, ZMQ_DONTWAIT) == -1) {
+            break;
+        }
+        bool more = true;
+        while (more) {
+            more = zmq_msg_more(&frame);
+            if (zmq_msg_send(&frame, router, more ? ZMQ_SNDMORE : 0) == -1) {
+                ERROR("Failed to send routed frame {}", zmq_strerror(zmq_errno()));
+            }
+            if (more) {
+                zmq_msg_recv(&frame, _replies, 0);
+            }
+        }
+    }
+    zmq_msg_close(&frame);
+}
+
+void ZMQBus::_worker_loop(size_t index) {
+    auto& worker = *_workers[index];
+    char endpoint[64];
+
+    void* in = zmq_socket(_ctx->get_context(), ZMQ_PULL);
+    void* out = zmq_socket(_ctx->get_context(), ZMQ_PUSH);
+    snprintf(endpoint, sizeof(endpoint), "inproc://bus-worker-%p-%zu", static_cast<void*>(this), index);
+    zmq_connect(in, endpoint);
+    snprintf(endpoint, sizeof(endpoint), "inproc://bus-replies-%p", static_cast<void*>(this));
+    zmq_connect(out, endpoint);
+
+    zmq_pollitem_t items[] = {{in, 0, ZMQ_POLLIN, 0}};
+    zmq_msg_t identity;
+    zmq_msg_t frame;
+    zmq_msg_t payload;
+    zmq_msg_init(&identity);
+    zmq_msg_init(&frame);
+    zmq_msg_init(&payload);
+
+    while (_poll && _workers_run.load(std::memory_order_acquire)) {
+        auto rc = zmq_poll(items, 1, 500);  // Poll with 500 ms timeout
+        if (rc == (int) ErrorCode::OK) {
+            continue;
+        } else if (rc == -1) {
+            ERROR("Error in bus worker zmq_poll {}", zmq_strerror(zmq_errno()));
+            break;
+        }
+
+        while (zmq_msg_recv(&identity, in, ZMQ_DONTWAIT) != -1) {
+            TelemetryTimer timer(_tm_handle_ns);
+            ipc_view_t view;
+            bool has_data = false;
+            bool more = zmq_msg_more(&identity);
+            while (more) {
+                if (zmq_msg_recv(&frame, in, 0) == -1) {
+                    // Whatever was parsed belongs to a message we no longer have in full
+                    ERROR("Bus worker {} failed to receive frame {}", index, zmq_strerror(zmq_errno()));
+                    has_data = false;
+                    break;
+                }
+                more = zmq_msg_more(&frame);
+                if (zmq_msg_size(&frame) > 0 && ipc_parse(zmq_msg_data(&frame), zmq_msg_size(&frame), &view) == 0) {
+                    zmq_msg_move(&payload, &frame);
+                    has_data = true;
+                }
+            }
+            // Parsed again from payload, a small frame's bytes live inside the zmq_msg_t and moved with it
+            if (has_data && ipc_parse(zmq_msg_data(&payload), zmq_msg_size(&payload), &view) == 0 && view.trace) {
+                IpcTrace::stamp(zmq_msg_data(&payload), zmq_msg_size(&payload), IPC_HOP_BUS_IN);
+            }
+            // Counted once dequeued so queue_depth is only what still waits in the pipe
+            worker.handled.fetch_add(1, std::memory_order_relaxed);
+
+            Route dst;
+            // view was taken from payload, the frame is forwarded without a copy
+            if (has_data && _route(zmq_msg_data(&identity), zmq_msg_size(&identity), view, &payload, dst)) {
+                if (zmq_send(out, dst.id, dst.size, ZMQ_SNDMORE) == -1 || zmq_send(out, "", 0, ZMQ_SNDMORE) == -1
+                    || zmq_msg_send(&payload, out, 0) == -1) {
+                    ERROR("Bus worker {} failed to send message", index);
+                }
+            }
+        }
+    }
+
+    zmq_msg_close(&payload);
+    zmq_msg_close(&frame);
+    zmq_msg_close(&identity);
+    int linger = 0;
+    zmq_setsockopt(out, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_setsockopt(in, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_close(out);
+    zmq_close(in);
+}
+
+std::vector<BusWorkerStats> ZMQBus::worker_stats() const {
+    std::vector<BusWorkerStats> stats;
+    stats.reserve(_workers.size());
+    for (const auto& worker : _workers) {
+        uint64_t handled = worker->handled.load(std::memory_order_relaxed);
+        uint64_t dispatched = worker->dispatched.load(std::memory_order_relaxed);
+        stats.push_back({dispatched, handled, dispatched > handled ? dispatched - handled : 0,
+                         worker->max_depth.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
 void ZMQBus::signal_handler(int sign) {
     if (sign == SIGINT || sign == SIGTERM) {
         DEBUG("Termination signal received. Cleaning up...");
@@ -160,4 +451,13 @@ void ZMQBus::signal_handler(int sign) {
 
 void ZMQBus::_init() {
     _router->set_endpoint(IPC_ENDPOINT);
+    _tm_messages = Telemetry::counter("bus.messages");
+    _tm_unroutable = Telemetry::counter("bus.unroutable");
+    _tm_handle_ns = Telemetry::histogram("bus.handle_ns");
+
+    if (_num_workers > 1 && _ctx) {
+        for (size_t i = 0; i < _num_workers; ++i) {
+            _workers.push_back(std::make_unique<Worker>());
+        }
+    }
 }
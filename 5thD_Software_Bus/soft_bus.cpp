@@ -1,34 +1,73 @@
 #include <zmq.h>
+#include <csignal>
+#include <cstdlib>
 #include <memory>
 
+#include "bus_trace.h"
+#include "ipc_trace.h"
 #include "keys_db.h"
 #include "module.h"
 #include "software_bus.h"
+#include "startup_profiler.h"
 
-int main() {
-    module_init_t config;
-    memset(&config, 0, sizeof(module_init_t));
+// Usage: 5thDSoftwareBus [workers], 1 (default) keeps the single threaded bus
+// FIFTHD_BUS_TRACE=1 turns per message tracing on (debug builds / BUS_TRACE_ENABLED only)
+// FIFTHD_TELEMETRY_FILE=path appends metrics as JSON lines, hop latencies included (see 5thDTraceReport)
+int main(int argc, char* argv[]) {
+    size_t workers = 1;
+    if (argc > 1) {
+        long requested = strtol(argv[1], nullptr, 10);
+        if (requested > 0) {
+            workers = static_cast<size_t>(requested);
+        }
+    }
+
+    const char* trace = getenv("FIFTHD_BUS_TRACE");
+    BusTrace::set_enabled(trace && trace[0] == '1');
+
+    const char* telemetry_file = getenv("FIFTHD_TELEMETRY_FILE");
+    FILE* telemetry_out = telemetry_file ? fopen(telemetry_file, "a") : nullptr;
+    if (telemetry_out) {
+        Telemetry::start(std::make_unique<JsonLinesExporter>(telemetry_out));
+    }
+
+    // Value initialized, a memset would wipe the LogConfig defaults
+    module_init_t config{};
     config.keys_info.is_ready = false;
     config.keys_info.key_type = KeyType::CURVE25519;
     config.client_id = Clients::ROUTER;
+    // The routing threads never wait on the console, a full queue drops the new message
+    config.log.mode = LogMode::ASYNC;
+    config.log.overflow = LogOverflow::DROP;
 
     module_init(&config);
 
+    // FIFTHD_STARTUP_PROFILE=1 logs where startup time went, see startup_profiler.h
+    auto setup_phase = std::make_unique<StartupPhase>("bus.setup");
     auto ctx = std::make_unique<ZMQWContext>();
     auto socket = std::make_unique<ZMQWSocket>(ctx.get(), ZMQ_ROUTER);
     auto recv =
         std::make_unique<ZMQWReceiver>(CLIENTS_IDS[static_cast<int>(config.client_id)], 0, ctx.get(), socket.get());
     recv->set_endpoint(IPC_ENDPOINT);
-    auto bus = std::make_unique<ZMQBus>(recv.get());
+    auto bus = std::make_unique<ZMQBus>(recv.get(), ctx.get(), workers);
 
     signal(SIGINT, bus->signal_handler);
     signal(SIGTERM, bus->signal_handler);
 
     bus->set_security(config.keys_info.curve_pub, config.keys_info.curve_prv);
     config.keys_info.deinit();
+    setup_phase.reset();
+    StartupProfiler::report();
 
     bus->run();
-    
+
+    // Hops of messages the senders traced, nothing when none were
+    auto routes = IpcTrace::report(Telemetry::snapshot().histograms);
+    if (!routes.empty()) {
+        INFO("Bus hop latency\n{}", IpcTrace::format_report(routes));
+    }
+    Telemetry::stop();
+
     DEBUG("Clearing router...");
     return 0;
 }
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "5thdbuffer.h"
+#include "5thdlfbuffer.h"
+#include "unity.h"
+
+struct Payload {
+    uint64_t value;
+};
+
+static void init_payload(Payload& p) {
+    p.value = 0;
+}
+
+static void deinit_payload(Payload& p) {
+    p.value = 0;
+}
+
+using LFBuffer = LockFreeManagedBuffer<Payload, 8>;
+using LFMagBuffer = LockFreeManagedBuffer<Payload, 64, 4>;
+
+std::unique_ptr<LFBuffer> buffer;
+std::unique_ptr<LFMagBuffer> mag_buffer;
+
+void setUp(void) {
+    buffer = std::make_unique<LFBuffer>(init_payload, deinit_payload);
+    mag_buffer = std::make_unique<LFMagBuffer>(init_payload, deinit_payload);
+}
+
+void tearDown(void) {
+    mag_buffer.reset();
+    buffer.reset();
+}
+
+void test_LFBuffer_exhaust(void) {
+    std::vector<Payload*> slots;
+    for (size_t i = 0; i < buffer->capacity(); ++i) {
+        auto slot = buffer->get_slot();
+        TEST_ASSERT_NOT_NULL(slot);
+        slots.push_back(slot);
+    }
+    TEST_ASSERT(buffer->is_full().value());
+    TEST_ASSERT_NULL(buffer->get_slot());
+
+    for (auto& slot : slots) {
+        TEST_ASSERT(buffer->release_slot(&slot).is_ok());
+        TEST_ASSERT_NULL(slot);
+    }
+    TEST_ASSERT(buffer->is_empty().value());
+}
+
+void test_LFBuffer_double_release(void) {
+    auto slot = buffer->get_slot();
+    auto copy = slot;
+    TEST_ASSERT(buffer->release_slot(&slot).is_ok());
+    TEST_ASSERT(buffer->release_slot(&copy).is_err());
+}
+
+void test_LFBuffer_release_out_of_range(void) {
+    Payload outsider;
+    Payload* ptr = &outsider;
+    Payload* null_ptr = nullptr;
+    TEST_ASSERT(buffer->release_slot(&ptr).is_err());
+    TEST_ASSERT(buffer->release_slot(&null_ptr).is_err());
+}
+
+void test_LFBuffer_magazine_steal(void) {
+    // Park slots in a magazine of a thread that exits, main thread must still get all of them
+    std::thread parker([] {
+        Payload* slots[4];
+        for (auto& slot : slots) {
+            slot = mag_buffer->get_slot();
+        }
+        for (auto& slot : slots) {
+            mag_buffer->release_slot(&slot);
+        }
+    });
+    parker.join();
+
+    std::vector<Payload*> slots;
+    Payload* slot;
+    while ((slot = mag_buffer->get_slot()) != nullptr) {
+        slots.push_back(slot);
+    }
+    TEST_ASSERT_EQUAL_UINT64(mag_buffer->capacity(), slots.size());
+    for (auto& s : slots) {
+        mag_buffer->release_slot(&s);
+    }
+}
+
+void test_LFBuffer_concurrent(void) {
+    std::atomic<bool> collision{false};
+    std::vector<std::thread> threads;
+    for (uint64_t t = 1; t <= 8; ++t) {
+        threads.emplace_back([t, &collision] {
+            for (int i = 0; i < 20000; ++i) {
+                auto slot = mag_buffer->get_slot();
+                if (!slot) {
+                    continue;
+                }
+                slot->value = t;
+                std::this_thread::yield();
+                if (slot->value != t) {
+                    collision = true;
+                }
+                mag_buffer->release_slot(&slot);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    TEST_ASSERT_FALSE(collision);
+    TEST_ASSERT(mag_buffer->is_empty().value());
+    TEST_ASSERT(mag_buffer->check_integrity().is_ok());
+}
+
+void test_ManagedBuffer_exhaust(void) {
+    ManagedBuffer<Payload, 4> locked(init_payload, deinit_payload);
+    Payload* slots[4];
+    for (auto& slot : slots) {
+        slot = locked.get_slot();
+        TEST_ASSERT_NOT_NULL(slot);
+    }
+    TEST_ASSERT_NULL(locked.get_slot());
+    for (auto& slot : slots) {
+        TEST_ASSERT(locked.release_slot(&slot).is_ok());
+    }
+}
+
+int main(void) {
+    Log::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_LFBuffer_exhaust);
+    RUN_TEST(test_LFBuffer_double_release);
+    RUN_TEST(test_LFBuffer_release_out_of_range);
+    RUN_TEST(test_LFBuffer_magazine_steal);
+    RUN_TEST(test_LFBuffer_concurrent);
+    RUN_TEST(test_ManagedBuffer_exhaust);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <zmq.h>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "5thdipcmsg.h"
+#include "ipc_messages.h"
+#include "ipc_trace.h"
+#include "izmq.h"
+#include "receiver.h"
+#include "software_bus.h"
+#include "unity.h"
+
+#define TEST_BUS_ENDPOINT "inproc://test_bus"
+#define TEST_BUS_WORKERS 4
+#define TEST_BUS_DEALERS 8
+
+std::unique_ptr<ZMQWContext> context;
+
+void setUp(void) {
+    context = std::make_unique<ZMQWContext>();
+}
+
+void tearDown(void) {
+    context.reset();
+}
+
+static bool recv_reply(void* dealer, std::vector<uint8_t>* payload) {
+    int timeout = 2000;
+    zmq_setsockopt(dealer, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    bool got = false;
+    do {
+        if (zmq_msg_recv(&frame, dealer, 0) == -1) {
+            break;
+        }
+        if (zmq_msg_size(&frame) > 0) {
+            auto data = static_cast<uint8_t*>(zmq_msg_data(&frame));
+            payload->assign(data, data + zmq_msg_size(&frame));
+            got = true;
+        }
+    } while (zmq_msg_more(&frame));
+    zmq_msg_close(&frame);
+    return got;
+}
+
+static bool recv_reply(void* dealer, ipc_msg_t* out) {
+    std::vector<uint8_t> payload;
+    ipc_view_t view;
+    return recv_reply(dealer, &payload) && ipc_parse(payload.data(), payload.size(), &view) == 0
+           && ipc_to_legacy(&view, out) == 0;
+}
+
+// ZMQBus::_poll is static, the whole multi worker scenario runs against one bus
+void test_ZMQBus_workers_route(void) {
+    ZMQWSocket router(context.get(), ZMQ_ROUTER);
+    ZMQWReceiver recv("test", 0, context.get(), &router);
+    ZMQBus bus(&recv, context.get(), TEST_BUS_WORKERS);
+    recv.set_endpoint(TEST_BUS_ENDPOINT);
+    std::thread bus_thread([&bus] { bus.run(); });
+
+    std::vector<void*> dealers;
+    for (int i = 0; i < TEST_BUS_DEALERS; ++i) {
+        void* dealer = zmq_socket(context->get_context(), ZMQ_DEALER);
+        std::string identity = "dealer" + std::to_string(i);
+        zmq_setsockopt(dealer, ZMQ_IDENTITY, identity.data(), identity.size());
+        // bind happens on the bus thread, retry until it is there
+        while (zmq_connect(dealer, TEST_BUS_ENDPOINT) != 0) {
+            std::this_thread::yield();
+        }
+        dealers.push_back(dealer);
+    }
+
+    ipc_msg_t msg;
+    ipc_msg_t reply;
+    memset(&msg, 0, sizeof(msg));
+
+    // Every dealer registers by sending to itself
+    for (int i = 0; i < TEST_BUS_DEALERS; ++i) {
+        msg.src_id = 100 + i;
+        msg.dist_id = 100 + i;
+        zmq_send(dealers[i], &msg, sizeof(msg), 0);
+        TEST_ASSERT(recv_reply(dealers[i], &reply));
+        TEST_ASSERT_EQUAL_INT(100 + i, reply.src_id);
+    }
+
+    // Cross traffic lands on the right dealer whichever worker handled it
+    for (int i = 0; i < TEST_BUS_DEALERS; ++i) {
+        int dst = (i + 1) % TEST_BUS_DEALERS;
+        msg.src_id = 100 + i;
+        msg.dist_id = 100 + dst;
+        zmq_send(dealers[i], &msg, sizeof(msg), 0);
+        TEST_ASSERT(recv_reply(dealers[dst], &reply));
+        TEST_ASSERT_EQUAL_INT(100 + i, reply.src_id);
+    }
+
+    // v1 message with a body the legacy struct can't hold
+    std::vector<uint8_t> body(1000, 0x5d);
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 42, 100, 101, body.size());
+    std::vector<uint8_t> frame(ipc_frame_size(body.size()));
+    ipc_encode(frame.data(), frame.size(), &hdr, body.data());
+    zmq_send(dealers[0], frame.data(), frame.size(), 0);
+
+    std::vector<uint8_t> payload;
+    ipc_view_t view;
+    TEST_ASSERT(recv_reply(dealers[1], &payload));
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(payload.data(), payload.size(), &view));
+    TEST_ASSERT_EQUAL_INT(42, view.hdr.type_id);
+    TEST_ASSERT_EQUAL_INT(body.size(), view.hdr.length);
+    TEST_ASSERT_EQUAL_MEMORY(body.data(), view.body, body.size());
+
+    // Frames up to 33 bytes live inside zmq_msg_t, routing has to read them after they moved
+    const uint8_t small_body[] = {1, 2, 3, 4};
+    ipc_hdr_init(&hdr, 43, 100, 101, sizeof(small_body));
+    std::vector<uint8_t> small(ipc_frame_size(sizeof(small_body)));
+    TEST_ASSERT(small.size() <= 33);
+    ipc_encode(small.data(), small.size(), &hdr, small_body);
+    zmq_send(dealers[0], small.data(), small.size(), 0);
+    TEST_ASSERT(recv_reply(dealers[1], &payload));
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(payload.data(), payload.size(), &view));
+    TEST_ASSERT_EQUAL_INT(43, view.hdr.type_id);
+    TEST_ASSERT_EQUAL_MEMORY(small_body, view.body, sizeof(small_body));
+
+    // Traced message, the bus stamps its hops in place and records them
+    ipc_hdr_init(&hdr, 42, 100, 101, body.size());
+    hdr.flags |= IPC_FLAG_TRACE;
+    frame.resize(ipc_hdr_frame_size(&hdr));
+    ipc_encode(frame.data(), frame.size(), &hdr, body.data());
+    int64_t sent = IpcTrace::now();
+    ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_SENT, sent);
+    zmq_send(dealers[0], frame.data(), frame.size(), 0);
+
+    ipc_trace_t trace;
+    TEST_ASSERT(recv_reply(dealers[1], &payload));
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(payload.data(), payload.size(), &view));
+    TEST_ASSERT_EQUAL_INT(0, ipc_trace_read(&view, &trace));
+    TEST_ASSERT_EQUAL_MEMORY(body.data(), view.body, body.size());
+    TEST_ASSERT_EQUAL_INT(sent, trace.stamps[IPC_HOP_SENT]);
+    TEST_ASSERT(trace.stamps[IPC_HOP_BUS_IN] >= sent);
+    TEST_ASSERT(trace.stamps[IPC_HOP_BUS_OUT] >= trace.stamps[IPC_HOP_BUS_IN]);
+    bool recorded = false;
+    for (const auto& hist : Telemetry::snapshot().histograms) {
+        recorded = recorded || (hist.name == "trace.other.other.in_bus_ns" && hist.count == 1);
+    }
+    TEST_ASSERT(recorded);
+
+    // Typed message addressed to the bus itself comes back as BusPong
+    BusPing ping{7};
+    frame.resize(IpcCodec<BusPing>::frame_size(ping));
+    IpcCodec<BusPing>::encode(ping, 100 + 2, Clients::ROUTER, frame.data(), frame.size());
+    zmq_send(dealers[2], frame.data(), frame.size(), 0);
+
+    BusPong pong{};
+    TEST_ASSERT(recv_reply(dealers[2], &payload));
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(payload.data(), payload.size(), &view));
+    TEST_ASSERT(IpcCodec<BusPong>::decode(view, pong));
+    TEST_ASSERT_EQUAL_INT(7, pong.seq);
+    TEST_ASSERT_EQUAL_INT(TEST_BUS_WORKERS, pong.workers);
+
+    // A traced message the bus answers itself is recorded before the answer replaces it
+    std::vector<uint8_t> ping_body(IpcCodec<BusPing>::body_size(ping));
+    IpcCodec<BusPing>::encode_body(ping, ping_body.data(), ping_body.size());
+    ipc_hdr_init(&hdr, BusPing::TYPE_ID, 100 + 2, Clients::ROUTER, ping_body.size());
+    hdr.flags |= IPC_FLAG_TRACE;
+    frame.resize(ipc_hdr_frame_size(&hdr));
+    ipc_encode(frame.data(), frame.size(), &hdr, ping_body.data());
+    ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_SENT, IpcTrace::now());
+    zmq_send(dealers[2], frame.data(), frame.size(), 0);
+    TEST_ASSERT(recv_reply(dealers[2], &payload));
+    std::string local_route = std::string("trace.other.") + CLIENTS_IDS[Clients::ROUTER] + ".in_bus_ns";
+    recorded = false;
+    for (const auto& hist : Telemetry::snapshot().histograms) {
+        recorded = recorded || (hist.name == local_route && hist.count == 1);
+    }
+    TEST_ASSERT(recorded);
+
+    auto stats = bus.worker_stats();
+    TEST_ASSERT_EQUAL_INT(TEST_BUS_WORKERS, stats.size());
+    uint64_t handled = 0;
+    for (const auto& worker : stats) {
+        handled += worker.handled;
+        TEST_ASSERT_EQUAL_INT(0, worker.queue_depth);
+    }
+    TEST_ASSERT_EQUAL_INT(2 * TEST_BUS_DEALERS + 5, handled);
+
+    ZMQBus::signal_handler(SIGINT);
+    bus_thread.join();
+
+    int linger = 0;
+    for (void* dealer : dealers) {
+        zmq_setsockopt(dealer, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_close(dealer);
+    }
+}
+
+int main(void) {
+    Log::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ZMQBus_workers_route);
+    return UNITY_END();
+}
@@ -0,0 +1,79 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hash_helpers.h"
+#include "unity.h"
+
+static const char* EMPTY_SHA256 = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+static const char* ABC_SHA256 = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_hex_encode_every_byte(void) {
+    unsigned char bytes[256];
+    for (int i = 0; i < 256; ++i) {
+        bytes[i] = static_cast<unsigned char>(i);
+    }
+    std::string hex = to_hex(bytes, sizeof(bytes));
+    TEST_ASSERT_EQUAL_size_t(512, hex.size());
+    TEST_ASSERT(hex.compare(0, 6, "000102") == 0);
+    TEST_ASSERT(hex.compare(2 * 0xa9, 2, "a9") == 0);
+    TEST_ASSERT(hex.compare(510, 2, "ff") == 0);
+    TEST_ASSERT(to_hex(bytes, 0).empty());
+}
+
+void test_sha256_vectors(void) {
+    TEST_ASSERT(sha256_hex("") == EMPTY_SHA256);
+    TEST_ASSERT(sha256_hex("abc") == ABC_SHA256);
+    Sha256Digest digest = Sha256::digest("abc", 3);
+    TEST_ASSERT(to_hex(digest.data(), digest.size()) == ABC_SHA256);
+}
+
+void test_sha256_streaming_and_reuse(void) {
+    std::string message(100000, 'x');
+    for (size_t i = 0; i < message.size(); ++i) {
+        message[i] = static_cast<char>(i * 31);
+    }
+    std::string expected = sha256_hex(message);
+
+    Sha256 hasher;
+    for (size_t pos = 0; pos < message.size(); pos += 4097) {
+        hasher.update(std::string_view(message).substr(pos, 4097));
+    }
+    char hex[SHA256_HEX_CHARS];
+    hasher.finish_hex(hex);
+    TEST_ASSERT(std::string(hex, sizeof(hex)) == expected);
+
+    // finish() left it reset
+    hasher.update("a").update("bc");
+    Sha256Digest digest = hasher.finish();
+    TEST_ASSERT(to_hex(digest.data(), digest.size()) == ABC_SHA256);
+    digest = hasher.finish();
+    TEST_ASSERT(to_hex(digest.data(), digest.size()) == EMPTY_SHA256);
+}
+
+void test_sha256_batch(void) {
+    std::vector<std::string> ids;
+    for (int i = 0; i < 100; ++i) {
+        ids.push_back("peer-" + std::to_string(i));
+    }
+    ids.push_back("");
+    std::vector<std::string_view> inputs(ids.begin(), ids.end());
+    std::vector<Sha256Digest> digests(inputs.size());
+    sha256_batch(inputs.data(), inputs.size(), digests.data());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        TEST_ASSERT(to_hex(digests[i].data(), SHA256_BYTES) == sha256_hex(ids[i]));
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hex_encode_every_byte);
+    RUN_TEST(test_sha256_vectors);
+    RUN_TEST(test_sha256_streaming_and_reuse);
+    RUN_TEST(test_sha256_batch);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "ipc_codec.h"
+#include "ipc_messages.h"
+#include "unity.h"
+
+// Exercises every field kind the codec supports
+struct AllFields {
+    static constexpr uint16_t TYPE_ID = 0x7f00;
+    int8_t small;
+    double real;
+    ModuleState state;
+    std::array<uint8_t, 4> fixed;
+    IpcBytes blob;
+    std::string_view text;
+
+    static constexpr auto schema() {
+        return std::make_tuple(ipc_field(&AllFields::small), ipc_field(&AllFields::real), ipc_field(&AllFields::state),
+                               ipc_field(&AllFields::fixed), ipc_field(&AllFields::blob), ipc_field(&AllFields::text));
+    }
+};
+
+static std::vector<uint8_t> encode_frame(const AllFields& msg) {
+    std::vector<uint8_t> frame(IpcCodec<AllFields>::frame_size(msg));
+    TEST_ASSERT_EQUAL_INT(frame.size(), IpcCodec<AllFields>::encode(msg, 1, 2, frame.data(), frame.size()));
+    return frame;
+}
+
+static AllFields sample() {
+    static const uint8_t blob[] = {9, 8, 7};
+    return {-3, 2.5, ModuleState::DEGRADED, {1, 2, 3, 4}, {blob, sizeof(blob)}, "detail"};
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_IpcCodec_roundtrip(void) {
+    auto in = sample();
+    auto frame = encode_frame(in);
+    // 1 + 8 + 1 + 4 + (4 + 3) + (4 + 6), no padding
+    TEST_ASSERT_EQUAL_INT(31, IpcCodec<AllFields>::body_size(in));
+
+    ipc_view_t view;
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame.data(), frame.size(), &view));
+    TEST_ASSERT_EQUAL_INT(AllFields::TYPE_ID, view.hdr.type_id);
+
+    AllFields out{};
+    TEST_ASSERT(IpcCodec<AllFields>::decode(view, out));
+    TEST_ASSERT_EQUAL_INT(-3, out.small);
+    TEST_ASSERT(out.real == 2.5);
+    TEST_ASSERT(out.state == ModuleState::DEGRADED);
+    TEST_ASSERT(out.fixed == in.fixed);
+    TEST_ASSERT_EQUAL_INT(3, out.blob.size);
+    TEST_ASSERT_EQUAL_MEMORY(in.blob.data, out.blob.data, 3);
+    TEST_ASSERT(out.text == "detail");
+    // Views point into the frame, nothing was copied out
+    TEST_ASSERT(out.blob.data > frame.data() && out.blob.data < frame.data() + frame.size());
+}
+
+void test_IpcCodec_rejects_bad_body(void) {
+    auto in = sample();
+    std::vector<uint8_t> body(IpcCodec<AllFields>::body_size(in) + 1);
+    IpcCodec<AllFields>::encode_body(in, body.data(), body.size());
+
+    AllFields out{};
+    // Truncated anywhere, including inside a length prefixed field
+    for (size_t size = 0; size + 1 < body.size(); ++size) {
+        TEST_ASSERT_FALSE(IpcCodec<AllFields>::decode_body(body.data(), size, out));
+    }
+    // Trailing garbage
+    TEST_ASSERT_FALSE(IpcCodec<AllFields>::decode_body(body.data(), body.size(), out));
+    TEST_ASSERT(IpcCodec<AllFields>::decode_body(body.data(), body.size() - 1, out));
+}
+
+void test_IpcCodec_type_mismatch(void) {
+    auto frame = encode_frame(sample());
+    ipc_view_t view;
+    ipc_parse(frame.data(), frame.size(), &view);
+
+    BusPing ping;
+    TEST_ASSERT_FALSE(IpcCodec<BusPing>::decode(view, ping));
+}
+
+void test_IpcDispatcher(void) {
+    IpcDispatcher<BusPing, BusPong, AllFields> dispatcher;
+    uint64_t pinged = 0;
+    dispatcher.on<BusPing>([&](const BusPing& ping, const ipc_view_t& view) { pinged = ping.seq; });
+
+    BusPing ping{77};
+    std::vector<uint8_t> frame(IpcCodec<BusPing>::frame_size(ping));
+    IpcCodec<BusPing>::encode(ping, Clients::UI, Clients::ROUTER, frame.data(), frame.size());
+    ipc_view_t view;
+    ipc_parse(frame.data(), frame.size(), &view);
+    TEST_ASSERT(dispatcher.dispatch(view));
+    TEST_ASSERT_EQUAL_INT(77, pinged);
+
+    // Known type without a handler
+    BusPong pong{1, 1};
+    frame.resize(IpcCodec<BusPong>::frame_size(pong));
+    IpcCodec<BusPong>::encode(pong, Clients::ROUTER, Clients::UI, frame.data(), frame.size());
+    ipc_parse(frame.data(), frame.size(), &view);
+    TEST_ASSERT_FALSE(dispatcher.dispatch(view));
+
+    // Unknown type
+    view.hdr.type_id = 0x7ff0;
+    TEST_ASSERT_FALSE(dispatcher.dispatch(view));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_IpcCodec_roundtrip);
+    RUN_TEST(test_IpcCodec_rejects_bad_body);
+    RUN_TEST(test_IpcCodec_type_mismatch);
+    RUN_TEST(test_IpcDispatcher);
+    return UNITY_END();
+}
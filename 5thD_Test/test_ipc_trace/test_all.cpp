@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc_trace.h"
+#include "unity.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static const HistogramSample* find_histogram(const std::vector<HistogramSample>& histograms, const std::string& name) {
+    for (const auto& sample : histograms) {
+        if (sample.name == name) {
+            return &sample;
+        }
+    }
+    return nullptr;
+}
+
+// What a sender, the bus and the receiver do to one message
+static std::vector<uint8_t> traced_frame(int32_t src, int32_t dst, int64_t sent, int64_t bus_in, int64_t bus_out) {
+    const char body[] = "hop";
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 9, src, dst, sizeof(body));
+    hdr.flags |= IPC_FLAG_TRACE;
+    std::vector<uint8_t> frame(ipc_hdr_frame_size(&hdr));
+    ipc_encode(frame.data(), frame.size(), &hdr, body);
+    ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_SENT, sent);
+    ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_BUS_IN, bus_in);
+    ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_BUS_OUT, bus_out);
+    return frame;
+}
+
+void test_bus_spans_per_route(void) {
+    for (int i = 1; i <= 100; ++i) {
+        auto frame = traced_frame(Clients::PEER, Clients::UI, 1000, 1000 + i * 1000, 1000 + i * 1000 + 500);
+        ipc_view_t view;
+        TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame.data(), frame.size(), &view));
+        IpcTrace::record_bus(view);
+    }
+    // Unknown ids share the "other" row
+    auto frame = traced_frame(42, Clients::UI, 1000, 2000, 3000);
+    ipc_view_t view;
+    ipc_parse(frame.data(), frame.size(), &view);
+    IpcTrace::record_bus(view);
+
+    auto histograms = Telemetry::snapshot().histograms;
+    const HistogramSample* to_bus = find_histogram(histograms, "trace.peerxxx.uixxxxx.to_bus_ns");
+    const HistogramSample* in_bus = find_histogram(histograms, "trace.peerxxx.uixxxxx.in_bus_ns");
+    TEST_ASSERT_NOT_NULL(to_bus);
+    TEST_ASSERT_NOT_NULL(in_bus);
+    TEST_ASSERT_EQUAL_UINT64(100, to_bus->count);
+    TEST_ASSERT_EQUAL_UINT64(1000, to_bus->min);
+    TEST_ASSERT_EQUAL_UINT64(100000, to_bus->max);
+    TEST_ASSERT_EQUAL_UINT64(500, in_bus->min);
+    TEST_ASSERT_EQUAL_UINT64(500, in_bus->max);
+    TEST_ASSERT_NOT_NULL(find_histogram(histograms, "trace.other.uixxxxx.to_bus_ns"));
+}
+
+void test_delivery_spans(void) {
+    int64_t now = IpcTrace::now();
+    auto frame = traced_frame(Clients::UI, Clients::PEER, now - 3000000, now - 2000000, now - 1000000);
+    ipc_view_t view;
+    ipc_parse(frame.data(), frame.size(), &view);
+    IpcTrace::record_delivery(view);
+
+    auto histograms = Telemetry::snapshot().histograms;
+    const HistogramSample* from_bus = find_histogram(histograms, "trace.uixxxxx.peerxxx.from_bus_ns");
+    const HistogramSample* end_to_end = find_histogram(histograms, "trace.uixxxxx.peerxxx.end_to_end_ns");
+    TEST_ASSERT_NOT_NULL(from_bus);
+    TEST_ASSERT_NOT_NULL(end_to_end);
+    TEST_ASSERT(from_bus->min >= 1000000);
+    TEST_ASSERT(end_to_end->min >= 3000000);
+    TEST_ASSERT(end_to_end->min > from_bus->min);
+}
+
+void test_unstamped_and_backwards_spans_skipped(void) {
+    IpcTrace::record(Clients::MANAGER, Clients::PEER, TraceSpan::TO_BUS, 0, 5000);
+    IpcTrace::record(Clients::MANAGER, Clients::PEER, TraceSpan::IN_BUS, 5000, 4000);
+    auto histograms = Telemetry::snapshot().histograms;
+    const HistogramSample* to_bus = find_histogram(histograms, "trace.manager.peerxxx.to_bus_ns");
+    TEST_ASSERT(!to_bus || to_bus->count == 0);
+    const HistogramSample* in_bus = find_histogram(histograms, "trace.manager.peerxxx.in_bus_ns");
+    TEST_ASSERT(!in_bus || in_bus->count == 0);
+
+    // Untraced frames are ignored altogether
+    const char body[] = "plain";
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 9, Clients::MANAGER, Clients::PEER, sizeof(body));
+    std::vector<uint8_t> frame(ipc_hdr_frame_size(&hdr));
+    ipc_encode(frame.data(), frame.size(), &hdr, body);
+    ipc_view_t view;
+    ipc_parse(frame.data(), frame.size(), &view);
+    IpcTrace::record_bus(view);
+    IpcTrace::record_delivery(view);
+}
+
+void test_sampling(void) {
+    TEST_ASSERT_FALSE(IpcTrace::sample());
+    IpcTrace::set_sampling(4);
+    int traced = 0;
+    for (int i = 0; i < 100; ++i) {
+        traced += IpcTrace::sample() ? 1 : 0;
+    }
+    TEST_ASSERT_EQUAL_INT(25, traced);
+    IpcTrace::set_sampling(1);
+    TEST_ASSERT(IpcTrace::sample() && IpcTrace::sample());
+    IpcTrace::set_sampling(0);
+    TEST_ASSERT_FALSE(IpcTrace::sample());
+}
+
+void test_report_from_exported_lines(void) {
+    FILE* out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    JsonLinesExporter exporter(out);
+    exporter.export_batch({}, Telemetry::snapshot(), {"node:test", "5thd-bus"});
+
+    // Read back the way 5thDTraceReport does
+    rewind(out);
+    std::vector<HistogramSample> parsed;
+    char line[4096];
+    while (fgets(line, sizeof(line), out)) {
+        HistogramSample sample;
+        if (IpcTrace::parse_metric_line(line, sample)) {
+            parsed.push_back(sample);
+        }
+    }
+    fclose(out);
+
+    auto routes = IpcTrace::report(parsed);
+    TEST_ASSERT(routes.size() >= 5);
+    // Route by route, spans in hop order
+    size_t peer_ui = routes.size();
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (routes[i].src == "peerxxx" && routes[i].dst == "uixxxxx") {
+            peer_ui = i;
+            break;
+        }
+    }
+    TEST_ASSERT(peer_ui + 1 < routes.size());
+    TEST_ASSERT_EQUAL_STRING("to_bus", routes[peer_ui].span.c_str());
+    TEST_ASSERT_EQUAL_STRING("in_bus", routes[peer_ui + 1].span.c_str());
+    TEST_ASSERT_EQUAL_UINT64(100, routes[peer_ui].count);
+    TEST_ASSERT(routes[peer_ui].p50 >= 50000 && routes[peer_ui].p50 <= 54000);
+    TEST_ASSERT(routes[peer_ui].p99 >= 99000 && routes[peer_ui].p999 <= 100000);
+
+    std::string table = IpcTrace::format_report(routes);
+    TEST_ASSERT(table.find("peerxxx -> uixxxxx") != std::string::npos);
+    TEST_ASSERT(table.find("end_to_end") != std::string::npos);
+
+    // Counters and events are not histograms
+    HistogramSample sample;
+    TEST_ASSERT_FALSE(IpcTrace::parse_metric_line("{\"class\":\"metric\",\"name\":\"bus.messages\",\"fields\":{\"value\":3}}",
+                                                  sample));
+    TEST_ASSERT_FALSE(IpcTrace::parse_metric_line("{\"class\":\"event\",\"name\":\"module.started\"}", sample));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bus_spans_per_route);
+    RUN_TEST(test_delivery_spans);
+    RUN_TEST(test_unstamped_and_backwards_spans_skipped);
+    RUN_TEST(test_sampling);
+    RUN_TEST(test_report_from_exported_lines);
+    return UNITY_END();
+}
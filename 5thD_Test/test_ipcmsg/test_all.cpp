@@ -0,0 +1,137 @@
+#include <cstring>
+#include <vector>
+
+#include "5thdipcmsg.h"
+#include "unity.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_ipc_encode_parse(void) {
+    const char body[] = "hello bus";
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 7, Clients::PEER, Clients::UI, sizeof(body));
+    hdr.timestamp = 1234;
+
+    std::vector<uint8_t> frame(ipc_frame_size(sizeof(body)));
+    TEST_ASSERT_EQUAL_INT(frame.size(), ipc_encode(frame.data(), frame.size(), &hdr, body));
+    // Too small buffer is refused
+    TEST_ASSERT_EQUAL_INT(0, ipc_encode(frame.data(), frame.size() - 1, &hdr, body));
+
+    ipc_view_t view;
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame.data(), frame.size(), &view));
+    TEST_ASSERT_FALSE(view.legacy);
+    TEST_ASSERT_EQUAL_INT(7, view.hdr.type_id);
+    TEST_ASSERT_EQUAL_INT(Clients::PEER, view.hdr.src_id);
+    TEST_ASSERT_EQUAL_INT(Clients::UI, view.hdr.dst_id);
+    TEST_ASSERT_EQUAL_INT(1234, view.hdr.timestamp);
+    TEST_ASSERT_EQUAL_INT(sizeof(body), view.hdr.length);
+    TEST_ASSERT_EQUAL_MEMORY(body, view.body, sizeof(body));
+}
+
+void test_ipc_parse_rejects(void) {
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 1, 0, 1, 16);
+    std::vector<uint8_t> frame(ipc_frame_size(16));
+    ipc_encode(frame.data(), frame.size(), &hdr, std::vector<uint8_t>(16).data());
+
+    ipc_view_t view;
+    // length doesn't match the frame
+    TEST_ASSERT_EQUAL_INT(-1, ipc_parse(frame.data(), frame.size() - 1, &view));
+    // shorter than a header
+    TEST_ASSERT_EQUAL_INT(-1, ipc_parse(frame.data(), 3, &view));
+    // unknown version
+    frame[2] = IPC_WIRE_VERSION + 1;
+    TEST_ASSERT_EQUAL_INT(-1, ipc_parse(frame.data(), frame.size(), &view));
+}
+
+void test_ipc_legacy_shim(void) {
+    ipc_msg_t legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    legacy.src_id = Clients::MANAGER;
+    legacy.dist_id = Clients::PEER;
+    legacy.timestamp = 99;
+    strcpy(legacy.category, "status");
+    strcpy(legacy.data, "up");
+
+    // The raw struct is still understood
+    ipc_view_t view;
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(&legacy, sizeof(legacy), &view));
+    TEST_ASSERT(view.legacy);
+    TEST_ASSERT_EQUAL_INT(Clients::PEER, view.hdr.dst_id);
+
+    // As v1 trailing zeros of data are dropped
+    uint8_t frame[sizeof(ipc_hdr_t) + sizeof(ipc_msg_t)];
+    size_t frame_size = ipc_from_legacy(&legacy, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_INT(ipc_frame_size(CATEGORY_LENGTH_BYTES + 2), frame_size);
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame, frame_size, &view));
+    TEST_ASSERT_FALSE(view.legacy);
+    TEST_ASSERT_EQUAL_INT(IPC_TYPE_LEGACY, view.hdr.type_id);
+
+    ipc_msg_t back;
+    TEST_ASSERT_EQUAL_INT(0, ipc_to_legacy(&view, &back));
+    TEST_ASSERT_EQUAL_MEMORY(&legacy, &back, sizeof(legacy));
+}
+
+void test_ipc_to_legacy_too_big(void) {
+    std::vector<uint8_t> body(DATA_LENGTH_BYTES + 1, 0xab);
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 3, 0, 1, body.size());
+    std::vector<uint8_t> frame(ipc_frame_size(body.size()));
+    ipc_encode(frame.data(), frame.size(), &hdr, body.data());
+
+    ipc_view_t view;
+    ipc_msg_t legacy;
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame.data(), frame.size(), &view));
+    TEST_ASSERT_EQUAL_INT(-1, ipc_to_legacy(&view, &legacy));
+}
+
+void test_ipc_trace_block(void) {
+    const char body[] = "traced";
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, 5, Clients::PEER, Clients::UI, sizeof(body));
+    hdr.flags |= IPC_FLAG_TRACE;
+
+    std::vector<uint8_t> frame(ipc_hdr_frame_size(&hdr));
+    TEST_ASSERT_EQUAL_INT(ipc_frame_size(sizeof(body)) + sizeof(ipc_trace_t), frame.size());
+    TEST_ASSERT_EQUAL_INT(frame.size(), ipc_encode(frame.data(), frame.size(), &hdr, body));
+    TEST_ASSERT_EQUAL_INT(0, ipc_encode(frame.data(), ipc_frame_size(sizeof(body)), &hdr, body));
+
+    TEST_ASSERT_EQUAL_INT(0, ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_SENT, 1000));
+    TEST_ASSERT_EQUAL_INT(0, ipc_trace_stamp(frame.data(), frame.size(), IPC_HOP_BUS_OUT, 3000));
+
+    ipc_view_t view;
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(frame.data(), frame.size(), &view));
+    TEST_ASSERT_NOT_NULL(view.trace);
+    TEST_ASSERT_EQUAL_INT(sizeof(body), view.hdr.length);
+    TEST_ASSERT_EQUAL_MEMORY(body, view.body, sizeof(body));
+
+    ipc_trace_t trace;
+    TEST_ASSERT_EQUAL_INT(0, ipc_trace_read(&view, &trace));
+    TEST_ASSERT_EQUAL_INT(1000, trace.stamps[IPC_HOP_SENT]);
+    // Hops not reached stay 0
+    TEST_ASSERT_EQUAL_INT(0, trace.stamps[IPC_HOP_BUS_IN]);
+    TEST_ASSERT_EQUAL_INT(3000, trace.stamps[IPC_HOP_BUS_OUT]);
+
+    // Untraced frames have no block to stamp
+    ipc_hdr_init(&hdr, 5, Clients::PEER, Clients::UI, sizeof(body));
+    std::vector<uint8_t> plain(ipc_hdr_frame_size(&hdr));
+    ipc_encode(plain.data(), plain.size(), &hdr, body);
+    TEST_ASSERT_EQUAL_INT(-1, ipc_trace_stamp(plain.data(), plain.size(), IPC_HOP_SENT, 1000));
+    TEST_ASSERT_EQUAL_INT(0, ipc_parse(plain.data(), plain.size(), &view));
+    TEST_ASSERT_NULL(view.trace);
+    TEST_ASSERT_EQUAL_INT(-1, ipc_trace_read(&view, &trace));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ipc_encode_parse);
+    RUN_TEST(test_ipc_parse_rejects);
+    RUN_TEST(test_ipc_legacy_shim);
+    RUN_TEST(test_ipc_to_legacy_too_big);
+    RUN_TEST(test_ipc_trace_block);
+    return UNITY_END();
+}
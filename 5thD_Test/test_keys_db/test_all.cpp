@@ -0,0 +1,663 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "5thdsql.h"
+#include "db_executor.h"
+#include "db_key.h"
+#include "db_pool.h"
+#include "key_store.h"
+#include "key_writer.h"
+#include "keys_db.h"
+#include "startup_profiler.h"
+#include "unity.h"
+
+static std::string db_path;
+std::unique_ptr<DatabaseAccess> db;
+
+static void remove_db_files() {
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + "-wal");
+    std::filesystem::remove(db_path + "-shm");
+}
+
+void setUp(void) {
+    remove_db_files();
+    // An existing (empty) file skips DatabaseAccess's first run scheme setup, the test applies its own
+    std::ofstream(db_path).close();
+    db = std::make_unique<DatabaseAccess>(db_path);
+    TEST_ASSERT(db->add_scheme(KEYS_SCHEME_PATH).is_ok());
+}
+
+void tearDown(void) {
+    db.reset();
+    remove_db_files();
+}
+
+void test_KeysDb_roundtrip(void) {
+    std::vector<unsigned char> value = {1, 2, 3, 4};
+    TEST_ASSERT(store_key(*db, "mod", KeyType::AES, "k", value).is_ok());
+
+    auto got = get_key(*db, "mod", KeyType::AES, "k");
+    TEST_ASSERT(got.is_ok());
+    TEST_ASSERT(got.value() == value);
+
+    std::vector<unsigned char> updated = {9, 9};
+    TEST_ASSERT(update_key(*db, "mod", KeyType::AES, "k", updated).is_ok());
+    got = get_key(*db, "mod", KeyType::AES, "k");
+    TEST_ASSERT(got.is_ok());
+    TEST_ASSERT(got.value() == updated);
+
+    TEST_ASSERT(remove_key(*db, "mod", KeyType::AES, "k").is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::AES, "k").is_err());
+}
+
+void test_KeysDb_cached_statement_reuse(void) {
+    std::vector<unsigned char> value = {7};
+    for (int i = 0; i < 50; ++i) {
+        TEST_ASSERT(store_key(*db, "mod", KeyType::ED25519, "k" + std::to_string(i), value).is_ok());
+    }
+    // Duplicate insert fails, the cached statement must still be usable after the error
+    TEST_ASSERT(store_key(*db, "mod", KeyType::ED25519, "k0", value).is_err());
+    TEST_ASSERT(store_key(*db, "mod", KeyType::ED25519, "k50", value).is_ok());
+
+    for (int i = 0; i <= 50; ++i) {
+        TEST_ASSERT(get_key(*db, "mod", KeyType::ED25519, "k" + std::to_string(i)).is_ok());
+    }
+    TEST_ASSERT(get_key(*db, "mod", KeyType::ED25519, "missing").is_err());
+
+    auto first = db->prepare_cached("SELECT 1;");
+    auto second = db->prepare_cached("SELECT 1;");
+    TEST_ASSERT(first.is_ok() && second.is_ok());
+    TEST_ASSERT_EQUAL(first.value(), second.value());
+}
+
+void test_KeysDb_close_finalizes_cache(void) {
+    std::vector<unsigned char> value = {1};
+    TEST_ASSERT(store_key(*db, "mod", KeyType::RSA, "k", value).is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::RSA, "k").is_ok());
+    // sqlite3_close reports SQLITE_BUSY if any statement were left alive
+    TEST_ASSERT(db->close().is_ok());
+}
+
+void test_DatabaseAccess_for_each_row(void) {
+    TEST_ASSERT(db->exec("CREATE TABLE scan (id INTEGER, name TEXT, payload BLOB, score REAL);").is_ok());
+    TEST_ASSERT(db->exec("INSERT INTO scan VALUES (1, 'one', x'0102', 0.5), (2, NULL, NULL, 1.5), "
+                         "(3, 'three', x'03', 2.5);")
+                    .is_ok());
+
+    static const std::string sql = "SELECT id, name, payload, score FROM scan ORDER BY id;";
+    for (int pass = 0; pass < 2; ++pass) {
+        auto stmt = db->prepare_cached(sql);
+        TEST_ASSERT(stmt.is_ok());
+        int rows = 0;
+        auto ret = db->for_each_row(stmt.value(), [&rows](const SqlRow& row) {
+            TEST_ASSERT_EQUAL_INT(4, row.column_count());
+            TEST_ASSERT_EQUAL_INT(2, row.index("payload"));
+            TEST_ASSERT_EQUAL_INT(-1, row.index("missing"));
+            int id = row.get_int(0);
+            if (id == 1) {
+                TEST_ASSERT(row.get_text(1) == "one");
+                SqlBlob blob = row.get_blob(2);
+                TEST_ASSERT_EQUAL_size_t(2, blob.size);
+                TEST_ASSERT_EQUAL_INT(2, blob.data[1]);
+                unsigned char out[2];
+                TEST_ASSERT_EQUAL_size_t(2, row.copy_to(2, out, sizeof(out)));
+                TEST_ASSERT_EQUAL_INT(1, out[0]);
+                TEST_ASSERT_EQUAL_size_t(2, row.copy_to(2, out, 1));
+            } else if (id == 2) {
+                TEST_ASSERT(row.is_null(1));
+                TEST_ASSERT(row.get_text(1).empty());
+                TEST_ASSERT_EQUAL_size_t(0, row.get_blob(2).size);
+                TEST_ASSERT(row.get_double(3) == 1.5);
+            }
+            return ++rows < 2;
+        });
+        TEST_ASSERT(ret.is_ok());
+        TEST_ASSERT_EQUAL_INT(2, rows);
+    }
+
+    // A statement not from the cache is finalized by the scan
+    auto stmt = db->prepare("SELECT COUNT(*) FROM scan;");
+    TEST_ASSERT(stmt.is_ok());
+    int64_t count = 0;
+    TEST_ASSERT(db->for_each_row(stmt.value(), [&count](const SqlRow& row) {
+                      count = row.get_int64(0);
+                      return true;
+                  })
+                    .is_ok());
+    TEST_ASSERT_EQUAL_INT(3, count);
+    TEST_ASSERT(db->close().is_ok());
+}
+
+void test_KeyStore_hits_and_invalidation(void) {
+    KeyStore keys(*db);
+    std::vector<unsigned char> value = {1, 2, 3};
+    TEST_ASSERT(keys.store("mod", KeyType::CURVE25519, "pub", value).is_ok());
+
+    for (int i = 0; i < 10; ++i) {
+        auto got = keys.get("mod", KeyType::CURVE25519, "pub");
+        TEST_ASSERT(got.is_ok());
+        TEST_ASSERT(got.value() == value);
+    }
+    KeyStoreStats stats = keys.stats();
+    TEST_ASSERT_EQUAL_UINT64(1, stats.misses);
+    TEST_ASSERT_EQUAL_UINT64(9, stats.hits);
+
+    std::vector<unsigned char> updated = {4, 5};
+    TEST_ASSERT(keys.update("mod", KeyType::CURVE25519, "pub", updated).is_ok());
+    auto got = keys.get("mod", KeyType::CURVE25519, "pub");
+    TEST_ASSERT(got.is_ok());
+    TEST_ASSERT(got.value() == updated);
+
+    TEST_ASSERT(keys.remove("mod", KeyType::CURVE25519, "pub").is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::CURVE25519, "pub").is_err());
+    stats = keys.stats();
+    TEST_ASSERT_EQUAL_UINT64(2, stats.invalidations);
+    TEST_ASSERT_EQUAL_UINT64(3, stats.misses);
+
+    // Writes that bypass the store need an explicit invalidate
+    TEST_ASSERT(store_key(*db, "mod", KeyType::AES, "direct", value).is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "direct").is_ok());
+    TEST_ASSERT(update_key(*db, "mod", KeyType::AES, "direct", updated).is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "direct").value() == value);
+    keys.invalidate("mod", KeyType::AES, "direct");
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "direct").value() == updated);
+}
+
+void test_KeyStore_expiry(void) {
+    KeyStore keys(*db);
+    std::vector<unsigned char> value = {1};
+    auto now = std::chrono::system_clock::now();
+
+    // Already past expires_at: still returned like get_key() does, never cached
+    TEST_ASSERT(keys.store("mod", KeyType::AES, "old", value, now - std::chrono::hours(1)).is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "old").is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "old").is_ok());
+    TEST_ASSERT_EQUAL_UINT64(2, keys.stats().misses);
+
+    // ttl 0 forces a reload on every lookup
+    KeyStore no_ttl(*db, std::chrono::seconds(0));
+    TEST_ASSERT(no_ttl.store("mod", KeyType::AES, "fresh", value, now + std::chrono::hours(1)).is_ok());
+    TEST_ASSERT(no_ttl.get("mod", KeyType::AES, "fresh").is_ok());
+    TEST_ASSERT(no_ttl.get("mod", KeyType::AES, "fresh").is_ok());
+    TEST_ASSERT_EQUAL_UINT64(1, no_ttl.stats().expired);
+
+    auto expires = string_to_time_point(time_point_to_string(now).c_str());
+    TEST_ASSERT(std::chrono::abs(expires - now) < std::chrono::seconds(1));
+}
+
+static std::vector<KeyWrite> make_writes(const std::string& prefix, int count, unsigned char fill) {
+    std::vector<KeyWrite> keys;
+    for (int i = 0; i < count; ++i) {
+        keys.push_back({"mod", KeyType::AES, prefix + std::to_string(i), std::vector<unsigned char>(16, fill)});
+    }
+    return keys;
+}
+
+void test_KeysDb_store_keys_bulk(void) {
+    auto keys = make_writes("k", 200, 1);
+    keys[7].key_type = KeyType::API_KEY;
+    TEST_ASSERT(store_keys(*db, keys).is_ok());
+    for (const auto& key : keys) {
+        auto got = get_key(*db, key.module_name, key.key_type, key.key_name);
+        TEST_ASSERT(got.is_ok());
+        TEST_ASSERT(got.value() == key.key_value);
+    }
+
+    // One duplicate undoes the whole batch
+    auto again = make_writes("n", 10, 2);
+    again.push_back(keys[0]);
+    TEST_ASSERT(store_keys(*db, again).is_err());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::AES, "n0").is_err());
+
+    // Usable inside a caller's transaction
+    TEST_ASSERT(db->begin_transaction().is_ok());
+    TEST_ASSERT(store_keys(*db, make_writes("t", 3, 3)).is_ok());
+    TEST_ASSERT(db->exec("ROLLBACK;").is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::AES, "t0").is_err());
+    TEST_ASSERT(db->close().is_ok());
+}
+
+void test_KeysDb_store_keys_upsert_and_each(void) {
+    TEST_ASSERT(store_keys(*db, make_writes("k", 5, 1)).is_ok());
+    TEST_ASSERT(remove_key(*db, "mod", KeyType::AES, "k1").is_ok());
+
+    // Rotation: existing rows take the new value, the removed one is reactivated
+    TEST_ASSERT(store_keys(*db, make_writes("k", 6, 9), KeyWriteMode::UPSERT).is_ok());
+    for (int i = 0; i < 6; ++i) {
+        auto got = get_key(*db, "mod", KeyType::AES, "k" + std::to_string(i));
+        TEST_ASSERT(got.is_ok());
+        TEST_ASSERT(got.value() == std::vector<unsigned char>(16, 9));
+    }
+
+    // Per row results, the failing row does not undo its neighbours
+    auto keys = make_writes("e", 3, 4);
+    keys.insert(keys.begin() + 1, {"mod", KeyType::AES, "k0", {1}});
+    std::vector<VoidResult> results;
+    store_keys_each(*db, keys, KeyWriteMode::INSERT, results);
+    TEST_ASSERT_EQUAL_size_t(4, results.size());
+    TEST_ASSERT(results[0].is_ok());
+    TEST_ASSERT(results[1].is_err());
+    TEST_ASSERT(results[2].is_ok() && results[3].is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::AES, "e2").is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::AES, "k0").value() == std::vector<unsigned char>(16, 9));
+}
+
+void test_KeyWriter_group_commit(void) {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 100;
+    {
+        KeyWriter writer(*db);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&writer, t]() {
+                std::vector<std::future<VoidResult>> done;
+                for (int i = 0; i < PER_THREAD; ++i) {
+                    std::string name = "t" + std::to_string(t) + "_" + std::to_string(i);
+                    done.push_back(writer.submit({"mod", KeyType::ED25519, name, {static_cast<unsigned char>(t)}}));
+                }
+                for (auto& result : done) {
+                    TEST_ASSERT(result.get().is_ok());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // A duplicate fails alone, the upsert behind it in the same queue still lands
+        auto duplicate = writer.submit({"mod", KeyType::ED25519, "t0_0", {42}});
+        auto rotated = writer.submit({"mod", KeyType::ED25519, "t1_0", {42}}, KeyWriteMode::UPSERT);
+        TEST_ASSERT(duplicate.get().is_err());
+        TEST_ASSERT(rotated.get().is_ok());
+
+        KeyWriterStats stats = writer.stats();
+        TEST_ASSERT_EQUAL_UINT64(THREADS * PER_THREAD + 2, stats.writes);
+        TEST_ASSERT(stats.batches >= 1 && stats.batches <= stats.writes);
+
+        // Left in the queue at destruction, still committed
+        writer.submit({"mod", KeyType::ED25519, "last", {1}});
+    }
+
+    for (int t = 0; t < THREADS; ++t) {
+        for (int i = 0; i < PER_THREAD; i += 17) {
+            auto got = get_key(*db, "mod", KeyType::ED25519, "t" + std::to_string(t) + "_" + std::to_string(i));
+            TEST_ASSERT(got.is_ok());
+            TEST_ASSERT_EQUAL_INT(i == 0 && t == 1 ? 42 : t, got.value()[0]);
+        }
+    }
+    TEST_ASSERT(get_key(*db, "mod", KeyType::ED25519, "last").is_ok());
+}
+
+void test_KeyStore_store_batch(void) {
+    KeyStore keys(*db);
+    TEST_ASSERT(keys.store("mod", KeyType::AES, "k0", {1}).is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "k0").is_ok());
+    TEST_ASSERT(keys.store_batch(make_writes("k", 3, 5), KeyWriteMode::UPSERT).is_ok());
+    TEST_ASSERT(keys.get("mod", KeyType::AES, "k0").value() == std::vector<unsigned char>(16, 5));
+    TEST_ASSERT_EQUAL_UINT64(1, keys.stats().invalidations);
+}
+
+void test_DbPool_reader_writer_split(void) {
+    DbTuning tuning;
+    tuning.cache_size_kib = 1024;
+    DbPool pool(db_path, 2, tuning);
+    TEST_ASSERT_EQUAL_size_t(2, pool.readers());
+
+    {
+        auto writer = pool.writer();
+        TEST_ASSERT(store_keys(*writer, make_writes("p", 20, 6)).is_ok());
+    }
+    {
+        auto reader = pool.reader();
+        auto got = get_key(*reader, "mod", KeyType::AES, "p19");
+        TEST_ASSERT(got.is_ok());
+        TEST_ASSERT(got.value() == std::vector<unsigned char>(16, 6));
+        // Readers are query_only
+        TEST_ASSERT(store_key(*reader, "mod", KeyType::AES, "nope", {1}).is_err());
+    }
+
+    // Both readers out: the third borrower waits for one to come back
+    auto first = std::make_unique<DbLease>(pool.reader());
+    auto second = pool.reader();
+    auto blocked = std::async(std::launch::async, [&pool]() {
+        auto reader = pool.reader();
+        return get_key(*reader, "mod", KeyType::AES, "p0").is_ok();
+    });
+    TEST_ASSERT(blocked.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+    first.reset();
+    TEST_ASSERT(blocked.get());
+
+    auto writer = std::make_unique<DbLease>(pool.writer());
+    auto second_writer = std::async(std::launch::async, [&pool]() {
+        auto writer = pool.writer();
+        return writer->exec("SELECT 1;").is_ok();
+    });
+    TEST_ASSERT(second_writer.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+    writer.reset();
+    TEST_ASSERT(second_writer.get());
+
+    DbPoolStats stats = pool.stats();
+    TEST_ASSERT_EQUAL_UINT64(4, stats.reader_borrows);
+    TEST_ASSERT_EQUAL_UINT64(3, stats.writer_borrows);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.waits);
+}
+
+void test_DbPool_concurrent_readers(void) {
+    TEST_ASSERT(store_keys(*db, make_writes("c", 50, 8)).is_ok());
+    DbPool pool(db_path, 2);
+    std::atomic<int> found{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, &found]() {
+            for (int i = 0; i < 200; ++i) {
+                auto reader = pool.reader();
+                found += get_key(*reader, "mod", KeyType::AES, "c" + std::to_string(i % 50)).is_ok();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    TEST_ASSERT_EQUAL_INT(800, found.load());
+}
+
+static std::string to_hex(const unsigned char* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 15]);
+    }
+    return hex;
+}
+
+void test_DbKey_pbkdf2_hmac_sha512(void) {
+    unsigned char out[64];
+    const unsigned char salt[] = {'s', 'a', 'l', 't'};
+    pbkdf2_hmac_sha512("password", 8, salt, sizeof(salt), 1, out, sizeof(out));
+    TEST_ASSERT(to_hex(out, sizeof(out))
+                == "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+                   "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce");
+    pbkdf2_hmac_sha512("password", 8, salt, sizeof(salt), 2, out, sizeof(out));
+    TEST_ASSERT(to_hex(out, sizeof(out))
+                == "e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+                   "f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e");
+}
+
+void test_DbKey_raw_key_cache(void) {
+    TEST_ASSERT(is_raw_db_key("x'" + std::string(64, 'a') + "'"));
+    TEST_ASSERT(is_raw_db_key("x'" + std::string(96, 'F') + "'"));
+    TEST_ASSERT(!is_raw_db_key("x'" + std::string(63, 'a') + "'"));
+    TEST_ASSERT(!is_raw_db_key("x'" + std::string(64, 'g') + "'"));
+    TEST_ASSERT(!is_raw_db_key(MEANWHILE_DB_KEY));
+
+    const std::string passphrase = "passphrase";
+    char derived[RAW_DB_KEY_CHARS];
+    char cached[RAW_DB_KEY_CHARS];
+    TEST_ASSERT(derive_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, derived).is_ok());
+    TEST_ASSERT(is_raw_db_key(derived));
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, cached).is_ok());
+    TEST_ASSERT_EQUAL_STRING(derived, cached);
+
+    // The salt part is the first 16 bytes of the file
+    unsigned char salt[SQLCIPHER_SALT_BYTES];
+    std::ifstream(db_path, std::ios::binary).read(reinterpret_cast<char*>(salt), sizeof(salt));
+    TEST_ASSERT(std::string(derived).substr(2 + 2 * SQLCIPHER_KEY_BYTES, 2 * SQLCIPHER_SALT_BYTES)
+                == to_hex(salt, sizeof(salt)));
+
+    // Another passphrase or iteration count derives again
+    TEST_ASSERT(cached_raw_db_key(db_path, "other", 5, 10, cached).is_ok());
+    TEST_ASSERT(std::string(derived) != cached);
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 11, cached).is_ok());
+    TEST_ASSERT(std::string(derived) != cached);
+    forget_raw_db_key(db_path);
+
+    TEST_ASSERT(derive_raw_db_key(db_path + ".missing", "k", 1, 10, derived).is_err());
+}
+
+void test_DbKey_rejected_key_is_not_derived_again(void) {
+    const std::string passphrase = "passphrase";
+    char cached[RAW_DB_KEY_CHARS];
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, cached).is_ok());
+    reject_raw_db_key(db_path);
+    // Same passphrase, iterations and salt: fails without another KDF run
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, cached).is_err());
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, cached).is_err());
+    // Anything else is a different key, derived and tried again
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 11, cached).is_ok());
+    TEST_ASSERT(is_raw_db_key(cached));
+    forget_raw_db_key(db_path);
+    TEST_ASSERT(cached_raw_db_key(db_path, passphrase.data(), passphrase.size(), 10, cached).is_ok());
+    forget_raw_db_key(db_path);
+}
+
+void test_DbKey_key_file(void) {
+    const std::string key_file = db_path + ".key";
+    char derived[RAW_DB_KEY_CHARS];
+    char loaded[RAW_DB_KEY_CHARS];
+    TEST_ASSERT(load_raw_db_key(key_file, db_path, loaded).error().code() == ErrorCode::NO_OBJECT);
+
+    TEST_ASSERT(derive_raw_db_key(db_path, "passphrase", 10, 10, derived).is_ok());
+    TEST_ASSERT(store_raw_db_key(key_file, db_path, derived).is_ok());
+    auto perms = std::filesystem::status(key_file).permissions();
+    TEST_ASSERT(perms == (std::filesystem::perms::owner_read | std::filesystem::perms::owner_write));
+    TEST_ASSERT(load_raw_db_key(key_file, db_path, loaded).is_ok());
+    TEST_ASSERT_EQUAL_STRING(derived, loaded);
+
+    // Rejected is remembered for this salt only
+    TEST_ASSERT(store_raw_db_key(key_file, db_path, nullptr).is_ok());
+    TEST_ASSERT(load_raw_db_key(key_file, db_path, loaded).error().code() == ErrorCode::FAIL_DECRYPT_DB);
+
+    // A key written for another salt is stale
+    std::string other(derived);
+    other.replace(2 + 2 * SQLCIPHER_KEY_BYTES, 2 * SQLCIPHER_SALT_BYTES, 2 * SQLCIPHER_SALT_BYTES, '0');
+    TEST_ASSERT(store_raw_db_key(key_file, db_path, other.c_str()).is_ok());
+    TEST_ASSERT(load_raw_db_key(key_file, db_path, loaded).error().code() == ErrorCode::NO_OBJECT);
+    std::filesystem::remove(key_file);
+}
+
+static bool sqlcipher_linked() {
+    sqlite3* probe = nullptr;
+    bool found = false;
+    if (sqlite3_open_v2(":memory:", &probe, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(probe, "PRAGMA cipher_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+            found = sqlite3_step(stmt) == SQLITE_ROW;
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(probe);
+    return found;
+}
+
+static bool raw_key_opens(const char* raw) {
+    sqlite3* conn = nullptr;
+    bool ok = sqlite3_open_v2(db_path.c_str(), &conn, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK
+              && sqlite3_key(conn, raw, RAW_DB_KEY_CHARS - 1) == SQLITE_OK
+              && sqlite3_exec(conn, "SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    sqlite3_close(conn);
+    return ok;
+}
+
+void test_DbKey_derived_key_opens_sqlcipher_db(void) {
+    if (!sqlcipher_linked()) {
+        TEST_IGNORE_MESSAGE("Plain sqlite accepts any key, needs SQLCipher");
+    }
+    db.reset();
+    remove_db_files();
+    DbTuning tuning;
+    tuning.kdf_iter = 10;
+    {
+        DatabaseAccess created(db_path, MEANWHILE_DB_KEY, tuning);
+        TEST_ASSERT(created.exec("CREATE TABLE t (v INTEGER);").is_ok());
+    }
+
+    char raw[RAW_DB_KEY_CHARS];
+    TEST_ASSERT(derive_raw_db_key(db_path, MEANWHILE_DB_KEY, sizeof(MEANWHILE_DB_KEY) - 1, 10, raw).is_ok());
+    TEST_ASSERT(raw_key_opens(raw));
+    TEST_ASSERT(derive_raw_db_key(db_path, MEANWHILE_DB_KEY, sizeof(MEANWHILE_DB_KEY) - 1, 11, raw).is_ok());
+    TEST_ASSERT_FALSE(raw_key_opens(raw));
+}
+
+void test_DatabaseAccess_open_with_cached_key(void) {
+    TEST_ASSERT(store_key(*db, "mod", KeyType::AES, "k", {1, 2}).is_ok());
+    StartupProfiler::reset();
+
+    DbTuning tuning;
+    tuning.kdf_iter = 10;
+    tuning.cache_kdf = true;
+    for (int i = 0; i < 3; ++i) {
+        DatabaseAccess again(db_path, MEANWHILE_DB_KEY, tuning);
+        TEST_ASSERT(get_key(again, "mod", KeyType::AES, "k").is_ok());
+    }
+
+    uint32_t opens = 0;
+    uint32_t derivations = 0;
+    for (const auto& stats : StartupProfiler::phases()) {
+        if (stats.name == "db.open") {
+            opens = stats.count;
+        } else if (stats.name == "db.kdf") {
+            derivations = stats.count;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, opens);
+    TEST_ASSERT_EQUAL_UINT32(3, derivations);
+    forget_raw_db_key(db_path);
+}
+
+static uint32_t kdf_runs() {
+    for (const auto& stats : StartupProfiler::phases()) {
+        if (stats.name == "db.kdf") {
+            return stats.count;
+        }
+    }
+    return 0;
+}
+
+void test_DatabaseAccess_open_with_key_file(void) {
+    TEST_ASSERT(store_key(*db, "mod", KeyType::AES, "k", {1, 2}).is_ok());
+    const std::string key_file = db_path + ".key";
+    std::filesystem::remove(key_file);
+    StartupProfiler::reset();
+
+    // Off by default, the passphrase goes to SQLCipher as is
+    DbTuning tuning;
+    tuning.kdf_iter = 10;
+    {
+        DatabaseAccess plain(db_path, MEANWHILE_DB_KEY, tuning);
+        TEST_ASSERT(get_key(plain, "mod", KeyType::AES, "k").is_ok());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, kdf_runs());
+
+    // Derived by the first open only, each later one (a new process too) loads it from the file
+    tuning.raw_key_file = key_file;
+    for (int i = 0; i < 3; ++i) {
+        DatabaseAccess again(db_path, MEANWHILE_DB_KEY, tuning);
+        TEST_ASSERT(get_key(again, "mod", KeyType::AES, "k").is_ok());
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, kdf_runs());
+    char derived[RAW_DB_KEY_CHARS];
+    char loaded[RAW_DB_KEY_CHARS];
+    TEST_ASSERT(derive_raw_db_key(db_path, MEANWHILE_DB_KEY, sizeof(MEANWHILE_DB_KEY) - 1, 10, derived).is_ok());
+    TEST_ASSERT(load_raw_db_key(key_file, db_path, loaded).is_ok());
+    TEST_ASSERT_EQUAL_STRING(derived, loaded);
+    std::filesystem::remove(key_file);
+}
+
+void test_DbExecutor_reads_and_group_commits(void) {
+    std::vector<std::future<VoidResult>> writes;
+    {
+        DbExecutor executor(db_path, 2);
+        for (int i = 0; i < 100; ++i) {
+            writes.push_back(executor.write([i](DatabaseAccess& conn) {
+                return store_key(conn, "mod", KeyType::RSA, "x" + std::to_string(i), {static_cast<unsigned char>(i)});
+            }));
+        }
+        // A failing write is undone alone, its neighbours in the batch still commit
+        auto duplicate = executor.write(
+            [](DatabaseAccess& conn) { return store_key(conn, "mod", KeyType::RSA, "x0", {1}); });
+        auto thrown = executor.write([](DatabaseAccess&) -> VoidResult { throw std::runtime_error("boom"); });
+        for (auto& write : writes) {
+            TEST_ASSERT(write.get().is_ok());
+        }
+        TEST_ASSERT(duplicate.get().is_err());
+        TEST_ASSERT(thrown.get().is_err());
+
+        std::vector<std::future<bool>> reads;
+        for (int i = 0; i < 100; ++i) {
+            reads.push_back(executor.read([i](DatabaseAccess& conn) {
+                auto got = get_key(conn, "mod", KeyType::RSA, "x" + std::to_string(i));
+                return got.is_ok() && got.value()[0] == i;
+            }));
+        }
+        for (auto& read : reads) {
+            TEST_ASSERT(read.get());
+        }
+        auto failed_read = executor.read([](DatabaseAccess&) -> int { throw std::runtime_error("boom"); });
+        bool threw = false;
+        try {
+            failed_read.get();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        TEST_ASSERT(threw);
+        // Not a std::exception and no future to take it, the reader thread has to survive it
+        executor.post_read([](DatabaseAccess&) { throw 42; });
+        TEST_ASSERT(executor.read([](DatabaseAccess& conn) { return get_key(conn, "mod", KeyType::RSA, "x1").is_ok(); })
+                        .get());
+
+        std::promise<VoidResult> done;
+        executor.post_write([](DatabaseAccess& conn) { return store_key(conn, "mod", KeyType::RSA, "cb", {1}); },
+                            [&done](const VoidResult& ret) { done.set_value(ret); });
+        TEST_ASSERT(done.get_future().get().is_ok());
+
+        DbExecutorStats stats = executor.stats();
+        TEST_ASSERT_EQUAL_UINT64(103, stats.writes);
+        TEST_ASSERT(stats.write_batches >= 1 && stats.write_batches <= stats.writes);
+        TEST_ASSERT_EQUAL_UINT64(103, stats.reads);
+
+        // Still queued at destruction, still committed
+        executor.post_write([](DatabaseAccess& conn) { return store_key(conn, "mod", KeyType::RSA, "last", {1}); },
+                            nullptr);
+    }
+    TEST_ASSERT(get_key(*db, "mod", KeyType::RSA, "x99").is_ok());
+    TEST_ASSERT(get_key(*db, "mod", KeyType::RSA, "last").is_ok());
+}
+
+int main(void) {
+    Log::init();
+    db_path = (std::filesystem::temp_directory_path() / "5thd_test_keys.db").string();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_KeysDb_roundtrip);
+    RUN_TEST(test_KeysDb_cached_statement_reuse);
+    RUN_TEST(test_KeysDb_close_finalizes_cache);
+    RUN_TEST(test_DatabaseAccess_for_each_row);
+    RUN_TEST(test_KeyStore_hits_and_invalidation);
+    RUN_TEST(test_KeyStore_expiry);
+    RUN_TEST(test_KeysDb_store_keys_bulk);
+    RUN_TEST(test_KeysDb_store_keys_upsert_and_each);
+    RUN_TEST(test_KeyWriter_group_commit);
+    RUN_TEST(test_KeyStore_store_batch);
+    RUN_TEST(test_DbPool_reader_writer_split);
+    RUN_TEST(test_DbPool_concurrent_readers);
+    RUN_TEST(test_DbKey_pbkdf2_hmac_sha512);
+    RUN_TEST(test_DbKey_raw_key_cache);
+    RUN_TEST(test_DbKey_rejected_key_is_not_derived_again);
+    RUN_TEST(test_DbKey_key_file);
+    RUN_TEST(test_DbKey_derived_key_opens_sqlcipher_db);
+    RUN_TEST(test_DatabaseAccess_open_with_cached_key);
+    RUN_TEST(test_DatabaseAccess_open_with_key_file);
+    RUN_TEST(test_DbExecutor_reads_and_group_commits);
+    return UNITY_END();
+}
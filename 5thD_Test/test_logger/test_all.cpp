@@ -0,0 +1,248 @@
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "spdlog/sinks/base_sink.h"
+#include "unity.h"
+
+using namespace std::chrono_literals;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * @brief Keeps every payload, can be closed to stall the flusher inside a write.
+ */
+class CaptureSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+    std::vector<std::string> lines() {
+        std::lock_guard<std::mutex> lock(_lines_lock);
+        return _lines;
+    }
+
+    std::vector<std::thread::id> writers() {
+        std::lock_guard<std::mutex> lock(_lines_lock);
+        return _writers;
+    }
+
+    void close_gate() {
+        std::lock_guard<std::mutex> lock(_gate_lock);
+        _open = false;
+    }
+
+    void open_gate() {
+        {
+            std::lock_guard<std::mutex> lock(_gate_lock);
+            _open = true;
+        }
+        _gate.notify_all();
+    }
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override {
+        {
+            std::unique_lock<std::mutex> lock(_gate_lock);
+            _gate.wait(lock, [this] { return _open; });
+        }
+        std::lock_guard<std::mutex> lock(_lines_lock);
+        _lines.emplace_back(msg.payload.data(), msg.payload.size());
+        _writers.push_back(std::this_thread::get_id());
+    }
+
+    void flush_() override {}
+
+private:
+    std::mutex _lines_lock;
+    std::vector<std::string> _lines;
+    std::vector<std::thread::id> _writers;
+    std::mutex _gate_lock;
+    std::condition_variable _gate;
+    bool _open = true;
+};
+
+static std::shared_ptr<CaptureSink> init_capture(LogMode mode, LogOverflow overflow, size_t queue_size = 64) {
+    auto sink = std::make_shared<CaptureSink>();
+    LogConfig config;
+    config.mode = mode;
+    config.overflow = overflow;
+    config.queue_size = queue_size;
+    config.sinks = {sink};
+    Log::init(config);
+    return sink;
+}
+
+// The sink is stuck in its first write, the ring fills behind it
+static void stall_flusher(const std::shared_ptr<CaptureSink>& sink) {
+    sink->close_gate();
+    INFO("stalled");
+    std::this_thread::sleep_for(20ms);
+}
+
+void test_async_writes_in_order_off_thread(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK);
+    for (int i = 0; i < 500; ++i) {
+        INFO("message {}", i);
+    }
+    Log::flush();
+    auto lines = sink->lines();
+    TEST_ASSERT_EQUAL_size_t(500, lines.size());
+    for (int i = 0; i < 500; ++i) {
+        TEST_ASSERT_EQUAL_STRING(("message " + std::to_string(i)).c_str(), lines[i].c_str());
+    }
+    for (const auto& writer : sink->writers()) {
+        TEST_ASSERT(writer != std::this_thread::get_id());
+    }
+    TEST_ASSERT_EQUAL_UINT64(500, Log::stats().written);
+}
+
+void test_many_producers_lose_nothing_when_blocking(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK, 16);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i) {
+                WARN("thread {} message {}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Log::flush();
+    TEST_ASSERT_EQUAL_size_t(4000, sink->lines().size());
+    TEST_ASSERT_EQUAL_UINT64(0, Log::stats().dropped);
+}
+
+void test_drop_discards_new_messages(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::DROP, 8);
+    stall_flusher(sink);
+    for (int i = 0; i < 20; ++i) {
+        INFO("message {}", i);
+    }
+    TEST_ASSERT_EQUAL_UINT64(12, Log::stats().dropped);
+    sink->open_gate();
+    Log::flush();
+    auto lines = sink->lines();
+    TEST_ASSERT_EQUAL_size_t(9, lines.size());
+    TEST_ASSERT_EQUAL_STRING("message 0", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("message 7", lines.back().c_str());
+}
+
+void test_overrun_discards_oldest_messages(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::OVERRUN, 8);
+    stall_flusher(sink);
+    for (int i = 0; i < 20; ++i) {
+        INFO("message {}", i);
+    }
+    TEST_ASSERT_EQUAL_UINT64(12, Log::stats().overrun);
+    sink->open_gate();
+    Log::flush();
+    auto lines = sink->lines();
+    TEST_ASSERT_EQUAL_size_t(9, lines.size());
+    TEST_ASSERT_EQUAL_STRING("message 12", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("message 19", lines.back().c_str());
+}
+
+void test_block_waits_for_the_flusher(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK, 8);
+    stall_flusher(sink);
+    std::thread producer([] {
+        for (int i = 0; i < 20; ++i) {
+            INFO("message {}", i);
+        }
+    });
+    std::this_thread::sleep_for(20ms);
+    TEST_ASSERT_EQUAL_UINT64(1, Log::stats().blocked);
+    sink->open_gate();
+    producer.join();
+    Log::flush();
+    TEST_ASSERT_EQUAL_size_t(21, sink->lines().size());
+}
+
+void test_long_messages_are_truncated(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK);
+    std::string longer(LOG_RECORD_TEXT * 2, 'x');
+    INFO("{}", longer);
+    Log::flush();
+    auto lines = sink->lines();
+    TEST_ASSERT_EQUAL_size_t(1, lines.size());
+    TEST_ASSERT_EQUAL_size_t(LOG_RECORD_TEXT, lines[0].size());
+    TEST_ASSERT_EQUAL_STRING("...", lines[0].substr(LOG_RECORD_TEXT - 3).c_str());
+    TEST_ASSERT_EQUAL_UINT64(1, Log::stats().truncated);
+}
+
+static int evaluated = 0;
+
+static int count_evaluation() {
+    return ++evaluated;
+}
+
+void test_disabled_level_skips_arguments(void) {
+    auto sink = init_capture(LogMode::SYNC, LogOverflow::BLOCK);
+    Log::get_logger()->set_level(spdlog::level::info);
+    DEBUG("value {}", count_evaluation());
+    TEST_ASSERT_EQUAL_INT(0, evaluated);
+    INFO("value {}", count_evaluation());
+    TEST_ASSERT_EQUAL_INT(1, evaluated);
+    // Sync mode writes on the caller thread
+    TEST_ASSERT_EQUAL_size_t(1, sink->lines().size());
+    TEST_ASSERT(sink->writers()[0] == std::this_thread::get_id());
+}
+
+void test_shutdown_writes_everything_left(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK);
+    // Let the flusher go idle so it has to be woken
+    std::this_thread::sleep_for(5ms);
+    for (int i = 0; i < 10; ++i) {
+        INFO("message {}", i);
+    }
+    Log::shutdown();
+    TEST_ASSERT_EQUAL_size_t(10, sink->lines().size());
+    // Still usable, now on the caller thread
+    ERROR("late");
+    TEST_ASSERT_EQUAL_size_t(11, sink->lines().size());
+}
+
+void test_default_config_is_sync(void) {
+    auto sink = std::make_shared<CaptureSink>();
+    LogConfig config;
+    config.sinks = {sink};
+    Log::init(config);
+    INFO("default");
+    TEST_ASSERT_EQUAL_size_t(1, sink->lines().size());
+    TEST_ASSERT(sink->writers()[0] == std::this_thread::get_id());
+}
+
+void test_idle_flusher_wakes_for_new_work(void) {
+    auto sink = init_capture(LogMode::ASYNC, LogOverflow::BLOCK);
+    for (int round = 0; round < 20; ++round) {
+        std::this_thread::sleep_for(2ms);
+        INFO("round {}", round);
+        // No flush() here, only the wake up gets the record written
+        for (int wait = 0; wait < 1000 && sink->lines().size() < static_cast<size_t>(round + 1); ++wait) {
+            std::this_thread::sleep_for(1ms);
+        }
+        TEST_ASSERT_EQUAL_size_t(static_cast<size_t>(round + 1), sink->lines().size());
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_async_writes_in_order_off_thread);
+    RUN_TEST(test_many_producers_lose_nothing_when_blocking);
+    RUN_TEST(test_drop_discards_new_messages);
+    RUN_TEST(test_overrun_discards_oldest_messages);
+    RUN_TEST(test_block_waits_for_the_flusher);
+    RUN_TEST(test_long_messages_are_truncated);
+    RUN_TEST(test_disabled_level_skips_arguments);
+    RUN_TEST(test_shutdown_writes_everything_left);
+    RUN_TEST(test_default_config_is_sync);
+    RUN_TEST(test_idle_flusher_wakes_for_new_work);
+    return UNITY_END();
+}
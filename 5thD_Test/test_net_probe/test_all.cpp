@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "5thdlogger.h"
+#include "net_probe.h"
+#include "unity.h"
+
+using namespace std::chrono_literals;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Stands in for a slow network probe (curl, upnp discovery)
+static Probe slow_probe(const std::string& answer, std::chrono::milliseconds delay, std::atomic<int>* runs = nullptr) {
+    return [=](const NetProbeConfig&) -> Result<std::string> {
+        if (runs) {
+            runs->fetch_add(1);
+        }
+        std::this_thread::sleep_for(delay);
+        return Ok<std::string>(std::string(answer));
+    };
+}
+
+void test_probes_run_concurrently(void) {
+    NetProbeConfig config;
+    config.forward_port = 7099;
+    NetProbe probe(config);
+    probe.set_probe(ProbeKind::LOCAL_IP, slow_probe("192.168.1.5", 150ms));
+    probe.set_probe(ProbeKind::EXTERNAL_IP, slow_probe("203.0.113.7", 150ms));
+    probe.set_probe(ProbeKind::PORT_FORWARD, slow_probe("7099", 150ms));
+
+    auto start = std::chrono::steady_clock::now();
+    probe.start();
+    TEST_ASSERT(std::chrono::steady_clock::now() - start < 50ms);
+
+    auto local = probe.get(ProbeKind::LOCAL_IP, 2000ms);
+    auto external = probe.get(ProbeKind::EXTERNAL_IP, 2000ms);
+    auto forward = probe.get(ProbeKind::PORT_FORWARD, 2000ms);
+    // One after the other would take 450 ms
+    TEST_ASSERT(std::chrono::steady_clock::now() - start < 400ms);
+    TEST_ASSERT(local.is_ok() && local.value() == "192.168.1.5");
+    TEST_ASSERT(external.is_ok() && external.value() == "203.0.113.7");
+    TEST_ASSERT(forward.is_ok() && forward.value() == "7099");
+    TEST_ASSERT_EQUAL_UINT64(3, probe.stats().runs);
+}
+
+void test_answers_are_cached(void) {
+    std::atomic<int> runs{0};
+    NetProbe probe;
+    probe.set_probe(ProbeKind::EXTERNAL_IP, slow_probe("203.0.113.7", 1ms, &runs));
+
+    TEST_ASSERT(probe.get(ProbeKind::EXTERNAL_IP, 2000ms).is_ok());
+    TEST_ASSERT(probe.fresh(ProbeKind::EXTERNAL_IP));
+    probe.start();
+    auto again = probe.get(ProbeKind::EXTERNAL_IP);
+    TEST_ASSERT(again.is_ok() && again.value() == "203.0.113.7");
+    TEST_ASSERT_EQUAL_INT(1, runs.load());
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().hits);
+
+    probe.invalidate(ProbeKind::EXTERNAL_IP);
+    TEST_ASSERT_FALSE(probe.fresh(ProbeKind::EXTERNAL_IP));
+    TEST_ASSERT(probe.get(ProbeKind::EXTERNAL_IP, 2000ms).is_ok());
+    TEST_ASSERT_EQUAL_INT(2, runs.load());
+}
+
+void test_expired_answer_served_while_refreshing(void) {
+    std::atomic<int> runs{0};
+    NetProbeConfig config;
+    config.local_ip_ttl = 0s;
+    NetProbe probe(config);
+    probe.set_probe(ProbeKind::LOCAL_IP, [&runs](const NetProbeConfig&) -> Result<std::string> {
+        return Ok<std::string>("10.0.0." + std::to_string(runs.fetch_add(1) + 1));
+    });
+
+    // Every answer expires at once, get() can only ever serve it stale
+    auto first = probe.get(ProbeKind::LOCAL_IP, 100ms);
+    TEST_ASSERT(first.is_ok() && first.value().rfind("10.0.0.", 0) == 0);
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().stale_served);
+    auto second = probe.get(ProbeKind::LOCAL_IP, 100ms);
+    TEST_ASSERT(second.is_ok());
+    TEST_ASSERT(runs.load() >= 2);
+}
+
+void test_failures_are_cached_for_failure_ttl(void) {
+    std::atomic<int> runs{0};
+    NetProbe probe;
+    probe.set_probe(ProbeKind::PORT_FORWARD, [&runs](const NetProbeConfig&) -> Result<std::string> {
+        runs.fetch_add(1);
+        return Err<std::string>(ErrorCode::FAIL_UPNP_FORWARD, "no gateway");
+    });
+
+    auto ret = probe.get(ProbeKind::PORT_FORWARD, 2000ms);
+    TEST_ASSERT(ret.is_err());
+    TEST_ASSERT(ret.error().code() == ErrorCode::FAIL_UPNP_FORWARD);
+    TEST_ASSERT(probe.get(ProbeKind::PORT_FORWARD).is_err());
+    TEST_ASSERT_EQUAL_INT(1, runs.load());
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().failures);
+}
+
+void test_get_does_not_wait_unless_asked(void) {
+    NetProbe probe;
+    auto missing = probe.get(ProbeKind::LOCAL_IP);
+    TEST_ASSERT(missing.is_err() && missing.error().code() == ErrorCode::NO_OBJECT);
+
+    probe.set_probe(ProbeKind::EXTERNAL_IP, slow_probe("203.0.113.7", 200ms));
+    auto start = std::chrono::steady_clock::now();
+    auto pending = probe.get(ProbeKind::EXTERNAL_IP);
+    TEST_ASSERT(std::chrono::steady_clock::now() - start < 50ms);
+    TEST_ASSERT(pending.is_err() && pending.error().code() == ErrorCode::SOCKET_TIMEOUT);
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().timeouts);
+    TEST_ASSERT(probe.get(ProbeKind::EXTERNAL_IP, 2000ms).is_ok());
+}
+
+void test_replaced_probe_drops_late_answer(void) {
+    NetProbe probe;
+    probe.set_probe(ProbeKind::EXTERNAL_IP, slow_probe("old", 100ms));
+    TEST_ASSERT(probe.get(ProbeKind::EXTERNAL_IP).is_err());
+
+    // A stub endpoint swapped in while the first probe is still out
+    probe.set_probe(ProbeKind::EXTERNAL_IP, slow_probe("new", 1ms));
+    auto ret = probe.get(ProbeKind::EXTERNAL_IP, 2000ms);
+    TEST_ASSERT(ret.is_ok() && ret.value() == "new");
+    std::this_thread::sleep_for(150ms);
+    ret = probe.get(ProbeKind::EXTERNAL_IP);
+    TEST_ASSERT(ret.is_ok() && ret.value() == "new");
+}
+
+void test_start_skips_port_forward_without_port(void) {
+    std::atomic<int> runs{0};
+    NetProbe probe;
+    probe.set_probe(ProbeKind::PORT_FORWARD, slow_probe("7099", 1ms, &runs));
+    probe.start();
+    std::this_thread::sleep_for(50ms);
+    TEST_ASSERT_EQUAL_INT(0, runs.load());
+    TEST_ASSERT_EQUAL_STRING("port_forward", probe_kind_to_string(ProbeKind::PORT_FORWARD));
+}
+
+void test_invalidate_never_runs_a_kind_twice(void) {
+    std::atomic<int> in_flight{0};
+    std::atomic<int> most{0};
+    std::atomic<int> runs{0};
+    NetProbe probe;
+    probe.set_probe(ProbeKind::LOCAL_IP, [&](const NetProbeConfig&) -> Result<std::string> {
+        int now = ++in_flight;
+        most = std::max(most.load(), now);
+        runs++;
+        std::this_thread::sleep_for(50ms);
+        in_flight--;
+        return Ok<std::string>("192.168.1.5");
+    });
+    probe.start();
+    std::this_thread::sleep_for(10ms);
+    // The first run is still out, the next get() has to wait for it instead of starting another
+    probe.invalidate(ProbeKind::LOCAL_IP);
+    auto ret = probe.get(ProbeKind::LOCAL_IP, 2000ms);
+    TEST_ASSERT(ret.is_ok());
+    TEST_ASSERT_EQUAL_INT(1, most.load());
+    TEST_ASSERT_EQUAL_INT(2, runs.load());
+    // Only the second run's answer was taken
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().runs);
+}
+
+void test_set_config_reaches_the_probes(void) {
+    NetProbe probe;
+    probe.set_probe(ProbeKind::PORT_FORWARD, [](const NetProbeConfig& config) -> Result<std::string> {
+        if (config.forward_port == 0) {
+            return Err<std::string>(ErrorCode::FAIL_UPNP_FORWARD, "No port");
+        }
+        return Ok<std::string>(std::to_string(config.forward_port));
+    });
+    TEST_ASSERT(probe.get(ProbeKind::PORT_FORWARD, 2000ms).is_err());
+
+    NetProbeConfig config = probe.config();
+    config.forward_port = 7099;
+    probe.set_config(config);
+    TEST_ASSERT_EQUAL_INT(7099, probe.config().forward_port);
+    // The cached failure was dropped with the old config
+    auto ret = probe.get(ProbeKind::PORT_FORWARD, 2000ms);
+    TEST_ASSERT(ret.is_ok() && ret.value() == "7099");
+}
+
+void test_throwing_probe_is_a_failure(void) {
+    std::atomic<int> runs{0};
+    NetProbe probe;
+    probe.set_probe(ProbeKind::EXTERNAL_IP, [&](const NetProbeConfig&) -> Result<std::string> {
+        if (runs++ == 0) {
+            throw std::runtime_error("boom");
+        }
+        return Ok<std::string>("203.0.113.7");
+    });
+    auto failed = probe.get(ProbeKind::EXTERNAL_IP, 2000ms);
+    TEST_ASSERT(failed.is_err() && failed.error().code() == ErrorCode::SOCKET_CONNECT_FAIL);
+    TEST_ASSERT_EQUAL_UINT64(1, probe.stats().failures);
+    // The kind is not stuck running, a dropped answer is probed again
+    probe.invalidate(ProbeKind::EXTERNAL_IP);
+    auto ret = probe.get(ProbeKind::EXTERNAL_IP, 2000ms);
+    TEST_ASSERT(ret.is_ok() && ret.value() == "203.0.113.7");
+}
+
+int main(void) {
+    Log::init();
+    UNITY_BEGIN();
+    RUN_TEST(test_probes_run_concurrently);
+    RUN_TEST(test_answers_are_cached);
+    RUN_TEST(test_expired_answer_served_while_refreshing);
+    RUN_TEST(test_failures_are_cached_for_failure_ttl);
+    RUN_TEST(test_get_does_not_wait_unless_asked);
+    RUN_TEST(test_replaced_probe_drops_late_answer);
+    RUN_TEST(test_start_skips_port_forward_without_port);
+    RUN_TEST(test_invalidate_never_runs_a_kind_twice);
+    RUN_TEST(test_set_config_reaches_the_probes);
+    RUN_TEST(test_throwing_probe_is_a_failure);
+    return UNITY_END();
+}
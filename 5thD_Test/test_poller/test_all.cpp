@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <zmq.h>
+#include "izmq.h"
+#include "poller.h"
+#include "unity.h"
+
+std::unique_ptr<ZMQWContext> context;
+std::unique_ptr<ZMQWSocket> pull_a;
+std::unique_ptr<ZMQWSocket> pull_b;
+std::unique_ptr<ZMQWSocket> push_a;
+std::unique_ptr<ZMQWSocket> push_b;
+std::unique_ptr<ZMQWPoller> poller;
+
+void setUp(void) {
+    context = std::make_unique<ZMQWContext>();
+    pull_a = std::make_unique<ZMQWSocket>(context.get(), ZMQ_PULL);
+    pull_b = std::make_unique<ZMQWSocket>(context.get(), ZMQ_PULL);
+    push_a = std::make_unique<ZMQWSocket>(context.get(), ZMQ_PUSH);
+    push_b = std::make_unique<ZMQWSocket>(context.get(), ZMQ_PUSH);
+    zmq_bind(pull_a->get_socket(), "inproc://test_poller_a");
+    zmq_bind(pull_b->get_socket(), "inproc://test_poller_b");
+    zmq_connect(push_a->get_socket(), "inproc://test_poller_a");
+    zmq_connect(push_b->get_socket(), "inproc://test_poller_b");
+    poller = std::make_unique<ZMQWPoller>(context.get(), 50);
+}
+
+void tearDown(void) {
+    poller.reset();
+    push_b.reset();
+    push_a.reset();
+    pull_b.reset();
+    pull_a.reset();
+    context.reset();
+}
+
+void test_ZMQWPoller_dispatch(void) {
+    std::atomic<bool> until{true};
+    int got_a = 0;
+    int got_b = 0;
+    auto recv_cb = [&](int* counter) {
+        return [&, counter](void* sock) {
+            int value;
+            while (zmq_recv(sock, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+                (*counter)++;
+            }
+            if (got_a == 3 && got_b == 2) {
+                until = false;
+            }
+        };
+    };
+    TEST_ASSERT(poller->add(pull_a.get(), ZMQ_POLLIN, recv_cb(&got_a)));
+    TEST_ASSERT(poller->add(pull_b.get(), ZMQ_POLLIN, recv_cb(&got_b)));
+    TEST_ASSERT_EQUAL_INT(2, poller->num_sockets());
+
+    for (int i = 0; i < 3; ++i) {
+        zmq_send(push_a->get_socket(), &i, sizeof(i), 0);
+    }
+    for (int i = 0; i < 2; ++i) {
+        zmq_send(push_b->get_socket(), &i, sizeof(i), 0);
+    }
+    poller->run(&until);
+
+    TEST_ASSERT_EQUAL_INT(3, got_a);
+    TEST_ASSERT_EQUAL_INT(2, got_b);
+}
+
+void test_ZMQWPoller_remove(void) {
+    std::atomic<bool> until{true};
+    int got_a = 0;
+    poller->add(pull_a.get(), ZMQ_POLLIN, [&](void* sock) {
+        got_a++;
+        until = false;
+    });
+    TEST_ASSERT(poller->remove(pull_a.get()));
+
+    int value = 1;
+    zmq_send(push_a->get_socket(), &value, sizeof(value), 0);
+
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        until = false;
+        poller->wake();
+    });
+    poller->run(&until);
+    stopper.join();
+
+    TEST_ASSERT_EQUAL_INT(0, got_a);
+    TEST_ASSERT_EQUAL_INT(0, poller->num_sockets());
+}
+
+void test_ZMQWPoller_remove_while_running(void) {
+    std::atomic<bool> until{true};
+    std::atomic<int> got_b{0};
+    poller->add(pull_a.get(), ZMQ_POLLIN, [](void* sock) {
+        int value;
+        zmq_recv(sock, &value, sizeof(value), ZMQ_DONTWAIT);
+    });
+    poller->add(pull_b.get(), ZMQ_POLLIN, [&](void* sock) {
+        int value;
+        while (zmq_recv(sock, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+            got_b++;
+        }
+    });
+    std::thread loop([&] { poller->run(&until); });
+
+    // The loop acknowledged, closing the socket now can't race its zmq_poll
+    TEST_ASSERT(poller->remove(pull_a.get()));
+    TEST_ASSERT_EQUAL_INT(1, poller->num_sockets());
+    push_a.reset();
+    pull_a.reset();
+
+    int value = 1;
+    zmq_send(push_b->get_socket(), &value, sizeof(value), 0);
+    for (int i = 0; i < 100 && got_b == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    until = false;
+    poller->wake();
+    loop.join();
+    TEST_ASSERT_EQUAL_INT(1, got_b.load());
+}
+
+void test_ZMQWPoller_remove_from_callback(void) {
+    std::atomic<bool> until{true};
+    int got_a = 0;
+    poller->add(pull_a.get(), ZMQ_POLLIN, [&](void* sock) {
+        int value;
+        while (zmq_recv(sock, &value, sizeof(value), ZMQ_DONTWAIT) != -1) {
+            got_a++;
+        }
+        // Returns at once on the loop thread, no callback after this one
+        TEST_ASSERT(poller->remove(pull_a.get()));
+    });
+
+    int value = 1;
+    zmq_send(push_a->get_socket(), &value, sizeof(value), 0);
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        zmq_send(push_a->get_socket(), &value, sizeof(value), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        until = false;
+        poller->wake();
+    });
+    poller->run(&until);
+    stopper.join();
+
+    TEST_ASSERT_EQUAL_INT(1, got_a);
+    TEST_ASSERT_EQUAL_INT(0, poller->num_sockets());
+}
+
+int main(void) {
+    Log::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ZMQWPoller_dispatch);
+    RUN_TEST(test_ZMQWPoller_remove);
+    RUN_TEST(test_ZMQWPoller_remove_while_running);
+    RUN_TEST(test_ZMQWPoller_remove_from_callback);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+#include "5thdlogger.h"
+#include "port_allocator.h"
+#include "unity.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Plain bind without SO_REUSEADDR, how a foreign process would try to take the port
+static int plain_bind(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// What zmq does for a tcp listener: SO_REUSEADDR, bind, listen
+static bool listener_binds(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    bool ok = bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(sock, 1) == 0;
+    close(sock);
+    return ok;
+}
+
+void test_reserve_kernel_ports_are_unique(void) {
+    PortAllocator ports;
+    std::set<int> seen;
+    for (int i = 0; i < 64; ++i) {
+        auto port = ports.reserve();
+        TEST_ASSERT(port.is_ok());
+        TEST_ASSERT(port.value() >= PORT_MIN && port.value() <= PORT_MAX);
+        TEST_ASSERT(seen.insert(port.value()).second);
+        TEST_ASSERT(ports.is_reserved(port.value()));
+    }
+    TEST_ASSERT_EQUAL_size_t(64, ports.size());
+    TEST_ASSERT_EQUAL_UINT64(64, ports.stats().kernel_picks);
+}
+
+void test_reserved_port_is_held_until_claimed(void) {
+    PortAllocator ports;
+    auto port = ports.reserve();
+    TEST_ASSERT(port.is_ok());
+    TEST_ASSERT_EQUAL_INT(-1, plain_bind(port.value()));
+    // SO_REUSEADDR does not get around the holder either
+    TEST_ASSERT_FALSE(listener_binds(port.value()));
+
+    ports.claim(port.value());
+    TEST_ASSERT(ports.is_reserved(port.value()));
+    TEST_ASSERT(listener_binds(port.value()));
+
+    ports.release(port.value());
+    TEST_ASSERT_FALSE(ports.is_reserved(port.value()));
+    TEST_ASSERT_EQUAL_size_t(0, ports.size());
+}
+
+void test_reserve_in_range_skips_busy_ports(void) {
+    PortAllocator ports;
+    auto base = ports.reserve();
+    TEST_ASSERT(base.is_ok());
+    int first = base.value();
+    if (first + 2 > PORT_MAX) {
+        return;
+    }
+
+    // first is held by this allocator (no syscall), first + 1 by a foreign socket
+    int foreign = plain_bind(first + 1);
+    auto next = ports.reserve_in_range("127.0.0.1", first, std::min(first + 200, PORT_MAX));
+    TEST_ASSERT(next.is_ok());
+    TEST_ASSERT(next.value() > first);
+    if (foreign >= 0) {
+        TEST_ASSERT(next.value() > first + 1);
+        close(foreign);
+    }
+    TEST_ASSERT(ports.is_reserved(next.value()));
+    TEST_ASSERT(ports.stats().probes >= 1);
+    TEST_ASSERT_EQUAL_UINT64(1, ports.stats().range_picks);
+}
+
+void test_reserve_rejects_bad_input(void) {
+    PortAllocator ports;
+    TEST_ASSERT(ports.reserve("not-an-address").is_err());
+    TEST_ASSERT(ports.reserve_in_range("127.0.0.1", 0, 10).is_err());
+    TEST_ASSERT(ports.reserve_in_range("127.0.0.1", 100, 99).is_err());
+    TEST_ASSERT(ports.reserve_in_range("127.0.0.1", 1, PORT_MAX + 1).is_err());
+
+    auto port = ports.reserve();
+    TEST_ASSERT(port.is_ok());
+    // The only candidate is already reserved
+    TEST_ASSERT(ports.reserve_in_range("127.0.0.1", port.value(), port.value()).is_err());
+    TEST_ASSERT_EQUAL_size_t(1, ports.size());
+}
+
+int main(void) {
+    Log::init();
+    UNITY_BEGIN();
+    RUN_TEST(test_reserve_kernel_ports_are_unique);
+    RUN_TEST(test_reserved_port_is_held_until_claimed);
+    RUN_TEST(test_reserve_in_range_skips_busy_ports);
+    RUN_TEST(test_reserve_rejects_bad_input);
+    return UNITY_END();
+}
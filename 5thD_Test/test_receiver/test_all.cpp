@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #include <zmq.h>
@@ -39,6 +41,66 @@ void test_ZMQWRecv_listen(void) {
   TEST_ASSERT(recv->listen());
 }
 
+void test_ZMQWRecv_worker_batch(void) {
+    ZMQWSocket router(context.get(), ZMQ_ROUTER);
+    ZMQWReceiver batch_recv(endpoint, 0, context.get(), &router);
+    batch_recv.set_endpoint("inproc://test_worker_batch");
+    TEST_ASSERT(batch_recv.listen());
+
+    void* dealer = zmq_socket(context->get_context(), ZMQ_DEALER);
+    zmq_connect(dealer, "inproc://test_worker_batch");
+    for (int i = 0; i < 5; ++i) {
+        zmq_send(dealer, &i, sizeof(i), 0);
+    }
+
+    std::atomic<bool> until{true};
+    size_t received = 0;
+    bool frames_ok = true;
+    batch_recv.worker_batch(&until, 4, [&](RecvBatch& batch) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            // routing id + payload
+            frames_ok &= batch.num_frames(i) == 2;
+            frames_ok &= zmq_msg_size(batch.frame(i, 1)) == sizeof(int);
+        }
+        received += batch.size();
+        if (received == 5) {
+            until = false;
+        }
+    });
+    zmq_close(dealer);
+
+    TEST_ASSERT_EQUAL_INT(5, received);
+    TEST_ASSERT(frames_ok);
+}
+
+void test_ZMQWRecv_worker_batch_zero_is_one(void) {
+    ZMQWSocket router(context.get(), ZMQ_ROUTER);
+    ZMQWReceiver batch_recv(endpoint, 0, context.get(), &router);
+    batch_recv.set_endpoint("inproc://test_worker_batch_zero");
+    TEST_ASSERT(batch_recv.listen());
+
+    void* dealer = zmq_socket(context->get_context(), ZMQ_DEALER);
+    zmq_connect(dealer, "inproc://test_worker_batch_zero");
+    for (int i = 0; i < 3; ++i) {
+        zmq_send(dealer, &i, sizeof(i), 0);
+    }
+
+    std::atomic<bool> until{true};
+    size_t received = 0;
+    size_t largest = 0;
+    batch_recv.worker_batch(&until, 0, [&](RecvBatch& batch) {
+        largest = std::max(largest, batch.size());
+        received += batch.size();
+        if (received == 3) {
+            until = false;
+        }
+    });
+    zmq_close(dealer);
+
+    TEST_ASSERT_EQUAL_INT(3, received);
+    TEST_ASSERT_EQUAL_INT(1, largest);
+}
+
 int main(void) {
     Log::init();
     
@@ -46,5 +108,7 @@ int main(void) {
     RUN_TEST(test_ZMQWRecv_set_endpoint);
     RUN_TEST(test_ZMQWRecv_get_port);
     RUN_TEST(test_ZMQWRecv_listen);
+    RUN_TEST(test_ZMQWRecv_worker_batch);
+    RUN_TEST(test_ZMQWRecv_worker_batch_zero_is_one);
     return UNITY_END();
 }
@@ -0,0 +1,100 @@
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "5thdlogger.h"
+#include "routing_table.h"
+#include "unity.h"
+
+std::unique_ptr<RoutingTable> table;
+
+void setUp(void) {
+    table = std::make_unique<RoutingTable>();
+}
+
+void tearDown(void) {
+    table.reset();
+}
+
+void test_RoutingTable_fixed_ids(void) {
+    Route route;
+    TEST_ASSERT_FALSE(table->lookup(Clients::PEER, route));
+
+    TEST_ASSERT(table->update(Clients::PEER, "peerxxx", 7));
+    TEST_ASSERT(table->lookup(Clients::PEER, route));
+    TEST_ASSERT(route.equals("peerxxx", 7));
+
+    // Same identity is a no-op
+    TEST_ASSERT_FALSE(table->update(Clients::PEER, "peerxxx", 7));
+    TEST_ASSERT(table->update(Clients::PEER, "peer2", 5));
+    TEST_ASSERT(table->lookup(Clients::PEER, route));
+    TEST_ASSERT(route.equals("peer2", 5));
+}
+
+void test_RoutingTable_dynamic_ids(void) {
+    Route route;
+    for (int id = 100; id < 200; ++id) {
+        std::string identity = "dyn" + std::to_string(id);
+        TEST_ASSERT(table->update(id, identity.data(), identity.size()));
+    }
+    TEST_ASSERT(table->lookup(150, route));
+    TEST_ASSERT(route.equals("dyn150", 6));
+
+    TEST_ASSERT(table->remove(150));
+    TEST_ASSERT_FALSE(table->lookup(150, route));
+    TEST_ASSERT(table->lookup(151, route));
+}
+
+void test_RoutingTable_bad_identity(void) {
+    char big[ROUTE_ID_MAX_BYTES + 1] = {0};
+    TEST_ASSERT_FALSE(table->update(Clients::UI, big, sizeof(big)));
+    TEST_ASSERT_FALSE(table->update(Clients::UI, nullptr, 3));
+}
+
+void test_RoutingTable_concurrent(void) {
+    std::atomic<bool> stop{false};
+    std::atomic<bool> torn{false};
+    std::vector<std::thread> readers;
+
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            Route route;
+            while (!stop) {
+                for (int id : {(int) Clients::MANAGER, 1000, 1001}) {
+                    if (table->lookup(id, route)) {
+                        // identities are written as N times the same char
+                        for (size_t i = 1; i < route.size; ++i) {
+                            if (route.id[i] != route.id[0]) {
+                                torn = true;
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 5000; ++i) {
+        std::string identity(1 + i % 64, 'a' + i % 26);
+        table->update(Clients::MANAGER, identity.data(), identity.size());
+        table->update(1000 + i % 2, identity.data(), identity.size());
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    TEST_ASSERT_FALSE(torn);
+}
+
+int main(void) {
+    Log::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_RoutingTable_fixed_ids);
+    RUN_TEST(test_RoutingTable_dynamic_ids);
+    RUN_TEST(test_RoutingTable_bad_identity);
+    RUN_TEST(test_RoutingTable_concurrent);
+    return UNITY_END();
+}
@@ -0,0 +1,126 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "5thdsharded_cache.h"
+#include "unity.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_ShardedCache_lru_order(void) {
+    // One shard so the eviction order is exact
+    ShardedCache<int, std::string> cache(3, 1);
+    cache.push(1, "one");
+    cache.push(2, "two");
+    cache.push(3, "three");
+
+    std::string value;
+    TEST_ASSERT(cache.get(1, value));
+    TEST_ASSERT_EQUAL_STRING("one", value.c_str());
+
+    cache.push(4, "four");
+    TEST_ASSERT_FALSE(cache.get(2, value));
+    TEST_ASSERT(cache.get(1, value));
+    TEST_ASSERT(cache.get(3, value));
+    TEST_ASSERT(cache.get(4, value));
+
+    cache.push(3, "THREE");
+    TEST_ASSERT(cache.get(3, value));
+    TEST_ASSERT_EQUAL_STRING("THREE", value.c_str());
+    TEST_ASSERT_EQUAL_size_t(3, cache.size());
+
+    CacheStats stats = cache.stats();
+    TEST_ASSERT_EQUAL_UINT64(5, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.misses);
+    TEST_ASSERT_EQUAL_UINT64(4, stats.inserts);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.evictions);
+}
+
+void test_ShardedCache_sieve_keeps_visited(void) {
+    ShardedCache<int, int, CachePolicy::SIEVE> cache(4, 1);
+    for (int i = 0; i < 4; ++i) {
+        cache.push(i, i * 10);
+    }
+    int value;
+    TEST_ASSERT(cache.get(0, value));
+    TEST_ASSERT(cache.get(1, value));
+
+    // 0 and 1 are visited, the hand skips them and takes 2 then 3
+    cache.push(4, 40);
+    cache.push(5, 50);
+    TEST_ASSERT(cache.get(0, value));
+    TEST_ASSERT_EQUAL_INT(0, value);
+    TEST_ASSERT(cache.get(1, value));
+    TEST_ASSERT_FALSE(cache.get(2, value));
+    TEST_ASSERT_FALSE(cache.get(3, value));
+    TEST_ASSERT(cache.get(5, value));
+    TEST_ASSERT_EQUAL_INT(50, value);
+}
+
+void test_ShardedCache_erase_and_visit(void) {
+    ShardedCache<std::string, std::string> cache(16);
+    cache.push("key", "value");
+
+    size_t seen = 0;
+    TEST_ASSERT(cache.visit("key", [&seen](const std::string& v) { seen = v.size(); }));
+    TEST_ASSERT_EQUAL_size_t(5, seen);
+
+    TEST_ASSERT(cache.erase("key"));
+    TEST_ASSERT_FALSE(cache.erase("key"));
+    TEST_ASSERT_FALSE(cache.visit("key", [](const std::string&) {}));
+    TEST_ASSERT_EQUAL_size_t(0, cache.size());
+}
+
+void test_ShardedCache_large_capacity(void) {
+    ShardedCache<uint32_t, uint32_t> cache(200000);
+    TEST_ASSERT(cache.capacity() >= 200000);
+    for (uint32_t i = 0; i < 200000; ++i) {
+        cache.push(i, i + 1);
+    }
+    uint32_t value;
+    TEST_ASSERT(cache.get(0, value));
+    TEST_ASSERT(cache.get(199999, value));
+    TEST_ASSERT_EQUAL_UINT32(200000, value);
+}
+
+void test_ShardedCache_concurrent(void) {
+    ShardedCache<int, int, CachePolicy::SIEVE> sieve(1024);
+    ShardedCache<int, int> lru(1024);
+    std::atomic<bool> wrong{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            int value;
+            for (int i = 0; i < 50000; ++i) {
+                int key = (i * 7 + t) % 4096;
+                sieve.push(key, key * 2);
+                lru.push(key, key * 2);
+                if (sieve.get(key ^ 1, value) && value != (key ^ 1) * 2) {
+                    wrong = true;
+                }
+                if (lru.get(key ^ 1, value) && value != (key ^ 1) * 2) {
+                    wrong = true;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    TEST_ASSERT_FALSE(wrong);
+    TEST_ASSERT(sieve.size() <= sieve.capacity());
+    TEST_ASSERT(lru.size() <= lru.capacity());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ShardedCache_lru_order);
+    RUN_TEST(test_ShardedCache_sieve_keeps_visited);
+    RUN_TEST(test_ShardedCache_erase_and_visit);
+    RUN_TEST(test_ShardedCache_large_capacity);
+    RUN_TEST(test_ShardedCache_concurrent);
+    return UNITY_END();
+}
@@ -0,0 +1,272 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "telemetry.h"
+#include "unity.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Metrics live for the whole process, every test registers its own names
+static const CounterSample* find_counter(const MetricsSnapshot& snapshot, const std::string& name) {
+    for (const auto& sample : snapshot.counters) {
+        if (sample.name == name) {
+            return &sample;
+        }
+    }
+    return nullptr;
+}
+
+static const HistogramSample* find_histogram(const MetricsSnapshot& snapshot, const std::string& name) {
+    for (const auto& sample : snapshot.histograms) {
+        if (sample.name == name) {
+            return &sample;
+        }
+    }
+    return nullptr;
+}
+
+class CaptureExporter : public TelemetryExporter {
+public:
+    struct Shared {
+        std::mutex lock;
+        std::vector<TelemetryEvent> events;
+        std::vector<std::string> lines;
+        size_t batches = 0;
+        uint64_t last_counter = 0;
+    };
+
+    explicit CaptureExporter(std::shared_ptr<Shared> shared) : _shared(std::move(shared)) {}
+
+    void export_batch(const std::vector<TelemetryEvent>& events, const MetricsSnapshot& metrics,
+                      const TelemetryIdentity& identity) override {
+        std::lock_guard<std::mutex> lock(_shared->lock);
+        for (const auto& event : events) {
+            _shared->events.push_back(event);
+            _shared->lines.push_back(telemetry_to_json(event, identity));
+        }
+        if (const CounterSample* sample = find_counter(metrics, "test.export.counter")) {
+            _shared->last_counter = sample->value;
+        }
+        _shared->batches++;
+    }
+
+private:
+    std::shared_ptr<Shared> _shared;
+};
+
+void test_bucket_bounds(void) {
+    uint32_t previous = 0;
+    for (uint64_t value = 0; value < 100000; ++value) {
+        uint32_t bucket = telemetry_bucket(value);
+        TEST_ASSERT(bucket >= previous);
+        TEST_ASSERT(value <= telemetry_bucket_upper(bucket));
+        if (bucket > 0) {
+            TEST_ASSERT(value > telemetry_bucket_upper(bucket - 1));
+        }
+        previous = bucket;
+    }
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_HIST_BUCKETS - 1, telemetry_bucket(UINT64_MAX));
+    // Relative width stays under 2^-SUB_BITS
+    uint32_t bucket = telemetry_bucket(1000000);
+    uint64_t width = telemetry_bucket_upper(bucket) - telemetry_bucket_upper(bucket - 1);
+    TEST_ASSERT(width * 16 <= telemetry_bucket_upper(bucket));
+}
+
+void test_counters_sum_every_thread(void) {
+    Counter counter = Telemetry::counter("test.counter.threads");
+    // Same name, same metric
+    Counter again = Telemetry::counter("test.counter.threads");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add();
+            }
+            again.add(5);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    counter.add(3);
+
+    // Those threads are gone, what they counted was folded in when they exited
+    auto snapshot = Telemetry::snapshot();
+    const CounterSample* sample = find_counter(snapshot, "test.counter.threads");
+    TEST_ASSERT_NOT_NULL(sample);
+    TEST_ASSERT_EQUAL_UINT64(40023, sample->value);
+
+    Counter unregistered;
+    unregistered.add(7);
+}
+
+void test_gauge(void) {
+    Gauge gauge = Telemetry::gauge("test.gauge");
+    gauge.set(10);
+    gauge.add(-3);
+    auto snapshot = Telemetry::snapshot();
+    bool found = false;
+    for (const auto& sample : snapshot.gauges) {
+        if (sample.name == "test.gauge") {
+            TEST_ASSERT_EQUAL_INT(7, sample.value);
+            found = true;
+        }
+    }
+    TEST_ASSERT(found);
+}
+
+void test_histogram_percentiles(void) {
+    Histogram hist = Telemetry::histogram("test.hist.latency");
+    std::thread other([&] {
+        for (uint64_t v = 1; v <= 5000; ++v) {
+            hist.record(v * 1000);
+        }
+    });
+    for (uint64_t v = 5001; v <= 10000; ++v) {
+        hist.record(v * 1000);
+    }
+    other.join();
+    hist.record(std::chrono::microseconds(1));
+
+    auto snapshot = Telemetry::snapshot();
+    const HistogramSample* sample = find_histogram(snapshot, "test.hist.latency");
+    TEST_ASSERT_NOT_NULL(sample);
+    TEST_ASSERT_EQUAL_UINT64(10001, sample->count);
+    TEST_ASSERT_EQUAL_UINT64(1000, sample->min);
+    TEST_ASSERT_EQUAL_UINT64(10000000, sample->max);
+    // Within one bucket (~6%) above the exact ranks
+    TEST_ASSERT(sample->p50 >= 5000000 && sample->p50 <= 5000000 * 107 / 100);
+    TEST_ASSERT(sample->p99 >= 9900000 && sample->p99 <= 10000000);
+    TEST_ASSERT(sample->p999 >= 9990000 && sample->p999 <= 10000000);
+    TEST_ASSERT(sample->p50 <= sample->p90 && sample->p90 <= sample->p99);
+}
+
+void test_event_envelope_json(void) {
+    TelemetryEvent event(EventClass::EVENT, "peer.invalid_frame", EventSeverity::HIGH, "transport.frame_decoder");
+    event.peer_id = "peer:3ac1";
+    event.outcome = "denied";
+    event.field("reason", "length \"mismatch\"").field("frame_size", uint64_t(42));
+    event.event_id = "01HRZ2E4K7Y8W3P4M7N9Q0R1ST";
+    event.ts = std::chrono::system_clock::time_point(std::chrono::milliseconds(1773576000123));
+
+    std::string json = telemetry_to_json(event, {"node:4f2a", "5thd-peer"});
+    TEST_ASSERT(json.find("\"event_id\":\"01HRZ2E4K7Y8W3P4M7N9Q0R1ST\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"ts_utc\":\"2026-03-15T12:00:00.123Z\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"class\":\"event\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"severity\":\"high\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"node_id\":\"node:4f2a\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"process\":\"5thd-peer\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"module_id\":null") != std::string::npos);
+    TEST_ASSERT(json.find("\"peer_id\":\"peer:3ac1\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"reason\":\"length \\\"mismatch\\\"\"") != std::string::npos);
+    TEST_ASSERT(json.find("\"frame_size\":42") != std::string::npos);
+    TEST_ASSERT(json.front() == '{' && json.back() == '}');
+}
+
+void test_audit_event_fields(void) {
+    TelemetryEvent event = audit_event("audit.key.export_attempt", "storage.keys", "phone:1", "phone", "key:curve",
+                                       "export", "denied", "policy");
+    TEST_ASSERT(event.event_class == EventClass::AUDIT);
+    TEST_ASSERT(event.outcome == "denied");
+    const char* required[] = {"actor_id", "actor_type", "target", "action", "decision", "reason"};
+    for (const char* key : required) {
+        bool found = false;
+        for (const auto& field : event.fields) {
+            found = found || field.key == key;
+        }
+        TEST_ASSERT(found);
+    }
+}
+
+void test_events_exported_in_batches(void) {
+    auto shared = std::make_shared<CaptureExporter::Shared>();
+    Telemetry::set_identity("node:test", "5thd-test");
+    Telemetry::start(std::make_unique<CaptureExporter>(shared), std::chrono::milliseconds(10000));
+
+    Counter counter = Telemetry::counter("test.export.counter");
+    counter.add(11);
+    for (int i = 0; i < 100; ++i) {
+        Telemetry::emit(TelemetryEvent(EventClass::EVENT, "module.started", EventSeverity::INFO, "module")
+                            .field("seq", i));
+    }
+    Telemetry::flush();
+    {
+        std::lock_guard<std::mutex> lock(shared->lock);
+        TEST_ASSERT_EQUAL_size_t(100, shared->events.size());
+        TEST_ASSERT_EQUAL_size_t(1, shared->batches);
+        TEST_ASSERT_EQUAL_UINT64(11, shared->last_counter);
+        TEST_ASSERT_EQUAL_size_t(26, shared->events[0].event_id.size());
+        TEST_ASSERT(shared->events[0].event_id != shared->events[1].event_id);
+        TEST_ASSERT(shared->lines[99].find("\"seq\":99") != std::string::npos);
+        TEST_ASSERT(shared->lines[0].find("\"node_id\":\"node:test\"") != std::string::npos);
+    }
+
+    Telemetry::emit(TelemetryEvent(EventClass::ANOMALY, "peer.rate_limited", EventSeverity::MEDIUM, "transport"));
+    Telemetry::stop();
+    {
+        std::lock_guard<std::mutex> lock(shared->lock);
+        // stop() exports what is left
+        TEST_ASSERT_EQUAL_size_t(101, shared->events.size());
+    }
+    TEST_ASSERT_EQUAL_UINT64(101, Telemetry::stats().exported);
+}
+
+void test_full_queue_drops(void) {
+    TelemetryStats before = Telemetry::stats();
+    for (int i = 0; i < TELEMETRY_EVENT_QUEUE + 10; ++i) {
+        Telemetry::emit(TelemetryEvent(EventClass::EVENT, "test.flood", EventSeverity::DEBUG, "test"));
+    }
+    TelemetryStats after = Telemetry::stats();
+    TEST_ASSERT_EQUAL_UINT64(10, after.dropped - before.dropped);
+    TEST_ASSERT_EQUAL_UINT64(TELEMETRY_EVENT_QUEUE, after.emitted - before.emitted);
+
+    // Draining it makes room again
+    auto shared = std::make_shared<CaptureExporter::Shared>();
+    Telemetry::start(std::make_unique<CaptureExporter>(shared));
+    Telemetry::stop();
+    TEST_ASSERT_EQUAL_size_t(TELEMETRY_EVENT_QUEUE, shared->events.size());
+}
+
+void test_full_table_counts_dropped_metrics(void) {
+    auto dropped = []() {
+        // Kept alive while sample points into it
+        MetricsSnapshot snapshot = Telemetry::snapshot();
+        const CounterSample* sample = find_counter(snapshot, "telemetry.metrics_dropped");
+        return sample ? sample->value : UINT64_MAX;
+    };
+    uint64_t before = dropped();
+    TEST_ASSERT(before != UINT64_MAX);
+
+    // Other tests registered some already, fill the rest and go one past
+    std::vector<Histogram> histograms;
+    for (int i = 0; i <= TELEMETRY_MAX_HISTOGRAMS; ++i) {
+        histograms.push_back(Telemetry::histogram(("test.fill." + std::to_string(i)).c_str()));
+    }
+    uint64_t after = dropped();
+    TEST_ASSERT(after > before);
+    histograms.back().record(1);
+    MetricsSnapshot full = Telemetry::snapshot();
+    TEST_ASSERT(find_histogram(full, "test.fill." + std::to_string(TELEMETRY_MAX_HISTOGRAMS)) == nullptr);
+    TEST_ASSERT_EQUAL_size_t(TELEMETRY_MAX_HISTOGRAMS, full.histograms.size());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_bounds);
+    RUN_TEST(test_counters_sum_every_thread);
+    RUN_TEST(test_gauge);
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_event_envelope_json);
+    RUN_TEST(test_audit_event_fields);
+    RUN_TEST(test_events_exported_in_batches);
+    RUN_TEST(test_full_queue_drops);
+    RUN_TEST(test_full_table_counts_dropped_metrics);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#include <array>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.h"
+#include "unity.h"
+
+std::unique_ptr<ThreadPool> pool;
+
+void setUp(void) {
+    pool = std::make_unique<ThreadPool>(4);
+}
+
+void tearDown(void) {
+    pool.reset();
+}
+
+void test_PoolTask_storage(void) {
+    int hits = 0;
+    PoolTask small([&hits] { ++hits; });
+    TEST_ASSERT_FALSE(small.on_heap());
+
+    std::array<char, POOL_TASK_INLINE_BYTES + 1> big{};
+    PoolTask large([&hits, big] { hits += big[0] + 1; });
+    TEST_ASSERT(large.on_heap());
+
+    PoolTask moved(std::move(small));
+    TEST_ASSERT_FALSE(small);
+    moved();
+    large();
+    TEST_ASSERT_EQUAL_INT(2, hits);
+
+    // Move-only captures are fine, std::function would not compile
+    auto owned = std::make_unique<int>(7);
+    PoolTask unique([owned = std::move(owned), &hits] { hits += *owned; });
+    unique();
+    TEST_ASSERT_EQUAL_INT(9, hits);
+}
+
+void test_ThreadPool_submit(void) {
+    auto sum = pool->submit([](int a, int b) { return a + b; }, 2, 3);
+    TEST_ASSERT_EQUAL_INT(5, sum.get());
+
+    auto fail = pool->submit([]() -> int { throw std::runtime_error("boom"); });
+    bool thrown = false;
+    try {
+        fail.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    TEST_ASSERT(thrown);
+}
+
+void test_ThreadPool_submit_bulk(void) {
+    std::vector<std::function<size_t()>> jobs;
+    for (size_t i = 0; i < 1000; ++i) {
+        jobs.push_back([i] { return i * i; });
+    }
+    auto results = pool->submit_bulk(jobs.begin(), jobs.end());
+    TEST_ASSERT_EQUAL_size_t(jobs.size(), results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        TEST_ASSERT_EQUAL_size_t(i * i, results[i].get());
+    }
+}
+
+void test_ThreadPool_parallel_for(void) {
+    std::vector<std::atomic<int>> seen(10007);
+    pool->parallel_for<size_t>(0, seen.size(), [&seen](size_t i) { seen[i].fetch_add(1); });
+    for (auto& count : seen) {
+        TEST_ASSERT_EQUAL_INT(1, count.load());
+    }
+
+    // Uneven grain and a non zero begin
+    std::atomic<long> total{0};
+    pool->parallel_for(-50, 50, [&total](int i) { total += i; }, 7);
+    TEST_ASSERT_EQUAL_INT(-50, total.load());
+
+    bool thrown = false;
+    try {
+        pool->parallel_for(0, 100, [](int i) {
+            if (i == 42) {
+                throw std::runtime_error("42");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    TEST_ASSERT(thrown);
+}
+
+void test_ThreadPool_nested(void) {
+    // Every worker blocks in a nested parallel_for, the callers must help instead of waiting
+    std::vector<std::future<long>> outer;
+    for (int t = 0; t < 8; ++t) {
+        outer.push_back(pool->submit([] {
+            std::atomic<long> sum{0};
+            pool->parallel_for(0, 1000, [&sum](int i) { sum += i; });
+            return sum.load();
+        }));
+    }
+    for (auto& result : outer) {
+        TEST_ASSERT_EQUAL_INT(499500, result.get());
+    }
+}
+
+void test_ThreadPool_drains_on_destroy(void) {
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 10000; ++i) {
+        pool->enqueue([&ran] { ran.fetch_add(1); });
+    }
+    pool.reset();
+    TEST_ASSERT_EQUAL_INT(10000, ran.load());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_PoolTask_storage);
+    RUN_TEST(test_ThreadPool_submit);
+    RUN_TEST(test_ThreadPool_submit_bulk);
+    RUN_TEST(test_ThreadPool_parallel_for);
+    RUN_TEST(test_ThreadPool_nested);
+    RUN_TEST(test_ThreadPool_drains_on_destroy);
+    return UNITY_END();
+}
@@ -1,5 +1,8 @@
+#include <atomic>
+#include <chrono>
 #include <cwchar>
 #include <memory>
+#include <thread>
 
 #include <zmq.h>
 #include "izmq.h"
@@ -48,11 +51,48 @@ void test_ZMQWTrans_send(void) {
     TEST_ASSERT(ret);
 }
 
+static std::atomic<int> zc_released;
+
+static void zc_release(void* data, void* hint) {
+    zc_released++;
+}
+
+void test_ZMQWTrans_send_zero_copy(void) {
+    static char data[4096];
+    zc_released = 0;
+    srv->listen();
+    trans->connect(endpoint, port);
+
+    TEST_ASSERT(trans->send_zero_copy(data, sizeof(data), zc_release, nullptr));
+
+    for (int i = 0; i < 100 && zc_released == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_ASSERT_EQUAL_INT(1, zc_released.load());
+}
+
+void test_ZMQWTrans_chunk_policy(void) {
+    TEST_ASSERT_EQUAL_UINT64(sizeof(ipc_msg_t), trans->chunk_size_for(1 << 20));
+
+    trans->set_chunk_policy({ChunkMode::SINGLE_FRAME, 0, 0});
+    TEST_ASSERT_EQUAL_UINT64(1 << 20, trans->chunk_size_for(1 << 20));
+
+    int hwm = 10;
+    trans->set_sockopt(ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    trans->set_chunk_policy({ChunkMode::ADAPTIVE, 0, 4096});
+    TEST_ASSERT_EQUAL_UINT64(100, trans->chunk_size_for(100));
+    TEST_ASSERT_EQUAL_UINT64(4096, trans->chunk_size_for(8192));
+    // 1 MiB over half of HWM 10 -> 5 frames
+    TEST_ASSERT_EQUAL_UINT64((1 << 20) / 5 + 1, trans->chunk_size_for(1 << 20));
+}
+
 int main(void) {
     Log::init();
     
     UNITY_BEGIN();
     RUN_TEST(test_ZMQWTrans_connect);
     RUN_TEST(test_ZMQWTrans_send);
+    RUN_TEST(test_ZMQWTrans_send_zero_copy);
+    RUN_TEST(test_ZMQWTrans_chunk_policy);
     return UNITY_END();
 }
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ipc_trace.h"
+
+/**
+ * Per route hop latency out of the telemetry JSON lines written with FIFTHD_TELEMETRY_FILE.
+ * Histograms are totals since each process started, the last sample of every name is the one shown.
+ * Usage: 5thDTraceReport [telemetry.jsonl ...], stdin when no file is given
+ */
+
+static void read_samples(std::istream& in, std::map<std::string, HistogramSample>& latest) {
+    std::string line;
+    while (std::getline(in, line)) {
+        HistogramSample sample;
+        if (IpcTrace::parse_metric_line(line, sample)) {
+            latest[sample.name] = sample;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, HistogramSample> latest;
+    if (argc < 2) {
+        read_samples(std::cin, latest);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream in(argv[i]);
+        if (!in) {
+            fprintf(stderr, "Can't open %s\n", argv[i]);
+            return 1;
+        }
+        read_samples(in, latest);
+    }
+
+    std::vector<HistogramSample> histograms;
+    for (auto& entry : latest) {
+        histograms.push_back(entry.second);
+    }
+    auto routes = IpcTrace::report(histograms);
+    if (routes.empty()) {
+        fprintf(stderr, "No trace histograms, were senders run with FIFTHD_IPC_TRACE?\n");
+        return 1;
+    }
+    fputs(IpcTrace::format_report(routes).c_str(), stdout);
+    return 0;
+}
@@ -1,3 +1,5 @@
+#include <ctime>
+
 #include "5thdipc_client.h"
 
 IpcClient::~IpcClient() {
@@ -8,7 +10,22 @@ IpcClient::~IpcClient() {
 }
 
 void IpcClient::send(const ipc_msg_t* msg) {
-    _transmitter->send((void*) msg, sizeof(ipc_msg_t));
+    ipc_hdr_t hdr;
+    const void* body = ipc_legacy_hdr(msg, &hdr);
+    if (IpcTrace::sample()) {
+        hdr.flags |= IPC_FLAG_TRACE;
+    }
+    _transmitter->send_ipc(&hdr, body);
+}
+
+void IpcClient::send(ipc_hdr_t hdr, const void* body) {
+    if (hdr.timestamp == 0) {
+        hdr.timestamp = time(NULL);
+    }
+    if (IpcTrace::sample()) {
+        hdr.flags |= IPC_FLAG_TRACE;
+    }
+    _transmitter->send_ipc(&hdr, body);
 }
 
 void IpcClient::_init() {
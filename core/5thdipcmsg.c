@@ -1,4 +1,6 @@
 #include "5thdipcmsg.h"
+#include <stddef.h>
+#include <string.h>
 
 #ifdef _WIN32
 const char* IPC_ENDPOINT = "ipc://secure_ipc";
@@ -25,4 +27,143 @@ const char* CLIENTS_IDS[] = {
     "peerxxx",
     "uixxxxx",
     "ipcrout",
-};
\ No newline at end of file
+};
+
+
+void ipc_hdr_init(ipc_hdr_t* hdr, uint16_t type_id, int32_t src_id, int32_t dst_id, uint32_t length) {
+    memset(hdr, 0, sizeof(ipc_hdr_t));
+    hdr->magic = IPC_WIRE_MAGIC;
+    hdr->version = IPC_WIRE_VERSION;
+    hdr->type_id = type_id;
+    hdr->src_id = src_id;
+    hdr->dst_id = dst_id;
+    hdr->length = length;
+}
+
+size_t ipc_encode(void* out, size_t out_size, const ipc_hdr_t* hdr, const void* body) {
+    if (!out || !hdr || hdr->length > IPC_MAX_BODY_BYTES || (hdr->length && !body)) {
+        return 0;
+    }
+    size_t trace_size = ipc_trace_size(hdr->flags);
+    size_t total = ipc_hdr_frame_size(hdr);
+    if (out_size < total) {
+        return 0;
+    }
+    memcpy(out, hdr, sizeof(ipc_hdr_t));
+    if (trace_size) {
+        memset((uint8_t*) out + sizeof(ipc_hdr_t), 0, trace_size);
+    }
+    if (hdr->length) {
+        memcpy((uint8_t*) out + sizeof(ipc_hdr_t) + trace_size, body, hdr->length);
+    }
+    return total;
+}
+
+int ipc_parse(const void* frame, size_t frame_size, ipc_view_t* out) {
+    if (!frame || !out) {
+        return -1;
+    }
+
+    if (frame_size >= sizeof(ipc_hdr_t)) {
+        ipc_hdr_t hdr;
+        memcpy(&hdr, frame, sizeof(ipc_hdr_t));
+        if (hdr.magic == IPC_WIRE_MAGIC && hdr.version == IPC_WIRE_VERSION && hdr.length <= IPC_MAX_BODY_BYTES
+            && ipc_hdr_frame_size(&hdr) == frame_size) {
+            size_t trace_size = ipc_trace_size(hdr.flags);
+            out->hdr = hdr;
+            out->trace = trace_size ? (const uint8_t*) frame + sizeof(ipc_hdr_t) : NULL;
+            out->body = (const uint8_t*) frame + sizeof(ipc_hdr_t) + trace_size;
+            out->legacy = false;
+            return 0;
+        }
+    }
+
+    // Compatibility shim, the old fixed struct as sent by clients that predate v1
+    if (frame_size == sizeof(ipc_msg_t)) {
+        const ipc_msg_t* legacy = (const ipc_msg_t*) frame;
+        ipc_hdr_init(&out->hdr, IPC_TYPE_LEGACY, legacy->src_id, legacy->dist_id,
+                     CATEGORY_LENGTH_BYTES + DATA_LENGTH_BYTES);
+        out->hdr.timestamp = legacy->timestamp;
+        out->body = (const uint8_t*) legacy + offsetof(ipc_msg_t, category);
+        out->legacy = true;
+        out->trace = NULL;
+        return 0;
+    }
+    return -1;
+}
+
+const void* ipc_legacy_hdr(const ipc_msg_t* legacy, ipc_hdr_t* hdr) {
+    uint32_t data_length = DATA_LENGTH_BYTES;
+    while (data_length > 0 && legacy->data[data_length - 1] == 0) {
+        data_length--;
+    }
+
+    ipc_hdr_init(hdr, IPC_TYPE_LEGACY, legacy->src_id, legacy->dist_id, CATEGORY_LENGTH_BYTES + data_length);
+    hdr->timestamp = legacy->timestamp;
+
+    // category and data are adjacent in the packed struct
+    return (const uint8_t*) legacy + offsetof(ipc_msg_t, category);
+}
+
+size_t ipc_from_legacy(const ipc_msg_t* legacy, void* out, size_t out_size) {
+    ipc_hdr_t hdr;
+    const void* body = ipc_legacy_hdr(legacy, &hdr);
+    return ipc_encode(out, out_size, &hdr, body);
+}
+
+int ipc_to_legacy(const ipc_view_t* view, ipc_msg_t* out) {
+    memset(out, 0, sizeof(ipc_msg_t));
+    out->src_id = view->hdr.src_id;
+    out->dist_id = view->hdr.dst_id;
+    out->timestamp = view->hdr.timestamp;
+
+    if (view->hdr.type_id == IPC_TYPE_LEGACY) {
+        if (view->hdr.length > CATEGORY_LENGTH_BYTES + DATA_LENGTH_BYTES) {
+            return -1;
+        }
+        memcpy((uint8_t*) out + offsetof(ipc_msg_t, category), view->body, view->hdr.length);
+        return 0;
+    }
+
+    if (view->hdr.length > DATA_LENGTH_BYTES) {
+        return -1;
+    }
+    memcpy(out->data, view->body, view->hdr.length);
+    return 0;
+}
+
+int ipc_trace_stamp(void* frame, size_t frame_size, enum IpcTraceHop hop, int64_t stamp_ns) {
+    ipc_view_t view;
+    if (hop < 0 || hop >= IPC_HOP_COUNT || ipc_parse(frame, frame_size, &view) != 0 || !view.trace) {
+        return -1;
+    }
+    memcpy((uint8_t*) frame + sizeof(ipc_hdr_t) + offsetof(ipc_trace_t, stamps) + hop * sizeof(int64_t), &stamp_ns,
+           sizeof(stamp_ns));
+    return 0;
+}
+
+int ipc_trace_read(const ipc_view_t* view, ipc_trace_t* out) {
+    if (!view || !view->trace) {
+        return -1;
+    }
+    memcpy(out, view->trace, sizeof(ipc_trace_t));
+    return 0;
+}
+
+void print_ipc_view(const ipc_view_t* view) {
+    printf("--- Frame v%d%s ---\n", view->hdr.version, view->legacy ? " (legacy)" : "");
+    printf("type: %u\n", view->hdr.type_id);
+    printf("src: %d\n", view->hdr.src_id);
+    printf("dist: %d\n", view->hdr.dst_id);
+    printf("timestamp: %lld\n", (long long) view->hdr.timestamp);
+    printf("length: %u\n", view->hdr.length);
+    if (view->trace) {
+        ipc_trace_t trace;
+        ipc_trace_read(view, &trace);
+        printf("trace: sent %lld bus_in %lld bus_out %lld\n", (long long) trace.stamps[IPC_HOP_SENT],
+               (long long) trace.stamps[IPC_HOP_BUS_IN], (long long) trace.stamps[IPC_HOP_BUS_OUT]);
+    }
+    printf("body: ");
+    for (uint32_t i = 0; i < view->hdr.length; i++) printf("%x", view->body[i]);
+    printf("\n");
+}
@@ -1,22 +1,298 @@
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 #include "5thdlogger.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 std::shared_ptr<spdlog::logger> Log::_logger = nullptr;
+std::shared_ptr<AsyncLogSink> Log::_async = nullptr;
 
-void Log::init() {
-    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-    std::vector<spdlog::sink_ptr> sinks{console_sink};
+static const char* LOGGER_NAME = "multi_sink";
+static const char* LOG_PATTERN = "[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v";
 
-    _logger = std::make_shared<spdlog::logger>("multi_sink", begin(sinks), end(sinks));
-    _logger->set_level(spdlog::level::debug);
-    _logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+/**
+ * @brief One queued message, the sequence number tells producers and consumers whose turn it is.
+ */
+struct AsyncLogSink::Record {
+    std::atomic<size_t> sequence{0};
+    spdlog::level::level_enum level = spdlog::level::info;
+    spdlog::log_clock::time_point time;
+    size_t thread_id = 0;
+    size_t length = 0;
+    char text[LOG_RECORD_TEXT];
+};
+
+static size_t round_up_pow2(size_t value) {
+    size_t size = 2;
+    while (size < value) {
+        size <<= 1;
+    }
+    return size;
+}
+
+AsyncLogSink::AsyncLogSink(std::string name, std::vector<spdlog::sink_ptr> sinks, LogOverflow overflow,
+                           size_t queue_size)
+    : _name(std::move(name)),
+      _sinks(std::move(sinks)),
+      _overflow(overflow),
+      _mask(round_up_pow2(queue_size) - 1) {
+    _ring.reset(new Record[_mask + 1]);
+    for (size_t i = 0; i <= _mask; ++i) {
+        _ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _flusher = std::thread(&AsyncLogSink::_flush_loop, this);
+}
+
+AsyncLogSink::~AsyncLogSink() {
+    stop();
+}
+
+void AsyncLogSink::log(const spdlog::details::log_msg& msg) {
+    if (!_running.load(std::memory_order_acquire)) {
+        _write(msg);
+        return;
+    }
+    if (_push(msg)) {
+        _notify();
+        return;
+    }
+    switch (_overflow) {
+        case LogOverflow::DROP:
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case LogOverflow::OVERRUN:
+            // Producers may consume too, the oldest record makes room for this one
+            do {
+                if (_pop(false)) {
+                    _overrun.fetch_add(1, std::memory_order_relaxed);
+                }
+            } while (!_push(msg));
+            _notify();
+            break;
+        case LogOverflow::BLOCK:
+            _blocked.fetch_add(1, std::memory_order_relaxed);
+            while (!_push(msg)) {
+                if (!_running.load(std::memory_order_acquire)) {
+                    _write(msg);
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            _notify();
+            break;
+    }
+}
+
+bool AsyncLogSink::_push(const spdlog::details::log_msg& msg) {
+    size_t pos = _head.load(std::memory_order_relaxed);
+    for (;;) {
+        Record& record = _ring[pos & _mask];
+        size_t sequence = record.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+
+    Record& record = _ring[pos & _mask];
+    record.level = msg.level;
+    record.time = msg.time;
+    record.thread_id = msg.thread_id;
+    size_t length = msg.payload.size();
+    if (length > LOG_RECORD_TEXT) {
+        static const char MARK[] = "...";
+        length = LOG_RECORD_TEXT - (sizeof(MARK) - 1);
+        std::memcpy(record.text + length, MARK, sizeof(MARK) - 1);
+        _truncated.fetch_add(1, std::memory_order_relaxed);
+        record.length = LOG_RECORD_TEXT;
+    } else {
+        record.length = length;
+    }
+    std::memcpy(record.text, msg.payload.data(), length);
+    record.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogSink::_pop(bool write) {
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Record& record = _ring[pos & _mask];
+        size_t sequence = record.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = _tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Copied out so the slot is free again while the sinks write, a stalled sink never pins the ring
+    Record& record = _ring[pos & _mask];
+    auto level = record.level;
+    auto time = record.time;
+    size_t thread_id = record.thread_id;
+    size_t length = write ? record.length : 0;
+    char text[LOG_RECORD_TEXT];
+    std::memcpy(text, record.text, length);
+    record.sequence.store(pos + _mask + 1, std::memory_order_release);
+
+    if (write) {
+        spdlog::details::log_msg msg(time, spdlog::source_loc{}, _name, level, spdlog::string_view_t(text, length));
+        msg.thread_id = thread_id;
+        _write(msg);
+    }
+    _consumed.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogSink::_write(const spdlog::details::log_msg& msg) {
+    for (auto& sink : _sinks) {
+        if (sink->should_log(msg.level)) {
+            sink->log(msg);
+        }
+    }
+    _written.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AsyncLogSink::_pending() const {
+    return _head.load(std::memory_order_seq_cst) != _consumed.load(std::memory_order_seq_cst);
+}
+
+void AsyncLogSink::_notify() {
+    // Pairs with the fence in _flush_loop, either the flusher sees the new head or we see it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        // Taking the lock means the flusher is either before its predicate check or already waiting
+        { std::lock_guard<std::mutex> lock(_wake_lock); }
+        _wake.notify_one();
+    }
+}
+
+void AsyncLogSink::_flush_loop() {
+    while (_running.load(std::memory_order_acquire)) {
+        size_t written = 0;
+        while (_pop(true)) {
+            written++;
+        }
+        if (written > 0) {
+            for (auto& sink : _sinks) {
+                sink->flush();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_wake_lock);
+        _sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!_pending()) {
+            // A claimed but unpublished record also counts as pending, so _pop may briefly miss it
+            _wake.wait(lock, [this]() { return _pending() || !_running.load(std::memory_order_acquire); });
+        }
+        _sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogSink::set_pattern(const std::string& pattern) {
+    for (auto& sink : _sinks) {
+        sink->set_pattern(pattern);
+    }
+}
+
+void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) {
+    for (auto& sink : _sinks) {
+        sink->set_formatter(sink_formatter->clone());
+    }
+}
+
+void AsyncLogSink::drain() {
+    size_t target = _head.load(std::memory_order_acquire);
+    while (_consumed.load(std::memory_order_acquire) < target) {
+        if (!_running.load(std::memory_order_acquire)) {
+            _pop(true);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& sink : _sinks) {
+        sink->flush();
+    }
+}
+
+void AsyncLogSink::stop() {
+    if (_running.exchange(false, std::memory_order_acq_rel) && _flusher.joinable()) {
+        { std::lock_guard<std::mutex> lock(_wake_lock); }
+        _wake.notify_all();
+        _flusher.join();
+    }
+    drain();
+}
+
+LogStats AsyncLogSink::stats() const {
+    LogStats stats;
+    stats.written = _written.load(std::memory_order_relaxed);
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    stats.overrun = _overrun.load(std::memory_order_relaxed);
+    stats.blocked = _blocked.load(std::memory_order_relaxed);
+    stats.truncated = _truncated.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Log::init(LogConfig config) {
+    static bool registered_exit = false;
+    if (_logger) {
+        shutdown();
+        spdlog::drop(LOGGER_NAME);
+    }
+
+    std::vector<spdlog::sink_ptr> sinks = std::move(config.sinks);
+    if (sinks.empty()) {
+        sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    }
+
+    if (config.mode == LogMode::ASYNC) {
+        _async = std::make_shared<AsyncLogSink>(LOGGER_NAME, std::move(sinks), config.overflow, config.queue_size);
+        _logger = std::make_shared<spdlog::logger>(LOGGER_NAME, _async);
+    } else {
+        _async = nullptr;
+        _logger = std::make_shared<spdlog::logger>(LOGGER_NAME, begin(sinks), end(sinks));
+    }
+    _logger->set_level(config.level);
+    _logger->set_pattern(LOG_PATTERN);
 
     spdlog::register_logger(_logger);
     spdlog::set_default_logger(_logger);
+
+    if (!registered_exit) {
+        registered_exit = true;
+        std::atexit(Log::shutdown);
+    }
 }
 
-std::shared_ptr<spdlog::logger> Log::get_logger() {
+const std::shared_ptr<spdlog::logger>& Log::get_logger() {
     return _logger;
 }
 
+void Log::flush() {
+    if (_async) {
+        _async->drain();
+    }
+}
+
+void Log::shutdown() {
+    if (_async) {
+        _async->stop();
+    }
+}
+
+LogStats Log::stats() {
+    return _async ? _async->stats() : LogStats();
+}
@@ -0,0 +1,309 @@
+#ifndef SHARDED_CACHE_H
+#define SHARDED_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+/**
+ * LRU evicts the least recently used entry, every hit relinks the node under the shard lock.
+ * SIEVE only marks the node visited on a hit (shared lock, no relink) and evicts the first
+ * unvisited node a hand sweeping from old to new finds; a better fit for read heavy loads.
+ */
+enum class CachePolicy { LRU, SIEVE };
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;
+};
+
+/**
+ * @brief Fixed capacity key/value cache split in independently locked shards.
+ * Every node lives in an array allocated by the constructor, the hash index is intrusive
+ * (chained through node indices) so push/get/erase never allocate.
+ * @note Tkey and Tval must be default constructible, slots are built up front and assigned on insert.
+ */
+template <typename Tkey, typename Tval, CachePolicy Policy = CachePolicy::LRU, typename Hash = std::hash<Tkey>>
+class ShardedCache {
+public:
+    /**
+     * @brief capacity is spread over shards (rounded up to a power of 2), 0 picks CACHE_DEFAULT_SHARDS.
+     */
+    explicit ShardedCache(size_t capacity, size_t shards = 0) {
+        size_t wanted = shards ? shards : CACHE_DEFAULT_SHARDS;
+        wanted = std::min({wanted, std::max<size_t>(capacity, 1), CACHE_MAX_SHARDS});
+        _num_shards = 1;
+        while (_num_shards < wanted) {
+            _num_shards <<= 1;
+        }
+        size_t per_shard = std::max<size_t>(1, (capacity + _num_shards - 1) / _num_shards);
+        _shards.reset(new Shard[_num_shards]);
+        for (size_t i = 0; i < _num_shards; ++i) {
+            _shards[i].init(static_cast<uint32_t>(per_shard));
+        }
+    }
+
+    ShardedCache(const ShardedCache&) = delete;
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+    /**
+     * @brief Insert or overwrite key, a full shard evicts one entry first.
+     */
+    void push(const Tkey& key, const Tval& value) {
+        size_t hash = _hash(key);
+        _shard(hash).push(key, value, hash);
+    }
+
+    /**
+     * @brief Copy the value of key to value.
+     */
+    bool get(const Tkey& key, Tval& value) {
+        return visit(key, [&value](const Tval& found) { value = found; });
+    }
+
+    /**
+     * @brief Call fn(const Tval&) under the shard lock instead of copying the value out.
+     * @note fn must not call back into this cache.
+     */
+    template <typename F>
+    bool visit(const Tkey& key, F&& fn) {
+        size_t hash = _hash(key);
+        return _shard(hash).visit(key, hash, fn);
+    }
+
+    bool erase(const Tkey& key) {
+        size_t hash = _hash(key);
+        return _shard(hash).erase(key, hash);
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < _num_shards; ++i) {
+            total += _shards[i].count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    size_t capacity() const { return _num_shards * _shards[0].capacity; }
+
+    size_t shards() const { return _num_shards; }
+
+    CacheStats stats() const {
+        CacheStats total;
+        for (size_t i = 0; i < _num_shards; ++i) {
+            total.hits += _shards[i].hits.load(std::memory_order_relaxed);
+            total.misses += _shards[i].misses.load(std::memory_order_relaxed);
+            total.inserts += _shards[i].inserts.load(std::memory_order_relaxed);
+            total.evictions += _shards[i].evictions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    static constexpr size_t CACHE_DEFAULT_SHARDS = 16;
+    static constexpr size_t CACHE_MAX_SHARDS = 1 << 16;
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        Tkey key{};
+        Tval value{};
+        size_t hash = 0;
+        uint32_t prev = NIL;  // towards head (newer)
+        uint32_t next = NIL;  // towards tail (older), free list link when unused
+        uint32_t chain = NIL;
+        std::atomic<bool> visited{false};
+    };
+
+    struct alignas(64) Shard {
+        std::shared_mutex lock;
+        std::unique_ptr<Node[]> nodes;
+        std::unique_ptr<uint32_t[]> buckets;
+        uint32_t bucket_mask = 0;
+        uint32_t capacity = 0;
+        uint32_t head = NIL;
+        uint32_t tail = NIL;
+        uint32_t hand = NIL;
+        uint32_t free = NIL;
+
+        std::atomic<size_t> count{0};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> inserts{0};
+        std::atomic<uint64_t> evictions{0};
+
+        void init(uint32_t cap) {
+            capacity = cap;
+            nodes.reset(new Node[cap]);
+            for (uint32_t i = 0; i < cap; ++i) {
+                nodes[i].next = i + 1 < cap ? i + 1 : NIL;
+            }
+            free = 0;
+
+            uint32_t num_buckets = 1;
+            while (num_buckets < cap * 2u) {
+                num_buckets <<= 1;
+            }
+            bucket_mask = num_buckets - 1;
+            buckets.reset(new uint32_t[num_buckets]);
+            std::fill(buckets.get(), buckets.get() + num_buckets, NIL);
+        }
+
+        uint32_t& bucket(size_t hash) { return buckets[hash & bucket_mask]; }
+
+        uint32_t find(const Tkey& key, size_t hash) {
+            for (uint32_t i = bucket(hash); i != NIL; i = nodes[i].chain) {
+                if (nodes[i].key == key) {
+                    return i;
+                }
+            }
+            return NIL;
+        }
+
+        void unchain(uint32_t index, size_t hash) {
+            uint32_t* link = &bucket(hash);
+            while (*link != index) {
+                link = &nodes[*link].chain;
+            }
+            *link = nodes[index].chain;
+            nodes[index].chain = NIL;
+        }
+
+        void unlink(uint32_t index) {
+            Node& node = nodes[index];
+            (node.prev != NIL ? nodes[node.prev].next : head) = node.next;
+            (node.next != NIL ? nodes[node.next].prev : tail) = node.prev;
+            node.prev = node.next = NIL;
+        }
+
+        void link_front(uint32_t index) {
+            Node& node = nodes[index];
+            node.prev = NIL;
+            node.next = head;
+            if (head != NIL) {
+                nodes[head].prev = index;
+            }
+            head = index;
+            if (tail == NIL) {
+                tail = index;
+            }
+        }
+
+        uint32_t victim() {
+            if constexpr (Policy == CachePolicy::LRU) {
+                return tail;
+            } else {
+                uint32_t i = hand != NIL ? hand : tail;
+                while (nodes[i].visited.load(std::memory_order_relaxed)) {
+                    nodes[i].visited.store(false, std::memory_order_relaxed);
+                    i = nodes[i].prev != NIL ? nodes[i].prev : tail;
+                }
+                hand = nodes[i].prev;
+                return i;
+            }
+        }
+
+        void release(uint32_t index) {
+            if (hand == index) {
+                hand = nodes[index].prev;
+            }
+            unchain(index, nodes[index].hash);
+            unlink(index);
+            nodes[index].next = free;
+            free = index;
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        void push(const Tkey& key, const Tval& value, size_t hash) {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            uint32_t index = find(key, hash);
+            if (index != NIL) {
+                nodes[index].value = value;
+                if constexpr (Policy == CachePolicy::LRU) {
+                    unlink(index);
+                    link_front(index);
+                } else {
+                    nodes[index].visited.store(true, std::memory_order_relaxed);
+                }
+                return;
+            }
+
+            if (free == NIL) {
+                uint32_t old = victim();
+                release(old);
+                evictions.fetch_add(1, std::memory_order_relaxed);
+            }
+            index = free;
+            free = nodes[index].next;
+
+            Node& node = nodes[index];
+            node.key = key;
+            node.value = value;
+            node.hash = hash;
+            node.visited.store(false, std::memory_order_relaxed);
+            node.chain = bucket(hash);
+            bucket(hash) = index;
+            link_front(index);
+            count.fetch_add(1, std::memory_order_relaxed);
+            inserts.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template <typename F>
+        bool visit(const Tkey& key, size_t hash, F& fn) {
+            uint32_t index;
+            if constexpr (Policy == CachePolicy::LRU) {
+                std::unique_lock<std::shared_mutex> guard(lock);
+                index = find(key, hash);
+                if (index != NIL) {
+                    if (head != index) {
+                        unlink(index);
+                        link_front(index);
+                    }
+                    fn(static_cast<const Tval&>(nodes[index].value));
+                }
+            } else {
+                std::shared_lock<std::shared_mutex> guard(lock);
+                index = find(key, hash);
+                if (index != NIL) {
+                    if (!nodes[index].visited.load(std::memory_order_relaxed)) {
+                        nodes[index].visited.store(true, std::memory_order_relaxed);
+                    }
+                    fn(static_cast<const Tval&>(nodes[index].value));
+                }
+            }
+            (index != NIL ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+            return index != NIL;
+        }
+
+        bool erase(const Tkey& key, size_t hash) {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            uint32_t index = find(key, hash);
+            if (index == NIL) {
+                return false;
+            }
+            release(index);
+            nodes[index].value = Tval{};
+            return true;
+        }
+    };
+
+    // std::hash of integers is the identity, spread it before taking shard and bucket bits
+    static constexpr size_t HASH_MIX = sizeof(size_t) == 8 ? size_t(0x9E3779B97F4A7C15ull) : size_t(0x9E3779B9u);
+
+    std::unique_ptr<Shard[]> _shards;
+    size_t _num_shards = 1;
+
+    static size_t _hash(const Tkey& key) { return Hash{}(key) * HASH_MIX; }
+
+    Shard& _shard(size_t hash) { return _shards[(hash >> (sizeof(size_t) * 8 - 16)) & (_num_shards - 1)]; }
+};
+
+#endif  // SHARDED_CACHE_H
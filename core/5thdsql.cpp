@@ -3,7 +3,9 @@
 #include <set>
 #include <sstream>
 #include <stdexcept>
+#include "db_key.h"
 #include "qwistys_macro.h"
+#include "startup_profiler.h"
 
 #ifdef USE_EXPERIMENTAL_FILESYSTEM
 #    include <experimental/filesystem>
@@ -28,7 +30,12 @@ VoidResult DatabaseAccess::open() {
         return Ok();
     }
 
-    int rc = sqlite3_open(_db_path.c_str(), &_db);
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | (_tuning.no_mutex ? SQLITE_OPEN_NOMUTEX : 0);
+    int rc;
+    {
+        StartupPhase phase("db.open");
+        rc = sqlite3_open_v2(_db_path.c_str(), &_db, flags, nullptr);
+    }
     if (rc != SQLITE_OK) {
         ERROR("Failed to open database. Error: {}", std::string(sqlite3_errmsg(_db)));
         sqlite3_close(_db);
@@ -36,17 +43,22 @@ VoidResult DatabaseAccess::open() {
         return Err(ErrorCode::FAIL_OPEN_DB_FILE, "Fail to open db file: " + _db_path, Severity::HIGH);
     }
 
-    rc = sqlite3_key(_db, _key, _key_num_byte);
-    if (rc != SQLITE_OK) {
-        ERROR("Failed decrypt. Error: {}", std::string(sqlite3_errmsg(_db)));
-        sqlite3_close(_db);
-        _db = nullptr;
-        return Err(ErrorCode::FAIL_DECRYPT_DB, "fail to decrypt the database", Severity::HIGH);
+    auto key_ret = _apply_key(flags);
+    if (key_ret.is_err()) {
+        return key_ret;
     }
 
+    StartupPhase phase("db.pragma");
     // Set WAL journal mode for better concurrency
     exec("PRAGMA journal_mode = WAL;");
 
+    if (_tuning.cache_size_kib > 0) {
+        exec("PRAGMA cache_size = -" + std::to_string(_tuning.cache_size_kib) + ";");
+    }
+    if (_tuning.query_only) {
+        exec("PRAGMA query_only = 1;");
+    }
+
     // Set busy timeout to handle lock contention
     sqlite3_busy_timeout(_db, 5000);  // 5 second timeout
 
@@ -59,6 +71,104 @@ VoidResult DatabaseAccess::open() {
     return Ok();
 }
 
+VoidResult DatabaseAccess::_raw_key(int kdf_iter, char* raw, bool& derived) {
+    if (!_tuning.raw_key_file.empty()) {
+        // Rejected before (FAIL_DECRYPT_DB) goes straight to the passphrase, only a missing key is derived
+        auto loaded = load_raw_db_key(_tuning.raw_key_file, _db_path, raw);
+        if (loaded.is_ok() || loaded.error().code() != ErrorCode::NO_OBJECT) {
+            return loaded;
+        }
+    }
+    derived = true;
+    StartupPhase phase("db.kdf");
+    if (_tuning.cache_kdf) {
+        return cached_raw_db_key(_db_path, _key, _key_num_byte, kdf_iter, raw);
+    }
+    return derive_raw_db_key(_db_path, _key, _key_num_byte, kdf_iter, raw);
+}
+
+VoidResult DatabaseAccess::_apply_key(int flags) {
+    int kdf_iter = _tuning.kdf_iter > 0 ? _tuning.kdf_iter : SQLCIPHER_DEFAULT_KDF_ITER;
+    std::string_view passphrase(reinterpret_cast<const char*>(_key), _key_num_byte);
+    bool keep_raw = !_tuning.raw_key_file.empty();
+    std::error_code ec;
+
+    // An existing file has its salt, open it with the raw key and skip SQLCipher's KDF
+    if ((_tuning.cache_kdf || keep_raw) && !is_raw_db_key(passphrase)
+        && std::filesystem::file_size(_db_path, ec) >= SQLCIPHER_SALT_BYTES && !ec) {
+        char raw[RAW_DB_KEY_CHARS];
+        bool derived = false;
+        if (_raw_key(kdf_iter, raw, derived).is_ok()) {
+            int rc;
+            {
+                StartupPhase phase("db.key");
+                rc = sqlite3_key(_db, raw, RAW_DB_KEY_CHARS - 1);
+            }
+            if (rc == SQLITE_OK) {
+                _cipher_pragmas();
+            }
+            bool works = rc == SQLITE_OK && _key_works();
+            if (works && derived && keep_raw) {
+                // Provisioned once, the next process loads it instead of deriving
+                auto stored = store_raw_db_key(_tuning.raw_key_file, _db_path, raw);
+                if (stored.is_err()) {
+                    WARN("{}", stored.error().message());
+                }
+            }
+            sodium_memzero(raw, sizeof(raw));
+            if (works) {
+                return Ok();
+            }
+            // Created with other cipher settings (cipher_compatibility, kdf_algorithm), the passphrase still works.
+            // Remembered, later opens skip the raw key instead of paying for two KDF runs each
+            WARN("Derived key does not open {}, falling back to the passphrase", _db_path);
+            if (_tuning.cache_kdf) {
+                reject_raw_db_key(_db_path);
+            }
+            if (keep_raw) {
+                auto stored = store_raw_db_key(_tuning.raw_key_file, _db_path, nullptr);
+                if (stored.is_err()) {
+                    WARN("{}", stored.error().message());
+                }
+            }
+            sqlite3_close(_db);
+            _db = nullptr;
+            if (sqlite3_open_v2(_db_path.c_str(), &_db, flags, nullptr) != SQLITE_OK) {
+                ERROR("Failed to reopen database. Error: {}", std::string(sqlite3_errmsg(_db)));
+                sqlite3_close(_db);
+                _db = nullptr;
+                return Err(ErrorCode::FAIL_OPEN_DB_FILE, "Fail to open db file: " + _db_path, Severity::HIGH);
+            }
+        }
+    }
+
+    StartupPhase phase("db.key");
+    int rc = sqlite3_key(_db, _key, _key_num_byte);
+    if (rc != SQLITE_OK) {
+        ERROR("Failed decrypt. Error: {}", std::string(sqlite3_errmsg(_db)));
+        sqlite3_close(_db);
+        _db = nullptr;
+        return Err(ErrorCode::FAIL_DECRYPT_DB, "fail to decrypt the database", Severity::HIGH);
+    }
+    _cipher_pragmas();
+    return Ok();
+}
+
+void DatabaseAccess::_cipher_pragmas() {
+    // Cipher settings have to follow the key before anything touches the file
+    if (_tuning.cipher_page_size > 0) {
+        exec("PRAGMA cipher_page_size = " + std::to_string(_tuning.cipher_page_size) + ";");
+    }
+    if (_tuning.kdf_iter > 0) {
+        exec("PRAGMA kdf_iter = " + std::to_string(_tuning.kdf_iter) + ";");
+    }
+}
+
+bool DatabaseAccess::_key_works() {
+    // SQLCipher only notices a wrong key on the first page read
+    return sqlite3_exec(_db, "SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
 VoidResult DatabaseAccess::begin_transaction() {
     return exec("BEGIN TRANSACTION;");
 }
@@ -73,6 +183,13 @@ VoidResult DatabaseAccess::close() {
         return Ok();
     }
 
+    for (auto& cached : _stmt_cache) {
+        sqlite3_finalize(cached.second);
+    }
+    _stmt_cache.clear();
+    _cached_stmts.clear();
+    _column_names.clear();
+
     // Finalize all prepared statements
     sqlite3_stmt* stmt;
     while ((stmt = sqlite3_next_stmt(_db, nullptr)) != nullptr) {
@@ -125,13 +242,58 @@ Result<sqlite3_stmt*> DatabaseAccess::prepare(const std::string& sql) {
     return Ok<sqlite3_stmt*>(std::move(stmt));
 }
 
+Result<sqlite3_stmt*> DatabaseAccess::prepare_cached(const std::string& sql) {
+    auto it = _stmt_cache.find(sql);
+    if (it != _stmt_cache.end()) {
+        // A statement left mid-iteration or with stale bindings is cleaned up here
+        sqlite3_reset(it->second);
+        sqlite3_clear_bindings(it->second);
+        return Ok<sqlite3_stmt*>(it->second);
+    }
+
+    DEBUG("Preparing cached SQL: {}", sql);
+
+    if (!_db) {
+        ERROR("Database connection is null");
+        return Err<sqlite3_stmt*>(ErrorCode::NO_VALID_DB, "Database connection is null");
+    }
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v3(_db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        ERROR("Failed to prepare statement. Error code: {}. Error message: {}", rc, sqlite3_errmsg(_db));
+        return Err<sqlite3_stmt*>(ErrorCode::DB_PREPARE_STATEMENT_FAILED,
+                                  "Failed to prepare statement: " + std::string(sqlite3_errmsg(_db)));
+    }
+
+    _stmt_cache.emplace(sql, stmt);
+    _cached_stmts.insert(stmt);
+    return Ok<sqlite3_stmt*>(std::move(stmt));
+}
+
+bool DatabaseAccess::_recycle(sqlite3_stmt* stmt) const {
+    if (_cached_stmts.find(stmt) == _cached_stmts.end()) {
+        return false;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return true;
+}
+
+void DatabaseAccess::release(sqlite3_stmt* stmt) {
+    if (!_recycle(stmt)) {
+        sqlite3_finalize(stmt);
+    }
+}
+
 VoidResult DatabaseAccess::execute(sqlite3_stmt* stmt) {
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     if (rc != SQLITE_DONE) {
-        return Err(ErrorCode::DB_STATEMENT_EXECUTION_FAILED,
-                   "Failed to execute statement: " + std::string(sqlite3_errmsg(_db)));
+        std::string error_msg = sqlite3_errmsg(_db);
+        release(stmt);
+        return Err(ErrorCode::DB_STATEMENT_EXECUTION_FAILED, "Failed to execute statement: " + error_msg);
     }
+    release(stmt);
     return Ok();
 }
 
@@ -249,9 +411,53 @@ VoidResult DatabaseAccess::query(sqlite3_stmt* stmt, sdbret_t& result) const {
 
     if (rc != SQLITE_DONE) {
         ERROR("Db error {}", std::string(sqlite3_errmsg(_db)));
+        _recycle(stmt);
         return Err(ErrorCode::DB_ERROR, "Db step");
     }
 
+    _recycle(stmt);
+    return Ok();
+}
+
+void DatabaseAccess::_read_column_names(sqlite3_stmt* stmt, std::vector<std::string>& names) {
+    int count = sqlite3_column_count(stmt);
+    names.clear();
+    names.reserve(count);
+    for (int i = 0; i < count; i++) {
+        const char* name = sqlite3_column_name(stmt, i);
+        names.emplace_back(name ? name : "");
+    }
+}
+
+VoidResult DatabaseAccess::for_each_row(sqlite3_stmt* stmt, const RowVisitor& visit) {
+    std::vector<std::string> local_names;
+    const std::vector<std::string>* names = &local_names;
+    if (_cached_stmts.find(stmt) != _cached_stmts.end()) {
+        auto it = _column_names.find(stmt);
+        if (it == _column_names.end()) {
+            it = _column_names.emplace(stmt, std::vector<std::string>()).first;
+            _read_column_names(stmt, it->second);
+        }
+        names = &it->second;
+    } else {
+        _read_column_names(stmt, local_names);
+    }
+
+    SqlRow row(stmt, *names);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!visit(row)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    if (rc != SQLITE_DONE) {
+        ERROR("Db error {}", std::string(sqlite3_errmsg(_db)));
+        release(stmt);
+        return Err(ErrorCode::DB_ERROR, "Db step");
+    }
+    release(stmt);
     return Ok();
 }
 
@@ -312,7 +518,11 @@ void DatabaseAccess::_init(const std::string& path, const std::string encryption
     }
     memcpy(_key, encryption_key.c_str(), _key_num_byte);
 
-    bool is_new_db = !std::filesystem::exists(_db_path);
+    bool is_new_db;
+    {
+        StartupPhase phase("db.exists");
+        is_new_db = !std::filesystem::exists(_db_path);
+    }
     DEBUG("Database file exists: {}", is_new_db ? "No" : "Yes");
 
     if (is_new_db) {
@@ -14,6 +14,8 @@
 template <typename T, size_t Size>
 class ManagedBuffer {
 public:
+    using value_type = T;
+
     explicit ManagedBuffer(std::function<void(T&)> init_func, std::function<void(T&)> deinit_func);
     ManagedBuffer(const ManagedBuffer&) = delete;
     ManagedBuffer& operator=(const ManagedBuffer&) = delete;
@@ -1,10 +1,17 @@
 #ifndef IPC_CLIENT_H
 #define IPC_CLIENT_H
 
+#include <ctime>
 #include <thread>
 #include <string>
+#include <vector>
 #include "transmitter.h"
 #include "5thdipcmsg.h"
+#include "ipc_codec.h"
+#include "ipc_trace.h"
+
+// Typed bodies up to this size are encoded on the stack
+#define IPC_CLIENT_STACK_BODY 512
 
 class IpcClient {
 public:
@@ -13,7 +20,26 @@ public:
         _init();
     };
     ~IpcClient();
+    /**
+     * @brief Legacy struct, goes out as a v1 IPC_TYPE_LEGACY message (see ipc_from_legacy).
+     */
     void send(const ipc_msg_t* msg);
+    /**
+     * @brief v1 message, timestamp is set here when hdr->timestamp is 0.
+     */
+    void send(ipc_hdr_t hdr, const void* body);
+    /**
+     * @brief Typed message, see ipc_codec.h. No heap allocation up to IPC_CLIENT_STACK_BODY bytes of body.
+     */
+    template <typename T>
+    void send(const T& msg, int32_t src_id, int32_t dst_id);
+    /**
+     * @brief Receive one message from socket and hand it to dispatcher by type id.
+     * Fits ITransmitter::worker as callback.
+     * @return false when nothing valid was received or no handler took it.
+     */
+    template <typename... Msgs>
+    bool receive(void* socket, const IpcDispatcher<Msgs...>& dispatcher);
 protected:
     ErrorHandler _error;
     DisasterRecoveryPlan _drp;
@@ -24,4 +50,56 @@ private:
     void _init();
 };
 
+template <typename T>
+void IpcClient::send(const T& msg, int32_t src_id, int32_t dst_id) {
+    size_t length = IpcCodec<T>::body_size(msg);
+    uint8_t stack_body[IPC_CLIENT_STACK_BODY];
+    uint8_t* body = stack_body;
+    if (length > sizeof(stack_body)) {
+        // Grows once per thread to the largest body sent
+        thread_local std::vector<uint8_t> large_body;
+        large_body.resize(length);
+        body = large_body.data();
+    }
+    IpcCodec<T>::encode_body(msg, body, length);
+
+    ipc_hdr_t hdr;
+    ipc_hdr_init(&hdr, T::TYPE_ID, src_id, dst_id, static_cast<uint32_t>(length));
+    hdr.timestamp = time(NULL);
+    if (IpcTrace::sample()) {
+        hdr.flags |= IPC_FLAG_TRACE;
+    }
+    _transmitter->send_ipc(&hdr, body);
+}
+
+template <typename... Msgs>
+bool IpcClient::receive(void* socket, const IpcDispatcher<Msgs...>& dispatcher) {
+    zmq_msg_t frame;
+    zmq_msg_t payload;
+    zmq_msg_init(&frame);
+    zmq_msg_init(&payload);
+
+    bool more = true;
+    while (more) {
+        if (zmq_msg_recv(&frame, socket, 0) == -1) {
+            break;
+        }
+        more = zmq_msg_more(&frame);
+        // Envelope frames are empty, the payload is the last non empty frame
+        if (zmq_msg_size(&frame) > 0) {
+            zmq_msg_move(&payload, &frame);
+        }
+    }
+
+    ipc_view_t view;
+    bool parsed = zmq_msg_size(&payload) > 0 && ipc_parse(zmq_msg_data(&payload), zmq_msg_size(&payload), &view) == 0;
+    if (parsed && view.trace) {
+        IpcTrace::record_delivery(view);
+    }
+    bool handled = parsed && dispatcher.dispatch(view);
+    zmq_msg_close(&payload);
+    zmq_msg_close(&frame);
+    return handled;
+}
+
 #endif  // IPC_CLIENT_H
\ No newline at end of file
@@ -43,6 +43,152 @@ typedef struct {
 
 void print_ipc_msg(ipc_msg_t* msg);
 
+/*
+ * Wire format v1: ipc_hdr_t followed by length bytes of body, one frame per message.
+ * Fields are host byte order, the bus is local IPC only.
+ * A frame is v1 when magic, version and length all match the frame size, anything else of exactly
+ * sizeof(ipc_msg_t) bytes is taken as the legacy struct (see ipc_parse).
+ */
+#define IPC_WIRE_MAGIC 0x5DD5
+#define IPC_WIRE_VERSION 1
+#define IPC_MAX_BODY_BYTES (16u * 1024u * 1024u)
+
+/* Body is category[CATEGORY_LENGTH_BYTES] + data with trailing zero bytes cut, see ipc_from_legacy */
+#define IPC_TYPE_LEGACY 0
+
+enum IpcFlags { IPC_FLAG_NONE = 0, IPC_FLAG_TRACE = 1 };
+
+#if defined(__GNUC__) || defined(__clang__)
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t type_id;
+    uint16_t reserved;
+    int64_t timestamp;
+    uint32_t length;
+    int32_t src_id;
+    int32_t dst_id;
+} ipc_hdr_t;
+#elif defined(_MSC_VER)
+#    pragma pack(push, 1)
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t type_id;
+    uint16_t reserved;
+    int64_t timestamp;
+    uint32_t length;
+    int32_t src_id;
+    int32_t dst_id;
+} ipc_hdr_t;
+#    pragma pack(pop)
+#endif
+
+/*
+ * With IPC_FLAG_TRACE an ipc_trace_t sits between the header and the body, length still counts the body only.
+ * Each hop writes its own stamp in place: monotonic nanoseconds (CLOCK_MONOTONIC on Linux, shared by every
+ * process on the host), 0 when the hop was not reached.
+ */
+enum IpcTraceHop { IPC_HOP_SENT = 0, IPC_HOP_BUS_IN, IPC_HOP_BUS_OUT, IPC_HOP_COUNT };
+
+#if defined(__GNUC__) || defined(__clang__)
+typedef struct __attribute__((packed)) {
+    int64_t stamps[IPC_HOP_COUNT];
+} ipc_trace_t;
+#elif defined(_MSC_VER)
+#    pragma pack(push, 1)
+typedef struct {
+    int64_t stamps[IPC_HOP_COUNT];
+} ipc_trace_t;
+#    pragma pack(pop)
+#endif
+
+/**
+ * @brief Parsed frame, hdr is a copy so fields can be read without unaligned access concerns.
+ * For a legacy frame hdr is synthesized (type IPC_TYPE_LEGACY) and body points at category.
+ * trace points at the ipc_trace_t inside the frame, NULL when the frame is not traced.
+ */
+typedef struct {
+    ipc_hdr_t hdr;
+    const uint8_t* body;
+    bool legacy;
+    const uint8_t* trace;
+} ipc_view_t;
+
+/**
+ * @brief Fill a v1 header, timestamp is left to the caller (0 means unset).
+ */
+void ipc_hdr_init(ipc_hdr_t* hdr, uint16_t type_id, int32_t src_id, int32_t dst_id, uint32_t length);
+
+/**
+ * @brief Bytes a v1 frame with length bytes of body takes on the wire.
+ */
+static inline size_t ipc_frame_size(uint32_t length) {
+    return sizeof(ipc_hdr_t) + length;
+}
+
+/**
+ * @brief Bytes the trace block adds for these header flags.
+ */
+static inline size_t ipc_trace_size(uint8_t flags) {
+    return (flags & IPC_FLAG_TRACE) ? sizeof(ipc_trace_t) : 0;
+}
+
+/**
+ * @brief Bytes the frame for hdr takes on the wire, trace block included.
+ */
+static inline size_t ipc_hdr_frame_size(const ipc_hdr_t* hdr) {
+    return ipc_frame_size(hdr->length) + ipc_trace_size(hdr->flags);
+}
+
+/**
+ * @brief Write hdr and body to out, hdr->length bytes are taken from body.
+ * A traced header gets a zeroed trace block, see ipc_trace_stamp.
+ * @return bytes written, 0 when out is too small or the header is invalid.
+ */
+size_t ipc_encode(void* out, size_t out_size, const ipc_hdr_t* hdr, const void* body);
+
+/**
+ * @brief Parse a v1 or legacy frame without copying the body.
+ * @return 0 on success, -1 when the frame is neither (out is left untouched).
+ */
+int ipc_parse(const void* frame, size_t frame_size, ipc_view_t* out);
+
+/**
+ * @brief v1 header for a legacy struct, body is category + data without trailing zeros.
+ * @return the body, points into legacy.
+ */
+const void* ipc_legacy_hdr(const ipc_msg_t* legacy, ipc_hdr_t* hdr);
+
+/**
+ * @brief Encode a legacy struct as a v1 frame, see ipc_legacy_hdr.
+ * @return bytes written, 0 when out is too small. ipc_frame_size(sizeof(ipc_msg_t)) is always enough.
+ */
+size_t ipc_from_legacy(const ipc_msg_t* legacy, void* out, size_t out_size);
+
+/**
+ * @brief Rebuild the legacy struct from any parsed frame.
+ * Non legacy types get an empty category and the body in data.
+ * @return 0 on success, -1 when the body doesn't fit.
+ */
+int ipc_to_legacy(const ipc_view_t* view, ipc_msg_t* out);
+
+/**
+ * @brief Write the stamp for hop into an encoded traced frame.
+ * @return 0 on success, -1 when the frame is not a traced v1 frame.
+ */
+int ipc_trace_stamp(void* frame, size_t frame_size, enum IpcTraceHop hop, int64_t stamp_ns);
+
+/**
+ * @brief Copy the stamps out of a parsed frame.
+ * @return 0 on success, -1 when the frame is not traced.
+ */
+int ipc_trace_read(const ipc_view_t* view, ipc_trace_t* out);
+
+void print_ipc_view(const ipc_view_t* view);
+
 #ifdef __cplusplus
 }
 #endif
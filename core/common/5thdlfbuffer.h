@@ -0,0 +1,351 @@
+#ifndef LOCK_FREE_MANAGED_BUFFER_H
+#define LOCK_FREE_MANAGED_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "5thderror_handler.h"
+
+/**
+ * @brief Hands out a small per process index to every thread that touches a lock-free buffer.
+ * @note Indexes are never recycled, threads past LF_BUFFER_MAX_THREADS just skip the magazines.
+ */
+inline uint32_t lf_buffer_thread_index() {
+    static std::atomic<uint32_t> next_index{0};
+    thread_local uint32_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+#ifndef LF_BUFFER_MAX_THREADS
+#    define LF_BUFFER_MAX_THREADS 64
+#endif
+
+/**
+ * @brief Lock-free variant of ManagedBuffer.
+ * Free slots are kept on a Treiber stack of slot indexes, the head is tagged with a generation
+ * counter so a pop/push race on the same index (ABA) fails the CAS instead of corrupting the list.
+ * When MagazineSize > 0 every thread also gets a private magazine of cached free slots, so a thread
+ * that keeps taking and returning slots never touches the shared head.
+ * @note Same API and same canary guarantees as ManagedBuffer, can be used as a drop-in.
+ */
+template <typename T, size_t Size, size_t MagazineSize = 0>
+class LockFreeManagedBuffer {
+public:
+    using value_type = T;
+
+    explicit LockFreeManagedBuffer(std::function<void(T&)> init_func, std::function<void(T&)> deinit_func);
+    LockFreeManagedBuffer(const LockFreeManagedBuffer&) = delete;
+    LockFreeManagedBuffer& operator=(const LockFreeManagedBuffer&) = delete;
+    ~LockFreeManagedBuffer();
+
+    /**
+     * @brief Take a free slot.
+     * @return nullptr when the buffer is exhausted.
+     */
+    T* get_slot();
+
+    /**
+     * @brief Return a slot taken with get_slot, the pointer is set to nullptr on success.
+     */
+    Result<bool> release_slot(T** slot_ptr);
+
+    /**
+     * @brief
+     */
+    Result<bool> is_empty() const;
+
+    /**
+     * @brief
+     * @note Snapshot only, another thread can change it right after the call.
+     */
+    Result<bool> is_full() const;
+
+    /**
+     * @brief Number of slots currently handed out to users (cached slots are not counted).
+     */
+    Result<size_t> size() const;
+
+    /**
+     * @brief
+     */
+    constexpr size_t capacity() const;
+
+    /**
+     * @brief Walk all the slots and verify canaries.
+     */
+    VoidResult check_integrity() const;
+
+protected:
+    ErrorHandler _error;
+    DisasterRecoveryPlan _drp;
+
+private:
+    static_assert(Size > 0 && Size < UINT32_MAX, "Slot index must fit 32 bit");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Tagged head needs lock-free 64 bit atomics");
+
+    static constexpr uint64_t CANARY_VALUE = 0xDEADBEEFCAFEBABE;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Metadata {
+        std::atomic<bool> in_use{false};
+        size_t id = 0;
+        std::atomic<uint32_t> next{NIL};
+    };
+
+    struct Slot {
+        Metadata meta;
+        T data;
+        uint64_t canary = CANARY_VALUE;
+    };
+
+    struct alignas(64) Magazine {
+        std::array<std::atomic<uint32_t>, (MagazineSize > 0 ? MagazineSize : 1)> cells;
+    };
+
+    std::array<Slot, Size> _buffer;
+    alignas(64) std::atomic<uint64_t> _free_head;
+    alignas(64) std::atomic<size_t> _used_count{0};
+    std::array<Magazine, (MagazineSize > 0 ? LF_BUFFER_MAX_THREADS : 0)> _magazines;
+    std::function<void(T&)> _user_data_init_callback;
+    std::function<void(T&)> _user_data_deinit_callback;
+
+    static constexpr uint64_t _pack(uint32_t index, uint32_t tag) { return (uint64_t(tag) << 32) | index; }
+    static constexpr uint32_t _index(uint64_t head) { return static_cast<uint32_t>(head); }
+    static constexpr uint32_t _tag(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+    uint32_t _pop_free();
+    void _push_free(uint32_t index);
+    Magazine* _own_magazine();
+    uint32_t _pop_magazine(Magazine* mag);
+    bool _push_magazine(Magazine* mag, uint32_t index);
+    uint32_t _steal_magazines();
+
+    VoidResult check_canary(const Slot* slot) const;
+    void _init();
+    void _setup_drp();
+    bool _handle_canary();
+};
+
+template <typename T, size_t Size, size_t MagazineSize>
+LockFreeManagedBuffer<T, Size, MagazineSize>::LockFreeManagedBuffer(std::function<void(T&)> init_func,
+                                                                   std::function<void(T&)> deinit_func)
+    : _error(_drp),
+      _user_data_init_callback(std::move(init_func)),
+      _user_data_deinit_callback(std::move(deinit_func)) {
+    _init();
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+inline LockFreeManagedBuffer<T, Size, MagazineSize>::~LockFreeManagedBuffer() {
+    for (size_t i = 0; i < _buffer.size(); ++i) {
+        _user_data_deinit_callback(_buffer[i].data);
+    }
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+T* LockFreeManagedBuffer<T, Size, MagazineSize>::get_slot() {
+    uint32_t index = NIL;
+    Magazine* mag = _own_magazine();
+
+    if (mag) {
+        index = _pop_magazine(mag);
+    }
+    if (index == NIL) {
+        index = _pop_free();
+    }
+    if (index == NIL && MagazineSize > 0) {
+        index = _steal_magazines();
+    }
+    if (index == NIL) {
+        return nullptr;
+    }
+
+    _buffer[index].meta.in_use.store(true, std::memory_order_relaxed);
+    _used_count.fetch_add(1, std::memory_order_relaxed);
+    return &_buffer[index].data;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+Result<bool> LockFreeManagedBuffer<T, Size, MagazineSize>::release_slot(T** slot_ptr) {
+    if (slot_ptr == nullptr || *slot_ptr == nullptr) {
+        return Err<bool>(ErrorCode::MANAGE_BUFF_NULL_ON_RELEASE, "Null was given to release");
+    }
+
+    Slot* slot = reinterpret_cast<Slot*>(reinterpret_cast<char*>(*slot_ptr) - offsetof(Slot, data));
+
+    if (slot < &_buffer[0] || slot >= &_buffer[0] + Size) {
+        return Err<bool>(ErrorCode::MANAGE_BUFF_SLOT_NOT_IN_RANGE, "Slot not in range of buffer memory");
+    }
+
+    auto canary_ret = check_canary(slot);
+    if (canary_ret.is_err()) {
+        if (!_error.handle_error(canary_ret.error())) {
+            std::abort();
+        }
+    }
+
+    // exchange makes a double release from two threads fail for exactly one of them
+    if (!slot->meta.in_use.exchange(false, std::memory_order_acq_rel)) {
+        return Err<bool>(ErrorCode::MANAGE_BUFF_MONKEY, "Slot is not in use");
+    }
+
+    uint32_t released_index = static_cast<uint32_t>(slot - &_buffer[0]);
+    _used_count.fetch_sub(1, std::memory_order_relaxed);
+
+    Magazine* mag = _own_magazine();
+    if (!mag || !_push_magazine(mag, released_index)) {
+        _push_free(released_index);
+    }
+
+    *slot_ptr = nullptr;
+    return Ok<bool>(true);
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+Result<bool> LockFreeManagedBuffer<T, Size, MagazineSize>::is_empty() const {
+    return Ok<bool>(_used_count.load(std::memory_order_relaxed) == 0);
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+Result<bool> LockFreeManagedBuffer<T, Size, MagazineSize>::is_full() const {
+    return Ok<bool>(_used_count.load(std::memory_order_relaxed) == Size);
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+Result<size_t> LockFreeManagedBuffer<T, Size, MagazineSize>::size() const {
+    return Ok<size_t>(_used_count.load(std::memory_order_relaxed));
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+constexpr size_t LockFreeManagedBuffer<T, Size, MagazineSize>::capacity() const {
+    return Size;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+VoidResult LockFreeManagedBuffer<T, Size, MagazineSize>::check_integrity() const {
+    for (const auto& slot : _buffer) {
+        auto canary_ret = check_canary(&slot);
+        if (canary_ret.is_err()) {
+            if (!_error.handle_error(canary_ret.error())) {
+                std::abort();
+            }
+        }
+    }
+    return Ok();
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+uint32_t LockFreeManagedBuffer<T, Size, MagazineSize>::_pop_free() {
+    uint64_t head = _free_head.load(std::memory_order_acquire);
+    while (_index(head) != NIL) {
+        // next may be stale if another thread popped this index meanwhile, the tag makes the CAS fail then
+        uint32_t next = _buffer[_index(head)].meta.next.load(std::memory_order_relaxed);
+        if (_free_head.compare_exchange_weak(head, _pack(next, _tag(head) + 1), std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+            return _index(head);
+        }
+    }
+    return NIL;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+void LockFreeManagedBuffer<T, Size, MagazineSize>::_push_free(uint32_t index) {
+    uint64_t head = _free_head.load(std::memory_order_relaxed);
+    do {
+        _buffer[index].meta.next.store(_index(head), std::memory_order_relaxed);
+    } while (!_free_head.compare_exchange_weak(head, _pack(index, _tag(head) + 1), std::memory_order_release,
+                                               std::memory_order_relaxed));
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+typename LockFreeManagedBuffer<T, Size, MagazineSize>::Magazine*
+LockFreeManagedBuffer<T, Size, MagazineSize>::_own_magazine() {
+    if constexpr (MagazineSize == 0) {
+        return nullptr;
+    } else {
+        uint32_t thread_index = lf_buffer_thread_index();
+        return thread_index < _magazines.size() ? &_magazines[thread_index] : nullptr;
+    }
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+uint32_t LockFreeManagedBuffer<T, Size, MagazineSize>::_pop_magazine(Magazine* mag) {
+    for (auto& cell : mag->cells) {
+        if (cell.load(std::memory_order_relaxed) != NIL) {
+            uint32_t index = cell.exchange(NIL, std::memory_order_acquire);
+            if (index != NIL) {
+                return index;
+            }
+        }
+    }
+    return NIL;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+bool LockFreeManagedBuffer<T, Size, MagazineSize>::_push_magazine(Magazine* mag, uint32_t index) {
+    // Only the owner thread fills its cells, stealers only empty them, so a plain store is enough
+    for (auto& cell : mag->cells) {
+        if (cell.load(std::memory_order_relaxed) == NIL) {
+            cell.store(index, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+uint32_t LockFreeManagedBuffer<T, Size, MagazineSize>::_steal_magazines() {
+    // Shared list is dry, slots may be parked in magazines of other (or exited) threads
+    for (auto& mag : _magazines) {
+        uint32_t index = _pop_magazine(&mag);
+        if (index != NIL) {
+            return index;
+        }
+    }
+    return NIL;
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+VoidResult LockFreeManagedBuffer<T, Size, MagazineSize>::check_canary(const Slot* slot) const {
+    if (slot->canary != CANARY_VALUE) {
+        return Err(ErrorCode::MANAGE_BUFF_OVERFLOW, "Buffer overflow detected", Severity::CRITICAL);
+    }
+    return Ok();
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+void LockFreeManagedBuffer<T, Size, MagazineSize>::_init() {
+    _setup_drp();
+
+    for (auto& mag : _magazines) {
+        for (auto& cell : mag.cells) {
+            cell.store(NIL, std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t i = 0; i < _buffer.size(); ++i) {
+        _buffer[i].meta.in_use.store(false, std::memory_order_relaxed);
+        _buffer[i].meta.id = i;
+        _buffer[i].meta.next.store((i + 1 < Size) ? static_cast<uint32_t>(i + 1) : NIL, std::memory_order_relaxed);
+        _user_data_init_callback(_buffer[i].data);
+        _buffer[i].canary = CANARY_VALUE;
+    }
+    _free_head.store(_pack(0, 0), std::memory_order_release);
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+void LockFreeManagedBuffer<T, Size, MagazineSize>::_setup_drp() {
+    _drp.register_recovery_action(ErrorCode::MANAGE_BUFF_OVERFLOW, [this]() {
+        WARN("Buffer overflow detected");
+        return _handle_canary();
+    });
+}
+
+template <typename T, size_t Size, size_t MagazineSize>
+bool LockFreeManagedBuffer<T, Size, MagazineSize>::_handle_canary() {
+    return false;
+}
+
+#endif  // LOCK_FREE_MANAGED_BUFFER_H
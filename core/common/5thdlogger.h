@@ -1,27 +1,157 @@
 #ifndef LOGGER_MANAGER_H
 #define LOGGER_MANAGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include "spdlog/spdlog.h"
 
+#ifndef LOG_RECORD_TEXT
+#    define LOG_RECORD_TEXT 488
+#endif
+
+#ifndef LOG_QUEUE_SIZE
+#    define LOG_QUEUE_SIZE 4096
+#endif
+
+enum class LogMode {
+    SYNC,   // Every call formats and writes on the caller thread
+    ASYNC,  // Opt in, the caller formats and a flusher thread writes
+};
+
+/**
+ * @brief What a producer does when the async queue is full.
+ */
+enum class LogOverflow {
+    BLOCK,    // Wait for the flusher, nothing is lost
+    DROP,     // Discard the new message
+    OVERRUN,  // Discard the oldest queued message to make room
+};
+
+struct LogConfig {
+    LogMode mode = LogMode::SYNC;
+    LogOverflow overflow = LogOverflow::BLOCK;  // Async only
+    size_t queue_size = LOG_QUEUE_SIZE;         // Async only, rounded up to a power of two
+    spdlog::level::level_enum level = spdlog::level::debug;
+    std::vector<spdlog::sink_ptr> sinks;  // Empty means colored stdout
+};
+
+struct LogStats {
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t overrun = 0;
+    uint64_t blocked = 0;  // Producer waits on a full queue
+    uint64_t truncated = 0;
+};
+
+/**
+ * @brief spdlog sink that hands records to a background flusher.
+ * The message text is formatted by the logger on the caller thread and copied into a fixed size
+ * binary record (level, time, thread id, text) on a bounded lock-free MPMC ring. Pattern formatting,
+ * colors and the write itself happen on the flusher thread, the caller never takes a sink mutex.
+ * An idle flusher sleeps on a condition variable, producers only take its mutex to wake it.
+ * @note Text past LOG_RECORD_TEXT bytes is truncated.
+ */
+class AsyncLogSink : public spdlog::sinks::sink {
+public:
+    AsyncLogSink(std::string name, std::vector<spdlog::sink_ptr> sinks, LogOverflow overflow, size_t queue_size);
+    ~AsyncLogSink() override;
+
+    void log(const spdlog::details::log_msg& msg) override;
+    void flush() override {}
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+    /**
+     * @brief Block until everything queued before the call is written and flushed.
+     */
+    void drain();
+
+    /**
+     * @brief Write what is left and join the flusher, later records are written on the caller thread.
+     */
+    void stop();
+
+    LogStats stats() const;
+
+private:
+    struct Record;
+
+    std::string _name;
+    std::vector<spdlog::sink_ptr> _sinks;
+    LogOverflow _overflow;
+    std::unique_ptr<Record[]> _ring;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) std::atomic<size_t> _consumed{0};
+    std::atomic<uint64_t> _written{0};
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _overrun{0};
+    std::atomic<uint64_t> _blocked{0};
+    std::atomic<uint64_t> _truncated{0};
+    std::atomic<bool> _running{true};
+    std::atomic<bool> _sleeping{false};
+    std::mutex _wake_lock;
+    std::condition_variable _wake;
+    std::thread _flusher;
+
+    bool _push(const spdlog::details::log_msg& msg);
+    bool _pop(bool write);
+    bool _pending() const;
+    void _notify();
+    void _write(const spdlog::details::log_msg& msg);
+    void _flush_loop();
+};
+
 class Log {
 public:
-    static void init();
-    static std::shared_ptr<spdlog::logger> get_logger();
+    static void init(LogConfig config = LogConfig());
+    static const std::shared_ptr<spdlog::logger>& get_logger();
+
+    /**
+     * @brief Wait until queued records are written, no-op in sync mode.
+     */
+    static void flush();
+
+    /**
+     * @brief Drain and stop the async flusher, registered with atexit by init().
+     */
+    static void shutdown();
+
+    static LogStats stats();
 
 private:
     static std::shared_ptr<spdlog::logger> _logger;
+    static std::shared_ptr<AsyncLogSink> _async;
 };
 
+// The level is checked before the arguments are evaluated
+#define LOG_AT(lvl, ...)                                      \
+    do {                                                      \
+        spdlog::logger* _log_ptr = Log::get_logger().get();   \
+        if (_log_ptr->should_log(lvl)) {                      \
+            _log_ptr->log(lvl, __VA_ARGS__);                  \
+        }                                                     \
+    } while (0)
+
 // Define logging macros
 #ifndef NDEBUG
     // Debug build
-    #define DEBUG(...) Log::get_logger()->debug(__VA_ARGS__)
+    #define DEBUG(...) LOG_AT(spdlog::level::debug, __VA_ARGS__)
 #else
     // Release build
     #define DEBUG(...) (void)0
 #endif
 
-#define ERROR(...) Log::get_logger()->error(__VA_ARGS__)
-#define WARN(...) Log::get_logger()->warn(__VA_ARGS__)
+#define ERROR(...) LOG_AT(spdlog::level::err, __VA_ARGS__)
+#define WARN(...) LOG_AT(spdlog::level::warn, __VA_ARGS__)
+#define INFO(...) LOG_AT(spdlog::level::info, __VA_ARGS__)
 
 #endif  // LOGGER_MANAGER_H
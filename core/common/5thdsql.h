@@ -5,8 +5,14 @@
 
 #include <sodium.h>
 #include <sqlcipher/sqlite3.h>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "5thderror_handler.h"
@@ -42,10 +48,96 @@ typedef struct SecureQueryResult {
 
 } sdbret_t;
 
+/**
+ * @brief Column bytes owned by sqlite, valid until the cursor steps or resets.
+ */
+struct SqlBlob {
+    const unsigned char* data;
+    size_t size;
+};
+
+/**
+ * @brief Row the cursor is sitting on, accessors read sqlite's buffers in place.
+ * Only valid inside the for_each_row() callback. Sensitive columns should be copy_to()'d straight
+ * into the caller's secure memory, no other copy of the value is made on the way.
+ */
+class SqlRow {
+public:
+    SqlRow(sqlite3_stmt* stmt, const std::vector<std::string>& names) : _stmt(stmt), _names(names) {}
+
+    int column_count() const { return static_cast<int>(_names.size()); }
+
+    /**
+     * @brief Column index by name, -1 when unknown. Resolve once before the scan, not per row.
+     */
+    int index(std::string_view name) const {
+        for (size_t i = 0; i < _names.size(); ++i) {
+            if (_names[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    bool is_null(int col) const { return sqlite3_column_type(_stmt, col) == SQLITE_NULL; }
+    int get_int(int col) const { return sqlite3_column_int(_stmt, col); }
+    int64_t get_int64(int col) const { return sqlite3_column_int64(_stmt, col); }
+    double get_double(int col) const { return sqlite3_column_double(_stmt, col); }
+
+    std::string_view get_text(int col) const {
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(_stmt, col));
+        return text ? std::string_view(text, sqlite3_column_bytes(_stmt, col)) : std::string_view();
+    }
+
+    SqlBlob get_blob(int col) const {
+        auto data = static_cast<const unsigned char*>(sqlite3_column_blob(_stmt, col));
+        return {data, data ? static_cast<size_t>(sqlite3_column_bytes(_stmt, col)) : 0};
+    }
+
+    /**
+     * @brief Copy the column bytes to out.
+     * @return bytes the column holds, nothing is written when that exceeds num_bytes.
+     */
+    size_t copy_to(int col, void* out, size_t num_bytes) const {
+        SqlBlob blob = get_blob(col);
+        if (blob.size <= num_bytes && blob.size) {
+            memcpy(out, blob.data, blob.size);
+        }
+        return blob.size;
+    }
+
+private:
+    sqlite3_stmt* _stmt;
+    const std::vector<std::string>& _names;
+};
+
+/**
+ * @brief Return false to stop the scan early.
+ */
+using RowVisitor = std::function<bool(const SqlRow& row)>;
+
+/**
+ * @brief Per connection knobs applied by open(), 0 keeps the SQLCipher/SQLite default.
+ * @note cipher_page_size and kdf_iter describe the file: every connection to it must use the values
+ * the database was created with or sqlite3_key succeeds and the first read fails.
+ */
+struct DbTuning {
+    int cipher_page_size = 0;
+    int kdf_iter = 0;
+    int cache_size_kib = 0;
+    bool query_only = false;  // reject writes on this connection
+    bool no_mutex = false;    // skip sqlite's connection mutex, the owner guarantees one thread at a time
+    // Opt in until SQLCipher is checked to accept the derived key (test_DbKey_derived_key_opens_sqlcipher_db).
+    // A rejected key costs that first open two KDF runs, later opens go straight to the passphrase.
+    bool cache_kdf = false;    // derive the raw key of an existing file once per process (db_key.h)
+    std::string raw_key_file;  // keep that raw key here across processes, empty = off (load/store_raw_db_key)
+};
+
 class DatabaseAccess {
 public:
-    DatabaseAccess(const std::string& path = DB_PATH, const std::string& encryption_key = MEANWHILE_DB_KEY)
-        : _db_path(path), _key(nullptr), _key_num_byte(0), _error(_drp), _db(nullptr) {
+    DatabaseAccess(const std::string& path = DB_PATH, const std::string& encryption_key = MEANWHILE_DB_KEY,
+                   const DbTuning& tuning = DbTuning())
+        : _db_path(path), _key(nullptr), _key_num_byte(0), _tuning(tuning), _error(_drp), _db(nullptr) {
         _init(path, encryption_key);
     }
     ~DatabaseAccess();
@@ -86,6 +178,13 @@ public:
      */
     VoidResult query(sqlite3_stmt* stmt, sdbret_t& result) const;
 
+    /**
+     * @brief Stream the rows of stmt through visit without copying them, the zero-copy counterpart of
+     * query(). Column names are resolved once per statement (for the statement's lifetime when it
+     * came from prepare_cached). stmt is released when the scan ends, early stop included.
+     */
+    VoidResult for_each_row(sqlite3_stmt* stmt, const RowVisitor& visit);
+
     /**
      * @brief
      */
@@ -111,12 +210,26 @@ public:
     Result<sqlite3_stmt*> prepare(const std::string& sql);
 
     /**
-     * @brief
+     * @brief Same as prepare() but the statement is kept alive and keyed by its sql text, later calls
+     * get it back reset with cleared bindings instead of re-parsing. Finalized by close().
+     * @note Finish with a cached statement (execute/query/release) before asking for the same sql again.
+     */
+    Result<sqlite3_stmt*> prepare_cached(const std::string& sql);
+
+    /**
+     * @brief Done with stmt: a cached statement is reset for reuse, any other is finalized.
+     */
+    void release(sqlite3_stmt* stmt);
+
+    /**
+     * @brief Step stmt to completion, then release() it.
      */
     VoidResult execute(sqlite3_stmt* stmt);
 
     VoidResult verify_tables();
 
+    const std::string& path() const { return _db_path; }
+
 protected:
     ErrorHandler _error;
     DisasterRecoveryPlan _drp;
@@ -126,11 +239,22 @@ private:
     std::string _db_path;
     unsigned char* _key;
     size_t _key_num_byte;
+    DbTuning _tuning;
+
+    std::unordered_map<std::string, sqlite3_stmt*> _stmt_cache;
+    std::unordered_set<sqlite3_stmt*> _cached_stmts;
+    std::unordered_map<sqlite3_stmt*, std::vector<std::string>> _column_names;
 
     std::string _read_scheme_script(const std::string& sql_script_path);
     void _init(const std::string& path, const std::string encryption_key);
+    bool _recycle(sqlite3_stmt* stmt) const;
+    static void _read_column_names(sqlite3_stmt* stmt, std::vector<std::string>& names);
 
     VoidResult _new_db();
+    VoidResult _apply_key(int flags);
+    VoidResult _raw_key(int kdf_iter, char* raw, bool& derived);
+    void _cipher_pragmas();
+    bool _key_works();
 
     void _setup_drp();
     bool _handle_open();
@@ -0,0 +1,140 @@
+#ifndef DB_EXECUTOR_H
+#define DB_EXECUTOR_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "5thderror_handler.h"
+#include "5thdsql.h"
+#include "db_pool.h"
+
+#define DB_EXECUTOR_MAX_BATCH 256
+
+using DbRead = std::function<void(DatabaseAccess& db)>;
+using DbWrite = std::function<VoidResult(DatabaseAccess& db)>;
+using DbWriteDone = std::function<void(const VoidResult& result)>;
+
+struct DbExecutorStats {
+    uint64_t reads = 0;
+    uint64_t read_batches = 0;
+    uint64_t writes = 0;
+    uint64_t write_batches = 0;
+};
+
+/**
+ * @brief Runs database work on threads that own the connections, so the submitting thread never
+ * waits on SQLite I/O or a busy_timeout. Reader threads take everything queued (up to
+ * DB_EXECUTOR_MAX_BATCH) and run it in one read transaction, a single snapshot per batch. The
+ * writer thread group commits: one transaction per batch, every write in its own savepoint so a
+ * failing write is undone alone, results are delivered once the batch commits.
+ * @note Work runs inside the executor's transaction, it must not begin/commit its own.
+ * Callbacks run on the executor thread, keep them short.
+ */
+class DbExecutor {
+public:
+    /**
+     * @brief readers reader threads, each with its own connection (0 picks 1).
+     */
+    explicit DbExecutor(const std::string& path = DB_PATH, size_t readers = 1, const DbTuning& tuning = DbTuning(),
+                        const std::string& encryption_key = MEANWHILE_DB_KEY);
+
+    /**
+     * @brief Runs everything already queued, then joins.
+     */
+    ~DbExecutor();
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    /**
+     * @brief fn(DatabaseAccess&) on a reader, its result or exception comes back through the future.
+     */
+    template <class F>
+    auto read(F&& fn) {
+        using R = std::invoke_result_t<std::decay_t<F>&, DatabaseAccess&>;
+        auto task = std::make_shared<std::packaged_task<R(DatabaseAccess&)>>(std::forward<F>(fn));
+        std::future<R> result = task->get_future();
+        post_read([task](DatabaseAccess& db) { (*task)(db); });
+        return result;
+    }
+
+    /**
+     * @brief Callback flavour of read(), fn delivers its own result.
+     */
+    void post_read(DbRead fn);
+
+    std::future<VoidResult> write(DbWrite fn);
+
+    /**
+     * @brief done (may be empty) gets the write's result after its batch committed.
+     */
+    void post_write(DbWrite fn, DbWriteDone done);
+
+    DbExecutorStats stats() const;
+
+private:
+    template <class Job>
+    struct Queue {
+        std::mutex lock;
+        std::condition_variable ready;
+        std::deque<Job> jobs;
+        bool stop = false;
+
+        void push(Job&& job) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                jobs.push_back(std::move(job));
+            }
+            ready.notify_one();
+        }
+
+        // Blocks for work, false once stopped and drained
+        bool pop_batch(std::vector<Job>& out) {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this] { return stop || !jobs.empty(); });
+            if (jobs.empty()) {
+                return false;
+            }
+            size_t count = std::min<size_t>(jobs.size(), DB_EXECUTOR_MAX_BATCH);
+            for (size_t i = 0; i < count; ++i) {
+                out.push_back(std::move(jobs.front()));
+                jobs.pop_front();
+            }
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            ready.notify_all();
+        }
+    };
+
+    struct WriteJob {
+        DbWrite apply;
+        DbWriteDone done;
+    };
+
+    DbPool _pool;
+    Queue<DbRead> _reads;
+    Queue<WriteJob> _writes;
+
+    mutable std::mutex _stats_lock;
+    DbExecutorStats _stats;
+
+    std::vector<std::thread> _threads;
+
+    void _read_loop();
+    void _write_loop();
+};
+
+#endif  // DB_EXECUTOR_H
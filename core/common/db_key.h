@@ -0,0 +1,71 @@
+#ifndef DB_KEY_H
+#define DB_KEY_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "5thderror_handler.h"
+
+// SQLCipher 4 defaults: PBKDF2-HMAC-SHA512, 256000 iterations, 16 byte salt at the start of the file
+#define SQLCIPHER_DEFAULT_KDF_ITER 256000
+#define SQLCIPHER_KEY_BYTES 32
+#define SQLCIPHER_SALT_BYTES 16
+
+// x'<key hex><salt hex>' plus the terminating nul
+#define RAW_DB_KEY_CHARS (3 + 2 * (SQLCIPHER_KEY_BYTES + SQLCIPHER_SALT_BYTES) + 1)
+// Key file line recording that the derived key did not open the database with that salt
+#define RAW_DB_KEY_REJECTED "rejected"
+
+/**
+ * @brief true for a raw key literal, x'<64 hex>' or x'<96 hex>' (key + salt).
+ * sqlite3_key() takes those as the key itself and skips PBKDF2.
+ */
+bool is_raw_db_key(std::string_view key);
+
+void pbkdf2_hmac_sha512(const void* password, size_t password_len, const unsigned char* salt, size_t salt_len,
+                        int iterations, unsigned char* out, size_t out_len);
+
+/**
+ * @brief Derive the raw key SQLCipher would derive from passphrase for the database at db_path
+ * (its salt is read from the file). Costs one full KDF run, opening with the result costs none.
+ * @param out RAW_DB_KEY_CHARS bytes, nul terminated x'...' literal. Key material, wipe it when done.
+ */
+VoidResult derive_raw_db_key(const std::string& db_path, const void* passphrase, size_t passphrase_len, int kdf_iter,
+                             char* out);
+
+/**
+ * @brief derive_raw_db_key() at most once per (db_path, passphrase, kdf_iter, salt) in the process,
+ * the derived key is kept in secure memory and copied to out on later calls.
+ * Fails without deriving when the same key was rejected with reject_raw_db_key().
+ */
+VoidResult cached_raw_db_key(const std::string& db_path, const void* passphrase, size_t passphrase_len, int kdf_iter,
+                             char* out);
+
+/**
+ * @brief Wipe the cached key of db_path, the next cached_raw_db_key() derives again.
+ */
+void forget_raw_db_key(const std::string& db_path);
+
+/**
+ * @brief Wipe the cached key of db_path but remember it did not open the database (other cipher settings),
+ * cached_raw_db_key() fails fast for the same (passphrase, kdf_iter, salt) so the opener goes straight to
+ * the passphrase instead of running the KDF twice.
+ */
+void reject_raw_db_key(const std::string& db_path);
+
+/**
+ * @brief Read the raw key provisioned in key_file for the database at db_path, lets a new process skip the KDF.
+ * NO_OBJECT when there is none or it was written for another salt (recreated database), FAIL_DECRYPT_DB when
+ * the file records the derived key as rejected.
+ * @param out RAW_DB_KEY_CHARS bytes, nul terminated x'...' literal. Key material, wipe it when done.
+ */
+VoidResult load_raw_db_key(const std::string& key_file, const std::string& db_path, char* out);
+
+/**
+ * @brief Write raw (a derive_raw_db_key() result) to key_file, owner read/write only, replaced atomically.
+ * raw == nullptr records that the derived key does not open db_path, later loads fail fast until it is recreated.
+ * @note Whoever can read key_file can open the database, it is as sensitive as the passphrase.
+ */
+VoidResult store_raw_db_key(const std::string& key_file, const std::string& db_path, const char* raw);
+
+#endif  // DB_KEY_H
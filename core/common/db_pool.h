@@ -0,0 +1,95 @@
+#ifndef DB_POOL_H
+#define DB_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "5thdsql.h"
+
+#define DB_POOL_DEFAULT_READERS 4
+
+struct DbPoolStats {
+    uint64_t reader_borrows = 0;
+    uint64_t writer_borrows = 0;
+    uint64_t waits = 0;  // borrows that found no free connection and blocked
+};
+
+class DbPool;
+
+/**
+ * @brief A borrowed connection, goes back to the pool when the lease is destroyed.
+ * Prepared statements cached on the connection stay with it, later borrowers reuse them.
+ */
+class DbLease {
+public:
+    DbLease(DbLease&& other) noexcept : _pool(other._pool), _db(other._db), _writer(other._writer) {
+        other._db = nullptr;
+    }
+    DbLease& operator=(DbLease&&) = delete;
+    DbLease(const DbLease&) = delete;
+    DbLease& operator=(const DbLease&) = delete;
+    ~DbLease();
+
+    DatabaseAccess& operator*() const { return *_db; }
+    DatabaseAccess* operator->() const { return _db; }
+
+private:
+    friend class DbPool;
+    DbLease(DbPool* pool, DatabaseAccess* db, bool writer) : _pool(pool), _db(db), _writer(writer) {}
+
+    DbPool* _pool;
+    DatabaseAccess* _db;
+    bool _writer;
+};
+
+/**
+ * @brief Connections to one encrypted database, opened and keyed once up front so borrowers never
+ * pay sqlite3_key's key derivation. WAL lets the readers run next to the single writer; readers are
+ * query_only, the writer is handed out to one borrower at a time. Every connection is opened
+ * without sqlite's own mutex, the lease is what keeps it on one thread.
+ */
+class DbPool {
+public:
+    /**
+     * @brief readers 0 picks DB_POOL_DEFAULT_READERS.
+     */
+    explicit DbPool(const std::string& path = DB_PATH, size_t readers = DB_POOL_DEFAULT_READERS,
+                    const DbTuning& tuning = DbTuning(), const std::string& encryption_key = MEANWHILE_DB_KEY);
+    DbPool(const DbPool&) = delete;
+    DbPool& operator=(const DbPool&) = delete;
+
+    /**
+     * @brief Borrow a read only connection, blocks while all of them are out.
+     */
+    DbLease reader();
+
+    /**
+     * @brief Borrow the writer, blocks while someone else holds it.
+     */
+    DbLease writer();
+
+    size_t readers() const { return _readers.size(); }
+
+    DbPoolStats stats() const;
+
+private:
+    friend class DbLease;
+
+    std::unique_ptr<DatabaseAccess> _writer;
+    std::vector<std::unique_ptr<DatabaseAccess>> _readers;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _reader_free;
+    std::condition_variable _writer_free;
+    std::vector<DatabaseAccess*> _idle_readers;
+    bool _writer_out = false;
+    DbPoolStats _stats;
+
+    void _give_back(DatabaseAccess* db, bool writer);
+};
+
+#endif  // DB_POOL_H
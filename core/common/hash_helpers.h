@@ -0,0 +1,70 @@
+#ifndef HASH_HELPERS_H
+#define HASH_HELPERS_H
+
+#include <sodium.h>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#define SHA256_BYTES 32
+#define SHA256_HEX_CHARS (2 * SHA256_BYTES)
+
+using Sha256Digest = std::array<unsigned char, SHA256_BYTES>;
+
+/**
+ * @brief Lower case hex of data, two chars per byte from a lookup table. out must hold 2 * size
+ * chars, no nul is written.
+ */
+void hex_encode(const void* data, size_t size, char* out);
+
+std::string to_hex(const void* data, size_t size);
+
+/**
+ * @brief Streaming SHA-256 over libsodium's state, lives on the stack and never allocates.
+ * finish() leaves it reset, one instance hashes any number of messages.
+ */
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset() { crypto_hash_sha256_init(&_state); }
+
+    Sha256& update(const void* data, size_t size) {
+        crypto_hash_sha256_update(&_state, static_cast<const unsigned char*>(data), size);
+        return *this;
+    }
+
+    Sha256& update(std::string_view data) { return update(data.data(), data.size()); }
+
+    void finish(unsigned char* out) {
+        crypto_hash_sha256_final(&_state, out);
+        reset();
+    }
+
+    Sha256Digest finish() {
+        Sha256Digest digest;
+        finish(digest.data());
+        return digest;
+    }
+
+    /**
+     * @brief finish() straight to SHA256_HEX_CHARS hex chars, no nul written.
+     */
+    void finish_hex(char* out);
+
+    static Sha256Digest digest(const void* data, size_t size);
+
+private:
+    crypto_hash_sha256_state _state;
+};
+
+/**
+ * @brief Digest of every input, out[i] for inputs[i]. One state is initialized once and copied per
+ * input, nothing is allocated, meant for many short inputs such as peer ids.
+ */
+void sha256_batch(const std::string_view* inputs, size_t count, Sha256Digest* out);
+
+std::string sha256_hex(std::string_view data);
+
+#endif  // HASH_HELPERS_H
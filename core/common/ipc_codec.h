@@ -0,0 +1,280 @@
+#ifndef IPC_CODEC_H
+#define IPC_CODEC_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "5thdipcmsg.h"
+
+/**
+ * Schema driven body codec for v1 IPC messages.
+ * A message type is a plain struct with a TYPE_ID and a constexpr schema() listing its fields:
+ *
+ *     struct BusPing {
+ *         static constexpr uint16_t TYPE_ID = IPC_TYPE_BUS_PING;
+ *         uint64_t seq;
+ *         static constexpr auto schema() { return std::make_tuple(ipc_field(&BusPing::seq)); }
+ *     };
+ *
+ * Encode/decode are generated from schema() at compile time, nothing is looked up at runtime and
+ * nothing is allocated. Fields are written in schema order, host byte order, no padding.
+ * Supported field types: arithmetic, enums, std::array of arithmetic, IpcBytes and std::string_view
+ * (both u32 length prefixed, decode points into the frame so they live as long as the frame).
+ */
+
+/**
+ * @brief Variable length byte field, non owning.
+ */
+struct IpcBytes {
+    const uint8_t* data = nullptr;
+    uint32_t size = 0;
+};
+
+template <typename T, typename M>
+struct IpcField {
+    M T::*member;
+};
+
+template <typename T, typename M>
+constexpr IpcField<T, M> ipc_field(M T::*member) {
+    return {member};
+}
+
+namespace ipc_codec_detail {
+
+template <typename M>
+struct FieldCodec {
+    static_assert(std::is_arithmetic_v<M> || std::is_enum_v<M>, "Unsupported IPC field type");
+
+    static constexpr size_t size(const M&) { return sizeof(M); }
+    static void encode(uint8_t*& cursor, const M& value) {
+        memcpy(cursor, &value, sizeof(M));
+        cursor += sizeof(M);
+    }
+    static bool decode(const uint8_t*& cursor, const uint8_t* end, M& value) {
+        if (static_cast<size_t>(end - cursor) < sizeof(M)) {
+            return false;
+        }
+        memcpy(&value, cursor, sizeof(M));
+        cursor += sizeof(M);
+        return true;
+    }
+};
+
+template <typename E, size_t N>
+struct FieldCodec<std::array<E, N>> {
+    static_assert(std::is_arithmetic_v<E>, "Unsupported IPC array element type");
+
+    static constexpr size_t size(const std::array<E, N>&) { return sizeof(E) * N; }
+    static void encode(uint8_t*& cursor, const std::array<E, N>& value) {
+        memcpy(cursor, value.data(), sizeof(E) * N);
+        cursor += sizeof(E) * N;
+    }
+    static bool decode(const uint8_t*& cursor, const uint8_t* end, std::array<E, N>& value) {
+        if (static_cast<size_t>(end - cursor) < sizeof(E) * N) {
+            return false;
+        }
+        memcpy(value.data(), cursor, sizeof(E) * N);
+        cursor += sizeof(E) * N;
+        return true;
+    }
+};
+
+// IpcBytes and std::string_view share the u32 length prefix layout
+inline void put_span(uint8_t*& cursor, const void* data, uint32_t length) {
+    memcpy(cursor, &length, sizeof(length));
+    cursor += sizeof(length);
+    if (length) {
+        memcpy(cursor, data, length);
+        cursor += length;
+    }
+}
+
+inline bool get_span(const uint8_t*& cursor, const uint8_t* end, const uint8_t*& data, uint32_t& length) {
+    if (static_cast<size_t>(end - cursor) < sizeof(length)) {
+        return false;
+    }
+    memcpy(&length, cursor, sizeof(length));
+    cursor += sizeof(length);
+    if (static_cast<size_t>(end - cursor) < length) {
+        return false;
+    }
+    data = cursor;
+    cursor += length;
+    return true;
+}
+
+template <>
+struct FieldCodec<std::string_view> {
+    static size_t size(const std::string_view& value) { return sizeof(uint32_t) + value.size(); }
+    static void encode(uint8_t*& cursor, const std::string_view& value) {
+        put_span(cursor, value.data(), static_cast<uint32_t>(value.size()));
+    }
+    static bool decode(const uint8_t*& cursor, const uint8_t* end, std::string_view& value) {
+        const uint8_t* data;
+        uint32_t length;
+        if (!get_span(cursor, end, data, length)) {
+            return false;
+        }
+        value = std::string_view(reinterpret_cast<const char*>(data), length);
+        return true;
+    }
+};
+
+template <>
+struct FieldCodec<IpcBytes> {
+    static size_t size(const IpcBytes& value) { return sizeof(uint32_t) + value.size; }
+    static void encode(uint8_t*& cursor, const IpcBytes& value) { put_span(cursor, value.data, value.size); }
+    static bool decode(const uint8_t*& cursor, const uint8_t* end, IpcBytes& value) {
+        return get_span(cursor, end, value.data, value.size);
+    }
+};
+
+template <typename... Msgs>
+constexpr bool unique_type_ids() {
+    constexpr uint16_t ids[] = {Msgs::TYPE_ID...};
+    for (size_t i = 0; i < sizeof...(Msgs); ++i) {
+        for (size_t j = i + 1; j < sizeof...(Msgs); ++j) {
+            if (ids[i] == ids[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace ipc_codec_detail
+
+template <typename T>
+class IpcCodec {
+public:
+    static_assert(std::is_same_v<std::remove_cv_t<decltype(T::TYPE_ID)>, uint16_t>, "TYPE_ID must be uint16_t");
+    static_assert(T::TYPE_ID != IPC_TYPE_LEGACY, "TYPE_ID 0 is reserved for legacy frames");
+
+    /**
+     * @brief Body bytes msg takes on the wire.
+     */
+    static size_t body_size(const T& msg) {
+        return std::apply([&msg](auto... fields) { return (size_of(msg, fields) + ... + size_t(0)); }, T::schema());
+    }
+
+    /**
+     * @brief Bytes of the whole v1 frame, header included.
+     */
+    static size_t frame_size(const T& msg) { return ipc_frame_size(body_size(msg)); }
+
+    /**
+     * @brief Write the body only, out must hold body_size(msg) bytes.
+     * @return bytes written, 0 when out is too small (or the body is empty).
+     */
+    static size_t encode_body(const T& msg, void* out, size_t out_size) {
+        size_t needed = body_size(msg);
+        if (out_size < needed) {
+            return 0;
+        }
+        auto cursor = static_cast<uint8_t*>(out);
+        std::apply([&](auto... fields) { (encode_field(cursor, msg, fields), ...); }, T::schema());
+        return needed;
+    }
+
+    /**
+     * @brief Write header + body as one v1 frame, timestamp is left 0 when not given.
+     * @return bytes written, 0 when out is too small.
+     */
+    static size_t encode(const T& msg, int32_t src_id, int32_t dst_id, void* out, size_t out_size,
+                         int64_t timestamp = 0) {
+        size_t length = body_size(msg);
+        if (out_size < ipc_frame_size(length) || length > IPC_MAX_BODY_BYTES) {
+            return 0;
+        }
+        ipc_hdr_t hdr;
+        ipc_hdr_init(&hdr, T::TYPE_ID, src_id, dst_id, static_cast<uint32_t>(length));
+        hdr.timestamp = timestamp;
+        memcpy(out, &hdr, sizeof(hdr));
+        encode_body(msg, static_cast<uint8_t*>(out) + sizeof(hdr), length);
+        return ipc_frame_size(length);
+    }
+
+    /**
+     * @brief Read every field from body, trailing bytes are an error.
+     */
+    static bool decode_body(const void* body, size_t size, T& out) {
+        auto cursor = static_cast<const uint8_t*>(body);
+        const uint8_t* end = cursor + size;
+        bool ok = std::apply([&](auto... fields) { return (decode_field(cursor, end, out, fields) && ...); },
+                             T::schema());
+        return ok && cursor == end;
+    }
+
+    /**
+     * @brief Decode a parsed frame, false when it carries another type.
+     */
+    static bool decode(const ipc_view_t& view, T& out) {
+        return !view.legacy && view.hdr.type_id == T::TYPE_ID && decode_body(view.body, view.hdr.length, out);
+    }
+
+private:
+    template <typename M>
+    static size_t size_of(const T& msg, IpcField<T, M> field) {
+        return ipc_codec_detail::FieldCodec<M>::size(msg.*(field.member));
+    }
+
+    template <typename M>
+    static void encode_field(uint8_t*& cursor, const T& msg, IpcField<T, M> field) {
+        ipc_codec_detail::FieldCodec<M>::encode(cursor, msg.*(field.member));
+    }
+
+    template <typename M>
+    static bool decode_field(const uint8_t*& cursor, const uint8_t* end, T& msg, IpcField<T, M> field) {
+        return ipc_codec_detail::FieldCodec<M>::decode(cursor, end, msg.*(field.member));
+    }
+};
+
+/**
+ * @brief Calls the handler registered for the frame type id, the candidate types are fixed at
+ * compile time so dispatch is a chain of integer compares and the message is decoded on the stack.
+ */
+template <typename... Msgs>
+class IpcDispatcher {
+public:
+    static_assert(ipc_codec_detail::unique_type_ids<Msgs...>(), "Duplicate TYPE_ID in IpcDispatcher");
+
+    template <typename T>
+    using Handler = std::function<void(const T&, const ipc_view_t&)>;
+
+    template <typename T>
+    void on(Handler<T> handler) {
+        std::get<Handler<T>>(_handlers) = std::move(handler);
+    }
+
+    /**
+     * @brief false when the type is unknown, has no handler or fails to decode.
+     */
+    bool dispatch(const ipc_view_t& view) const {
+        bool handled = false;
+        ((view.hdr.type_id == Msgs::TYPE_ID ? (handled = _call<Msgs>(view), true) : false) || ...);
+        return handled;
+    }
+
+private:
+    std::tuple<Handler<Msgs>...> _handlers;
+
+    template <typename T>
+    bool _call(const ipc_view_t& view) const {
+        auto& handler = std::get<Handler<T>>(_handlers);
+        T msg{};
+        if (!handler || !IpcCodec<T>::decode(view, msg)) {
+            return false;
+        }
+        handler(msg, view);
+        return true;
+    }
+};
+
+#endif  // IPC_CODEC_H
@@ -0,0 +1,53 @@
+#ifndef IPC_MESSAGES_H
+#define IPC_MESSAGES_H
+
+#include <cstdint>
+#include <string_view>
+#include "ipc_codec.h"
+
+/**
+ * @brief Type ids of every typed IPC message, 0 is IPC_TYPE_LEGACY.
+ * @note Never reuse or renumber an id, old binaries may still send it.
+ */
+enum IpcType : uint16_t {
+    IPC_TYPE_BUS_PING = 1,
+    IPC_TYPE_BUS_PONG,
+    IPC_TYPE_MODULE_STATUS,
+};
+
+/**
+ * @brief Addressed to Clients::ROUTER, the bus answers with BusPong.
+ */
+struct BusPing {
+    static constexpr uint16_t TYPE_ID = IPC_TYPE_BUS_PING;
+    uint64_t seq;
+
+    static constexpr auto schema() { return std::make_tuple(ipc_field(&BusPing::seq)); }
+};
+
+struct BusPong {
+    static constexpr uint16_t TYPE_ID = IPC_TYPE_BUS_PONG;
+    uint64_t seq;
+    uint32_t workers;
+
+    static constexpr auto schema() { return std::make_tuple(ipc_field(&BusPong::seq), ipc_field(&BusPong::workers)); }
+};
+
+enum class ModuleState : uint8_t { STARTING = 0, RUNNING, DEGRADED, STOPPING };
+
+/**
+ * @brief Module health report, detail points into the frame after decode.
+ */
+struct ModuleStatus {
+    static constexpr uint16_t TYPE_ID = IPC_TYPE_MODULE_STATUS;
+    ModuleState state;
+    uint32_t uptime_s;
+    std::string_view detail;
+
+    static constexpr auto schema() {
+        return std::make_tuple(ipc_field(&ModuleStatus::state), ipc_field(&ModuleStatus::uptime_s),
+                               ipc_field(&ModuleStatus::detail));
+    }
+};
+
+#endif  // IPC_MESSAGES_H
@@ -0,0 +1,112 @@
+#ifndef IPC_TRACE_H
+#define IPC_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "5thdipcmsg.h"
+#include "telemetry.h"
+
+/**
+ * Latency of every bus hop, per route (src_id -> dst_id).
+ * A sampled sender sets IPC_FLAG_TRACE, the transmitter and the bus stamp the trace block and the spans
+ * between stamps go to telemetry histograms named "trace.<src>.<dst>.<span>_ns". With bus workers the
+ * dispatch hand-off is part of to_bus. from_bus and end_to_end only exist for receivers reading with
+ * IpcClient::receive, which no module does yet.
+ */
+enum class TraceSpan {
+    TO_BUS,      // sent -> bus_in
+    IN_BUS,      // bus_in -> bus_out
+    FROM_BUS,    // bus_out -> delivered
+    END_TO_END,  // sent -> delivered
+    COUNT,
+};
+
+const char* trace_span_to_string(TraceSpan span);
+
+/**
+ * @brief One histogram of the report, latencies in ns.
+ */
+struct TraceRouteStats {
+    std::string src;
+    std::string dst;
+    std::string span;
+    uint64_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+class IpcTrace {
+public:
+    /**
+     * @brief Trace one message out of every, 0 turns tracing off (default).
+     */
+    static void set_sampling(uint32_t every) { _every.store(every, std::memory_order_relaxed); }
+
+    /**
+     * @brief Should the next message sent from this thread be traced.
+     */
+    static bool sample() {
+        uint32_t every = _every.load(std::memory_order_relaxed);
+        if (every == 0) {
+            return false;
+        }
+        thread_local uint32_t sent = 0;
+        return sent++ % every == 0;
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /**
+     * @brief Stamp hop into an encoded frame, no-op for untraced frames.
+     */
+    static void stamp(void* frame, size_t frame_size, IpcTraceHop hop) {
+        ipc_trace_stamp(frame, frame_size, hop, now());
+    }
+
+    /**
+     * @brief Record a span for the route, negative or unstamped spans are skipped.
+     */
+    static void record(int32_t src_id, int32_t dst_id, TraceSpan span, int64_t from_ns, int64_t to_ns);
+
+    /**
+     * @brief Bus side, once bus_out is stamped: to_bus and in_bus. Messages the bus answers itself
+     * are recorded too, bus_out is then taken before the handler runs.
+     */
+    static void record_bus(const ipc_view_t& view);
+
+    /**
+     * @brief Receiver side: from_bus and end_to_end, taken now.
+     */
+    static void record_delivery(const ipc_view_t& view);
+
+    /**
+     * @brief Trace histograms out of a snapshot, ordered by route then span.
+     */
+    static std::vector<TraceRouteStats> report(const std::vector<HistogramSample>& histograms);
+
+    /**
+     * @brief Fixed width table, one line per route and span.
+     */
+    static std::string format_report(const std::vector<TraceRouteStats>& routes);
+
+    /**
+     * @brief Histogram sample out of one JsonLinesExporter metric line.
+     * @return false when the line is not a histogram.
+     */
+    static bool parse_metric_line(const std::string& line, HistogramSample& out);
+
+private:
+    inline static std::atomic<uint32_t> _every{0};
+};
+
+#endif  // IPC_TRACE_H
@@ -14,6 +14,21 @@ void init_allmsg(ZMQAllMsg& msg);
 
 void deinit_allmsg(ZMQAllMsg& msg);
 
+/**
+ * @brief Release callback for zero-copy sends, same signature as zmq_free_fn.
+ * @note libzmq may call it from one of its io threads.
+ */
+using zc_free_cb = void (*)(void* data, void* hint);
+
+/**
+ * @brief zc_free_cb that gives a slot back to the ManagedBuffer / LockFreeManagedBuffer passed as hint.
+ */
+template <typename Pool>
+void zc_release_slot(void* data, void* hint) {
+    auto slot = static_cast<typename Pool::value_type*>(data);
+    static_cast<Pool*>(hint)->release_slot(&slot);
+}
+
 /**
  * @brief ZMQ CURVE API for generating the keys
  * @return 0 on success
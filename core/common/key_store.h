@@ -0,0 +1,108 @@
+#ifndef KEY_STORE_H
+#define KEY_STORE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "5thderror_handler.h"
+#include "5thdsql.h"
+#include "keys_db.h"
+
+#define KEY_STORE_DEFAULT_TTL std::chrono::minutes(10)
+
+struct KeyStoreStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t expired = 0;
+    uint64_t invalidations = 0;
+};
+
+/**
+ * @brief Read-through cache of active keys in front of keys_db.
+ * Key bytes live in sodium_malloc'd (guarded, mlock'd) memory and are wiped on eviction. An entry
+ * is dropped after ttl or at the row's expires_at, whichever comes first, and on any update/remove
+ * done through the store. A hit is one hash probe, no SQL and no page decryption.
+ * @note Writes done straight through keys_db bypass the store, call invalidate() after them.
+ */
+class KeyStore {
+public:
+    using KeyView = std::function<void(const unsigned char* data, size_t num_bytes)>;
+
+    explicit KeyStore(DatabaseAccess& db, std::chrono::seconds ttl = KEY_STORE_DEFAULT_TTL);
+    ~KeyStore();
+    KeyStore(const KeyStore&) = delete;
+    KeyStore& operator=(const KeyStore&) = delete;
+
+    /**
+     * @brief Process wide store over its own DatabaseAccess(DB_PATH), opened on first use.
+     */
+    static KeyStore& shared();
+
+    /**
+     * @brief Call view with the key bytes while they sit in secure memory, nothing is copied out.
+     * @note view runs under the store lock, it must not call back into the store.
+     */
+    VoidResult with_key(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                        const KeyView& view);
+
+    /**
+     * @brief get_key() drop-in, the returned copy is ordinary heap memory.
+     */
+    Result<std::vector<unsigned char>> get(const std::string& module_name, KeyType key_type,
+                                           const std::string& key_name);
+
+    VoidResult store(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                     const std::vector<unsigned char>& key_value,
+                     const std::chrono::system_clock::time_point& expires_at = std::chrono::system_clock::time_point());
+
+    /**
+     * @brief store_keys() through the cache, every written key is dropped from it first.
+     */
+    VoidResult store_batch(const std::vector<KeyWrite>& keys, KeyWriteMode mode = KeyWriteMode::INSERT);
+
+    VoidResult update(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                      const std::vector<unsigned char>& new_key_value,
+                      const std::chrono::system_clock::time_point& new_expires_at = std::chrono::system_clock::time_point());
+
+    VoidResult remove(const std::string& module_name, KeyType key_type, const std::string& key_name);
+
+    /**
+     * @brief Drop one cached key, the next lookup reads the db again.
+     */
+    void invalidate(const std::string& module_name, KeyType key_type, const std::string& key_name);
+
+    /**
+     * @brief Wipe every cached key.
+     */
+    void clear();
+
+    KeyStoreStats stats() const;
+
+    DatabaseAccess& db() { return _db; }
+
+private:
+    struct Entry {
+        unsigned char* data;
+        size_t num_bytes;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    DatabaseAccess& _db;
+    std::chrono::seconds _ttl;
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, Entry> _entries;
+    KeyStoreStats _stats;
+
+    static std::string _cache_key(const std::string& module_name, KeyType key_type, const std::string& key_name);
+    static void _wipe(Entry& entry);
+    Result<const Entry*> _load(const std::string& cache_key, const std::string& module_name, KeyType key_type,
+                       const std::string& key_name, KeyRecord& uncached);
+    void _invalidate(const std::string& cache_key);
+};
+
+#endif  // KEY_STORE_H
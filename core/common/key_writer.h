@@ -0,0 +1,67 @@
+#ifndef KEY_WRITER_H
+#define KEY_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "5thderror_handler.h"
+#include "5thdsql.h"
+#include "keys_db.h"
+
+#define KEY_WRITER_MAX_BATCH 4096
+
+struct KeyWriterStats {
+    uint64_t writes = 0;
+    uint64_t batches = 0;
+    uint64_t largest_batch = 0;
+};
+
+/**
+ * @brief Group commit for key writes coming from many threads.
+ * submit() queues the write and returns at once. One writer thread takes everything queued so far
+ * (up to max_batch) and commits it as a single transaction, N concurrent writers pay about one
+ * commit instead of N. A failing row fails only its own future, submission order is kept.
+ * @note The writer thread is the only user of db while the KeyWriter lives, give it its own connection.
+ */
+class KeyWriter {
+public:
+    explicit KeyWriter(DatabaseAccess& db, size_t max_batch = KEY_WRITER_MAX_BATCH);
+
+    /**
+     * @brief Commits whatever is still queued, then joins the writer thread.
+     */
+    ~KeyWriter();
+    KeyWriter(const KeyWriter&) = delete;
+    KeyWriter& operator=(const KeyWriter&) = delete;
+
+    std::future<VoidResult> submit(KeyWrite write, KeyWriteMode mode = KeyWriteMode::INSERT);
+
+    KeyWriterStats stats() const;
+
+private:
+    struct Pending {
+        KeyWrite write;
+        KeyWriteMode mode;
+        std::promise<VoidResult> done;
+    };
+
+    DatabaseAccess& _db;
+    size_t _max_batch;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<Pending> _queue;
+    bool _stop = false;
+    KeyWriterStats _stats;
+
+    std::thread _thread;
+
+    void _run();
+    void _commit(std::vector<Pending>& batch);
+};
+
+#endif  // KEY_WRITER_H
@@ -2,6 +2,7 @@
 #define KEYS_DB_H
 
 #include <chrono>
+#include <functional>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -20,6 +21,9 @@ void print_all_keys(DatabaseAccess& db);
 // Helper function to convert time_point to string
 std::string time_point_to_string(const std::chrono::system_clock::time_point& tp);
 
+// Inverse of time_point_to_string (UTC), empty or malformed text gives time_point()
+std::chrono::system_clock::time_point string_to_time_point(const char* text);
+
 // Enum for key types
 enum class KeyType {
     CURVE25519,
@@ -29,6 +33,10 @@ enum class KeyType {
     API_KEY
 };
 
+constexpr size_t KEY_TYPE_COUNT = static_cast<size_t>(KeyType::API_KEY) + 1;
+
+const char* key_type_to_string(KeyType key_type);
+
 /**
  * @brief Initialize the key_types table
  */
@@ -41,6 +49,35 @@ VoidResult store_key(DatabaseAccess& db, const std::string& module_name, KeyType
                      const std::string& key_name, const std::vector<unsigned char>& key_value,
                      const std::chrono::system_clock::time_point& expires_at = std::chrono::system_clock::time_point());
 
+/**
+ * @brief One row for store_keys()
+ */
+struct KeyWrite {
+    std::string module_name;
+    KeyType key_type;
+    std::string key_name;
+    std::vector<unsigned char> key_value;
+    std::chrono::system_clock::time_point expires_at = std::chrono::system_clock::time_point();
+};
+
+enum class KeyWriteMode {
+    INSERT,  // fail on an existing (module, type, name), like store_key()
+    UPSERT   // replace value and expiry and reactivate, for rotation
+};
+
+/**
+ * @brief Write every key in one transaction (a savepoint, so it nests in a caller's transaction)
+ * through one reused statement, key type ids are resolved once per call. All or nothing.
+ */
+VoidResult store_keys(DatabaseAccess& db, const std::vector<KeyWrite>& keys, KeyWriteMode mode = KeyWriteMode::INSERT);
+
+/**
+ * @brief store_keys() where a failing row does not undo the others, results[i] is the outcome of keys[i].
+ * The transaction itself failing (begin/commit) fails every row.
+ */
+void store_keys_each(DatabaseAccess& db, const std::vector<KeyWrite>& keys, KeyWriteMode mode,
+                     std::vector<VoidResult>& results);
+
 /**
  * @brief Update an existing key
  */
@@ -54,6 +91,30 @@ VoidResult update_key(DatabaseAccess& db, const std::string& module_name, KeyTyp
 Result<std::vector<unsigned char>> get_key(DatabaseAccess& db, const std::string& module_name,
                                            KeyType key_type, const std::string& key_name);
 
+/**
+ * @brief Active key with its expiry, expires_at is time_point() when the key never expires
+ */
+struct KeyRecord {
+    std::vector<unsigned char> value;
+    std::chrono::system_clock::time_point expires_at;
+};
+
+/**
+ * @brief Retrieve a key together with its expires_at column
+ */
+Result<KeyRecord> get_key_record(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
+                                 const std::string& key_name);
+
+using KeyRecordView =
+    std::function<void(SqlBlob value, const std::chrono::system_clock::time_point& expires_at)>;
+
+/**
+ * @brief Zero-copy get_key_record(): view gets the value in sqlite's buffer, copy it straight to
+ * secure memory from there
+ */
+VoidResult with_key_record(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
+                           const std::string& key_name, const KeyRecordView& view);
+
 /**
  * @brief Remove (deactivate) a key
  */
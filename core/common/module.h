@@ -6,6 +6,7 @@
 
 #include "5thderror_handler.h"
 #include "5thdipcmsg.h"
+#include "5thdlogger.h"
 #include "keys_db.h"
 
 struct KeysInfo{
@@ -41,6 +42,7 @@ typedef struct {
     std::vector<std::unique_ptr<void, Deleter>> unique_ptrs;
     Clients client_id;
     KeysInfo keys_info;
+    LogConfig log;  // Handed to Log::init, sync by default
 
 } module_init_t;
 
@@ -2,17 +2,44 @@
 #define NETWORK_HELPERS_H 
 
 #include<string>
+#include "net_probe.h"
 
 std::string sha256(const std::string& str);
 
-std::string get_external_addr();
+/**
+ * @brief Blocking, asks url for this host's public address. Prefer network_probe().
+ */
+std::string get_external_addr(const std::string& url = NET_PROBE_EXTERNAL_ADDR_URL, long timeout_ms = 0);
 
+/**
+ * @brief First free loopback port from port upwards (0 lets the kernel pick), -1 when none is.
+ * The port stays reserved by PortAllocator::shared(), claim() it right before binding.
+ */
 int is_port_available(int port);
 
-std::string get_local_ip();
+/**
+ * @brief Source address the kernel would route route_addr through, nothing is sent.
+ */
+std::string get_local_ip(const std::string& route_addr = NET_PROBE_ROUTE_ADDR, int route_port = NET_PROBE_ROUTE_PORT);
 
 std::string get_iface_name(const std::string& local_addr);
 
-bool set_port_forward(int external_port, const std::string& internal_ip, int internal_port, std::string& iface);
-
-#endif // NETWORK_HELPERS_H
\ No newline at end of file
+/**
+ * @brief Blocking, UPnP discovery waits up to discover_timeout_ms. Prefer network_probe().
+ */
+bool set_port_forward(int external_port, const std::string& internal_ip, int internal_port,
+                      const std::string& description = "5thD", int discover_timeout_ms = NET_PROBE_UPNP_TIMEOUT_MS);
+
+/**
+ * @brief Point probe's LOCAL_IP, EXTERNAL_IP and PORT_FORWARD at the functions above.
+ */
+void install_network_probes(NetProbe& probe);
+
+/**
+ * @brief Process wide probe with install_network_probes() applied. Call start() early in startup,
+ * get() the answers later without waiting on the network. PORT_FORWARD needs a forward_port,
+ * set_config() one in before start().
+ */
+NetProbe& network_probe();
+
+#endif // NETWORK_HELPERS_H
@@ -0,0 +1,133 @@
+#ifndef NET_PROBE_H
+#define NET_PROBE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "5thderror_handler.h"
+#include "thread_pool.h"
+
+#define NET_PROBE_EXTERNAL_ADDR_URL "https://api.ipify.org"
+#define NET_PROBE_ROUTE_ADDR "8.8.8.8"
+#define NET_PROBE_ROUTE_PORT 53
+#define NET_PROBE_HTTP_TIMEOUT_MS 3000
+#define NET_PROBE_UPNP_TIMEOUT_MS 2000
+
+enum class ProbeKind { LOCAL_IP = 0, EXTERNAL_IP, PORT_FORWARD, COUNT };
+
+const char* probe_kind_to_string(ProbeKind kind);
+
+/**
+ * @brief Where the probes go and how long their answers are trusted.
+ * Point the endpoints at a local stub (http server, 127.0.0.1 route) to probe without the internet.
+ */
+struct NetProbeConfig {
+    std::string external_addr_url = NET_PROBE_EXTERNAL_ADDR_URL;
+    std::string route_addr = NET_PROBE_ROUTE_ADDR;
+    int route_port = NET_PROBE_ROUTE_PORT;
+    int http_timeout_ms = NET_PROBE_HTTP_TIMEOUT_MS;
+    int upnp_timeout_ms = NET_PROBE_UPNP_TIMEOUT_MS;
+    int forward_port = 0;  // mapped to the same internal port, 0 leaves PORT_FORWARD out of start()
+    std::chrono::seconds local_ip_ttl{60};
+    std::chrono::seconds external_ip_ttl{300};
+    std::chrono::seconds port_forward_ttl{600};
+    std::chrono::seconds failure_ttl{10};  // failed answers are retried sooner
+};
+
+/**
+ * @brief One probe: the discovered value (an address, the mapped port) or why there is none.
+ * Runs on a NetProbe worker, may block for as long as its own timeout.
+ */
+using Probe = std::function<Result<std::string>(const NetProbeConfig&)>;
+
+struct NetProbeStats {
+    uint64_t runs = 0;
+    uint64_t failures = 0;
+    uint64_t hits = 0;          // get() answered from a fresh cache entry
+    uint64_t stale_served = 0;  // get() timed out and served an expired answer
+    uint64_t timeouts = 0;      // get() timed out with nothing to serve
+};
+
+/**
+ * @brief Reachability of this host (local address, external address, upnp port forward), probed
+ * in the background, every kind on its own worker so the slow ones never queue behind each other.
+ * Answers are cached until their TTL runs out; an expired answer triggers a refresh and is still
+ * served to callers that cannot wait for it.
+ */
+class NetProbe {
+public:
+    explicit NetProbe(NetProbeConfig config = NetProbeConfig());
+    ~NetProbe();
+    NetProbe(const NetProbe&) = delete;
+    NetProbe& operator=(const NetProbe&) = delete;
+
+    /**
+     * @brief Replace the probe of kind, drops its cached answer.
+     * A run of the old probe still in flight finishes first, its answer is dropped and the new probe
+     * runs after it if someone asked meanwhile; a kind never has two runs in flight.
+     */
+    void set_probe(ProbeKind kind, Probe probe);
+
+    /**
+     * @brief Replace the configuration (e.g. forward_port of the process wide probe), drops every
+     * cached answer. Runs already in flight keep the configuration they started with.
+     */
+    void set_config(NetProbeConfig config);
+
+    NetProbeConfig config() const;
+
+    /**
+     * @brief Refresh every configured probe whose answer is missing or expired, returns at once.
+     */
+    void start();
+
+    /**
+     * @brief Fresh cached answer, or (re)run the probe and wait up to wait for it.
+     * On timeout an expired answer is served if there is one, else SOCKET_TIMEOUT.
+     */
+    Result<std::string> get(ProbeKind kind, std::chrono::milliseconds wait = std::chrono::milliseconds(0));
+
+    /**
+     * @brief true when kind has an answer that has not expired.
+     */
+    bool fresh(ProbeKind kind) const;
+
+    void invalidate(ProbeKind kind);
+
+    NetProbeStats stats() const;
+
+private:
+    struct Slot {
+        Probe probe;
+        bool answered = false;
+        bool running = false;   // A run is in flight, cleared only when it returns
+        bool relaunch = false;  // The run in flight is of an older generation and someone wants a new one
+        bool ok = false;
+        std::string value;
+        ErrorCode code = ErrorCode::OK;
+        std::string error;
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t generation = 0;  // bumped by set_probe/invalidate, late answers of older runs are dropped
+    };
+
+    NetProbeConfig _config;
+    mutable std::mutex _mutex;
+    std::condition_variable _answered;
+    Slot _slots[static_cast<size_t>(ProbeKind::COUNT)];
+    NetProbeStats _stats;
+    // Declared last, destroyed first: in-flight probes finish while the slots still exist
+    ThreadPool _pool;
+
+    Slot& _slot(ProbeKind kind) { return _slots[static_cast<size_t>(kind)]; }
+    const Slot& _slot(ProbeKind kind) const { return _slots[static_cast<size_t>(kind)]; }
+    std::chrono::seconds _ttl(ProbeKind kind, bool ok) const;
+    bool _fresh(const Slot& slot, std::chrono::steady_clock::time_point now) const;
+    void _launch(ProbeKind kind);
+    void _run(ProbeKind kind, Probe probe, uint64_t generation, NetProbeConfig config);
+    void _drop_answer(Slot& slot);
+};
+
+#endif  // NET_PROBE_H
@@ -0,0 +1,152 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "izmq.h"
+
+/**
+ * @brief Interface for a reactor that serves many sockets from one thread.
+ * @note Currently we use ZMQ but need to check libp2p, also useful for
+ * testing mocks.
+ */
+class IPoller {
+public:
+    virtual ~IPoller() = default;
+    virtual bool add(ISocket* socket, short events, std::function<void(void*)> callback) = 0;
+    virtual bool remove(ISocket* socket) = 0;
+    virtual void run(std::atomic<bool>* until) = 0;
+    virtual void wake() = 0;
+    virtual size_t num_sockets() const = 0;
+};
+
+/**
+ * @brief One zmq_poll loop over any number of sockets with per-socket callbacks.
+ * add/remove may be called from any thread, the change is applied by the loop thread
+ * (it is woken through an inproc PAIR so the change doesn't wait for the poll timeout).
+ * @note Registered sockets belong to the loop thread, only touch them from the callbacks.
+ * @note Without its wake sockets (creation failed) the poller refuses add() and run() returns at once.
+ */
+class ZMQWPoller : public IPoller {
+public:
+    virtual ~ZMQWPoller();
+    ZMQWPoller(IContext* ctx, long timeout_ms = 500) : _ctx(ctx), _timeout_ms(timeout_ms), _error(_drp) {
+        _init();
+    };
+    ZMQWPoller(const ZMQWPoller&) = delete;
+    ZMQWPoller& operator=(const ZMQWPoller&) = delete;
+
+    /**
+     * @brief Register socket, callback gets the raw socket when any of events (ZMQ_POLLIN/OUT) is ready.
+     */
+    bool add(ISocket* socket, short events, std::function<void(void*)> callback) override;
+
+    /**
+     * @brief Unregister socket. Returns once the loop dropped it, so the caller may close it right after.
+     * From a callback (the loop thread) it returns at once, the socket is dropped before the next poll
+     * and its pending callback of this round is skipped.
+     */
+    bool remove(ISocket* socket) override;
+
+    /**
+     * @brief Poll and dispatch until *until turns false.
+     */
+    void run(std::atomic<bool>* until) override;
+
+    /**
+     * @brief Break the current zmq_poll, e.g. after flipping until.
+     */
+    void wake() override;
+
+    /**
+     * @brief Number of sockets registered, pending changes included.
+     */
+    size_t num_sockets() const override { return _registered.load(std::memory_order_relaxed); }
+
+protected:
+    ErrorHandler _error;
+    DisasterRecoveryPlan _drp;
+
+private:
+    struct Change {
+        ISocket* socket;
+        short events;
+        std::function<void(void*)> callback;
+        bool add;
+    };
+
+    IContext* _ctx;
+    long _timeout_ms;
+    void* _wake_recv = nullptr;
+    void* _wake_send = nullptr;
+    std::vector<zmq_pollitem_t> _items;
+    std::vector<std::function<void(void*)>> _callbacks;
+    std::vector<ISocket*> _sockets;
+    std::vector<Change> _pending;
+    std::mutex _pending_mutex;
+    std::atomic<size_t> _registered{0};
+    bool _ready = false;  // Wake pair created, set once by _init()
+    // Guarded by _pending_mutex: removals wait until _applied reaches their ticket
+    bool _looping = false;
+    std::thread::id _loop_thread;
+    uint64_t _queued = 0;
+    uint64_t _applied = 0;
+    std::condition_variable _applied_cv;
+    bool _local_change = false;  // Loop thread only, a callback queued a change
+
+    void _init();
+    void _close();
+    void _apply(std::vector<Change>& changes);
+    void _apply_pending();
+    void _drain_wake();
+    VoidResult _create_wake_pair();
+};
+
+/**
+ * @brief Small fixed pool of ZMQWPoller loops each on its own thread.
+ * New sockets go to the loop with the fewest sockets.
+ */
+class ZMQWPollerPool {
+public:
+    ZMQWPollerPool(IContext* ctx, size_t num_loops, long timeout_ms = 500);
+    ~ZMQWPollerPool();
+    ZMQWPollerPool(const ZMQWPollerPool&) = delete;
+    ZMQWPollerPool& operator=(const ZMQWPollerPool&) = delete;
+
+    /**
+     * @brief Register socket on the least loaded loop, callbacks run on that loop thread.
+     */
+    bool add(ISocket* socket, short events, std::function<void(void*)> callback);
+
+    /**
+     * @brief Unregister socket from its loop, returns once that loop dropped it.
+     */
+    bool remove(ISocket* socket);
+
+    /**
+     * @brief Start all loops.
+     */
+    void start();
+
+    /**
+     * @brief Stop and join all loops.
+     */
+    void stop();
+
+private:
+    std::vector<std::unique_ptr<ZMQWPoller>> _loops;
+    std::vector<std::thread> _threads;
+    std::unordered_map<ISocket*, ZMQWPoller*> _owner;
+    std::mutex _owner_mutex;
+    std::atomic<bool> _running{false};
+};
+
+#endif  // POLLER_H
@@ -0,0 +1,73 @@
+#ifndef PORT_ALLOCATOR_H
+#define PORT_ALLOCATOR_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "5thderror_handler.h"
+
+#define PORT_MIN 1
+#define PORT_MAX 65535
+
+struct PortAllocatorStats {
+    uint64_t kernel_picks = 0;
+    uint64_t range_picks = 0;
+    uint64_t probes = 0;  // bind() calls made by range scans
+    uint64_t claims = 0;
+};
+
+/**
+ * @brief Process wide TCP port reservations.
+ * reserve() binds to port 0 and lets the kernel pick, one syscall however many ports are busy.
+ * A reserved port is held by a bound socket that never listens and has no SO_REUSEADDR, so no other
+ * socket can bind it, with or without SO_REUSEADDR, including a zmq listener in this process.
+ * claim() closes the holder right before the owner binds; the port stays known to the allocator
+ * for the process lifetime and is never handed out twice.
+ */
+class PortAllocator {
+public:
+    static PortAllocator& shared();
+
+    PortAllocator() = default;
+    ~PortAllocator();
+    PortAllocator(const PortAllocator&) = delete;
+    PortAllocator& operator=(const PortAllocator&) = delete;
+
+    /**
+     * @brief Ephemeral port picked by the kernel on addr (IPv4/IPv6 literal, "*" for any).
+     */
+    Result<int> reserve(const std::string& addr = "127.0.0.1");
+
+    /**
+     * @brief First free port in [first, last]. Ports this process already holds are skipped
+     * without a syscall, every other candidate costs one non-blocking bind() on a single socket.
+     */
+    Result<int> reserve_in_range(const std::string& addr, int first, int last = PORT_MAX);
+
+    /**
+     * @brief Close the socket holding port so its owner can bind it, the port stays reserved.
+     */
+    void claim(int port);
+
+    /**
+     * @brief Drop port from the allocator altogether (closing its holder if still open).
+     */
+    void release(int port);
+
+    bool is_reserved(int port) const;
+
+    size_t size() const;
+
+    PortAllocatorStats stats() const;
+
+private:
+    static constexpr int CLAIMED = -1;
+
+    mutable std::mutex _mutex;
+    // port -> holding socket, CLAIMED once its owner took it over
+    std::unordered_map<int, int> _ports;
+    PortAllocatorStats _stats;
+};
+
+#endif  // PORT_ALLOCATOR_H
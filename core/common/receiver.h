@@ -1,15 +1,67 @@
 #ifndef RECEIVER_H
 #define RECEIVER_H
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
 #include "izmq.h"
 
+/**
+ * @brief Messages drained from a socket in one poll wakeup.
+ * Frames of all messages are kept back to back, message i owns frames [first, first + count).
+ * @note Frames are only valid inside the batch callback, the worker closes them afterwards.
+ */
+class RecvBatch {
+public:
+    // A batch of 0 would never fill nor receive, it holds at least one message
+    explicit RecvBatch(size_t max_messages = 64) : _max_messages(std::max<size_t>(max_messages, 1)) {
+        _messages.reserve(_max_messages);
+        // identity + empty + payload is the usual shape
+        _frames.resize(_max_messages * 3);
+    }
+    ~RecvBatch() { clear(); }
+    RecvBatch(const RecvBatch&) = delete;
+    RecvBatch& operator=(const RecvBatch&) = delete;
+
+    size_t size() const { return _messages.size(); }
+    bool full() const { return _messages.size() >= _max_messages; }
+    size_t num_frames(size_t msg) const { return _messages[msg].count; }
+    zmq_msg_t* frame(size_t msg, size_t index) { return &_frames[_messages[msg].first + index]; }
+
+    /**
+     * @brief Receive one complete multipart message, first frame with ZMQ_DONTWAIT.
+     * @return false when nothing is pending (EAGAIN) or on error.
+     */
+    bool recv_one(void* socket);
+
+    /**
+     * @brief Close all frames, keeps the capacity.
+     */
+    void clear();
+
+private:
+    struct Span {
+        size_t first;
+        size_t count;
+    };
+    size_t _max_messages;
+    size_t _used_frames = 0;
+    std::vector<Span> _messages;
+    // deque so growing never relocates frames already received
+    std::deque<zmq_msg_t> _frames;
+};
+
 class IReceiver {
 public:
     virtual ~IReceiver() = default;
     virtual bool listen() = 0;
     virtual void close() = 0;
     virtual int get_port() const = 0;
+    virtual void* get_socket() = 0;
     virtual void worker(std::atomic<bool>* until, std::function<void(void*)> callback) = 0;
+    virtual void worker_batch(std::atomic<bool>* until, size_t max_batch, std::function<void(RecvBatch&)> callback) = 0;
     virtual bool set_endpoint(const char* endpoint) = 0;
     virtual int set_sockopt(int option_name, const void* option_value, size_t option_len) = 0;
     virtual int get_sockopt(int option_name, void* option_value, size_t* option_len) = 0;
@@ -27,7 +79,14 @@ public:
     bool listen() override;
     void close() override;
     void worker(std::atomic<bool>* until, std::function<void(void*)> callback) override;
+    /**
+     * @brief Like worker, but every POLLIN wakeup drains up to max_batch ready messages with
+     * ZMQ_DONTWAIT and hands them to callback at once. A full batch is followed by another drain
+     * without going through zmq_poll. max_batch is clamped to at least 1.
+     */
+    void worker_batch(std::atomic<bool>* until, size_t max_batch, std::function<void(RecvBatch&)> callback) override;
     int get_port() const override { return _port; }
+    void* get_socket() override { return _socket->get_socket(); }
     bool set_curve_server_options(const char* self_pub_key, const char* self_prv_key, size_t key_length_bytes) override;
     bool set_endpoint(const char* endpoint) override;
     int set_sockopt(int option_name, const void* option_value, size_t option_len) override;
@@ -0,0 +1,91 @@
+#ifndef ROUTING_TABLE_H
+#define ROUTING_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "5thdipcmsg.h"
+
+#define ROUTE_ID_MAX_BYTES 255
+#define ROUTING_SHARDS 16
+#define ROUTING_MAX_READERS 64
+
+/**
+ * @brief ZMQ routing identity of a registered client, max 255 bytes as in zmq.
+ */
+struct Route {
+    uint8_t size = 0;
+    char id[ROUTE_ID_MAX_BYTES];
+
+    bool equals(const void* identity, size_t num_bytes) const {
+        return size == num_bytes && memcmp(id, identity, num_bytes) == 0;
+    }
+};
+
+/**
+ * @brief Client id -> identity table for the bus, built for read-mostly access.
+ * Well known ids (enum Clients) live in a fixed array, any other id goes to one of
+ * ROUTING_SHARDS copy-on-write maps. Readers never lock, writers serialize on a mutex and
+ * publish a fresh copy, old copies are freed once no reader can still see them (epoch based).
+ */
+class RoutingTable {
+public:
+    RoutingTable();
+    ~RoutingTable();
+    RoutingTable(const RoutingTable&) = delete;
+    RoutingTable& operator=(const RoutingTable&) = delete;
+
+    /**
+     * @brief Register or refresh the identity of client_id.
+     * @return true when the table changed, the common "already known" case is a read-only compare.
+     */
+    bool update(int client_id, const void* identity, size_t num_bytes);
+
+    /**
+     * @brief Copy the identity of client_id to out.
+     * @return false when client_id never registered.
+     */
+    bool lookup(int client_id, Route& out) const;
+
+    /**
+     * @brief Forget client_id, readers still holding the old route finish with it safely.
+     * @return false when client_id was not registered.
+     */
+    bool remove(int client_id);
+
+private:
+    using DynamicMap = std::unordered_map<int, const Route*>;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    struct Retired {
+        const Route* route;
+        const DynamicMap* map;
+        uint64_t epoch;
+    };
+
+    std::array<std::atomic<const Route*>, CLIENTS_TOTAL> _fixed;
+    std::array<std::atomic<const DynamicMap*>, ROUTING_SHARDS> _shards;
+
+    mutable std::array<ReaderSlot, ROUTING_MAX_READERS> _readers;
+    mutable std::atomic<uint32_t> _overflow_readers{0};
+    std::atomic<uint64_t> _epoch{1};
+
+    std::mutex _writer_mutex;
+    std::vector<Retired> _retired;
+
+    static size_t _shard_of(int client_id);
+    uint32_t _enter() const;
+    void _exit(uint32_t slot) const;
+    void _retire(const Route* route, const DynamicMap* map);
+    void _reclaim();
+};
+
+#endif  // ROUTING_TABLE_H
@@ -0,0 +1,49 @@
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Wall time spent in each startup phase (db open, key derivation, module init ...).
+ * A StartupPhase times its scope, phases with the same name add up. Recording costs two clock
+ * reads per phase and is always on, report() only logs when FIFTHD_STARTUP_PROFILE=1.
+ */
+struct StartupPhaseStats {
+    std::string name;
+    uint32_t count = 0;
+    std::chrono::nanoseconds total{0};
+};
+
+class StartupProfiler {
+public:
+    static void record(const char* phase, std::chrono::steady_clock::duration elapsed);
+
+    /**
+     * @brief Every phase recorded so far, in the order they first ran.
+     */
+    static std::vector<StartupPhaseStats> phases();
+
+    /**
+     * @brief Log the phases and the time since the process started.
+     */
+    static void report();
+
+    static void reset();
+};
+
+class StartupPhase {
+public:
+    explicit StartupPhase(const char* name) : _name(name), _start(std::chrono::steady_clock::now()) {}
+    ~StartupPhase() { StartupProfiler::record(_name, std::chrono::steady_clock::now() - _start); }
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+    const char* _name;
+    std::chrono::steady_clock::time_point _start;
+};
+
+#endif  // STARTUP_PROFILER_H
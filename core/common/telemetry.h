@@ -0,0 +1,366 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+/**
+ * In-process telemetry following docs/telemetry.md: metrics (counters, gauges, latency histograms)
+ * and typed events sharing the documented envelope, exported in batches by a background thread.
+ *
+ * Recording a metric never locks or allocates (a histogram's first record on a thread allocates its
+ * buckets once). Every thread writes its own slab with plain relaxed load/store, snapshot() sums the
+ * slabs, so hot paths pay a few nanoseconds and never share a cache line with other writers.
+ * Names past a table's capacity get handles that record nothing, the snapshot's
+ * "telemetry.metrics_dropped" counter says how many were refused.
+ */
+
+#define TELEMETRY_MAX_COUNTERS 256
+#define TELEMETRY_MAX_GAUGES 64
+// A thread's slab only holds a pointer per histogram, buckets are allocated on its first record
+#define TELEMETRY_MAX_HISTOGRAMS 256
+// Log-linear buckets: 2^SUB_BITS per power of two, about 6% relative error
+#define TELEMETRY_HIST_SUB_BITS 4
+// Values at or past 2^(MAX_EXP + 1) (~9.7 hours in ns) share the last bucket
+#define TELEMETRY_HIST_MAX_EXP 44
+#define TELEMETRY_HIST_BUCKETS ((TELEMETRY_HIST_MAX_EXP - TELEMETRY_HIST_SUB_BITS + 2) << TELEMETRY_HIST_SUB_BITS)
+#define TELEMETRY_EVENT_QUEUE 4096
+#define TELEMETRY_FLUSH_MS 1000
+
+enum class EventClass { METRIC, TRACE, EVENT, AUDIT, ANOMALY };
+
+enum class EventSeverity { DEBUG, INFO, LOW, MEDIUM, HIGH, CRITICAL };
+
+const char* event_class_to_string(EventClass event_class);
+const char* event_severity_to_string(EventSeverity severity);
+
+inline uint32_t telemetry_bucket(uint64_t value) {
+    constexpr uint64_t linear = uint64_t(1) << TELEMETRY_HIST_SUB_BITS;
+    if (value < linear) {
+        return static_cast<uint32_t>(value);
+    }
+#if defined(_MSC_VER)
+    unsigned long msb;
+    _BitScanReverse64(&msb, value);
+    uint32_t exp = static_cast<uint32_t>(msb);
+#else
+    uint32_t exp = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+    if (exp > TELEMETRY_HIST_MAX_EXP) {
+        return TELEMETRY_HIST_BUCKETS - 1;
+    }
+    uint32_t sub = static_cast<uint32_t>(value >> (exp - TELEMETRY_HIST_SUB_BITS)) & (linear - 1);
+    return ((exp - TELEMETRY_HIST_SUB_BITS + 1) << TELEMETRY_HIST_SUB_BITS) | sub;
+}
+
+/**
+ * @brief Largest value that lands in bucket.
+ */
+uint64_t telemetry_bucket_upper(uint32_t bucket);
+
+struct TelemetryHistogramSlab {
+    std::atomic<uint64_t> buckets[TELEMETRY_HIST_BUCKETS];
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> min{UINT64_MAX};
+    std::atomic<uint64_t> max{0};
+};
+
+/**
+ * @brief One thread's metric values, written only by that thread.
+ */
+struct TelemetrySlab {
+    std::atomic<uint64_t> counters[TELEMETRY_MAX_COUNTERS];
+    std::atomic<TelemetryHistogramSlab*> histograms[TELEMETRY_MAX_HISTOGRAMS];
+};
+
+// Trivial thread_local, reading it costs no init guard; telemetry_register_slab() sets it once per thread
+inline thread_local TelemetrySlab* tls_telemetry_slab = nullptr;
+
+TelemetrySlab* telemetry_register_slab();
+TelemetryHistogramSlab* telemetry_histogram_slab(TelemetrySlab* slab, uint32_t id);
+
+inline TelemetrySlab* telemetry_slab() {
+    TelemetrySlab* slab = tls_telemetry_slab;
+    return slab ? slab : telemetry_register_slab();
+}
+
+// Single writer, a load and a store instead of a locked read-modify-write
+inline void telemetry_bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Monotonic count. A default constructed (or over capacity) handle records nothing.
+ */
+class Counter {
+public:
+    Counter() = default;
+
+    void add(uint64_t n = 1) const {
+        if (_id < TELEMETRY_MAX_COUNTERS) {
+            telemetry_bump(telemetry_slab()->counters[_id], n);
+        }
+    }
+
+private:
+    friend class Telemetry;
+    explicit Counter(uint32_t id) : _id(id) {}
+    uint32_t _id = TELEMETRY_MAX_COUNTERS;
+};
+
+/**
+ * @brief Last value wins (set) or running total (add), shared by every thread.
+ */
+class Gauge {
+public:
+    Gauge() = default;
+
+    void set(int64_t value) const {
+        if (_cell) {
+            _cell->store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void add(int64_t delta) const {
+        if (_cell) {
+            _cell->fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    friend class Telemetry;
+    explicit Gauge(std::atomic<int64_t>* cell) : _cell(cell) {}
+    std::atomic<int64_t>* _cell = nullptr;
+};
+
+/**
+ * @brief Distribution of values (latencies in ns, sizes in bytes), HDR style log-linear buckets.
+ */
+class Histogram {
+public:
+    Histogram() = default;
+
+    void record(uint64_t value) const {
+        if (_id >= TELEMETRY_MAX_HISTOGRAMS) {
+            return;
+        }
+        TelemetrySlab* slab = telemetry_slab();
+        TelemetryHistogramSlab* hist = slab->histograms[_id].load(std::memory_order_relaxed);
+        if (!hist) {
+            hist = telemetry_histogram_slab(slab, _id);
+        }
+        telemetry_bump(hist->buckets[telemetry_bucket(value)], 1);
+        telemetry_bump(hist->count, 1);
+        telemetry_bump(hist->sum, value);
+        if (value < hist->min.load(std::memory_order_relaxed)) {
+            hist->min.store(value, std::memory_order_relaxed);
+        }
+        if (value > hist->max.load(std::memory_order_relaxed)) {
+            hist->max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void record(std::chrono::steady_clock::duration elapsed) const {
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    friend class Telemetry;
+    explicit Histogram(uint32_t id) : _id(id) {}
+    uint32_t _id = TELEMETRY_MAX_HISTOGRAMS;
+};
+
+/**
+ * @brief Records the time its scope took into a histogram (two steady_clock reads).
+ */
+class TelemetryTimer {
+public:
+    explicit TelemetryTimer(const Histogram& histogram)
+        : _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+    ~TelemetryTimer() { _histogram.record(std::chrono::steady_clock::now() - _start); }
+    TelemetryTimer(const TelemetryTimer&) = delete;
+    TelemetryTimer& operator=(const TelemetryTimer&) = delete;
+
+private:
+    const Histogram& _histogram;
+    std::chrono::steady_clock::time_point _start;
+};
+
+struct CounterSample {
+    std::string name;
+    uint64_t value = 0;
+};
+
+struct GaugeSample {
+    std::string name;
+    int64_t value = 0;
+};
+
+struct HistogramSample {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+};
+
+/**
+ * @brief Every registered metric, totals since the process started (exited threads included).
+ */
+struct MetricsSnapshot {
+    std::chrono::system_clock::time_point taken_at;
+    std::vector<CounterSample> counters;
+    std::vector<GaugeSample> gauges;
+    std::vector<HistogramSample> histograms;
+};
+
+struct TelemetryField {
+    std::string key;
+    std::string value;
+    bool number = false;  // written unquoted
+};
+
+/**
+ * @brief One envelope of docs/telemetry.md. node_id and process come from Telemetry::set_identity(),
+ * event_id and ts_utc are stamped by Telemetry::emit(). Empty optional ids are exported as null.
+ */
+struct TelemetryEvent {
+    EventClass event_class = EventClass::EVENT;
+    std::string name;
+    EventSeverity severity = EventSeverity::INFO;
+    std::string component;
+    std::string module_id;
+    std::string peer_id;
+    std::string session_id;
+    std::string trace_id;
+    std::string span_id;
+    std::string outcome;
+    std::vector<TelemetryField> fields;
+
+    std::string event_id;
+    std::chrono::system_clock::time_point ts;
+
+    TelemetryEvent() = default;
+    TelemetryEvent(EventClass event_class, std::string name, EventSeverity severity, std::string component)
+        : event_class(event_class), name(std::move(name)), severity(severity), component(std::move(component)) {}
+
+    TelemetryEvent& field(std::string key, std::string value) {
+        fields.push_back({std::move(key), std::move(value), false});
+        return *this;
+    }
+    TelemetryEvent& field(std::string key, const char* value) { return field(std::move(key), std::string(value)); }
+    TelemetryEvent& field(std::string key, int64_t value) {
+        fields.push_back({std::move(key), std::to_string(value), true});
+        return *this;
+    }
+    TelemetryEvent& field(std::string key, uint64_t value) {
+        fields.push_back({std::move(key), std::to_string(value), true});
+        return *this;
+    }
+    TelemetryEvent& field(std::string key, int value) { return field(std::move(key), static_cast<int64_t>(value)); }
+};
+
+/**
+ * @brief Audit event carrying the fields docs/telemetry.md requires of every audit.
+ */
+TelemetryEvent audit_event(std::string name, std::string component, const std::string& actor_id,
+                           const std::string& actor_type, const std::string& target, const std::string& action,
+                           const std::string& decision, const std::string& reason);
+
+struct TelemetryIdentity {
+    std::string node_id;
+    std::string process;
+};
+
+/**
+ * @brief Envelope as one line of JSON, no trailing newline.
+ */
+std::string telemetry_to_json(const TelemetryEvent& event, const TelemetryIdentity& identity);
+
+/**
+ * @brief Receives every batch on the export thread, never from the recording threads.
+ */
+class TelemetryExporter {
+public:
+    virtual ~TelemetryExporter() = default;
+    virtual void export_batch(const std::vector<TelemetryEvent>& events, const MetricsSnapshot& metrics,
+                              const TelemetryIdentity& identity) = 0;
+};
+
+/**
+ * @brief JSON lines, metrics written as class "metric" envelopes after the batch's events.
+ */
+class JsonLinesExporter : public TelemetryExporter {
+public:
+    explicit JsonLinesExporter(FILE* out = stdout) : _out(out) {}
+    void export_batch(const std::vector<TelemetryEvent>& events, const MetricsSnapshot& metrics,
+                      const TelemetryIdentity& identity) override;
+
+private:
+    FILE* _out;
+};
+
+struct TelemetryStats {
+    uint64_t emitted = 0;
+    uint64_t dropped = 0;  // emit() found the queue full
+    uint64_t exported = 0;
+    uint64_t batches = 0;
+};
+
+class Telemetry {
+public:
+    /**
+     * @brief Handle of the metric called name, registered on first use. Resolve handles once
+     * (constructor, static) and keep them, the lookup takes a lock.
+     */
+    static Counter counter(const char* name);
+    static Gauge gauge(const char* name);
+    static Histogram histogram(const char* name);
+
+    static MetricsSnapshot snapshot();
+
+    static void set_identity(std::string node_id, std::string process);
+    static TelemetryIdentity identity();
+
+    /**
+     * @brief Stamp event_id/ts and queue event for the next batch. Never waits on the exporter,
+     * drops the event when TELEMETRY_EVENT_QUEUE are already waiting.
+     */
+    static void emit(TelemetryEvent event);
+
+    /**
+     * @brief Export thread handing batches to exporter every interval, or sooner when half the
+     * queue is used. A second start() replaces the running one.
+     */
+    static void start(std::unique_ptr<TelemetryExporter> exporter,
+                      std::chrono::milliseconds interval = std::chrono::milliseconds(TELEMETRY_FLUSH_MS));
+
+    /**
+     * @brief Export what is queued now and wait for it, no-op when not started.
+     */
+    static void flush();
+
+    /**
+     * @brief Final flush, then join the export thread.
+     */
+    static void stop();
+
+    static TelemetryStats stats();
+};
+
+#endif  // TELEMETRY_H
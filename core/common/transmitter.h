@@ -1,9 +1,26 @@
 #ifndef TRANSMITTER_H_
 #define TRANSMITTER_H_
 
-#include "5thdbuffer.h"
 #include "5thderror_handler.h"
+#include "5thdipcmsg.h"
+#include "5thdlfbuffer.h"
 #include "izmq.h"
+#include "telemetry.h"
+
+/**
+ * @brief How a payload is split into multipart frames.
+ * FIXED - every frame is chunk_size bytes (last one may be shorter).
+ * SINGLE_FRAME - whole payload in one frame.
+ * ADAPTIVE - single frame up to max_chunk, above that max_chunk sized frames, grown when the frame
+ * count would take more than half of the socket send HWM.
+ */
+enum class ChunkMode { FIXED, SINGLE_FRAME, ADAPTIVE };
+
+struct ChunkPolicy {
+    ChunkMode mode = ChunkMode::FIXED;
+    size_t chunk_size = sizeof(ipc_msg_t);
+    size_t max_chunk = 1 << 20;
+};
 
 /**
  * @brief Interface for the transmitter.
@@ -16,6 +33,8 @@ public:
     virtual bool connect(const std::string& ip, int port) = 0;
     virtual void close() = 0;
     virtual bool send(void* data, size_t num_bytes) = 0;
+    virtual bool send_zero_copy(void* data, size_t num_bytes, zc_free_cb free_fn, void* hint) = 0;
+    virtual bool send_ipc(const ipc_hdr_t* hdr, const void* body) = 0;
     virtual void worker(std::atomic<bool>* until, std::function<void(void*)> callback) = 0;
     virtual int set_sockopt(int option_name, const void* option_value, size_t option_len) = 0;
 };
@@ -61,6 +80,22 @@ public:
      */
     bool send(void* data, size_t num_bytes) override;
 
+    /**
+     * @brief Sends caller or pool owned memory without copying it into libzmq.
+     * @param data Pointer to data, must stay untouched until free_fn is called.
+     * @param num_bytes Size of the data in bytes.
+     * @param free_fn Called exactly once when libzmq is done with data, see zc_release_slot for pools.
+     * @param hint Passed as is to free_fn.
+     * @note free_fn is also called when the send fails, ownership always moves to the transmitter.
+     */
+    bool send_zero_copy(void* data, size_t num_bytes, zc_free_cb free_fn, void* hint) override;
+
+    /**
+     * @brief Sends one v1 IPC message (header + hdr->length bytes of body) as a single frame.
+     * @note Chunk policy doesn't apply, the bus needs the whole message in one frame.
+     */
+    bool send_ipc(const ipc_hdr_t* hdr, const void* body) override;
+
     /**
      * @brief
      */
@@ -76,6 +111,17 @@ public:
      */
     void set_curve_client_options(const char* server_public_key);
 
+    /**
+     * @brief Sets how send/send_zero_copy split payloads into frames.
+     * @note Default is FIXED with sizeof(ipc_msg_t) chunks, what the bus expects.
+     */
+    void set_chunk_policy(const ChunkPolicy& policy);
+
+    /**
+     * @brief Frame size the current policy picks for a payload of num_bytes.
+     */
+    size_t chunk_size_for(size_t num_bytes) const;
+
 protected:
     ErrorHandler _error;
     DisasterRecoveryPlan _drp;
@@ -84,11 +130,21 @@ private:
     IContext* _context;
     ISocket* _socket;
     std::string _identity;
-    ManagedBuffer<ZMQAllMsg, 10> _msg_buffer;
+    ChunkPolicy _chunk_policy;
+    int _snd_hwm = 1000;
+    LockFreeManagedBuffer<ZMQAllMsg, 10> _msg_buffer;
+    Counter _tm_sent;
+    Counter _tm_bytes;
+    Counter _tm_failed;
     void _init();
+    void _record_send(size_t num_bytes, bool sent);
     void _setup_drp();
 
     VoidResult _send(void* data, size_t num_bytes);
+    VoidResult _send_zero_copy(void* data, size_t num_bytes, zc_free_cb free_fn, void* hint);
+    VoidResult _send_ipc(const ipc_hdr_t* hdr, const void* body);
+    VoidResult _send_envelope();
+    void _refresh_snd_hwm();
     VoidResult _connect(const std::string& ip, int port);
     bool _handle_connect();
     bool _handle_msg_buff();
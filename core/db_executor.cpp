@@ -0,0 +1,141 @@
+#include "db_executor.h"
+#include <exception>
+
+DbExecutor::DbExecutor(const std::string& path, size_t readers, const DbTuning& tuning,
+                       const std::string& encryption_key)
+    : _pool(path, std::max<size_t>(readers, 1), tuning, encryption_key) {
+    _threads.emplace_back(&DbExecutor::_write_loop, this);
+    for (size_t i = 0; i < _pool.readers(); ++i) {
+        _threads.emplace_back(&DbExecutor::_read_loop, this);
+    }
+}
+
+DbExecutor::~DbExecutor() {
+    _reads.close();
+    _writes.close();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void DbExecutor::post_read(DbRead fn) {
+    _reads.push(std::move(fn));
+}
+
+std::future<VoidResult> DbExecutor::write(DbWrite fn) {
+    auto done = std::make_shared<std::promise<VoidResult>>();
+    std::future<VoidResult> result = done->get_future();
+    post_write(std::move(fn), [done](const VoidResult& ret) { done->set_value(ret); });
+    return result;
+}
+
+void DbExecutor::post_write(DbWrite fn, DbWriteDone done) {
+    _writes.push({std::move(fn), std::move(done)});
+}
+
+DbExecutorStats DbExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(_stats_lock);
+    return _stats;
+}
+
+// exec() re-parses every time, these run once per job
+static VoidResult _run(DatabaseAccess& db, const std::string& sql) {
+    auto stmt = db.prepare_cached(sql);
+    if (stmt.is_err()) {
+        return Err(stmt.error().code(), stmt.error().message());
+    }
+    return db.execute(stmt.value());
+}
+
+void DbExecutor::_read_loop() {
+    static const std::string begin_sql = "BEGIN;";
+    static const std::string commit_sql = "COMMIT;";
+    static const std::string rollback_sql = "ROLLBACK;";
+
+    DbLease db = _pool.reader();
+    std::vector<DbRead> batch;
+    while (_reads.pop_batch(batch)) {
+        {
+            std::lock_guard<std::mutex> lock(_stats_lock);
+            _stats.reads += batch.size();
+            _stats.read_batches++;
+        }
+        bool in_transaction = _run(*db, begin_sql).is_ok();
+        for (auto& fn : batch) {
+            // read() hands exceptions to the future, a throwing post_read() must not take the thread down
+            try {
+                fn(*db);
+            } catch (const std::exception& e) {
+                ERROR("Database read threw: {}", e.what());
+            } catch (...) {
+                ERROR("Database read threw a non standard exception");
+            }
+        }
+        if (in_transaction) {
+            auto commit_result = _run(*db, commit_sql);
+            if (commit_result.is_err()) {
+                // A read transaction left open would pin the WAL snapshot for every later batch
+                ERROR("Database read batch failed to commit: {}", commit_result.error().message());
+                _run(*db, rollback_sql);
+            }
+        }
+        batch.clear();
+    }
+}
+
+void DbExecutor::_write_loop() {
+    static const std::string begin_sql = "BEGIN IMMEDIATE;";
+    static const std::string commit_sql = "COMMIT;";
+    static const std::string rollback_sql = "ROLLBACK;";
+    static const std::string savepoint_sql = "SAVEPOINT db_write;";
+    static const std::string release_sql = "RELEASE db_write;";
+    static const std::string undo_sql = "ROLLBACK TO db_write;";
+
+    DbLease db = _pool.writer();
+    std::vector<WriteJob> batch;
+    std::vector<VoidResult> results;
+    while (_writes.pop_batch(batch)) {
+        auto begin_result = _run(*db, begin_sql);
+        for (auto& job : batch) {
+            if (begin_result.is_err()) {
+                results.push_back(begin_result);
+                continue;
+            }
+            _run(*db, savepoint_sql);
+            VoidResult ret = Err(ErrorCode::DB_ERROR, "Database write threw");
+            try {
+                ret = job.apply(*db);
+            } catch (const std::exception& e) {
+                ret = Err(ErrorCode::DB_ERROR, std::string("Database write threw: ") + e.what());
+            } catch (...) {
+                // ret still reports the throw
+            }
+            if (ret.is_err()) {
+                _run(*db, undo_sql);
+            }
+            _run(*db, release_sql);
+            results.push_back(std::move(ret));
+        }
+
+        if (begin_result.is_ok()) {
+            auto commit_result = _run(*db, commit_sql);
+            if (commit_result.is_err()) {
+                ERROR("Database write batch failed to commit: {}", commit_result.error().message());
+                _run(*db, rollback_sql);
+                results.assign(batch.size(), commit_result);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(_stats_lock);
+            _stats.writes += batch.size();
+            _stats.write_batches++;
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].done) {
+                batch[i].done(results[i]);
+            }
+        }
+        batch.clear();
+        results.clear();
+    }
+}
@@ -0,0 +1,271 @@
+#include "db_key.h"
+#include <sodium.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+bool is_raw_db_key(std::string_view key) {
+    if (key.size() < 3 || key[0] != 'x' || key[1] != '\'' || key.back() != '\'') {
+        return false;
+    }
+    std::string_view hex = key.substr(2, key.size() - 3);
+    if (hex.size() != 2 * SQLCIPHER_KEY_BYTES && hex.size() != 2 * (SQLCIPHER_KEY_BYTES + SQLCIPHER_SALT_BYTES)) {
+        return false;
+    }
+    return std::all_of(hex.begin(), hex.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    });
+}
+
+void pbkdf2_hmac_sha512(const void* password, size_t password_len, const unsigned char* salt, size_t salt_len,
+                        int iterations, unsigned char* out, size_t out_len) {
+    // The password only shapes the HMAC's inner and outer pads, hash them once and copy the state
+    crypto_auth_hmacsha512_state keyed;
+    crypto_auth_hmacsha512_init(&keyed, static_cast<const unsigned char*>(password), password_len);
+
+    unsigned char u[crypto_auth_hmacsha512_BYTES];
+    unsigned char t[crypto_auth_hmacsha512_BYTES];
+    for (uint32_t block = 1; out_len > 0; ++block) {
+        unsigned char counter[4] = {static_cast<unsigned char>(block >> 24), static_cast<unsigned char>(block >> 16),
+                                    static_cast<unsigned char>(block >> 8), static_cast<unsigned char>(block)};
+        crypto_auth_hmacsha512_state state = keyed;
+        crypto_auth_hmacsha512_update(&state, salt, salt_len);
+        crypto_auth_hmacsha512_update(&state, counter, sizeof(counter));
+        crypto_auth_hmacsha512_final(&state, u);
+        memcpy(t, u, sizeof(t));
+
+        for (int i = 1; i < iterations; ++i) {
+            state = keyed;
+            crypto_auth_hmacsha512_update(&state, u, sizeof(u));
+            crypto_auth_hmacsha512_final(&state, u);
+            for (size_t j = 0; j < sizeof(t); ++j) {
+                t[j] ^= u[j];
+            }
+        }
+
+        size_t n = std::min(out_len, sizeof(t));
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+    sodium_memzero(&keyed, sizeof(keyed));
+    sodium_memzero(u, sizeof(u));
+    sodium_memzero(t, sizeof(t));
+}
+
+static VoidResult _read_salt(const std::string& db_path, unsigned char* salt) {
+    std::ifstream file(db_path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(salt), SQLCIPHER_SALT_BYTES)) {
+        return Err(ErrorCode::FAIL_OPEN_DB_FILE, "No salt to read in " + db_path);
+    }
+    return Ok();
+}
+
+static void _format_raw_key(const unsigned char* key, const unsigned char* salt, char* out) {
+    out[0] = 'x';
+    out[1] = '\'';
+    sodium_bin2hex(out + 2, 2 * SQLCIPHER_KEY_BYTES + 1, key, SQLCIPHER_KEY_BYTES);
+    sodium_bin2hex(out + 2 + 2 * SQLCIPHER_KEY_BYTES, 2 * SQLCIPHER_SALT_BYTES + 1, salt, SQLCIPHER_SALT_BYTES);
+    out[RAW_DB_KEY_CHARS - 2] = '\'';
+    out[RAW_DB_KEY_CHARS - 1] = '\0';
+}
+
+static void _derive(const void* passphrase, size_t passphrase_len, const unsigned char* salt, int kdf_iter,
+                    char* out) {
+    unsigned char key[SQLCIPHER_KEY_BYTES];
+    pbkdf2_hmac_sha512(passphrase, passphrase_len, salt, SQLCIPHER_SALT_BYTES, kdf_iter, key, sizeof(key));
+    _format_raw_key(key, salt, out);
+    sodium_memzero(key, sizeof(key));
+}
+
+VoidResult derive_raw_db_key(const std::string& db_path, const void* passphrase, size_t passphrase_len, int kdf_iter,
+                             char* out) {
+    unsigned char salt[SQLCIPHER_SALT_BYTES];
+    auto ret = _read_salt(db_path, salt);
+    if (ret.is_err()) {
+        return ret;
+    }
+    _derive(passphrase, passphrase_len, salt, kdf_iter, out);
+    return Ok();
+}
+
+namespace {
+
+// The passphrase hash is unsalted, it is as sensitive as the key and shares its secure block
+struct KeySecret {
+    unsigned char passphrase_hash[crypto_hash_sha512_BYTES];
+    char raw[RAW_DB_KEY_CHARS];
+};
+
+struct CachedKey {
+    std::mutex lock;  // Held while deriving, only openers of the same file wait
+    KeySecret* secret = nullptr;
+    unsigned char salt[SQLCIPHER_SALT_BYTES];
+    int kdf_iter = 0;
+    bool derived = false;
+    bool rejected = false;  // raw is wiped, the database needs the passphrase
+
+    CachedKey() = default;
+    ~CachedKey() {
+        if (secret) {
+            sodium_free(secret);
+        }
+    }
+    CachedKey(const CachedKey&) = delete;
+    CachedKey& operator=(const CachedKey&) = delete;
+};
+
+std::mutex cache_lock;  // Guards the map only, never held while deriving
+std::unordered_map<std::string, std::shared_ptr<CachedKey>> cache;
+
+std::shared_ptr<CachedKey> _cache_entry(const std::string& db_path) {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    auto& entry = cache[db_path];
+    if (!entry) {
+        entry = std::make_shared<CachedKey>();
+    }
+    return entry;
+}
+
+}  // namespace
+
+VoidResult cached_raw_db_key(const std::string& db_path, const void* passphrase, size_t passphrase_len, int kdf_iter,
+                             char* out) {
+    unsigned char salt[SQLCIPHER_SALT_BYTES];
+    auto ret = _read_salt(db_path, salt);
+    if (ret.is_err()) {
+        return ret;
+    }
+
+    // Kept alive by the shared_ptr if forget_raw_db_key() drops it from the map meanwhile
+    auto entry = _cache_entry(db_path);
+    std::lock_guard<std::mutex> lock(entry->lock);
+    if (!entry->secret) {
+        entry->secret = static_cast<KeySecret*>(sodium_malloc(sizeof(KeySecret)));
+        if (!entry->secret) {
+            return Err(ErrorCode::FAIL_DECRYPT_DB, "Failed to allocate secure memory for db key");
+        }
+        entry->derived = false;
+    }
+
+    // Only compared here and wiped below, the kept copy lives in the secure block
+    unsigned char passphrase_hash[crypto_hash_sha512_BYTES];
+    crypto_hash_sha512(passphrase_hash, static_cast<const unsigned char*>(passphrase), passphrase_len);
+    // A recreated file has a new salt, a rotated passphrase a new hash: both derive again
+    if (!entry->derived || entry->kdf_iter != kdf_iter || sodium_memcmp(entry->salt, salt, sizeof(salt)) != 0
+        || sodium_memcmp(entry->secret->passphrase_hash, passphrase_hash, sizeof(passphrase_hash)) != 0) {
+        _derive(passphrase, passphrase_len, salt, kdf_iter, entry->secret->raw);
+        memcpy(entry->secret->passphrase_hash, passphrase_hash, sizeof(passphrase_hash));
+        memcpy(entry->salt, salt, sizeof(salt));
+        entry->kdf_iter = kdf_iter;
+        entry->derived = true;
+        entry->rejected = false;
+    }
+    sodium_memzero(passphrase_hash, sizeof(passphrase_hash));
+    if (entry->rejected) {
+        return Err(ErrorCode::FAIL_DECRYPT_DB, "Derived key does not open " + db_path);
+    }
+    memcpy(out, entry->secret->raw, RAW_DB_KEY_CHARS);
+    return Ok();
+}
+
+void forget_raw_db_key(const std::string& db_path) {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    cache.erase(db_path);
+}
+
+void reject_raw_db_key(const std::string& db_path) {
+    std::shared_ptr<CachedKey> entry;
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        auto it = cache.find(db_path);
+        if (it == cache.end()) {
+            return;
+        }
+        entry = it->second;
+    }
+    std::lock_guard<std::mutex> lock(entry->lock);
+    if (entry->secret) {
+        sodium_memzero(entry->secret->raw, RAW_DB_KEY_CHARS);
+        entry->rejected = true;
+    }
+}
+
+VoidResult load_raw_db_key(const std::string& key_file, const std::string& db_path, char* out) {
+    unsigned char salt[SQLCIPHER_SALT_BYTES];
+    auto ret = _read_salt(db_path, salt);
+    if (ret.is_err()) {
+        return ret;
+    }
+    char salt_hex[2 * SQLCIPHER_SALT_BYTES + 1];
+    sodium_bin2hex(salt_hex, sizeof(salt_hex), salt, sizeof(salt));
+
+    // One line: the x'...' literal, or "rejected <salt hex>"
+    char line[RAW_DB_KEY_CHARS + 1] = {};
+    std::ifstream file(key_file, std::ios::binary);
+    file.read(line, RAW_DB_KEY_CHARS);
+    std::string_view content(line, static_cast<size_t>(file.gcount()));
+    while (!content.empty() && (content.back() == '\n' || content.back() == '\0')) {
+        content.remove_suffix(1);
+    }
+
+    ret = Err(ErrorCode::NO_OBJECT, "No raw key for " + db_path + " in " + key_file);
+    if (content == std::string(RAW_DB_KEY_REJECTED " ") + salt_hex) {
+        ret = Err(ErrorCode::FAIL_DECRYPT_DB, "Derived key does not open " + db_path);
+    } else if (content.size() == RAW_DB_KEY_CHARS - 1 && is_raw_db_key(content)
+               && content.substr(2 + 2 * SQLCIPHER_KEY_BYTES, 2 * SQLCIPHER_SALT_BYTES) == salt_hex) {
+        // Another salt means the database was recreated, the key is stale and NO_OBJECT asks for a new one
+        memcpy(out, content.data(), content.size());
+        out[RAW_DB_KEY_CHARS - 1] = '\0';
+        ret = Ok();
+    }
+    sodium_memzero(line, sizeof(line));
+    return ret;
+}
+
+VoidResult store_raw_db_key(const std::string& key_file, const std::string& db_path, const char* raw) {
+    std::string content;
+    if (raw) {
+        content.assign(raw, RAW_DB_KEY_CHARS - 1);
+    } else {
+        unsigned char salt[SQLCIPHER_SALT_BYTES];
+        auto ret = _read_salt(db_path, salt);
+        if (ret.is_err()) {
+            return ret;
+        }
+        char salt_hex[2 * SQLCIPHER_SALT_BYTES + 1];
+        sodium_bin2hex(salt_hex, sizeof(salt_hex), salt, sizeof(salt));
+        content = std::string(RAW_DB_KEY_REJECTED " ") + salt_hex;
+    }
+    content += '\n';
+
+    // Owner only before a byte of key lands in it, renamed over the old file so a reader never sees half a key
+    namespace fs = std::filesystem;
+    std::string tmp = key_file + ".tmp";
+    std::error_code ec;
+    std::ofstream(tmp, std::ios::binary | std::ios::trunc).close();
+    fs::permissions(tmp, fs::perms::owner_read | fs::perms::owner_write, fs::perm_options::replace, ec);
+    bool written = false;
+    if (!ec) {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        written = static_cast<bool>(file.write(content.data(), static_cast<std::streamsize>(content.size())));
+        file.close();
+        written = written && !file.fail();
+    }
+    sodium_memzero(&content[0], content.size());
+    if (!written) {
+        fs::remove(tmp, ec);
+        return Err(ErrorCode::FAIL_OPEN_DB_FILE, "Failed to write raw db key to " + tmp);
+    }
+    fs::rename(tmp, key_file, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return Err(ErrorCode::FAIL_OPEN_DB_FILE, "Failed to replace " + key_file);
+    }
+    return Ok();
+}
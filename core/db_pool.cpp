@@ -0,0 +1,69 @@
+#include "db_pool.h"
+
+DbLease::~DbLease() {
+    if (_db) {
+        _pool->_give_back(_db, _writer);
+    }
+}
+
+DbPool::DbPool(const std::string& path, size_t readers, const DbTuning& tuning, const std::string& encryption_key) {
+    if (readers == 0) {
+        readers = DB_POOL_DEFAULT_READERS;
+    }
+    DbTuning conn = tuning;
+    conn.no_mutex = true;
+
+    // The writer goes first, it is the one that creates a missing database
+    conn.query_only = false;
+    _writer = std::make_unique<DatabaseAccess>(path, encryption_key, conn);
+
+    conn.query_only = true;
+    _readers.reserve(readers);
+    _idle_readers.reserve(readers);
+    for (size_t i = 0; i < readers; ++i) {
+        _readers.push_back(std::make_unique<DatabaseAccess>(path, encryption_key, conn));
+        _idle_readers.push_back(_readers.back().get());
+    }
+    DEBUG("Database pool ready: {} readers + 1 writer on {}", readers, path);
+}
+
+DbLease DbPool::reader() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_idle_readers.empty()) {
+        _stats.waits++;
+        _reader_free.wait(lock, [this] { return !_idle_readers.empty(); });
+    }
+    // LIFO, the connection returned last has the warmest page cache
+    DatabaseAccess* db = _idle_readers.back();
+    _idle_readers.pop_back();
+    _stats.reader_borrows++;
+    return DbLease(this, db, false);
+}
+
+DbLease DbPool::writer() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_writer_out) {
+        _stats.waits++;
+        _writer_free.wait(lock, [this] { return !_writer_out; });
+    }
+    _writer_out = true;
+    _stats.writer_borrows++;
+    return DbLease(this, _writer.get(), true);
+}
+
+void DbPool::_give_back(DatabaseAccess* db, bool writer) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (writer) {
+            _writer_out = false;
+        } else {
+            _idle_readers.push_back(db);
+        }
+    }
+    (writer ? _writer_free : _reader_free).notify_one();
+}
+
+DbPoolStats DbPool::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
@@ -0,0 +1,59 @@
+#include "hash_helpers.h"
+#include <cstring>
+
+namespace {
+
+// Both hex chars of every byte value, one 16 bit load per input byte
+struct HexTable {
+    char pairs[256][2];
+
+    constexpr HexTable() : pairs() {
+        constexpr char digits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i) {
+            pairs[i][0] = digits[i >> 4];
+            pairs[i][1] = digits[i & 15];
+        }
+    }
+};
+
+constexpr HexTable hex_table;
+
+}  // namespace
+
+void hex_encode(const void* data, size_t size, char* out) {
+    auto in = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        memcpy(out + 2 * i, hex_table.pairs[in[i]], 2);
+    }
+}
+
+std::string to_hex(const void* data, size_t size) {
+    std::string hex(2 * size, '\0');
+    hex_encode(data, size, hex.data());
+    return hex;
+}
+
+void Sha256::finish_hex(char* out) {
+    unsigned char digest[SHA256_BYTES];
+    finish(digest);
+    hex_encode(digest, sizeof(digest), out);
+}
+
+Sha256Digest Sha256::digest(const void* data, size_t size) {
+    return Sha256().update(data, size).finish();
+}
+
+void sha256_batch(const std::string_view* inputs, size_t count, Sha256Digest* out) {
+    crypto_hash_sha256_state initial;
+    crypto_hash_sha256_init(&initial);
+    for (size_t i = 0; i < count; ++i) {
+        crypto_hash_sha256_state state = initial;
+        crypto_hash_sha256_update(&state, reinterpret_cast<const unsigned char*>(inputs[i].data()), inputs[i].size());
+        crypto_hash_sha256_final(&state, out[i].data());
+    }
+}
+
+std::string sha256_hex(std::string_view data) {
+    Sha256Digest digest = Sha256::digest(data.data(), data.size());
+    return to_hex(digest.data(), digest.size());
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#include "ipc_trace.h"
+
+namespace {
+    // Known clients get their own row, any other id shares the last one
+    constexpr size_t TRACE_ROUTE_IDS = CLIENTS_TOTAL + 1;
+    constexpr size_t TRACE_SPANS = static_cast<size_t>(TraceSpan::COUNT);
+    // Every slot may end up registered, the components keep the other half of the table
+    static_assert(TRACE_ROUTE_IDS * TRACE_ROUTE_IDS * TRACE_SPANS <= TELEMETRY_MAX_HISTOGRAMS / 2,
+                  "Trace routes do not fit the telemetry histogram table");
+
+    struct RouteSlot {
+        std::atomic<bool> ready{false};
+        Histogram hist;
+    };
+
+    RouteSlot route_slots[TRACE_ROUTE_IDS][TRACE_ROUTE_IDS][TRACE_SPANS];
+    std::mutex register_lock;
+
+    size_t route_index(int32_t id) {
+        return (id >= 0 && id < CLIENTS_TOTAL) ? static_cast<size_t>(id) : static_cast<size_t>(CLIENTS_TOTAL);
+    }
+
+    const char* route_name(size_t index) {
+        return index < CLIENTS_TOTAL ? CLIENTS_IDS[index] : "other";
+    }
+
+    // Registered on first use, the registry lock is only taken once per route and span
+    const Histogram& route_histogram(int32_t src_id, int32_t dst_id, TraceSpan span) {
+        size_t src = route_index(src_id);
+        size_t dst = route_index(dst_id);
+        RouteSlot& slot = route_slots[src][dst][static_cast<size_t>(span)];
+        if (!slot.ready.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(register_lock);
+            if (!slot.ready.load(std::memory_order_relaxed)) {
+                std::string name = std::string("trace.") + route_name(src) + "." + route_name(dst) + "."
+                                   + trace_span_to_string(span) + "_ns";
+                slot.hist = Telemetry::histogram(name.c_str());
+                slot.ready.store(true, std::memory_order_release);
+            }
+        }
+        return slot.hist;
+    }
+
+    bool json_number(const std::string& line, const char* key, uint64_t& out) {
+        std::string needle = std::string("\"") + key + "\":";
+        size_t at = line.find(needle);
+        if (at == std::string::npos) {
+            return false;
+        }
+        out = std::strtoull(line.c_str() + at + needle.size(), nullptr, 10);
+        return true;
+    }
+}  // namespace
+
+const char* trace_span_to_string(TraceSpan span) {
+    switch (span) {
+        case TraceSpan::TO_BUS:
+            return "to_bus";
+        case TraceSpan::IN_BUS:
+            return "in_bus";
+        case TraceSpan::FROM_BUS:
+            return "from_bus";
+        case TraceSpan::END_TO_END:
+            return "end_to_end";
+        default:
+            return "unknown";
+    }
+}
+
+void IpcTrace::record(int32_t src_id, int32_t dst_id, TraceSpan span, int64_t from_ns, int64_t to_ns) {
+    if (from_ns == 0 || to_ns == 0 || to_ns < from_ns) {
+        return;
+    }
+    route_histogram(src_id, dst_id, span).record(static_cast<uint64_t>(to_ns - from_ns));
+}
+
+void IpcTrace::record_bus(const ipc_view_t& view) {
+    ipc_trace_t trace;
+    if (ipc_trace_read(&view, &trace) != 0) {
+        return;
+    }
+    record(view.hdr.src_id, view.hdr.dst_id, TraceSpan::TO_BUS, trace.stamps[IPC_HOP_SENT],
+           trace.stamps[IPC_HOP_BUS_IN]);
+    record(view.hdr.src_id, view.hdr.dst_id, TraceSpan::IN_BUS, trace.stamps[IPC_HOP_BUS_IN],
+           trace.stamps[IPC_HOP_BUS_OUT]);
+}
+
+void IpcTrace::record_delivery(const ipc_view_t& view) {
+    ipc_trace_t trace;
+    if (ipc_trace_read(&view, &trace) != 0) {
+        return;
+    }
+    int64_t delivered = now();
+    record(view.hdr.src_id, view.hdr.dst_id, TraceSpan::FROM_BUS, trace.stamps[IPC_HOP_BUS_OUT], delivered);
+    record(view.hdr.src_id, view.hdr.dst_id, TraceSpan::END_TO_END, trace.stamps[IPC_HOP_SENT], delivered);
+}
+
+std::vector<TraceRouteStats> IpcTrace::report(const std::vector<HistogramSample>& histograms) {
+    static const std::string PREFIX = "trace.";
+    static const std::string SUFFIX = "_ns";
+    std::vector<std::pair<size_t, TraceRouteStats>> found;
+
+    for (const auto& sample : histograms) {
+        const std::string& name = sample.name;
+        if (name.compare(0, PREFIX.size(), PREFIX) != 0 || name.size() < PREFIX.size() + SUFFIX.size()
+            || name.compare(name.size() - SUFFIX.size(), SUFFIX.size(), SUFFIX) != 0) {
+            continue;
+        }
+        // trace.<src>.<dst>.<span>_ns, client ids have no dots
+        std::string rest = name.substr(PREFIX.size(), name.size() - PREFIX.size() - SUFFIX.size());
+        size_t first = rest.find('.');
+        size_t second = first == std::string::npos ? first : rest.find('.', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        TraceRouteStats stats;
+        stats.src = rest.substr(0, first);
+        stats.dst = rest.substr(first + 1, second - first - 1);
+        stats.span = rest.substr(second + 1);
+        stats.count = sample.count;
+        stats.p50 = sample.p50;
+        stats.p99 = sample.p99;
+        stats.p999 = sample.p999;
+        stats.max = sample.max;
+
+        size_t order = TRACE_SPANS;
+        for (size_t i = 0; i < TRACE_SPANS; ++i) {
+            if (stats.span == trace_span_to_string(static_cast<TraceSpan>(i))) {
+                order = i;
+            }
+        }
+        found.emplace_back(order, std::move(stats));
+    }
+
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        if (a.second.src != b.second.src) {
+            return a.second.src < b.second.src;
+        }
+        if (a.second.dst != b.second.dst) {
+            return a.second.dst < b.second.dst;
+        }
+        return a.first < b.first;
+    });
+    std::vector<TraceRouteStats> routes;
+    routes.reserve(found.size());
+    for (auto& entry : found) {
+        routes.push_back(std::move(entry.second));
+    }
+    return routes;
+}
+
+std::string IpcTrace::format_report(const std::vector<TraceRouteStats>& routes) {
+    std::string out;
+    char line[160];
+    snprintf(line, sizeof(line), "%-20s %-11s %10s %10s %10s %10s %10s\n", "route", "span", "count", "p50 us",
+             "p99 us", "p999 us", "max us");
+    out.append(line);
+    for (const auto& route : routes) {
+        std::string name = route.src + " -> " + route.dst;
+        snprintf(line, sizeof(line), "%-20s %-11s %10llu %10.1f %10.1f %10.1f %10.1f\n", name.c_str(),
+                 route.span.c_str(), (unsigned long long) route.count, route.p50 / 1000.0, route.p99 / 1000.0,
+                 route.p999 / 1000.0, route.max / 1000.0);
+        out.append(line);
+    }
+    return out;
+}
+
+bool IpcTrace::parse_metric_line(const std::string& line, HistogramSample& out) {
+    static const std::string NAME = "\"name\":\"";
+    if (line.find("\"class\":\"metric\"") == std::string::npos) {
+        return false;
+    }
+    size_t at = line.find(NAME);
+    if (at == std::string::npos) {
+        return false;
+    }
+    at += NAME.size();
+    size_t end = line.find('"', at);
+    if (end == std::string::npos) {
+        return false;
+    }
+
+    HistogramSample sample;
+    sample.name = line.substr(at, end - at);
+    if (!json_number(line, "count", sample.count) || !json_number(line, "p999", sample.p999)) {
+        return false;
+    }
+    json_number(line, "sum", sample.sum);
+    json_number(line, "min", sample.min);
+    json_number(line, "max", sample.max);
+    json_number(line, "p50", sample.p50);
+    json_number(line, "p90", sample.p90);
+    json_number(line, "p99", sample.p99);
+    out = std::move(sample);
+    return true;
+}
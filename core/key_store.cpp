@@ -0,0 +1,177 @@
+#include "key_store.h"
+#include <sodium.h>
+#include <algorithm>
+#include <cstring>
+#include "5thdallocator.h"
+
+KeyStore::KeyStore(DatabaseAccess& db, std::chrono::seconds ttl) : _db(db), _ttl(ttl) {}
+
+KeyStore::~KeyStore() {
+    clear();
+}
+
+KeyStore& KeyStore::shared() {
+    // Destroyed in reverse order, the store wipes its keys before the db closes
+    static DatabaseAccess db;
+    static KeyStore store(db);
+    return store;
+}
+
+std::string KeyStore::_cache_key(const std::string& module_name, KeyType key_type, const std::string& key_name) {
+    std::string cache_key;
+    cache_key.reserve(module_name.size() + key_name.size() + 3);
+    cache_key.append(module_name);
+    cache_key.push_back('\x1f');
+    cache_key.push_back(static_cast<char>('0' + static_cast<int>(key_type)));
+    cache_key.push_back('\x1f');
+    cache_key.append(key_name);
+    return cache_key;
+}
+
+void KeyStore::_wipe(Entry& entry) {
+    if (entry.data) {
+        free_smem(entry.data, entry.num_bytes);
+        entry.data = nullptr;
+    }
+}
+
+Result<const KeyStore::Entry*> KeyStore::_load(const std::string& cache_key, const std::string& module_name,
+                                               KeyType key_type, const std::string& key_name, KeyRecord& uncached) {
+    auto now = std::chrono::steady_clock::now();
+    auto it = _entries.find(cache_key);
+    if (it != _entries.end()) {
+        if (now < it->second.deadline) {
+            _stats.hits++;
+            return Ok<const Entry*>(&it->second);
+        }
+        _stats.expired++;
+        _wipe(it->second);
+        _entries.erase(it);
+    }
+    _stats.misses++;
+
+    // The value goes from sqlite's buffer straight into secure memory, no heap copy on the way
+    Entry entry{nullptr, 0, now + _ttl};
+    bool past_expiry = false;
+    auto ret = with_key_record(
+        _db, module_name, key_type, key_name,
+        [&](SqlBlob value, const std::chrono::system_clock::time_point& expires_at) {
+            if (expires_at != std::chrono::system_clock::time_point()) {
+                auto left = expires_at - std::chrono::system_clock::now();
+                if (left <= std::chrono::system_clock::duration::zero()) {
+                    // Past its expires_at: handed out like get_key() does, but never cached
+                    past_expiry = true;
+                    uncached.value.assign(value.data, value.data + value.size);
+                    return;
+                }
+                entry.deadline = std::min(
+                    entry.deadline, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(left));
+            }
+            entry.data = static_cast<unsigned char*>(allocate_smem(std::max<size_t>(value.size, 1)));
+            if (entry.data) {
+                entry.num_bytes = value.size;
+                if (value.size) {
+                    memcpy(entry.data, value.data, value.size);
+                }
+            }
+        });
+    if (ret.is_err()) {
+        return Err<const Entry*>(ret.error().code(), ret.error().message());
+    }
+    if (past_expiry) {
+        return Ok<const Entry*>(nullptr);
+    }
+    if (entry.data == nullptr) {
+        return Err<const Entry*>(ErrorCode::FAIL_GET_KEY, "Failed to allocate secure memory for key");
+    }
+
+    auto inserted = _entries.emplace(cache_key, entry);
+    return Ok<const Entry*>(&inserted.first->second);
+}
+
+VoidResult KeyStore::with_key(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                              const KeyView& view) {
+    std::string cache_key = _cache_key(module_name, key_type, key_name);
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    KeyRecord uncached;
+    auto entry = _load(cache_key, module_name, key_type, key_name, uncached);
+    if (entry.is_err()) {
+        return Err(entry.error().code(), entry.error().message());
+    }
+    if (entry.value()) {
+        view(entry.value()->data, entry.value()->num_bytes);
+    } else {
+        view(uncached.value.data(), uncached.value.size());
+        sodium_memzero(uncached.value.data(), uncached.value.size());
+    }
+    return Ok();
+}
+
+Result<std::vector<unsigned char>> KeyStore::get(const std::string& module_name, KeyType key_type,
+                                                 const std::string& key_name) {
+    std::vector<unsigned char> out;
+    auto ret = with_key(module_name, key_type, key_name,
+                        [&out](const unsigned char* data, size_t num_bytes) { out.assign(data, data + num_bytes); });
+    if (ret.is_err()) {
+        return Err<std::vector<unsigned char>>(ret.error().code(), ret.error().message());
+    }
+    return Ok<std::vector<unsigned char>>(std::move(out));
+}
+
+void KeyStore::_invalidate(const std::string& cache_key) {
+    auto it = _entries.find(cache_key);
+    if (it != _entries.end()) {
+        _wipe(it->second);
+        _entries.erase(it);
+        _stats.invalidations++;
+    }
+}
+
+VoidResult KeyStore::store(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                           const std::vector<unsigned char>& key_value,
+                           const std::chrono::system_clock::time_point& expires_at) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _invalidate(_cache_key(module_name, key_type, key_name));
+    return store_key(_db, module_name, key_type, key_name, key_value, expires_at);
+}
+
+VoidResult KeyStore::store_batch(const std::vector<KeyWrite>& keys, KeyWriteMode mode) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& key : keys) {
+        _invalidate(_cache_key(key.module_name, key.key_type, key.key_name));
+    }
+    return store_keys(_db, keys, mode);
+}
+
+VoidResult KeyStore::update(const std::string& module_name, KeyType key_type, const std::string& key_name,
+                            const std::vector<unsigned char>& new_key_value,
+                            const std::chrono::system_clock::time_point& new_expires_at) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _invalidate(_cache_key(module_name, key_type, key_name));
+    return update_key(_db, module_name, key_type, key_name, new_key_value, new_expires_at);
+}
+
+VoidResult KeyStore::remove(const std::string& module_name, KeyType key_type, const std::string& key_name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _invalidate(_cache_key(module_name, key_type, key_name));
+    return remove_key(_db, module_name, key_type, key_name);
+}
+
+void KeyStore::invalidate(const std::string& module_name, KeyType key_type, const std::string& key_name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _invalidate(_cache_key(module_name, key_type, key_name));
+}
+
+void KeyStore::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& entry : _entries) {
+        _wipe(entry.second);
+    }
+    _entries.clear();
+}
+
+KeyStoreStats KeyStore::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
@@ -0,0 +1,92 @@
+#include "key_writer.h"
+#include <algorithm>
+
+KeyWriter::KeyWriter(DatabaseAccess& db, size_t max_batch)
+    : _db(db), _max_batch(std::max<size_t>(max_batch, 1)), _thread(&KeyWriter::_run, this) {}
+
+KeyWriter::~KeyWriter() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cond.notify_one();
+    _thread.join();
+}
+
+std::future<VoidResult> KeyWriter::submit(KeyWrite write, KeyWriteMode mode) {
+    Pending pending{std::move(write), mode, std::promise<VoidResult>()};
+    auto result = pending.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(std::move(pending));
+    }
+    _cond.notify_one();
+    return result;
+}
+
+KeyWriterStats KeyWriter::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void KeyWriter::_run() {
+    std::vector<Pending> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this] { return _stop || !_queue.empty(); });
+            if (_queue.empty()) {
+                return;
+            }
+            // Everything that queued up while the previous batch was committing goes in this one
+            size_t count = std::min(_queue.size(), _max_batch);
+            batch.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(_queue.front()));
+                _queue.pop_front();
+            }
+            _stats.writes += count;
+            _stats.batches++;
+            _stats.largest_batch = std::max<uint64_t>(_stats.largest_batch, count);
+        }
+        _commit(batch);
+        batch.clear();
+    }
+}
+
+void KeyWriter::_commit(std::vector<Pending>& batch) {
+    auto begin_result = _db.exec("BEGIN IMMEDIATE;");
+    if (begin_result.is_err()) {
+        for (auto& pending : batch) {
+            pending.done.set_value(begin_result);
+        }
+        return;
+    }
+
+    // Runs of the same mode keep submission order, each run is a savepoint inside the one transaction
+    std::vector<VoidResult> results;
+    std::vector<KeyWrite> run;
+    std::vector<VoidResult> run_results;
+    for (size_t start = 0; start < batch.size();) {
+        size_t end = start;
+        while (end < batch.size() && batch[end].mode == batch[start].mode) {
+            run.push_back(std::move(batch[end].write));
+            ++end;
+        }
+        store_keys_each(_db, run, batch[start].mode, run_results);
+        for (auto& result : run_results) {
+            results.push_back(std::move(result));
+        }
+        run.clear();
+        start = end;
+    }
+
+    auto commit_result = _db.exec("COMMIT;");
+    if (commit_result.is_err()) {
+        ERROR("Key batch commit failed: {}", commit_result.error().message());
+        _db.exec("ROLLBACK;");
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i].done.set_value(commit_result.is_err() ? commit_result : std::move(results[i]));
+    }
+}
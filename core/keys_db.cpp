@@ -1,12 +1,15 @@
 #include "keys_db.h"
+#include <array>
+#include <cstdio>
+#include <ctime>
 #include <iomanip>
 #include <sstream>
 
 
 VoidResult check_key_types(DatabaseAccess& db) {
-    std::string sql = "SELECT type_name FROM key_types;";
+    static const std::string sql = "SELECT type_name FROM key_types;";
     sdbret_t result;
-    auto stmt = db.prepare(sql);
+    auto stmt = db.prepare_cached(sql);
     if (stmt.is_err())
         return Err(ErrorCode::DB_ERROR, "Failed to prepare key_types query");
 
@@ -24,9 +27,9 @@ VoidResult check_key_types(DatabaseAccess& db) {
 }
 
 VoidResult print_schema(DatabaseAccess& db) {
-    std::string sql = "SELECT name, sql FROM sqlite_master WHERE type='table';";
+    static const std::string sql = "SELECT name, sql FROM sqlite_master WHERE type='table';";
     sdbret_t result;
-    auto stmt = db.prepare(sql);
+    auto stmt = db.prepare_cached(sql);
     if (stmt.is_err())
         return Err(ErrorCode::DB_ERROR, "Failed to prepare schema query");
 
@@ -47,9 +50,10 @@ VoidResult print_schema(DatabaseAccess& db) {
 void print_all_keys(DatabaseAccess& db) {
     DEBUG("Printing all keys in the database:");
     
-    const char* query = "SELECT module_name, key_type_id, key_name, created_at, expires_at, is_active FROM module_keys";
+    static const std::string query =
+        "SELECT module_name, key_type_id, key_name, created_at, expires_at, is_active FROM module_keys";
     
-    auto stmt_result = db.prepare(query);
+    auto stmt_result = db.prepare_cached(query);
     if (stmt_result.is_err()) {
         ERROR("Failed to prepare statement for printing keys: {}", stmt_result.error().message());
         return;
@@ -74,7 +78,7 @@ void print_all_keys(DatabaseAccess& db) {
               is_active);
     }
     
-    sqlite3_finalize(stmt);
+    db.release(stmt);
 }
 
 
@@ -85,6 +89,17 @@ std::string time_point_to_string(const std::chrono::system_clock::time_point& tp
     return ss.str();
 }
 
+std::chrono::system_clock::time_point string_to_time_point(const char* text) {
+    std::tm tm = {};
+    if (text == nullptr || sscanf(text, "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour,
+                                  &tm.tm_min, &tm.tm_sec) != 6) {
+        return std::chrono::system_clock::time_point();
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    return std::chrono::system_clock::from_time_t(timegm(&tm));
+}
+
 const char* key_type_to_string(KeyType key_type) {
     switch (key_type) {
         case KeyType::CURVE25519:
@@ -105,11 +120,12 @@ const char* key_type_to_string(KeyType key_type) {
 VoidResult store_key(DatabaseAccess& db, const std::string& module_name, KeyType key_type, const std::string& key_name,
                      const std::vector<unsigned char>& key_value,
                      const std::chrono::system_clock::time_point& expires_at) {
-    std::string sql = "INSERT INTO module_keys (module_name, key_type_id, key_name, key_value, expires_at) "
-                      "VALUES (?, (SELECT id FROM key_types WHERE type_name = ?), ?, ?, ?)";
+    static const std::string sql =
+        "INSERT INTO module_keys (module_name, key_type_id, key_name, key_value, expires_at) "
+        "VALUES (?, (SELECT id FROM key_types WHERE type_name = ?), ?, ?, ?)";
     DEBUG("Attempting to store key: module={}, type={}, name={}", module_name, key_type_to_string(key_type), key_name);
 
-    auto stmt = db.prepare(sql);
+    auto stmt = db.prepare_cached(sql);
     if (stmt.is_err())
         return Err(ErrorCode::FAIL_ADD_KEY, "Failed to prepare statement to add key");
 
@@ -150,14 +166,107 @@ VoidResult store_key(DatabaseAccess& db, const std::string& module_name, KeyType
     return result;
 }
 
+// key_types ids indexed by KeyType, -1 for a type the table does not know
+static VoidResult _key_type_ids(DatabaseAccess& db, std::array<int, KEY_TYPE_COUNT>& ids) {
+    static const std::string sql = "SELECT id, type_name FROM key_types;";
+    ids.fill(-1);
+    auto stmt = db.prepare_cached(sql);
+    if (stmt.is_err())
+        return Err(ErrorCode::KEY_TYPE_NOT_FOUND, "Failed to prepare key_types query");
+
+    return db.for_each_row(stmt.value(), [&ids](const SqlRow& row) {
+        std::string_view name = row.get_text(1);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (name == key_type_to_string(static_cast<KeyType>(i))) {
+                ids[i] = row.get_int(0);
+            }
+        }
+        return true;
+    });
+}
+
+static VoidResult _write_key(DatabaseAccess& db, sqlite3_stmt* stmt, const KeyWrite& key, int type_id) {
+    if (type_id < 0)
+        return Err(ErrorCode::KEY_TYPE_NOT_FOUND, "Unknown key type for " + key.key_name);
+
+    std::string expires_at_str;
+    if (key.expires_at != std::chrono::system_clock::time_point()) {
+        expires_at_str = time_point_to_string(key.expires_at);
+    }
+    if (db.bind_text(stmt, 1, key.module_name).is_err() || db.bind_int(stmt, 2, type_id).is_err()
+        || db.bind_text(stmt, 3, key.key_name).is_err() || db.bind_blob(stmt, 4, key.key_value).is_err()
+        || (expires_at_str.empty() ? db.bind_null(stmt, 5) : db.bind_text(stmt, 5, expires_at_str)).is_err()) {
+        db.release(stmt);
+        return Err(ErrorCode::FAIL_ADD_KEY, "Failed to bind key " + key.key_name);
+    }
+    return db.execute(stmt);
+}
+
+static VoidResult _store_keys(DatabaseAccess& db, const std::vector<KeyWrite>& keys, KeyWriteMode mode,
+                              std::vector<VoidResult>* results) {
+    static const std::string insert_sql =
+        "INSERT INTO module_keys (module_name, key_type_id, key_name, key_value, expires_at) VALUES (?, ?, ?, ?, ?)";
+    static const std::string upsert_sql =
+        "INSERT INTO module_keys (module_name, key_type_id, key_name, key_value, expires_at) VALUES (?, ?, ?, ?, ?) "
+        "ON CONFLICT(module_name, key_type_id, key_name) DO UPDATE SET "
+        "key_value = excluded.key_value, expires_at = excluded.expires_at, is_active = 1";
+
+    std::array<int, KEY_TYPE_COUNT> type_ids;
+    auto ids_result = _key_type_ids(db, type_ids);
+    if (ids_result.is_err())
+        return ids_result;
+
+    auto stmt = db.prepare_cached(mode == KeyWriteMode::UPSERT ? upsert_sql : insert_sql);
+    if (stmt.is_err())
+        return Err(ErrorCode::FAIL_ADD_KEY, "Failed to prepare statement to add keys");
+
+    auto begin_result = db.exec("SAVEPOINT store_keys;");
+    if (begin_result.is_err())
+        return begin_result;
+
+    for (const auto& key : keys) {
+        // A failed row only undoes its own statement, the savepoint stays open
+        auto row_result = _write_key(db, stmt.value(), key, type_ids[static_cast<size_t>(key.key_type)]);
+        if (results) {
+            results->push_back(std::move(row_result));
+        } else if (row_result.is_err()) {
+            ERROR("Bulk key write failed: {}", row_result.error().message());
+            db.exec("ROLLBACK TO store_keys;");
+            db.exec("RELEASE store_keys;");
+            return row_result;
+        }
+    }
+
+    auto commit_result = db.exec("RELEASE store_keys;");
+    if (commit_result.is_err()) {
+        db.exec("ROLLBACK TO store_keys;");
+        db.exec("RELEASE store_keys;");
+    }
+    return commit_result;
+}
+
+VoidResult store_keys(DatabaseAccess& db, const std::vector<KeyWrite>& keys, KeyWriteMode mode) {
+    return _store_keys(db, keys, mode, nullptr);
+}
+
+void store_keys_each(DatabaseAccess& db, const std::vector<KeyWrite>& keys, KeyWriteMode mode,
+                     std::vector<VoidResult>& results) {
+    results.clear();
+    results.reserve(keys.size());
+    auto ret = _store_keys(db, keys, mode, &results);
+    if (ret.is_err()) {
+        results.assign(keys.size(), ret);
+    }
+}
+
 VoidResult update_key(DatabaseAccess& db, const std::string& module_name, KeyType key_type, const std::string& key_name,
                       const std::vector<unsigned char>& new_key_value,
                       const std::chrono::system_clock::time_point& new_expires_at) {
-    std::string sql =
+    static const std::string sql =
         "UPDATE module_keys SET key_value = ?, expires_at = ? "
         "WHERE module_name = ? AND key_type_id = (SELECT id FROM key_types WHERE type_name = ?) AND key_name = ?";
 
-    auto stmt = db.prepare(sql);
+    auto stmt = db.prepare_cached(sql);
     if (stmt.is_err())
         return Err(ErrorCode::FAIL_UPDATE_KEY, "Failed to prepare statement to update key");
 
@@ -192,46 +301,81 @@ VoidResult update_key(DatabaseAccess& db, const std::string& module_name, KeyTyp
     return db.execute(stmt_ptr);
 }
 
-Result<std::vector<unsigned char>> get_key(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
-                                           const std::string& key_name) {
-    std::string key_query = "SELECT key_value FROM module_keys "
-                            "WHERE module_name = ? AND key_type_id = (SELECT id FROM key_types WHERE type_name = ?) "
-                            "AND key_name = ? AND is_active = 1";
-    auto key_stmt = db.prepare(key_query);
+VoidResult with_key_record(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
+                           const std::string& key_name, const KeyRecordView& view) {
+    static const std::string key_query =
+        "SELECT key_value, expires_at FROM module_keys "
+        "WHERE module_name = ? AND key_type_id = (SELECT id FROM key_types WHERE type_name = ?) "
+        "AND key_name = ? AND is_active = 1";
+    auto key_stmt = db.prepare_cached(key_query);
     if (key_stmt.is_err())
-        return Err<std::vector<unsigned char>>(ErrorCode::FAIL_GET_KEY, "Failed to prepare key query");
+        return Err(ErrorCode::FAIL_GET_KEY, "Failed to prepare key query");
 
     auto key_stmt_ptr = key_stmt.value();
 
     auto bind_result = db.bind_text(key_stmt_ptr, 1, module_name);
     if (bind_result.is_err())
-        return Err<std::vector<unsigned char>>(ErrorCode::FAIL_GET_KEY, "Failed to bind module_name");
+        return Err(ErrorCode::FAIL_GET_KEY, "Failed to bind module_name");
 
     const char* key_type_str = key_type_to_string(key_type);
     bind_result = db.bind_text(key_stmt_ptr, 2, key_type_str);
     if (bind_result.is_err())
-        return Err<std::vector<unsigned char>>(ErrorCode::FAIL_GET_KEY, "Failed to bind key_type");
+        return Err(ErrorCode::FAIL_GET_KEY, "Failed to bind key_type");
 
     bind_result = db.bind_text(key_stmt_ptr, 3, key_name);
     if (bind_result.is_err())
-        return Err<std::vector<unsigned char>>(ErrorCode::FAIL_GET_KEY, "Failed to bind key_name");
+        return Err(ErrorCode::FAIL_GET_KEY, "Failed to bind key_name");
 
-    sdbret_t key_result;
-    auto key_query_result = db.query(key_stmt_ptr, key_result);
-    if (key_query_result.is_err() || key_result.rows.empty()) {
-        return Err<std::vector<unsigned char>>(ErrorCode::KEY_NOT_FOUND, "Key not found");
+    bool found = false;
+    auto scan = db.for_each_row(key_stmt_ptr, [&](const SqlRow& row) {
+        std::chrono::system_clock::time_point expires_at;
+        if (!row.is_null(1)) {
+            expires_at = string_to_time_point(row.get_text(1).data());
+        }
+        view(row.get_blob(0), expires_at);
+        found = true;
+        return false;
+    });
+    if (scan.is_err() || !found) {
+        return Err(ErrorCode::KEY_NOT_FOUND, "Key not found");
     }
+    return Ok();
+}
+
+Result<std::vector<unsigned char>> get_key(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
+                                           const std::string& key_name) {
+    std::vector<unsigned char> value;
+    auto ret = with_key_record(db, module_name, key_type, key_name,
+                               [&value](SqlBlob blob, const std::chrono::system_clock::time_point&) {
+                                   value.assign(blob.data, blob.data + blob.size);
+                               });
+    if (ret.is_err()) {
+        return Err<std::vector<unsigned char>>(ret.error().code(), ret.error().message());
+    }
+    return Ok<std::vector<unsigned char>>(std::move(value));
+}
 
-    return Ok<std::vector<unsigned char>>(key_result.rows[0].columns[0].second);
+Result<KeyRecord> get_key_record(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
+                                 const std::string& key_name) {
+    KeyRecord record;
+    auto ret = with_key_record(db, module_name, key_type, key_name,
+                               [&record](SqlBlob blob, const std::chrono::system_clock::time_point& expires_at) {
+                                   record.value.assign(blob.data, blob.data + blob.size);
+                                   record.expires_at = expires_at;
+                               });
+    if (ret.is_err()) {
+        return Err<KeyRecord>(ret.error().code(), ret.error().message());
+    }
+    return Ok<KeyRecord>(std::move(record));
 }
 
 VoidResult remove_key(DatabaseAccess& db, const std::string& module_name, KeyType key_type,
                       const std::string& key_name) {
-    std::string sql =
+    static const std::string sql =
         "UPDATE module_keys SET is_active = 0 "
         "WHERE module_name = ? AND key_type_id = (SELECT id FROM key_types WHERE type_name = ?) AND key_name = ?";
 
-    auto stmt = db.prepare(sql);
+    auto stmt = db.prepare_cached(sql);
     if (stmt.is_err())
         return Err(ErrorCode::FAIL_REMOVE_KEY, "Failed to prepare statement to remove key");
 
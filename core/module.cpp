@@ -3,6 +3,8 @@
 #include "5thderror_handler.h"
 #include "5thdsql.h"
 #include "izmq.h"
+#include "key_store.h"
+#include "startup_profiler.h"
 
 bool KeysInfo::init() {
     bool ret = false;
@@ -41,62 +43,60 @@ void KeysInfo::deinit() {
     }
 }
 
-inline bool _get_zmq_curve_keys(DatabaseAccess& db, char* pub, char* prv, Clients id) {
+inline bool _get_zmq_curve_keys(KeyStore& keys, char* pub, char* prv, Clients id) {
     DEBUG("Attempting to retrieve existing keys");
-    auto public_key_result = get_key(db, CLIENTS_IDS[static_cast<int>(id)], KeyType::CURVE25519, "public_key");
-    auto private_key_result = get_key(db, CLIENTS_IDS[static_cast<int>(id)], KeyType::CURVE25519, "private_key");
-
-    if (public_key_result.is_err() || private_key_result.is_err()) {
+    // Copied straight from the store's secure memory into the caller's locked buffers (40 chars + NUL)
+    bool fits = true;
+    auto copy_to = [&fits](char* out) {
+        return [&fits, out](const unsigned char* data, size_t num_bytes) {
+            fits = fits && num_bytes <= 40;
+            if (fits) {
+                std::memcpy(out, data, num_bytes);
+            }
+        };
+    };
+    auto public_key_result =
+        keys.with_key(CLIENTS_IDS[static_cast<int>(id)], KeyType::CURVE25519, "public_key", copy_to(pub));
+    auto private_key_result =
+        keys.with_key(CLIENTS_IDS[static_cast<int>(id)], KeyType::CURVE25519, "private_key", copy_to(prv));
+
+    if (public_key_result.is_err() || private_key_result.is_err() || !fits) {
         DEBUG("Keys not found, generating new ones");
 
         return false;
     }
 
-    std::memcpy(pub, public_key_result.value().data(), public_key_result.value().size());
-    std::memcpy(prv, private_key_result.value().data(), private_key_result.value().size());
-
     return true;
 }
 
 inline bool _handle_keys(void* conf) {
     module_init_t* config = (module_init_t*) conf;
     bool ret = false;
-    DatabaseAccess db;
+    KeyStore& keys = KeyStore::shared();
 
     switch (config->keys_info.key_type) {
         case KeyType::CURVE25519:
             config->keys_info.init();
 
             // New keys needed
-            if (!_get_zmq_curve_keys(db, config->keys_info.curve_pub, config->keys_info.curve_prv, config->client_id)) {
+            if (!_get_zmq_curve_keys(keys, config->keys_info.curve_pub, config->keys_info.curve_prv, config->client_id)) {
                 if (generate_keys(config->keys_info.curve_pub, config->keys_info.curve_prv) != (int) ErrorCode::OK) {
                     ERROR("Fail o curve keys");
                     config->keys_info.deinit();
                     return ret;
                 } else {
-                    std::vector<unsigned char> pub(config->keys_info.curve_pub,
-                                                   config->keys_info.curve_pub
-                                                       + std::strlen(config->keys_info.curve_pub));
-                    std::vector<unsigned char> prv(config->keys_info.curve_prv,
-                                                   config->keys_info.curve_prv
-                                                       + std::strlen(config->keys_info.curve_prv));
-                    auto begin_result = db.begin_transaction();
-                    if (begin_result.is_err()) {
-                        ERROR("Failed to begin transaction: {}", begin_result.error().message());
-                        break;
-                    }
-                    auto write_pub = store_key(db, CLIENTS_IDS[static_cast<int>(config->client_id)],
-                                               config->keys_info.key_type, "public_key", pub);
-                    auto write_prv = store_key(db, CLIENTS_IDS[static_cast<int>(config->client_id)],
-                                               config->keys_info.key_type, "private_key", prv);
-                    if (write_prv.is_err() || write_prv.is_err()) {
-                        db.exec("ROLLBACK");
-                        ERROR("Error to write keys to db");
-                        break;
-                    }
-                    auto commit_ret = db.end_transaction();
-                    if (commit_ret.is_err()) {
-                        ERROR("Failed to commit transaction: {}", commit_ret.error().message());
+                    std::string module_name = CLIENTS_IDS[static_cast<int>(config->client_id)];
+                    const char* pub = config->keys_info.curve_pub;
+                    const char* prv = config->keys_info.curve_prv;
+                    // Both halves in one transaction, the pair is never stored half written
+                    std::vector<KeyWrite> pair{
+                        {module_name, config->keys_info.key_type, "public_key",
+                         std::vector<unsigned char>(pub, pub + std::strlen(pub))},
+                        {module_name, config->keys_info.key_type, "private_key",
+                         std::vector<unsigned char>(prv, prv + std::strlen(prv))}};
+                    auto write_ret = keys.store_batch(pair);
+                    if (write_ret.is_err()) {
+                        ERROR("Error to write keys to db: {}", write_ret.error().message());
                         break;
                     }
 
@@ -114,10 +114,12 @@ inline bool _handle_keys(void* conf) {
 }
 
 VoidResult module_init(module_init_t* config) {
-    Log::init();
+    StartupPhase phase("module.init");
+    Log::init(config->log);
     init_sodium();
     atomic_cb wrapped_callback = std::bind(_handle_keys, std::placeholders::_1);
 
+    StartupPhase keys_phase("module.keys");
     handle_atomic_opt(wrapped_callback, (void*) config);
     return Ok();
 }
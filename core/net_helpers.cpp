@@ -1,12 +1,10 @@
 #include "net_helpers.h"
 #include "5thderror_handler.h"
 #include "5thdlogger.h"
+#include "hash_helpers.h"
+#include "port_allocator.h"
 
-#include <openssl/err.h>
-#include <openssl/evp.h>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 #include <string>
 
 #include <arpa/inet.h>  //INET6_ADDRSTRLEN
@@ -32,42 +30,7 @@
 #endif
 
 std::string sha256(const std::string& str) {
-    unsigned char hash[EVP_MAX_MD_SIZE];  // Buffer to hold the hash
-    unsigned int hash_len;                // Length of the resulting hash
-
-    // Initialize OpenSSL's digest
-    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
-    if (mdctx == NULL) {
-        throw std::runtime_error("EVP_MD_CTX_new failed");
-    }
-
-    // Initialize the context for SHA-256
-    if (1 != EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL)) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("EVP_DigestInit_ex failed");
-    }
-
-    // Provide the data to be hashed
-    if (1 != EVP_DigestUpdate(mdctx, str.c_str(), str.size())) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("EVP_DigestUpdate failed");
-    }
-
-    // Finalize the hash
-    if (1 != EVP_DigestFinal_ex(mdctx, hash, &hash_len)) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("EVP_DigestFinal_ex failed");
-    }
-
-    // Clean up
-    EVP_MD_CTX_free(mdctx);
-
-    // Convert the hash to a hexadecimal string
-    std::stringstream ss;
-    for (unsigned int i = 0; i < hash_len; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << (int) hash[i];
-    }
-    return ss.str();
+    return sha256_hex(str);
 }
 
 // Callback function to handle response data
@@ -78,17 +41,21 @@ size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
     return size * nmemb;
 }
 
-std::string get_external_addr() {
+std::string get_external_addr(const std::string& url, long timeout_ms) {
     CURL *curl = curl_easy_init();
     std::string ip_address;
 
     if (curl) {
         // Set URL to fetch external IP
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.ipify.org");
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
         // Follow HTTP redirects if necessary
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
+        // Bound the wait, 0 keeps curl's own (none)
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
         // Response data callback
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
 
@@ -111,46 +78,22 @@ std::string get_external_addr() {
 }
 
 int is_port_available(int port) {
-    int _port = port;
-    int ret = -1;
-    sockaddr_in addr;
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-
-    if (sock == -1) {
-        ERROR("FAIL TO OPEN SOCKET FOR PORT DISCOVERY");
-        return ret;
+    auto& ports = PortAllocator::shared();
+    auto ret = port > 0 ? ports.reserve_in_range("127.0.0.1", port) : ports.reserve("127.0.0.1");
+    if (ret.is_err()) {
+        ERROR("Port discovery failed: {}", ret.error().message());
+        return -1;
     }
-
-    while (true) {
-        memset(&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-        addr.sin_port = htons(_port);
-
-        if (bind(sock, (struct sockaddr*) &addr, sizeof(addr)) == (int)ErrorCode::OK) {
-            ret = _port;
-            break;
-        } else {
-            _port++;
-            DEBUG("Checking next port {}", _port);
-            if (_port > 7110) {
-                return ret;
-            }
-        }
-    }
-    close(sock);
-    DEBUG("Chosen socket port {}", _port);
-    return _port;
+    DEBUG("Chosen socket port {}", ret.value());
+    return ret.value();
 }
 
-std::string get_local_ip() {
+std::string get_local_ip(const std::string& route_addr, int route_port) {
 #if defined(_WIN32) || defined(_WIN64)
     WSADATA wsaData;
     WSAStartup(MAKEWORD(2, 2), &wsaData);
 #endif
 
-    const char* googleDnsIp = "8.8.8.8";
-    uint16_t dnsPort = 53;
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
 
     if (sock < 0) {
@@ -163,8 +106,8 @@ std::string get_local_ip() {
     sockaddr_in serv;
     memset(&serv, 0, sizeof(serv));
     serv.sin_family = AF_INET;
-    serv.sin_addr.s_addr = inet_addr(googleDnsIp);
-    serv.sin_port = htons(dnsPort);
+    serv.sin_addr.s_addr = inet_addr(route_addr.c_str());
+    serv.sin_port = htons(static_cast<uint16_t>(route_port));
 
     int err = connect(sock, (const sockaddr*) &serv, sizeof(serv));
 
@@ -287,7 +230,8 @@ std::string get_iface_name(const std::string& local_addr) {
 #endif
 }
 
-bool set_port_forward(const std::string& external_ip, int external_port, const std::string& internal_ip, int internal_port, const std::string& description) {
+bool set_port_forward(int external_port, const std::string& internal_ip, int internal_port,
+                      const std::string& description, int discover_timeout_ms) {
     struct UPNPDev* devlist;
     struct UPNPUrls urls;
     struct IGDdatas data;
@@ -295,7 +239,7 @@ bool set_port_forward(const std::string& external_ip, int external_port, const s
     int error = -1;
 
     // Discover UPnP devices
-    devlist = upnpDiscover(2000, NULL, NULL, 0, 0, 2, &error);
+    devlist = upnpDiscover(discover_timeout_ms, NULL, NULL, 0, 0, 2, &error);
     if (!devlist) {
         ERROR("No UPnP devices found. Error code: {}", error);
         return false;
@@ -331,3 +275,36 @@ bool set_port_forward(const std::string& external_ip, int external_port, const s
 
     return (error == UPNPCOMMAND_SUCCESS);
 }
+
+void install_network_probes(NetProbe& probe) {
+    probe.set_probe(ProbeKind::LOCAL_IP, [](const NetProbeConfig& config) -> Result<std::string> {
+        std::string addr = get_local_ip(config.route_addr, config.route_port);
+        if (addr.empty()) {
+            return Err<std::string>(ErrorCode::SOCKET_CONNECT_FAIL, "No route to " + config.route_addr);
+        }
+        return Ok<std::string>(std::move(addr));
+    });
+    probe.set_probe(ProbeKind::EXTERNAL_IP, [](const NetProbeConfig& config) -> Result<std::string> {
+        std::string addr = get_external_addr(config.external_addr_url, config.http_timeout_ms);
+        if (addr.empty()) {
+            return Err<std::string>(ErrorCode::SOCKET_CONNECT_FAIL, "No answer from " + config.external_addr_url);
+        }
+        return Ok<std::string>(std::move(addr));
+    });
+    probe.set_probe(ProbeKind::PORT_FORWARD, [](const NetProbeConfig& config) -> Result<std::string> {
+        // The route lookup never leaves the host, no need to wait on the LOCAL_IP probe for it
+        std::string internal_ip = get_local_ip(config.route_addr, config.route_port);
+        if (internal_ip.empty() || config.forward_port == 0 ||
+            !set_port_forward(config.forward_port, internal_ip, config.forward_port, "5thD", config.upnp_timeout_ms)) {
+            return Err<std::string>(ErrorCode::FAIL_UPNP_FORWARD, "UPnP port forward failed");
+        }
+        return Ok<std::string>(std::to_string(config.forward_port));
+    });
+}
+
+NetProbe& network_probe() {
+    static NetProbe probe;
+    static bool installed = (install_network_probes(probe), true);
+    (void) installed;
+    return probe;
+}
@@ -0,0 +1,186 @@
+#include "net_probe.h"
+#include "5thdlogger.h"
+
+const char* probe_kind_to_string(ProbeKind kind) {
+    switch (kind) {
+        case ProbeKind::LOCAL_IP:
+            return "local_ip";
+        case ProbeKind::EXTERNAL_IP:
+            return "external_ip";
+        case ProbeKind::PORT_FORWARD:
+            return "port_forward";
+        default:
+            return "unknown";
+    }
+}
+
+NetProbe::NetProbe(NetProbeConfig config)
+    : _config(std::move(config)), _pool(static_cast<size_t>(ProbeKind::COUNT)) {}
+
+NetProbe::~NetProbe() {
+    // Nobody is left to take the answers, newer generations make the running probes drop them
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& slot : _slots) {
+        slot.generation++;
+        slot.relaunch = false;
+    }
+}
+
+void NetProbe::_drop_answer(Slot& slot) {
+    // running stays as is, the run in flight still owns the worker and clears it when it returns
+    slot.answered = false;
+    slot.generation++;
+}
+
+void NetProbe::set_probe(ProbeKind kind, Probe probe) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Slot& slot = _slot(kind);
+    slot.probe = std::move(probe);
+    _drop_answer(slot);
+}
+
+void NetProbe::set_config(NetProbeConfig config) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _config = std::move(config);
+    for (auto& slot : _slots) {
+        _drop_answer(slot);
+    }
+}
+
+NetProbeConfig NetProbe::config() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _config;
+}
+
+std::chrono::seconds NetProbe::_ttl(ProbeKind kind, bool ok) const {
+    if (!ok) {
+        return _config.failure_ttl;
+    }
+    switch (kind) {
+        case ProbeKind::LOCAL_IP:
+            return _config.local_ip_ttl;
+        case ProbeKind::EXTERNAL_IP:
+            return _config.external_ip_ttl;
+        default:
+            return _config.port_forward_ttl;
+    }
+}
+
+bool NetProbe::_fresh(const Slot& slot, std::chrono::steady_clock::time_point now) const {
+    return slot.answered && now < slot.deadline;
+}
+
+void NetProbe::_launch(ProbeKind kind) {
+    Slot& slot = _slot(kind);
+    if (!slot.probe) {
+        return;
+    }
+    if (slot.running) {
+        // Started before set_probe/set_config/invalidate, its answer is dropped: run again once it returns
+        slot.relaunch = true;
+        return;
+    }
+    slot.running = true;
+    slot.relaunch = false;
+    // The config is copied, set_config() may replace it while the probe runs
+    _pool.enqueue([this, kind, probe = slot.probe, generation = slot.generation, config = _config]() {
+        _run(kind, probe, generation, config);
+    });
+}
+
+void NetProbe::_run(ProbeKind kind, Probe probe, uint64_t generation, NetProbeConfig config) {
+    auto start = std::chrono::steady_clock::now();
+    // A throwing probe is a failed answer, escaping here would leave the kind running for good
+    Result<std::string> ret = Err<std::string>(ErrorCode::SOCKET_CONNECT_FAIL, "Probe threw");
+    try {
+        ret = probe(config);
+    } catch (const std::exception& e) {
+        ret = Err<std::string>(ErrorCode::SOCKET_CONNECT_FAIL, std::string("Probe threw: ") + e.what());
+    } catch (...) {
+        // ret still reports the throw
+    }
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Slot& slot = _slot(kind);
+    slot.running = false;
+    if (slot.generation != generation) {
+        if (slot.relaunch) {
+            _launch(kind);
+        }
+        return;
+    }
+    slot.relaunch = false;
+    slot.answered = true;
+    slot.ok = ret.is_ok();
+    if (slot.ok) {
+        slot.value = ret.value();
+        slot.code = ErrorCode::OK;
+        slot.error.clear();
+    } else {
+        slot.code = ret.error().code();
+        slot.error = ret.error().message();
+        _stats.failures++;
+    }
+    slot.deadline = now + _ttl(kind, slot.ok);
+    _stats.runs++;
+    DEBUG("Probe {} {} in {} ms", probe_kind_to_string(kind), slot.ok ? "answered" : "failed",
+          std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+    _answered.notify_all();
+}
+
+void NetProbe::start() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < static_cast<size_t>(ProbeKind::COUNT); ++i) {
+        auto kind = static_cast<ProbeKind>(i);
+        if (kind == ProbeKind::PORT_FORWARD && _config.forward_port == 0) {
+            continue;
+        }
+        if (!_fresh(_slots[i], now)) {
+            _launch(kind);
+        }
+    }
+}
+
+Result<std::string> NetProbe::get(ProbeKind kind, std::chrono::milliseconds wait) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    Slot& slot = _slot(kind);
+    auto now = std::chrono::steady_clock::now();
+    if (_fresh(slot, now)) {
+        _stats.hits++;
+    } else {
+        if (!slot.probe) {
+            return Err<std::string>(ErrorCode::NO_OBJECT, std::string("No probe for ") + probe_kind_to_string(kind));
+        }
+        _launch(kind);
+        bool done = _answered.wait_for(lock, wait, [&] { return _fresh(slot, std::chrono::steady_clock::now()); });
+        if (!done) {
+            if (!slot.answered) {
+                _stats.timeouts++;
+                return Err<std::string>(ErrorCode::SOCKET_TIMEOUT,
+                                        std::string("Probe ") + probe_kind_to_string(kind) + " still running");
+            }
+            _stats.stale_served++;
+        }
+    }
+    if (!slot.ok) {
+        return Err<std::string>(slot.code, slot.error);
+    }
+    return Ok<std::string>(slot.value);
+}
+
+bool NetProbe::fresh(ProbeKind kind) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _fresh(_slot(kind), std::chrono::steady_clock::now());
+}
+
+void NetProbe::invalidate(ProbeKind kind) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _drop_answer(_slot(kind));
+}
+
+NetProbeStats NetProbe::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
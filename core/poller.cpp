@@ -0,0 +1,287 @@
+#include <zmq.h>
+#include <algorithm>
+#include <cstdio>
+
+#include "5thdlogger.h"
+#include "poller.h"
+
+ZMQWPoller::~ZMQWPoller() {
+    _close();
+    DEBUG("Closed poller");
+}
+
+void ZMQWPoller::_init() {
+    auto ret = _create_wake_pair();
+    if (ret.is_err()) {
+        _error.handle_error(ret.error());
+        return;
+    }
+    _ready = true;
+}
+
+VoidResult ZMQWPoller::_create_wake_pair() {
+    char endpoint[64];
+    snprintf(endpoint, sizeof(endpoint), "inproc://poller-wake-%p", static_cast<void*>(this));
+
+    _wake_recv = zmq_socket(_ctx->get_context(), ZMQ_PAIR);
+    _wake_send = zmq_socket(_ctx->get_context(), ZMQ_PAIR);
+    if (!_wake_recv || !_wake_send) {
+        return Err(ErrorCode::FAIL_OPEN_SOCKET, "Failed to create poller wake sockets", Severity::HIGH);
+    }
+    if (zmq_bind(_wake_recv, endpoint) != (int) ErrorCode::OK
+        || zmq_connect(_wake_send, endpoint) != (int) ErrorCode::OK) {
+        return Err(ErrorCode::FAIL_BIND_SOCKET, "Failed to bind poller wake socket", Severity::HIGH);
+    }
+
+    // Slot 0 is always the wake socket
+    _items.push_back({_wake_recv, 0, ZMQ_POLLIN, 0});
+    _callbacks.emplace_back();
+    _sockets.push_back(nullptr);
+    return Ok();
+}
+
+void ZMQWPoller::_close() {
+    int linger = 0;
+    for (void* sock : {_wake_send, _wake_recv}) {
+        if (sock) {
+            zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(linger));
+            zmq_close(sock);
+        }
+    }
+    _wake_send = nullptr;
+    _wake_recv = nullptr;
+}
+
+bool ZMQWPoller::add(ISocket* socket, short events, std::function<void(void*)> callback) {
+    if (!socket || !socket->get_socket() || !callback) {
+        WARN("Poller: refusing to register null socket or callback");
+        return false;
+    }
+    if (!_ready) {
+        WARN("Poller: no wake sockets, refusing to register");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        _pending.push_back({socket, events, std::move(callback), true});
+        _queued++;
+    }
+    _registered.fetch_add(1, std::memory_order_relaxed);
+    wake();
+    return true;
+}
+
+bool ZMQWPoller::remove(ISocket* socket) {
+    if (!socket) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(_pending_mutex);
+    _pending.push_back({socket, 0, nullptr, false});
+    uint64_t ticket = ++_queued;
+
+    if (!_looping) {
+        // No loop owns the sockets, run() can't start while the lock is held
+        std::vector<Change> changes;
+        changes.swap(_pending);
+        _apply(changes);
+        _applied = ticket;
+        return true;
+    }
+    if (std::this_thread::get_id() == _loop_thread) {
+        // Called from a callback, the loop applies it before polling again
+        _local_change = true;
+        auto it = std::find(_sockets.begin() + 1, _sockets.end(), socket);
+        if (it != _sockets.end()) {
+            _items[it - _sockets.begin()].revents = 0;
+        }
+        return true;
+    }
+
+    lock.unlock();
+    wake();
+    lock.lock();
+    _applied_cv.wait(lock, [&] { return _applied >= ticket; });
+    return true;
+}
+
+void ZMQWPoller::wake() {
+    std::lock_guard<std::mutex> lock(_pending_mutex);
+    if (_wake_send) {
+        zmq_send(_wake_send, "", 0, ZMQ_DONTWAIT);
+    }
+}
+
+void ZMQWPoller::_drain_wake() {
+    char dummy;
+    while (zmq_recv(_wake_recv, &dummy, sizeof(dummy), ZMQ_DONTWAIT) != -1) {
+    }
+}
+
+void ZMQWPoller::_apply_pending() {
+    std::vector<Change> changes;
+    uint64_t upto;
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        changes.swap(_pending);
+        upto = _queued;
+    }
+    _apply(changes);
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        _applied = upto;
+    }
+    _applied_cv.notify_all();
+}
+
+void ZMQWPoller::_apply(std::vector<Change>& changes) {
+    for (auto& change : changes) {
+        auto it = std::find(_sockets.begin() + 1, _sockets.end(), change.socket);
+        if (change.add) {
+            if (it != _sockets.end()) {
+                // Re-register replaces events and callback
+                size_t index = it - _sockets.begin();
+                _items[index].events = change.events;
+                _callbacks[index] = std::move(change.callback);
+                _registered.fetch_sub(1, std::memory_order_relaxed);
+                continue;
+            }
+            _items.push_back({change.socket->get_socket(), 0, change.events, 0});
+            _callbacks.push_back(std::move(change.callback));
+            _sockets.push_back(change.socket);
+        } else if (it != _sockets.end()) {
+            // swap with last, order of dispatch doesn't matter
+            size_t index = it - _sockets.begin();
+            std::swap(_items[index], _items.back());
+            std::swap(_callbacks[index], _callbacks.back());
+            std::swap(_sockets[index], _sockets.back());
+            _items.pop_back();
+            _callbacks.pop_back();
+            _sockets.pop_back();
+            _registered.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ZMQWPoller::run(std::atomic<bool>* until) {
+    if (!_ready) {
+        ERROR("Poller has no wake sockets, not running");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        _looping = true;
+        _loop_thread = std::this_thread::get_id();
+    }
+    DEBUG("Poller loop started");
+    _apply_pending();
+
+    while (*until) {
+        int rc = zmq_poll(_items.data(), static_cast<int>(_items.size()), _timeout_ms);
+
+        if (rc == (int) ErrorCode::OK) {
+            continue;
+        } else if (rc == -1) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+            ERROR("Error in zmq_poll {}", zmq_strerror(zmq_errno()));
+            break;
+        }
+
+        bool woke = _items[0].revents & ZMQ_POLLIN;
+        // Size is fixed for this round, add/remove only land in _apply_pending below
+        for (size_t i = 1; i < _items.size() && rc > 0; ++i) {
+            if (_items[i].revents) {
+                rc--;
+                _callbacks[i](_items[i].socket);
+            }
+        }
+
+        if (woke) {
+            _drain_wake();
+        }
+        if (woke || _local_change) {
+            _local_change = false;
+            _apply_pending();
+        }
+    }
+
+    {
+        // Whatever was queued meanwhile is applied here, waiting removers return
+        std::lock_guard<std::mutex> lock(_pending_mutex);
+        std::vector<Change> changes;
+        changes.swap(_pending);
+        _apply(changes);
+        _applied = _queued;
+        _looping = false;
+        _loop_thread = std::thread::id();
+        _local_change = false;
+    }
+    _applied_cv.notify_all();
+    DEBUG("Poller loop ended");
+}
+
+// ================ Poller pool implementation ================
+
+ZMQWPollerPool::ZMQWPollerPool(IContext* ctx, size_t num_loops, long timeout_ms) {
+    num_loops = std::max<size_t>(num_loops, 1);
+    for (size_t i = 0; i < num_loops; ++i) {
+        _loops.push_back(std::make_unique<ZMQWPoller>(ctx, timeout_ms));
+    }
+}
+
+ZMQWPollerPool::~ZMQWPollerPool() {
+    stop();
+}
+
+bool ZMQWPollerPool::add(ISocket* socket, short events, std::function<void(void*)> callback) {
+    std::lock_guard<std::mutex> lock(_owner_mutex);
+    if (_owner.count(socket)) {
+        return _owner[socket]->add(socket, events, std::move(callback));
+    }
+    auto loop = std::min_element(_loops.begin(), _loops.end(), [](const auto& a, const auto& b) {
+        return a->num_sockets() < b->num_sockets();
+    });
+    if (!(*loop)->add(socket, events, std::move(callback))) {
+        return false;
+    }
+    _owner[socket] = loop->get();
+    return true;
+}
+
+bool ZMQWPollerPool::remove(ISocket* socket) {
+    ZMQWPoller* loop;
+    {
+        std::lock_guard<std::mutex> lock(_owner_mutex);
+        auto it = _owner.find(socket);
+        if (it == _owner.end()) {
+            return false;
+        }
+        loop = it->second;
+        _owner.erase(it);
+    }
+    // Waits for the loop, which may itself be in a callback calling add()
+    return loop->remove(socket);
+}
+
+void ZMQWPollerPool::start() {
+    if (_running.exchange(true)) {
+        return;
+    }
+    for (auto& loop : _loops) {
+        _threads.emplace_back([this, poller = loop.get()] { poller->run(&_running); });
+    }
+}
+
+void ZMQWPollerPool::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    for (auto& loop : _loops) {
+        loop->wake();
+    }
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+}
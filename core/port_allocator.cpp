@@ -0,0 +1,175 @@
+#include "port_allocator.h"
+#include <cstring>
+#include "5thdlogger.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#    include <winsock2.h>
+#    include <ws2tcpip.h>
+#    define close_socket closesocket
+#else
+#    include <arpa/inet.h>
+#    include <netinet/in.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+#    define close_socket close
+#endif
+
+PortAllocator& PortAllocator::shared() {
+    static PortAllocator allocator;
+    return allocator;
+}
+
+PortAllocator::~PortAllocator() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& port : _ports) {
+        if (port.second != CLAIMED) {
+            close_socket(port.second);
+        }
+    }
+    _ports.clear();
+}
+
+static bool parse_addr(const std::string& addr, sockaddr_storage& out, socklen_t& len) {
+    memset(&out, 0, sizeof(out));
+    auto* v4 = reinterpret_cast<sockaddr_in*>(&out);
+    if (addr.empty() || addr == "*" || addr == "0.0.0.0") {
+        v4->sin_family = AF_INET;
+        v4->sin_addr.s_addr = htonl(INADDR_ANY);
+        len = sizeof(sockaddr_in);
+        return true;
+    }
+    if (inet_pton(AF_INET, addr.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        len = sizeof(sockaddr_in);
+        return true;
+    }
+    auto* v6 = reinterpret_cast<sockaddr_in6*>(&out);
+    std::string host = addr.size() > 2 && addr.front() == '[' && addr.back() == ']' ? addr.substr(1, addr.size() - 2)
+                                                                                    : addr;
+    if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        len = sizeof(sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+static void set_port(sockaddr_storage& addr, int port) {
+    if (addr.ss_family == AF_INET) {
+        reinterpret_cast<sockaddr_in*>(&addr)->sin_port = htons(static_cast<uint16_t>(port));
+    } else {
+        reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port = htons(static_cast<uint16_t>(port));
+    }
+}
+
+// No SO_REUSEADDR: with it, any other SO_REUSEADDR socket could bind on top of the holder
+static int open_holder(const sockaddr_storage& addr) {
+    int sock = static_cast<int>(socket(addr.ss_family, SOCK_STREAM, 0));
+    if (sock < 0) {
+        return -1;
+    }
+    return sock;
+}
+
+Result<int> PortAllocator::reserve(const std::string& addr) {
+    sockaddr_storage bind_addr;
+    socklen_t len;
+    if (!parse_addr(addr, bind_addr, len)) {
+        return Err<int>(ErrorCode::FAIL_TO_BIND, "Port allocator needs a numeric address, got " + addr);
+    }
+    int sock = open_holder(bind_addr);
+    if (sock < 0) {
+        return Err<int>(ErrorCode::FAIL_OPEN_SOCKET, "Failed to open socket for port reservation");
+    }
+
+    set_port(bind_addr, 0);
+    sockaddr_storage bound;
+    socklen_t bound_len = sizeof(bound);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&bind_addr), len) != 0 ||
+        getsockname(sock, reinterpret_cast<sockaddr*>(&bound), &bound_len) != 0) {
+        close_socket(sock);
+        return Err<int>(ErrorCode::FAIL_TO_BIND, "Kernel did not hand out an ephemeral port");
+    }
+    int port = ntohs(bound.ss_family == AF_INET ? reinterpret_cast<sockaddr_in*>(&bound)->sin_port
+                                                : reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // The kernel cannot hand out a port a holder still owns, only one claimed earlier on
+    auto it = _ports.find(port);
+    if (it != _ports.end() && it->second != CLAIMED) {
+        close_socket(it->second);
+    }
+    _ports[port] = sock;
+    _stats.kernel_picks++;
+    DEBUG("Reserved port {}", port);
+    return Ok<int>(port);
+}
+
+Result<int> PortAllocator::reserve_in_range(const std::string& addr, int first, int last) {
+    if (first < PORT_MIN || last > PORT_MAX || first > last) {
+        return Err<int>(ErrorCode::FAIL_TO_BIND, "Invalid port range");
+    }
+    sockaddr_storage bind_addr;
+    socklen_t len;
+    if (!parse_addr(addr, bind_addr, len)) {
+        return Err<int>(ErrorCode::FAIL_TO_BIND, "Port allocator needs a numeric address, got " + addr);
+    }
+    int sock = open_holder(bind_addr);
+    if (sock < 0) {
+        return Err<int>(ErrorCode::FAIL_OPEN_SOCKET, "Failed to open socket for port discovery");
+    }
+
+    // A failed bind leaves the socket unbound, the same socket probes the next candidate
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int port = first; port <= last; ++port) {
+        if (_ports.count(port)) {
+            continue;
+        }
+        set_port(bind_addr, port);
+        _stats.probes++;
+        if (bind(sock, reinterpret_cast<sockaddr*>(&bind_addr), len) == 0) {
+            _ports[port] = sock;
+            _stats.range_picks++;
+            DEBUG("Reserved port {}", port);
+            return Ok<int>(port);
+        }
+    }
+    close_socket(sock);
+    return Err<int>(ErrorCode::FAIL_TO_BIND, "No free port in range");
+}
+
+void PortAllocator::claim(int port) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _ports.find(port);
+    if (it != _ports.end() && it->second != CLAIMED) {
+        close_socket(it->second);
+        it->second = CLAIMED;
+        _stats.claims++;
+    }
+}
+
+void PortAllocator::release(int port) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _ports.find(port);
+    if (it != _ports.end()) {
+        if (it->second != CLAIMED) {
+            close_socket(it->second);
+        }
+        _ports.erase(it);
+    }
+}
+
+bool PortAllocator::is_reserved(int port) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _ports.count(port) != 0;
+}
+
+size_t PortAllocator::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _ports.size();
+}
+
+PortAllocatorStats PortAllocator::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
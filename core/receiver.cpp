@@ -1,5 +1,6 @@
 #include <zmq.h>
 #include "receiver.h"
+#include "port_allocator.h"
 
 ZMQWReceiver::~ZMQWReceiver() {
     close();
@@ -41,11 +42,96 @@ void ZMQWReceiver::worker(std::atomic<bool>* until, std::function<void(void*)> c
     DEBUG("Polling ended");
 }
 
+void ZMQWReceiver::worker_batch(std::atomic<bool>* until, size_t max_batch,
+                                std::function<void(RecvBatch&)> callback) {
+    zmq_pollitem_t items[] = {{_socket->get_socket(), 0, ZMQ_POLLIN, 0}};
+    RecvBatch batch(max_batch);
+    bool drained = true;
+
+    DEBUG("Batch polling thread started");
+
+    while (*until) {
+        // Last drain hit max_batch, more is likely queued so skip the poll syscall
+        if (drained) {
+            auto ret = zmq_poll(items, 1, 500);  // Poll with 500 ms timeout
+
+            if (ret == (int) ErrorCode::OK) {
+                continue;
+            } else if (ret == -1) {
+                ERROR("Error in zmq_poll {}", zmq_strerror(zmq_errno()));
+                break;
+            }
+            if (!(items[0].revents & ZMQ_POLLIN)) {
+                continue;
+            }
+        }
+
+        while (!batch.full() && batch.recv_one(_socket->get_socket())) {
+        }
+        drained = !batch.full();
+
+        if (batch.size() > 0) {
+            callback(batch);
+        }
+        batch.clear();
+    }
+    DEBUG("Batch polling ended");
+}
+
+bool RecvBatch::recv_one(void* socket) {
+    size_t first = _used_frames;
+    int flags = ZMQ_DONTWAIT;
+
+    while (true) {
+        if (_used_frames == _frames.size()) {
+            _frames.emplace_back();
+        }
+        zmq_msg_t* part = &_frames[_used_frames];
+        zmq_msg_init(part);
+        if (zmq_msg_recv(part, socket, flags) == -1) {
+            zmq_msg_close(part);
+            if (zmq_errno() != EAGAIN) {
+                ERROR("Batch recv failed {}", zmq_strerror(zmq_errno()));
+            }
+            // Parts of a multipart message arrive together, so only the first frame can fail here
+            for (size_t i = first; i < _used_frames; ++i) {
+                zmq_msg_close(&_frames[i]);
+            }
+            _used_frames = first;
+            return false;
+        }
+        _used_frames++;
+        // Remaining parts are already queued, no need for DONTWAIT
+        flags = 0;
+        if (!zmq_msg_more(part)) {
+            break;
+        }
+    }
+    _messages.push_back({first, _used_frames - first});
+    return true;
+}
+
+void RecvBatch::clear() {
+    for (size_t i = 0; i < _used_frames; ++i) {
+        zmq_msg_close(&_frames[i]);
+    }
+    _used_frames = 0;
+    _messages.clear();
+}
+
 VoidResult ZMQWReceiver::_listen() {
     std::string endpoint;
     if (!_endpoint.empty()) {
         endpoint = _endpoint;
     } else {
+        if (_port == 0) {
+            // Kernel picked, startup does not scan past busy ports; get_port() reports the real one
+            auto reserved = PortAllocator::shared().reserve(_addr);
+            if (reserved.is_ok()) {
+                _port = reserved.value();
+                PortAllocator::shared().claim(_port);
+            }
+        }
         endpoint = "tcp://" + _addr + ":" + std::to_string(_port);
     }
 
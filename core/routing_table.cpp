@@ -0,0 +1,182 @@
+#include "routing_table.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    uint32_t reader_index() {
+        static std::atomic<uint32_t> next_index{0};
+        thread_local uint32_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    const Route* make_route(const void* identity, size_t num_bytes) {
+        auto route = new Route;
+        route->size = static_cast<uint8_t>(num_bytes);
+        memcpy(route->id, identity, num_bytes);
+        return route;
+    }
+}  // namespace
+
+RoutingTable::RoutingTable() {
+    for (auto& entry : _fixed) {
+        entry.store(nullptr, std::memory_order_relaxed);
+    }
+    for (auto& shard : _shards) {
+        shard.store(new DynamicMap(), std::memory_order_relaxed);
+    }
+}
+
+RoutingTable::~RoutingTable() {
+    for (auto& entry : _fixed) {
+        delete entry.load(std::memory_order_relaxed);
+    }
+    for (auto& shard : _shards) {
+        auto map = shard.load(std::memory_order_relaxed);
+        for (auto& kv : *map) {
+            delete kv.second;
+        }
+        delete map;
+    }
+    for (auto& retired : _retired) {
+        delete retired.route;
+        delete retired.map;
+    }
+}
+
+size_t RoutingTable::_shard_of(int client_id) {
+    return static_cast<uint32_t>(client_id) % ROUTING_SHARDS;
+}
+
+uint32_t RoutingTable::_enter() const {
+    uint32_t slot = reader_index();
+    if (slot < _readers.size()) {
+        _readers[slot].epoch.store(_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    } else {
+        // No private slot, hold reclamation off completely while reading
+        _overflow_readers.fetch_add(1, std::memory_order_seq_cst);
+    }
+    return slot;
+}
+
+void RoutingTable::_exit(uint32_t slot) const {
+    if (slot < _readers.size()) {
+        _readers[slot].epoch.store(0, std::memory_order_release);
+    } else {
+        _overflow_readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool RoutingTable::lookup(int client_id, Route& out) const {
+    bool found = false;
+    uint32_t slot = _enter();
+
+    const Route* route = nullptr;
+    if (client_id >= 0 && client_id < CLIENTS_TOTAL) {
+        route = _fixed[client_id].load(std::memory_order_seq_cst);
+    } else {
+        auto map = _shards[_shard_of(client_id)].load(std::memory_order_seq_cst);
+        auto it = map->find(client_id);
+        if (it != map->end()) {
+            route = it->second;
+        }
+    }
+    if (route) {
+        out.size = route->size;
+        memcpy(out.id, route->id, route->size);
+        found = true;
+    }
+
+    _exit(slot);
+    return found;
+}
+
+bool RoutingTable::update(int client_id, const void* identity, size_t num_bytes) {
+    if (!identity || num_bytes == 0 || num_bytes > ROUTE_ID_MAX_BYTES) {
+        return false;
+    }
+
+    // Fast path, no writer lock and no allocation when the identity is already known
+    Route current;
+    if (lookup(client_id, current) && current.equals(identity, num_bytes)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_writer_mutex);
+    auto route = make_route(identity, num_bytes);
+
+    if (client_id >= 0 && client_id < CLIENTS_TOTAL) {
+        auto old = _fixed[client_id].exchange(route, std::memory_order_seq_cst);
+        _retire(old, nullptr);
+    } else {
+        auto& shard = _shards[_shard_of(client_id)];
+        auto old_map = shard.load(std::memory_order_relaxed);
+        auto new_map = new DynamicMap(*old_map);
+        const Route* old_route = nullptr;
+        auto it = new_map->find(client_id);
+        if (it != new_map->end()) {
+            old_route = it->second;
+        }
+        (*new_map)[client_id] = route;
+        shard.store(new_map, std::memory_order_seq_cst);
+        _retire(old_route, old_map);
+    }
+    _reclaim();
+    return true;
+}
+
+bool RoutingTable::remove(int client_id) {
+    std::lock_guard<std::mutex> lock(_writer_mutex);
+
+    if (client_id >= 0 && client_id < CLIENTS_TOTAL) {
+        auto old = _fixed[client_id].exchange(nullptr, std::memory_order_seq_cst);
+        _retire(old, nullptr);
+        _reclaim();
+        return old != nullptr;
+    }
+
+    auto& shard = _shards[_shard_of(client_id)];
+    auto old_map = shard.load(std::memory_order_relaxed);
+    auto it = old_map->find(client_id);
+    if (it == old_map->end()) {
+        return false;
+    }
+    const Route* old_route = it->second;
+    auto new_map = new DynamicMap(*old_map);
+    new_map->erase(client_id);
+    shard.store(new_map, std::memory_order_seq_cst);
+    _retire(old_route, old_map);
+    _reclaim();
+    return true;
+}
+
+void RoutingTable::_retire(const Route* route, const DynamicMap* map) {
+    if (!route && !map) {
+        return;
+    }
+    // Readers that entered before this bump may still hold route/map
+    uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+    _retired.push_back({route, map, epoch});
+}
+
+void RoutingTable::_reclaim() {
+    if (_overflow_readers.load(std::memory_order_seq_cst) != 0) {
+        return;
+    }
+
+    uint64_t oldest_reader = std::numeric_limits<uint64_t>::max();
+    for (const auto& reader : _readers) {
+        uint64_t epoch = reader.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0) {
+            oldest_reader = std::min(oldest_reader, epoch);
+        }
+    }
+
+    auto freeable = [oldest_reader](const Retired& retired) { return retired.epoch < oldest_reader; };
+    for (auto& retired : _retired) {
+        if (freeable(retired)) {
+            delete retired.route;
+            delete retired.map;
+        }
+    }
+    _retired.erase(std::remove_if(_retired.begin(), _retired.end(), freeable), _retired.end());
+}
@@ -0,0 +1,47 @@
+#include "startup_profiler.h"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "5thdlogger.h"
+
+// Taken during static initialization, close enough to process start
+static const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
+
+static std::mutex phases_lock;
+static std::vector<StartupPhaseStats> recorded;
+
+void StartupProfiler::record(const char* phase, std::chrono::steady_clock::duration elapsed) {
+    std::lock_guard<std::mutex> lock(phases_lock);
+    for (auto& stats : recorded) {
+        if (stats.name == phase) {
+            stats.count++;
+            stats.total += elapsed;
+            return;
+        }
+    }
+    recorded.push_back({phase, 1, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)});
+}
+
+std::vector<StartupPhaseStats> StartupProfiler::phases() {
+    std::lock_guard<std::mutex> lock(phases_lock);
+    return recorded;
+}
+
+void StartupProfiler::report() {
+    const char* enabled = getenv("FIFTHD_STARTUP_PROFILE");
+    if (!enabled || strcmp(enabled, "1") != 0) {
+        return;
+    }
+    auto since_start = std::chrono::steady_clock::now() - process_start;
+    INFO("Startup profile, {:.3f} ms since process start:",
+         std::chrono::duration<double, std::milli>(since_start).count());
+    for (const auto& stats : phases()) {
+        INFO("  {:<16} {:>10.3f} ms  x{}", stats.name, std::chrono::duration<double, std::milli>(stats.total).count(),
+             stats.count);
+    }
+}
+
+void StartupProfiler::reset() {
+    std::lock_guard<std::mutex> lock(phases_lock);
+    recorded.clear();
+}
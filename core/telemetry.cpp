@@ -0,0 +1,575 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+    struct RetiredHistogram {
+        uint64_t buckets[TELEMETRY_HIST_BUCKETS] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+    };
+
+    struct Registry {
+        std::mutex lock;
+        std::vector<std::string> counters;
+        std::vector<std::string> gauges;
+        std::vector<std::string> histograms;
+        std::atomic<int64_t> gauge_cells[TELEMETRY_MAX_GAUGES] = {};
+        std::vector<TelemetrySlab*> slabs;
+        // What threads that already exited had recorded
+        uint64_t retired_counters[TELEMETRY_MAX_COUNTERS] = {};
+        std::unique_ptr<RetiredHistogram> retired_histograms[TELEMETRY_MAX_HISTOGRAMS];
+        uint64_t metrics_dropped = 0;  // Names refused because their table was full
+        TelemetryIdentity identity;
+    };
+
+    // Never destroyed, threads may still retire their slab while statics are torn down
+    Registry& registry() {
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    void retire(TelemetrySlab* slab) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.lock);
+        reg.slabs.erase(std::remove(reg.slabs.begin(), reg.slabs.end(), slab), reg.slabs.end());
+        for (size_t i = 0; i < TELEMETRY_MAX_COUNTERS; ++i) {
+            reg.retired_counters[i] += slab->counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < TELEMETRY_MAX_HISTOGRAMS; ++i) {
+            TelemetryHistogramSlab* hist = slab->histograms[i].load(std::memory_order_acquire);
+            if (!hist) {
+                continue;
+            }
+            if (!reg.retired_histograms[i]) {
+                reg.retired_histograms[i] = std::make_unique<RetiredHistogram>();
+            }
+            RetiredHistogram& out = *reg.retired_histograms[i];
+            for (size_t b = 0; b < TELEMETRY_HIST_BUCKETS; ++b) {
+                out.buckets[b] += hist->buckets[b].load(std::memory_order_relaxed);
+            }
+            out.count += hist->count.load(std::memory_order_relaxed);
+            out.sum += hist->sum.load(std::memory_order_relaxed);
+            out.min = std::min(out.min, hist->min.load(std::memory_order_relaxed));
+            out.max = std::max(out.max, hist->max.load(std::memory_order_relaxed));
+            delete hist;
+        }
+        delete slab;
+    }
+
+    // Records made by other thread_local destructors after the owner retired land here, unread
+    TelemetrySlab* sink_slab() {
+        static TelemetrySlab* sink = new TelemetrySlab();
+        return sink;
+    }
+
+    thread_local bool tls_retired = false;
+
+    struct SlabOwner {
+        TelemetrySlab* slab = nullptr;
+        ~SlabOwner() {
+            tls_retired = true;
+            tls_telemetry_slab = sink_slab();
+            if (slab) {
+                retire(slab);
+            }
+        }
+    };
+
+    // Called with reg.lock held
+    uint32_t find_or_add(Registry& reg, std::vector<std::string>& names, const char* name, size_t capacity,
+                         const char* kind) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        if (names.size() >= capacity) {
+            // The handle records nothing, said once here and counted in telemetry.metrics_dropped
+            if (reg.metrics_dropped++ == 0) {
+                fprintf(stderr, "telemetry: %s table is full (%zu), %s and later names record nothing\n", kind,
+                        capacity, name);
+            }
+            return static_cast<uint32_t>(capacity);
+        }
+        names.emplace_back(name);
+        return static_cast<uint32_t>(names.size() - 1);
+    }
+
+    uint64_t percentile(const uint64_t* buckets, uint64_t count, uint64_t max, double q) {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < TELEMETRY_HIST_BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                return std::min(telemetry_bucket_upper(b), max);
+            }
+        }
+        return max;
+    }
+}  // namespace
+
+const char* event_class_to_string(EventClass event_class) {
+    switch (event_class) {
+        case EventClass::METRIC:
+            return "metric";
+        case EventClass::TRACE:
+            return "trace";
+        case EventClass::EVENT:
+            return "event";
+        case EventClass::AUDIT:
+            return "audit";
+        case EventClass::ANOMALY:
+            return "anomaly";
+    }
+    return "event";
+}
+
+const char* event_severity_to_string(EventSeverity severity) {
+    switch (severity) {
+        case EventSeverity::DEBUG:
+            return "debug";
+        case EventSeverity::INFO:
+            return "info";
+        case EventSeverity::LOW:
+            return "low";
+        case EventSeverity::MEDIUM:
+            return "medium";
+        case EventSeverity::HIGH:
+            return "high";
+        case EventSeverity::CRITICAL:
+            return "critical";
+    }
+    return "info";
+}
+
+uint64_t telemetry_bucket_upper(uint32_t bucket) {
+    constexpr uint32_t linear = 1u << TELEMETRY_HIST_SUB_BITS;
+    if (bucket < linear) {
+        return bucket;
+    }
+    if (bucket >= TELEMETRY_HIST_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    uint32_t exp = (bucket >> TELEMETRY_HIST_SUB_BITS) + TELEMETRY_HIST_SUB_BITS - 1;
+    uint64_t sub = bucket & (linear - 1);
+    uint64_t width = uint64_t(1) << (exp - TELEMETRY_HIST_SUB_BITS);
+    return (uint64_t(1) << exp) + sub * width + width - 1;
+}
+
+TelemetrySlab* telemetry_register_slab() {
+    if (tls_retired) {
+        return sink_slab();
+    }
+    thread_local SlabOwner owner;
+    auto* slab = new TelemetrySlab();
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.lock);
+        reg.slabs.push_back(slab);
+    }
+    owner.slab = slab;
+    tls_telemetry_slab = slab;
+    return slab;
+}
+
+TelemetryHistogramSlab* telemetry_histogram_slab(TelemetrySlab* slab, uint32_t id) {
+    auto* hist = new TelemetryHistogramSlab();
+    // Published for snapshot(), only this thread ever stores the pointer
+    slab->histograms[id].store(hist, std::memory_order_release);
+    return hist;
+}
+
+Counter Telemetry::counter(const char* name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    return Counter(find_or_add(reg, reg.counters, name, TELEMETRY_MAX_COUNTERS, "counter"));
+}
+
+Gauge Telemetry::gauge(const char* name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    uint32_t id = find_or_add(reg, reg.gauges, name, TELEMETRY_MAX_GAUGES, "gauge");
+    return id < TELEMETRY_MAX_GAUGES ? Gauge(&reg.gauge_cells[id]) : Gauge();
+}
+
+Histogram Telemetry::histogram(const char* name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    return Histogram(find_or_add(reg, reg.histograms, name, TELEMETRY_MAX_HISTOGRAMS, "histogram"));
+}
+
+MetricsSnapshot Telemetry::snapshot() {
+    Registry& reg = registry();
+    MetricsSnapshot snapshot;
+    snapshot.taken_at = std::chrono::system_clock::now();
+
+    std::lock_guard<std::mutex> lock(reg.lock);
+    snapshot.counters.reserve(reg.counters.size() + 1);
+    for (size_t i = 0; i < reg.counters.size(); ++i) {
+        uint64_t total = reg.retired_counters[i];
+        for (TelemetrySlab* slab : reg.slabs) {
+            total += slab->counters[i].load(std::memory_order_relaxed);
+        }
+        snapshot.counters.push_back({reg.counters[i], total});
+    }
+    // Kept outside the counter table, it has to work when that table is the full one
+    snapshot.counters.push_back({"telemetry.metrics_dropped", reg.metrics_dropped});
+
+    snapshot.gauges.reserve(reg.gauges.size());
+    for (size_t i = 0; i < reg.gauges.size(); ++i) {
+        snapshot.gauges.push_back({reg.gauges[i], reg.gauge_cells[i].load(std::memory_order_relaxed)});
+    }
+
+    snapshot.histograms.reserve(reg.histograms.size());
+    std::vector<uint64_t> buckets(TELEMETRY_HIST_BUCKETS);
+    for (size_t i = 0; i < reg.histograms.size(); ++i) {
+        HistogramSample sample;
+        sample.name = reg.histograms[i];
+        uint64_t min = UINT64_MAX;
+        std::fill(buckets.begin(), buckets.end(), 0);
+        if (const RetiredHistogram* retired = reg.retired_histograms[i].get()) {
+            std::copy(retired->buckets, retired->buckets + TELEMETRY_HIST_BUCKETS, buckets.begin());
+            sample.count = retired->count;
+            sample.sum = retired->sum;
+            min = retired->min;
+            sample.max = retired->max;
+        }
+        for (TelemetrySlab* slab : reg.slabs) {
+            TelemetryHistogramSlab* hist = slab->histograms[i].load(std::memory_order_acquire);
+            if (!hist) {
+                continue;
+            }
+            for (size_t b = 0; b < TELEMETRY_HIST_BUCKETS; ++b) {
+                buckets[b] += hist->buckets[b].load(std::memory_order_relaxed);
+            }
+            sample.count += hist->count.load(std::memory_order_relaxed);
+            sample.sum += hist->sum.load(std::memory_order_relaxed);
+            min = std::min(min, hist->min.load(std::memory_order_relaxed));
+            sample.max = std::max(sample.max, hist->max.load(std::memory_order_relaxed));
+        }
+        if (sample.count) {
+            // Buckets and count are read apart, rank against what the buckets hold
+            uint64_t in_buckets = 0;
+            for (uint64_t n : buckets) {
+                in_buckets += n;
+            }
+            sample.min = min;
+            sample.p50 = percentile(buckets.data(), in_buckets, sample.max, 0.50);
+            sample.p90 = percentile(buckets.data(), in_buckets, sample.max, 0.90);
+            sample.p99 = percentile(buckets.data(), in_buckets, sample.max, 0.99);
+            sample.p999 = percentile(buckets.data(), in_buckets, sample.max, 0.999);
+        }
+        snapshot.histograms.push_back(std::move(sample));
+    }
+    return snapshot;
+}
+
+void Telemetry::set_identity(std::string node_id, std::string process) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    reg.identity.node_id = std::move(node_id);
+    reg.identity.process = std::move(process);
+}
+
+TelemetryIdentity Telemetry::identity() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.lock);
+    return reg.identity;
+}
+
+TelemetryEvent audit_event(std::string name, std::string component, const std::string& actor_id,
+                           const std::string& actor_type, const std::string& target, const std::string& action,
+                           const std::string& decision, const std::string& reason) {
+    TelemetryEvent event(EventClass::AUDIT, std::move(name), EventSeverity::INFO, std::move(component));
+    event.outcome = decision;
+    event.field("actor_id", actor_id)
+        .field("actor_type", actor_type)
+        .field("target", target)
+        .field("action", action)
+        .field("decision", decision)
+        .field("reason", reason);
+    return event;
+}
+
+// ULID: 48 bit unix ms then 80 random bits, 26 Crockford base32 chars, sorts by time
+static std::string make_event_id(std::chrono::system_clock::time_point ts) {
+    static const char CROCKFORD[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+    thread_local std::mt19937_64 rng(std::random_device{}() ^
+                                     std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    uint64_t ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count());
+    uint64_t hi = (ms << 16) | (rng() & 0xFFFF);
+    uint64_t lo = rng();
+
+    std::string id(26, '0');
+    for (int i = 25; i >= 0; --i) {
+        id[i] = CROCKFORD[lo & 31];
+        lo = (lo >> 5) | (hi << 59);
+        hi >>= 5;
+    }
+    return id;
+}
+
+static void append_utc(std::string& out, std::chrono::system_clock::time_point ts) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count();
+    time_t seconds = static_cast<time_t>(ms / 1000);
+    std::tm tm{};
+#if defined(_WIN32) || defined(_WIN64)
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900, tm.tm_mon + 1,
+             tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ms % 1000));
+    out.append(buffer);
+}
+
+static void append_json_string(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out.append(escaped);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+static void append_member(std::string& out, const char* key, const std::string& value, bool nullable) {
+    out.push_back('"');
+    out.append(key);
+    out.append("\":");
+    if (nullable && value.empty()) {
+        out.append("null");
+    } else {
+        append_json_string(out, value);
+    }
+    out.push_back(',');
+}
+
+std::string telemetry_to_json(const TelemetryEvent& event, const TelemetryIdentity& identity) {
+    std::string out;
+    out.reserve(256 + 32 * event.fields.size());
+    out.push_back('{');
+    append_member(out, "event_id", event.event_id, false);
+    out.append("\"ts_utc\":\"");
+    append_utc(out, event.ts);
+    out.append("\",");
+    append_member(out, "class", event_class_to_string(event.event_class), false);
+    append_member(out, "name", event.name, false);
+    append_member(out, "severity", event_severity_to_string(event.severity), false);
+    append_member(out, "node_id", identity.node_id, true);
+    append_member(out, "process", identity.process, true);
+    append_member(out, "component", event.component, true);
+    append_member(out, "module_id", event.module_id, true);
+    append_member(out, "peer_id", event.peer_id, true);
+    append_member(out, "session_id", event.session_id, true);
+    append_member(out, "trace_id", event.trace_id, true);
+    append_member(out, "span_id", event.span_id, true);
+    append_member(out, "outcome", event.outcome, true);
+    out.append("\"fields\":{");
+    for (size_t i = 0; i < event.fields.size(); ++i) {
+        const TelemetryField& field = event.fields[i];
+        if (i) {
+            out.push_back(',');
+        }
+        append_json_string(out, field.key);
+        out.push_back(':');
+        if (field.number) {
+            out.append(field.value);
+        } else {
+            append_json_string(out, field.value);
+        }
+    }
+    out.append("}}");
+    return out;
+}
+
+void JsonLinesExporter::export_batch(const std::vector<TelemetryEvent>& events, const MetricsSnapshot& metrics,
+                                     const TelemetryIdentity& identity) {
+    for (const auto& event : events) {
+        std::string line = telemetry_to_json(event, identity);
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), _out);
+    }
+
+    TelemetryEvent sample(EventClass::METRIC, "", EventSeverity::DEBUG, "telemetry");
+    sample.ts = metrics.taken_at;
+    auto write_sample = [&]() {
+        sample.event_id = make_event_id(sample.ts);
+        std::string line = telemetry_to_json(sample, identity);
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), _out);
+        sample.fields.clear();
+    };
+    for (const auto& counter : metrics.counters) {
+        sample.name = counter.name;
+        sample.field("value", counter.value);
+        write_sample();
+    }
+    for (const auto& gauge : metrics.gauges) {
+        sample.name = gauge.name;
+        sample.field("value", gauge.value);
+        write_sample();
+    }
+    for (const auto& hist : metrics.histograms) {
+        sample.name = hist.name;
+        sample.field("count", hist.count)
+            .field("sum", hist.sum)
+            .field("min", hist.min)
+            .field("max", hist.max)
+            .field("p50", hist.p50)
+            .field("p90", hist.p90)
+            .field("p99", hist.p99)
+            .field("p999", hist.p999);
+        write_sample();
+    }
+    fflush(_out);
+}
+
+namespace {
+    struct Pipeline {
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable flushed;
+        std::vector<TelemetryEvent> queue;
+        std::unique_ptr<TelemetryExporter> exporter;
+        std::chrono::milliseconds interval{TELEMETRY_FLUSH_MS};
+        std::thread thread;
+        bool running = false;
+        bool stopping = false;
+        uint64_t flush_requests = 0;
+        uint64_t flushes_done = 0;
+        TelemetryStats stats;
+
+        ~Pipeline() { Telemetry::stop(); }
+    };
+
+    Pipeline& pipeline() {
+        static Pipeline instance;
+        return instance;
+    }
+
+    void export_loop(Pipeline& p) {
+        std::unique_lock<std::mutex> lock(p.lock);
+        std::vector<TelemetryEvent> batch;
+        while (true) {
+            p.wake.wait_for(lock, p.interval, [&p] {
+                return p.stopping || p.flush_requests != p.flushes_done || p.queue.size() >= TELEMETRY_EVENT_QUEUE / 2;
+            });
+            bool last = p.stopping;
+            uint64_t requested = p.flush_requests;
+            batch.swap(p.queue);
+            lock.unlock();
+
+            // Export runs unlocked, emit() keeps queuing meanwhile
+            MetricsSnapshot metrics = Telemetry::snapshot();
+            p.exporter->export_batch(batch, metrics, Telemetry::identity());
+
+            lock.lock();
+            p.stats.exported += batch.size();
+            p.stats.batches++;
+            batch.clear();
+            p.flushes_done = requested;
+            p.flushed.notify_all();
+            if (last) {
+                return;
+            }
+        }
+    }
+}  // namespace
+
+void Telemetry::emit(TelemetryEvent event) {
+    event.ts = std::chrono::system_clock::now();
+    event.event_id = make_event_id(event.ts);
+
+    Pipeline& p = pipeline();
+    std::lock_guard<std::mutex> lock(p.lock);
+    if (p.queue.size() >= TELEMETRY_EVENT_QUEUE) {
+        p.stats.dropped++;
+        return;
+    }
+    p.queue.push_back(std::move(event));
+    p.stats.emitted++;
+    if (p.running && p.queue.size() == TELEMETRY_EVENT_QUEUE / 2) {
+        p.wake.notify_one();
+    }
+}
+
+void Telemetry::start(std::unique_ptr<TelemetryExporter> exporter, std::chrono::milliseconds interval) {
+    stop();
+    Pipeline& p = pipeline();
+    std::lock_guard<std::mutex> lock(p.lock);
+    p.exporter = std::move(exporter);
+    p.interval = interval;
+    p.running = true;
+    p.thread = std::thread(export_loop, std::ref(p));
+}
+
+void Telemetry::flush() {
+    Pipeline& p = pipeline();
+    std::unique_lock<std::mutex> lock(p.lock);
+    if (!p.running || p.stopping) {
+        return;
+    }
+    uint64_t ticket = ++p.flush_requests;
+    p.wake.notify_one();
+    p.flushed.wait(lock, [&p, ticket] { return p.flushes_done >= ticket || !p.running; });
+}
+
+void Telemetry::stop() {
+    Pipeline& p = pipeline();
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(p.lock);
+        if (!p.running || p.stopping) {
+            return;
+        }
+        p.stopping = true;
+        thread = std::move(p.thread);
+    }
+    p.wake.notify_one();
+    thread.join();
+
+    std::lock_guard<std::mutex> lock(p.lock);
+    p.running = false;
+    p.stopping = false;
+    p.exporter.reset();
+    p.flushed.notify_all();
+}
+
+TelemetryStats Telemetry::stats() {
+    Pipeline& p = pipeline();
+    std::lock_guard<std::mutex> lock(p.lock);
+    return p.stats;
+}
@@ -1,41 +1,130 @@
 #include "thread_pool.h"
 
-ThreadPool::ThreadPool(size_t numThreads) : stop(false) {
+// Worker identity of the calling thread, lets tasks submitted from a task stay local
+static thread_local const ThreadPool* tls_pool = nullptr;
+static thread_local size_t tls_index = 0;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _workers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    // Start only once every deque exists, workers steal from all of them
     for (size_t i = 0; i < numThreads; ++i) {
-        workers.emplace_back([this] {
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(this->queueMutex);
-                    this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-                    if (this->stop && this->tasks.empty()) {
-                        return;
-                    }
-                    task = std::move(this->tasks.front());
-                    this->tasks.pop();
-                }
-                task();
-            }
-        });
+        _workers[i]->thread = std::thread(&ThreadPool::_worker_loop, this, i);
     }
 }
 
 ThreadPool::~ThreadPool() {
     {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        stop = true;
+        std::lock_guard<std::mutex> lock(_sleep_lock);
+        _stop.store(true);
     }
-    condition.notify_all();
-    for (std::thread& worker : workers) {
-        worker.join();
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        worker->thread.join();
+    }
+}
+
+size_t ThreadPool::_home() {
+    if (tls_pool == this) {
+        return tls_index;
     }
+    return _next.fetch_add(1, std::memory_order_relaxed) % _workers.size();
 }
 
-template <class F, class... Args>
-void ThreadPool::enqueue(F&& f, Args&&... args) {
+void ThreadPool::_push(PoolTask&& task) {
+    Worker& worker = *_workers[_home()];
+    _pending.fetch_add(1);
     {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        tasks.emplace(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::lock_guard<std::mutex> lock(worker.lock);
+        worker.tasks.push_back(std::move(task));
+    }
+    _notify(1);
+}
+
+void ThreadPool::_push_bulk(std::vector<PoolTask>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    size_t n = _workers.size();
+    size_t slice = (tasks.size() + n - 1) / n;
+    size_t start = _home();
+
+    _pending.fetch_add(tasks.size());
+    for (size_t lo = 0, k = 0; lo < tasks.size(); lo += slice, ++k) {
+        size_t hi = std::min(lo + slice, tasks.size());
+        Worker& worker = *_workers[(start + k) % n];
+        std::lock_guard<std::mutex> lock(worker.lock);
+        for (size_t i = lo; i < hi; ++i) {
+            worker.tasks.push_back(std::move(tasks[i]));
+        }
+    }
+    _notify(tasks.size());
+    tasks.clear();
+}
+
+bool ThreadPool::_pop(size_t self, PoolTask& out) {
+    Worker& worker = *_workers[self];
+    std::lock_guard<std::mutex> lock(worker.lock);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    out = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    _pending.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::_steal(size_t self, PoolTask& out) {
+    size_t n = _workers.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker& victim = *_workers[(self + k) % n];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            out = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            _pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::_notify(size_t count) {
+    // Pairs with the _idle increment in _worker_loop: either the sleeper sees _pending or we see it idle
+    if (_idle.load() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_sleep_lock);
+    if (count == 1) {
+        _wake.notify_one();
+    } else {
+        _wake.notify_all();
+    }
+}
+
+void ThreadPool::_worker_loop(size_t self) {
+    tls_pool = this;
+    tls_index = self;
+
+    PoolTask task;
+    while (true) {
+        if (_pop(self, task) || _steal(self, task)) {
+            task();
+            task = PoolTask();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleep_lock);
+        _idle.fetch_add(1);
+        _wake.wait(lock, [this] { return _stop.load() || _pending.load() > 0; });
+        _idle.fetch_sub(1);
+        if (_stop.load() && _pending.load() == 0) {
+            return;
+        }
     }
-    condition.notify_one();
 }
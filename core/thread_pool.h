@@ -1,32 +1,297 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
 #include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#define POOL_TASK_INLINE_BYTES 48
+
+/**
+ * @brief Move-only void() callable. Callables up to POOL_TASK_INLINE_BYTES are stored inline, so
+ * queuing a small lambda does not touch the heap. Unlike std::function it also holds move-only
+ * captures such as std::packaged_task.
+ */
+class PoolTask {
+public:
+    PoolTask() = default;
+
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, PoolTask>>>
+    PoolTask(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (fits_inline<Fn>) {
+            new (_storage) Fn(std::forward<F>(f));
+            _ops = &inline_ops<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(_storage) = new Fn(std::forward<F>(f));
+            _ops = &heap_ops<Fn>;
+        }
+    }
+
+    PoolTask(PoolTask&& other) noexcept { _take(other); }
+
+    PoolTask& operator=(PoolTask&& other) noexcept {
+        if (this != &other) {
+            _reset();
+            _take(other);
+        }
+        return *this;
+    }
+
+    PoolTask(const PoolTask&) = delete;
+    PoolTask& operator=(const PoolTask&) = delete;
+
+    ~PoolTask() { _reset(); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    void operator()() { _ops->invoke(_storage); }
+
+    /**
+     * @brief true when the callable did not fit inline.
+     */
+    bool on_heap() const { return _ops && _ops->heap; }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void*);
+        bool heap;
+    };
+
+    template <class F>
+    static constexpr bool fits_inline = sizeof(F) <= POOL_TASK_INLINE_BYTES &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+    template <class F>
+    static void inline_invoke(void* p) {
+        (*static_cast<F*>(p))();
+    }
+    template <class F>
+    static void inline_relocate(void* dst, void* src) {
+        new (dst) F(std::move(*static_cast<F*>(src)));
+        static_cast<F*>(src)->~F();
+    }
+    template <class F>
+    static void inline_destroy(void* p) {
+        static_cast<F*>(p)->~F();
+    }
+
+    template <class F>
+    static void heap_invoke(void* p) {
+        (**static_cast<F**>(p))();
+    }
+    template <class F>
+    static void heap_relocate(void* dst, void* src) {
+        *static_cast<F**>(dst) = *static_cast<F**>(src);
+    }
+    template <class F>
+    static void heap_destroy(void* p) {
+        delete *static_cast<F**>(p);
+    }
+
+    template <class F>
+    static constexpr Ops inline_ops = {inline_invoke<F>, inline_relocate<F>, inline_destroy<F>, false};
+    template <class F>
+    static constexpr Ops heap_ops = {heap_invoke<F>, heap_relocate<F>, heap_destroy<F>, true};
+
+    alignas(std::max_align_t) unsigned char _storage[POOL_TASK_INLINE_BYTES];
+    const Ops* _ops = nullptr;
+
+    void _take(PoolTask& other) noexcept {
+        if (other._ops) {
+            other._ops->relocate(_storage, other._storage);
+            _ops = other._ops;
+            other._ops = nullptr;
+        }
+    }
+
+    void _reset() noexcept {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+};
+
+/**
+ * @brief Work stealing pool. Every worker owns a deque, it pops its own work LIFO (cache warm) and
+ * steals FIFO from the others when it runs dry. Tasks submitted from a worker stay on that
+ * worker, tasks from outside are spread round robin, idle workers sleep on one condvar.
+ * The destructor runs every task already queued before joining.
+ */
 class ThreadPool {
 public:
-    ThreadPool(size_t numThreads);
+    /**
+     * @brief numThreads 0 picks std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(size_t numThreads);
     ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
+    size_t size() const { return _workers.size(); }
+
+    /**
+     * @brief Fire and forget, an exception escaping f terminates like on any std::thread.
+     */
     template <class F, class... Args>
-    void enqueue(F&& f, Args&&... args);
+    void enqueue(F&& f, Args&&... args) {
+        _push(PoolTask(_bind(std::forward<F>(f), std::forward<Args>(args)...)));
+    }
+
+    /**
+     * @brief Run f(args...) on the pool, the result or exception is delivered through the future.
+     */
+    template <class F, class... Args>
+    auto submit(F&& f, Args&&... args) {
+        using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        std::packaged_task<R()> task(_bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::future<R> result = task.get_future();
+        _push(PoolTask(std::move(task)));
+        return result;
+    }
+
+    /**
+     * @brief submit() for a range of callables taking no arguments, the tasks are handed to the
+     * workers in one contiguous slice each (one lock per worker, not per task).
+     */
+    template <class It>
+    auto submit_bulk(It first, It last) {
+        using R = std::invoke_result_t<typename std::iterator_traits<It>::value_type&>;
+        std::vector<std::future<R>> results;
+        std::vector<PoolTask> tasks;
+        results.reserve(std::distance(first, last));
+        tasks.reserve(results.capacity());
+        for (; first != last; ++first) {
+            std::packaged_task<R()> task(*first);
+            results.push_back(task.get_future());
+            tasks.emplace_back(std::move(task));
+        }
+        _push_bulk(tasks);
+        return results;
+    }
+
+    /**
+     * @brief fn(i) for every i in [begin, end), blocks until done and rethrows the first exception.
+     * The range is cut in chunks of grain indices (0 = about 4 chunks per worker). The calling
+     * thread works on chunks too, so calling this from inside a task does not deadlock.
+     */
+    template <class Index, class F>
+    void parallel_for(Index begin, Index end, F&& fn, Index grain = 0) {
+        static_assert(std::is_integral_v<Index>, "parallel_for needs an integral index");
+        if (end <= begin) {
+            return;
+        }
+        size_t count = static_cast<size_t>(end - begin);
+        size_t chunk = grain > 0 ? static_cast<size_t>(grain) : std::max<size_t>(1, count / (size() * 4));
+
+        auto state = std::make_shared<ForState>();
+        state->count = count;
+        state->chunk = chunk;
+        state->chunks = (count + chunk - 1) / chunk;
+
+        auto* body = &fn;
+        auto run = [state, body, begin]() {
+            size_t c;
+            while ((c = state->next.fetch_add(1)) < state->chunks) {
+                size_t lo = c * state->chunk;
+                size_t hi = std::min(lo + state->chunk, state->count);
+                try {
+                    for (size_t i = lo; i < hi; ++i) {
+                        (*body)(static_cast<Index>(begin + static_cast<Index>(i)));
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    if (!state->error) {
+                        state->error = std::current_exception();
+                    }
+                }
+                if (state->done.fetch_add(1) + 1 == state->chunks) {
+                    std::lock_guard<std::mutex> lock(state->lock);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        std::vector<PoolTask> helpers;
+        size_t num_helpers = std::min(size(), state->chunks - 1);
+        helpers.reserve(num_helpers);
+        for (size_t i = 0; i < num_helpers; ++i) {
+            helpers.emplace_back(run);
+        }
+        _push_bulk(helpers);
+
+        run();
+        std::unique_lock<std::mutex> lock(state->lock);
+        state->finished.wait(lock, [&state] { return state->done.load() == state->chunks; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
 
 private:
-    // Need to keep track of threads so we can join them
-    std::vector<std::thread> workers;
+    struct alignas(64) Worker {
+        std::mutex lock;
+        std::deque<PoolTask> tasks;
+        std::thread thread;
+    };
+
+    struct ForState {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        size_t chunk = 0;
+        size_t chunks = 0;
+        std::mutex lock;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
 
-    // The task queue
-    std::queue<std::function<void()>> tasks;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Tasks sitting in any deque, counted before they are pushed
+    std::atomic<size_t> _pending{0};
+    std::atomic<size_t> _idle{0};
+    std::atomic<size_t> _next{0};
+    std::atomic<bool> _stop{false};
+
+    std::mutex _sleep_lock;
+    std::condition_variable _wake;
+
+    template <class F, class... Args>
+    static auto _bind(F&& f, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0) {
+            return std::decay_t<F>(std::forward<F>(f));
+        } else {
+            return [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(f, args);
+            };
+        }
+    }
 
-    // Synchronization
-    std::mutex queueMutex;
-    std::condition_variable condition;
-    bool stop;
+    size_t _home();
+    void _push(PoolTask&& task);
+    void _push_bulk(std::vector<PoolTask>& tasks);
+    bool _pop(size_t self, PoolTask& out);
+    bool _steal(size_t self, PoolTask& out);
+    void _notify(size_t count);
+    void _worker_loop(size_t self);
 };
 
 #endif /* THREAD_POOL_H */
@@ -2,10 +2,12 @@
 #include <features.h>
 #include <zmq.h>
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include "5thderror_handler.h"
 #include "5thdipcmsg.h"
 #include "5thdlogger.h"
+#include "ipc_trace.h"
 
 #define DEFAULT_DATA_CHUNK sizeof(ipc_msg_t)
 
@@ -15,6 +17,11 @@ ZMQWTransmitter::~ZMQWTransmitter() {
 
 void ZMQWTransmitter::_init() {
     zmq_setsockopt(_socket->get_socket(), ZMQ_IDENTITY, _identity.c_str(), _identity.size());
+    _refresh_snd_hwm();
+
+    _tm_sent = Telemetry::counter("transmitter.messages");
+    _tm_bytes = Telemetry::counter("transmitter.bytes");
+    _tm_failed = Telemetry::counter("transmitter.send_failures");
 
     _drp.register_recovery_action(ErrorCode::SOCKET_CONNECT_FAIL, [this]() { return _handle_connect(); });
 }
@@ -79,7 +86,11 @@ void ZMQWTransmitter::worker(std::atomic<bool>* until, std::function<void(void*)
 }
 
 int ZMQWTransmitter::set_sockopt(int option_name, const void* option_value, size_t option_len) {
-    return zmq_setsockopt(_socket->get_socket(), option_name, option_value, option_len);
+    int rc = zmq_setsockopt(_socket->get_socket(), option_name, option_value, option_len);
+    if (rc == 0 && option_name == ZMQ_SNDHWM) {
+        _refresh_snd_hwm();
+    }
+    return rc;
 }
 
 bool ZMQWTransmitter::connect(const std::string& ip, int port) {
@@ -96,64 +107,235 @@ void ZMQWTransmitter::close() {
 
 bool ZMQWTransmitter::send(void* data, size_t data_length) {
     auto ret = _send(data, data_length);
+    _record_send(data_length, ret.is_ok());
+    if (ret.is_err()) {
+        return _error.handle_error(ret.error());
+    }
+    return true;
+}
+
+bool ZMQWTransmitter::send_zero_copy(void* data, size_t num_bytes, zc_free_cb free_fn, void* hint) {
+    auto ret = _send_zero_copy(data, num_bytes, free_fn, hint);
+    _record_send(num_bytes, ret.is_ok());
     if (ret.is_err()) {
         return _error.handle_error(ret.error());
     }
     return true;
 }
 
+void ZMQWTransmitter::_record_send(size_t num_bytes, bool sent) {
+    if (sent) {
+        _tm_sent.add();
+        _tm_bytes.add(num_bytes);
+    } else {
+        _tm_failed.add();
+    }
+}
+
 VoidResult ZMQWTransmitter::_send(void* data, size_t num_bytes) {
     int rc;
     size_t min = 0;
-    if (_msg_buffer.is_full().value()) {
+    // get_slot returns null when exhausted, no need for a separate is_full() round trip
+    auto all_msg = _msg_buffer.get_slot();
+    if (!all_msg) {
         return Err(ErrorCode::MANAGE_BUFF_FULL, "messages buffer is full", Severity::LOW);
     }
-    auto all_msg = _msg_buffer.get_slot();
 
     // RAII cleanup
     auto buffer_cleanup = [this](decltype(all_msg)* msg_slot) { _msg_buffer.release_slot(msg_slot); };
     std::unique_ptr<decltype(all_msg), decltype(buffer_cleanup)> all_msg_ptr(&all_msg, buffer_cleanup);
 
-    if (!all_msg) {
-        WARN("Fail to allocate slot");
-        return Err(ErrorCode::MANAGE_BUFF_MONKEY, "IDK what happen :/", Severity::MEDIUM);
+    auto envelope_ret = _send_envelope();
+    if (envelope_ret.is_err()) {
+        return envelope_ret;
     }
 
+    size_t chunk = chunk_size_for(num_bytes);
+    do {
+        min = std::min(num_bytes, chunk);
+
+        zmq_msg_init_size(&all_msg->msg, min);
+        memcpy(zmq_msg_data(&all_msg->msg), data, min);
+        rc = zmq_msg_send(&all_msg->msg, _socket->get_socket(), (num_bytes > min) ? ZMQ_SNDMORE : 0);
+        if (rc == -1) {
+            zmq_msg_close(&all_msg->msg);
+            return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send chunk of data");
+        }
+        zmq_msg_close(&all_msg->msg);
+
+        data = static_cast<char*>(data) + min;
+        num_bytes -= min;
+    } while (num_bytes > 0);
+    return Ok();
+}
+
+bool ZMQWTransmitter::send_ipc(const ipc_hdr_t* hdr, const void* body) {
+    auto ret = _send_ipc(hdr, body);
+    _record_send(hdr ? ipc_hdr_frame_size(hdr) : 0, ret.is_ok());
+    if (ret.is_err()) {
+        return _error.handle_error(ret.error());
+    }
+    return true;
+}
+
+VoidResult ZMQWTransmitter::_send_ipc(const ipc_hdr_t* hdr, const void* body) {
+    if (!hdr || hdr->length > IPC_MAX_BODY_BYTES || (hdr->length && !body)) {
+        return Err(ErrorCode::FAIL_SEND_FRAME, "Invalid ipc header");
+    }
+
+    // The frame is built before the envelope goes out, a failure here must not leave half a multipart message
+    // Header and body are written straight into the frame, only length bytes of body are copied
+    zmq_msg_t msg;
+    size_t frame_size = ipc_hdr_frame_size(hdr);
+    if (zmq_msg_init_size(&msg, frame_size) == -1) {
+        return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to allocate ipc message");
+    }
+    if (ipc_encode(zmq_msg_data(&msg), frame_size, hdr, body) != frame_size) {
+        zmq_msg_close(&msg);
+        return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to encode ipc message");
+    }
+
+    auto envelope_ret = _send_envelope();
+    if (envelope_ret.is_err()) {
+        zmq_msg_close(&msg);
+        return envelope_ret;
+    }
+
+    if (hdr->flags & IPC_FLAG_TRACE) {
+        // Stamped last, encoding is not part of the trip
+        IpcTrace::stamp(zmq_msg_data(&msg), frame_size, IPC_HOP_SENT);
+    }
+    if (zmq_msg_send(&msg, _socket->get_socket(), 0) == -1) {
+        zmq_msg_close(&msg);
+        return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send ipc message");
+    }
+    return Ok();
+}
+
+VoidResult ZMQWTransmitter::_send_envelope() {
     // Ensure identity is valid
     if (_identity.empty()) {
         return Err(ErrorCode::INVALID_IDENTITY, "Identity is empty");
     }
-    // Send identity
-    memcpy(zmq_msg_data(&all_msg->identity), _identity.c_str(), _identity.size());
-    rc = zmq_msg_send(&all_msg->identity, _socket->get_socket(), ZMQ_SNDMORE);
-
+    // Send identity, zmq_send copies it so the frame size always matches the identity
+    int rc = zmq_send(_socket->get_socket(), _identity.c_str(), _identity.size(), ZMQ_SNDMORE);
     if (rc == -1) {
         return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send identity frame");
     }
 
     // Send empty
-    rc = zmq_msg_send(&all_msg->empty, _socket->get_socket(), ZMQ_SNDMORE);
+    rc = zmq_send(_socket->get_socket(), "", 0, ZMQ_SNDMORE);
     if (rc == -1) {
         return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send empty frame");
     }
+    return Ok();
+}
 
-    while (num_bytes > 0) {
-        min = std::min(num_bytes, static_cast<size_t>(DEFAULT_DATA_CHUNK));
+/**
+ * @brief Shared ownership of a zero-copy payload split into several frames,
+ * the user free_fn runs when the last frame is released by libzmq.
+ */
+struct ZeroCopyShare {
+    std::atomic<size_t> refs;
+    void* data;
+    zc_free_cb free_fn;
+    void* hint;
+};
 
-        zmq_msg_init_size(&all_msg->msg, min);
-        memcpy(zmq_msg_data(&all_msg->msg), data, min);
-        rc = zmq_msg_send(&all_msg->msg, _socket->get_socket(), (num_bytes > min) ? ZMQ_SNDMORE : 0);
-        DEBUG("Sent {} bytes", rc);
-        if (rc == -1) {
-            zmq_msg_close(&all_msg->msg);
-            return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send chunk of data");
+static void _zc_share_release(void* chunk, void* share_ptr) {
+    auto share = static_cast<ZeroCopyShare*>(share_ptr);
+    if (share->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        share->free_fn(share->data, share->hint);
+        delete share;
+    }
+}
+
+VoidResult ZMQWTransmitter::_send_zero_copy(void* data, size_t num_bytes, zc_free_cb free_fn, void* hint) {
+    zmq_msg_t msg;
+
+    auto envelope_ret = _send_envelope();
+    if (envelope_ret.is_err()) {
+        free_fn(data, hint);
+        return envelope_ret;
+    }
+
+    size_t chunk = chunk_size_for(num_bytes);
+    if (num_bytes <= chunk) {
+        // From here libzmq owns data and calls free_fn once the frame left the socket (or on close)
+        if (zmq_msg_init_data(&msg, data, num_bytes, free_fn, hint) == -1) {
+            free_fn(data, hint);
+            return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to wrap zero-copy data");
         }
-        zmq_msg_close(&all_msg->msg);
 
-        data = static_cast<char*>(data) + min;
+        if (zmq_msg_send(&msg, _socket->get_socket(), 0) == -1) {
+            zmq_msg_close(&msg);
+            return Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send zero-copy frame");
+        }
+        return Ok();
+    }
+
+    // Sender holds one reference so the payload can't be freed before the last frame is queued
+    auto share = new ZeroCopyShare{{1}, data, free_fn, hint};
+    auto cursor = static_cast<char*>(data);
+    VoidResult ret = Ok();
+
+    while (num_bytes > 0) {
+        size_t min = std::min(num_bytes, chunk);
+        share->refs.fetch_add(1, std::memory_order_relaxed);
+        if (zmq_msg_init_data(&msg, cursor, min, _zc_share_release, share) == -1) {
+            share->refs.fetch_sub(1, std::memory_order_relaxed);
+            ret = Err(ErrorCode::FAIL_SEND_FRAME, "Failed to wrap zero-copy data");
+            break;
+        }
+        if (zmq_msg_send(&msg, _socket->get_socket(), (num_bytes > min) ? ZMQ_SNDMORE : 0) == -1) {
+            zmq_msg_close(&msg);
+            ret = Err(ErrorCode::FAIL_SEND_FRAME, "Failed to send zero-copy chunk");
+            break;
+        }
+        cursor += min;
         num_bytes -= min;
     }
-    return Ok();
+
+    _zc_share_release(nullptr, share);
+    return ret;
+}
+
+void ZMQWTransmitter::set_chunk_policy(const ChunkPolicy& policy) {
+    _chunk_policy = policy;
+    if (_chunk_policy.chunk_size == 0) {
+        _chunk_policy.chunk_size = DEFAULT_DATA_CHUNK;
+    }
+    if (_chunk_policy.max_chunk == 0) {
+        _chunk_policy.max_chunk = DEFAULT_DATA_CHUNK;
+    }
+    _refresh_snd_hwm();
+}
+
+size_t ZMQWTransmitter::chunk_size_for(size_t num_bytes) const {
+    switch (_chunk_policy.mode) {
+        case ChunkMode::SINGLE_FRAME:
+            return std::max<size_t>(num_bytes, 1);
+        case ChunkMode::ADAPTIVE: {
+            if (num_bytes <= _chunk_policy.max_chunk) {
+                return std::max<size_t>(num_bytes, 1);
+            }
+            // Keep one message under half of the HWM so a single blob doesn't stall the pipe, HWM 0 is unlimited
+            size_t frame_budget = _snd_hwm > 0 ? std::max(1, _snd_hwm / 2) : SIZE_MAX;
+            size_t by_budget = (num_bytes + frame_budget - 1) / frame_budget;
+            return std::max(_chunk_policy.max_chunk, by_budget);
+        }
+        case ChunkMode::FIXED:
+        default:
+            return _chunk_policy.chunk_size;
+    }
+}
+
+void ZMQWTransmitter::_refresh_snd_hwm() {
+    int hwm = 0;
+    size_t hwm_size = sizeof(hwm);
+    if (zmq_getsockopt(_socket->get_socket(), ZMQ_SNDHWM, &hwm, &hwm_size) == 0) {
+        _snd_hwm = hwm;
+    }
 }
 
 bool ZMQWTransmitter::_handle_connect() {